@@ -0,0 +1,405 @@
+/*==========================================================================
+
+  a429_dict.c - Decode ARINC 429 words into engineering units using a
+    label dictionary
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+/*
+The dictionary is a text file with one line for each parameter
+
+  Bus  Label  SDI  Name  Encoding  Bits  Resolution  [Units]
+
+Bus is the Ch 10 429 bus number and label is in octal, the way labels are
+usually written. Bus and SDI can be "*" to match any. Encoding is BNR
+(two's complement with the sign in bit 29), UBNR (unsigned), BCD or DIS
+(discrete). For BNR and UBNR, Bits counts data bits from bit 28 down and
+Resolution is the value of the least significant one. For BCD, Bits is the
+number of digits from bit 29 down and Resolution is the value of the least
+significant digit. For DIS, Bits counts from bit 11 up. Anything after a
+'#' is a comment.
+
+The entries are compiled into a [bus][label][SDI] table indexed by the
+label field as it comes off the bus, so looking up a word needs no bit
+reversal. More specific entries win over ones with "*" for the bus or SDI.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "a429_dict.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define DICT_LINE_LEN       512
+#define A429_DATA_BITS      19          // Bits 11 through 29
+#define A429_BNR_BITS       18          // Bits 11 through 28
+#define A429_BCD_DIGITS     5
+#define A429_TABLE_SIZE     (A429_DICT_NUM_LABELS * A429_DICT_NUM_SDIS)
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static int          bParseBusSdi(const char * szValue, int32_t * piValue, int32_t iMax);
+static uint16_t   * pauNewTable(const uint16_t * pauCopy);
+static unsigned int uReverseLabel(unsigned int uLabel);
+static char       * pchDecodeBnr(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText);
+static char       * pchDecodeBcd(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText);
+static char       * pchDecodeDiscrete(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText);
+
+
+/* ======================================================================== */
+
+void vA429Dict_Init(SuA429Dict * psuDict)
+    {
+    memset(psuDict, 0, sizeof(SuA429Dict));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the dictionary file. Lines that can't be understood are reported
+// and skipped.
+
+EnI106Status enA429Dict_Load(SuA429Dict * psuDict, const char * szFileName)
+    {
+    FILE              * psuDictFile;
+    char                szLine[DICT_LINE_LEN];
+    char                szBus[16];
+    char                szSDI[16];
+    char                szEncoding[16];
+    char              * pchComment;
+    int                 iLineNum;
+    int                 iFields;
+    SuA429Param         suParam;
+
+    psuDictFile = fopen(szFileName, "r");
+    if (psuDictFile == NULL)
+        return I106_OPEN_ERROR;
+
+    iLineNum = 0;
+    while (fgets(szLine, sizeof(szLine), psuDictFile) != NULL)
+        {
+        iLineNum++;
+        pchComment = strchr(szLine, '#');
+        if (pchComment != NULL)
+            *pchComment = '\0';
+
+        memset(&suParam, 0, sizeof(suParam));
+        iFields = sscanf(szLine, "%15s %o %15s %63s %15s %u %lf %15s", szBus, &suParam.uLabel, szSDI, 
+                         suParam.szName, szEncoding, &suParam.uBits, &suParam.dResolution, suParam.szUnits);
+        if (iFields <= 0)
+            continue;
+
+        if      (strcasecmp(szEncoding, "BNR")  == 0) suParam.uEncoding = A429_ENC_BNR;
+        else if (strcasecmp(szEncoding, "UBNR") == 0) suParam.uEncoding = A429_ENC_UBNR;
+        else if (strcasecmp(szEncoding, "BCD")  == 0) suParam.uEncoding = A429_ENC_BCD;
+        else if (strcasecmp(szEncoding, "DIS")  == 0) suParam.uEncoding = A429_ENC_DISCRETE;
+        else iFields = 0;
+
+        if ((iFields < 7) || (suParam.uLabel >= A429_DICT_NUM_LABELS) ||
+            !bParseBusSdi(szBus, &suParam.iBus, A429_DICT_NUM_BUSES) ||
+            !bParseBusSdi(szSDI, &suParam.iSDI, A429_DICT_NUM_SDIS) ||
+            (suParam.uBits == 0) ||
+            ((suParam.uEncoding == A429_ENC_BCD) ? (suParam.uBits > A429_BCD_DIGITS) : 
+             (suParam.uBits > ((suParam.uEncoding == A429_ENC_DISCRETE) ? A429_DATA_BITS : A429_BNR_BITS))))
+            {
+            fprintf(stderr, "Dictionary line %d not understood\n", iLineNum);
+            continue;
+            }
+
+        psuDict->pasuParams = (SuA429Param *)realloc(psuDict->pasuParams, 
+                                                     (psuDict->uNumParams + 1) * sizeof(SuA429Param));
+        if (psuDict->pasuParams == NULL)
+            {
+            fclose(psuDictFile);
+            return I106_BUFFER_TOO_SMALL;
+            }
+        psuDict->pasuParams[psuDict->uNumParams++] = suParam;
+        } // end while reading lines
+
+    fclose(psuDictFile);
+
+    if (psuDict->uNumParams == 0)
+        return I106_INVALID_DATA;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Work out the decode function, shift and masks for each entry and fill in
+// the bus tables. Tables are filled least specific first so more specific
+// entries overwrite them.
+
+EnI106Status enA429Dict_Compile(SuA429Dict * psuDict)
+    {
+    SuA429Param       * psuParam;
+    uint16_t          * pauTable;
+    uint32_t            uParamIdx;
+    unsigned int        uBus;
+    int                 iPass;
+    int                 iSDI;
+    unsigned int        uTableIdx;
+
+    for (uParamIdx=0; uParamIdx<psuDict->uNumParams; uParamIdx++)
+        {
+        psuParam = &psuDict->pasuParams[uParamIdx];
+        switch (psuParam->uEncoding)
+            {
+            case A429_ENC_BNR :
+            case A429_ENC_UBNR :
+                psuParam->pfDecode  = pchDecodeBnr;
+                psuParam->uShift    = A429_BNR_BITS - psuParam->uBits;
+                psuParam->ulMask    = (1UL << psuParam->uBits) - 1;
+                if (psuParam->uEncoding == A429_ENC_BNR)
+                    {
+                    psuParam->ulSignBit = 1UL << psuParam->uBits;
+                    psuParam->ulMask   |= psuParam->ulSignBit;
+                    }
+                break;
+            case A429_ENC_BCD :
+                psuParam->pfDecode  = pchDecodeBcd;
+                break;
+            default :
+                psuParam->pfDecode  = pchDecodeDiscrete;
+                psuParam->ulMask    = (1UL << psuParam->uBits) - 1;
+                break;
+            }
+        } // end for all params
+
+    // Pass 0 any bus and SDI, 1 any bus, 2 any SDI, 3 exact
+    for (iPass=0; iPass<4; iPass++)
+        {
+        for (uParamIdx=0; uParamIdx<psuDict->uNumParams; uParamIdx++)
+            {
+            psuParam = &psuDict->pasuParams[uParamIdx];
+            if (((psuParam->iBus != A429_DICT_ANY) != (iPass >= 2)) ||
+                ((psuParam->iSDI != A429_DICT_ANY) != ((iPass & 1) != 0)))
+                continue;
+
+            // Find or make the table
+            if (psuParam->iBus == A429_DICT_ANY)
+                {
+                if (psuDict->pauAnyBus == NULL)
+                    psuDict->pauAnyBus = pauNewTable(NULL);
+                pauTable = psuDict->pauAnyBus;
+                }
+            else
+                {
+                if (psuDict->apauBus[psuParam->iBus] == NULL)
+                    psuDict->apauBus[psuParam->iBus] = pauNewTable(psuDict->pauAnyBus);
+                pauTable = psuDict->apauBus[psuParam->iBus];
+                }
+            if (pauTable == NULL)
+                return I106_BUFFER_TOO_SMALL;
+
+            uTableIdx = uReverseLabel(psuParam->uLabel) * A429_DICT_NUM_SDIS;
+            for (iSDI=0; iSDI<A429_DICT_NUM_SDIS; iSDI++)
+                if ((psuParam->iSDI == A429_DICT_ANY) || (psuParam->iSDI == iSDI))
+                    pauTable[uTableIdx + iSDI] = (uint16_t)(uParamIdx + 1);
+            } // end for all params
+        } // end for all passes
+
+    // The rest of the buses use the any bus table
+    for (uBus=0; uBus<A429_DICT_NUM_BUSES; uBus++)
+        if (psuDict->apauBus[uBus] == NULL)
+            psuDict->apauBus[uBus] = psuDict->pauAnyBus;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The dictionary entry for a word, NULL if there isn't one. uLabelField is
+// the label as it is in the 429 word, bit reversed.
+
+SuA429Param * psuA429Dict_Find(SuA429Dict * psuDict, unsigned int uBus, unsigned int uLabelField, unsigned int uSDI)
+    {
+    uint16_t          * pauTable;
+    uint16_t            uParamIdx;
+
+    pauTable = psuDict->apauBus[uBus & (A429_DICT_NUM_BUSES - 1)];
+    if (pauTable == NULL)
+        return NULL;
+
+    uParamIdx = pauTable[(uLabelField & (A429_DICT_NUM_LABELS - 1)) * A429_DICT_NUM_SDIS + (uSDI & 0x03)];
+    if (uParamIdx == 0)
+        return NULL;
+
+    return &psuDict->pasuParams[uParamIdx - 1];
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vA429Dict_Free(SuA429Dict * psuDict)
+    {
+    unsigned int        uBus;
+
+    for (uBus=0; uBus<A429_DICT_NUM_BUSES; uBus++)
+        if (psuDict->apauBus[uBus] != psuDict->pauAnyBus)
+            free(psuDict->apauBus[uBus]);
+    free(psuDict->pauAnyBus);
+    free(psuDict->pasuParams);
+    vA429Dict_Init(psuDict);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// A bus or SDI number, or "*" for any
+
+static int bParseBusSdi(const char * szValue, int32_t * piValue, int32_t iMax)
+    {
+    if (strcmp(szValue, "*") == 0)
+        {
+        *piValue = A429_DICT_ANY;
+        return bTRUE;
+        }
+
+    if (sscanf(szValue, "%d", piValue) != 1)
+        return bFALSE;
+
+    return (*piValue >= 0) && (*piValue < iMax);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static uint16_t * pauNewTable(const uint16_t * pauCopy)
+    {
+    uint16_t          * pauTable;
+
+    pauTable = (uint16_t *)calloc(A429_TABLE_SIZE, sizeof(uint16_t));
+    if ((pauTable != NULL) && (pauCopy != NULL))
+        memcpy(pauTable, pauCopy, A429_TABLE_SIZE * sizeof(uint16_t));
+
+    return pauTable;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static unsigned int uReverseLabel(unsigned int uLabel)
+    {
+    unsigned int        uRLabel;
+    int                 iBitIdx;
+
+    uRLabel = 0;
+    for (iBitIdx=0; iBitIdx<8; iBitIdx++)
+        {
+        uRLabel <<= 1;
+        uRLabel  |= uLabel & 0x01;
+        uLabel  >>= 1;
+        }
+
+    return uRLabel;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static char * pchDecodeBnr(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText)
+    {
+    uint32_t            ulRaw;
+    int32_t             lValue;
+
+    (void)uSSM;
+    ulRaw  = (uData >> psuParam->uShift) & psuParam->ulMask;
+    lValue = (int32_t)(ulRaw ^ psuParam->ulSignBit) - (int32_t)psuParam->ulSignBit;
+
+    return pchText + sprintf(pchText, "%.10g", lValue * psuParam->dResolution);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The most significant digit is bits 27-29, then 4 bit digits down to bit 11
+
+static char * pchDecodeBcd(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText)
+    {
+    uint32_t            ulValue;
+    uint32_t            uDigitIdx;
+    int                 iShift;
+
+    ulValue = (uData >> (A429_DATA_BITS - 3)) & 0x07;
+    iShift  = A429_DATA_BITS - 3;
+    for (uDigitIdx=1; uDigitIdx<psuParam->uBits; uDigitIdx++)
+        {
+        iShift -= 4;
+        ulValue = ulValue * 10 + ((uData >> iShift) & 0x0f);
+        }
+
+    return pchText + sprintf(pchText, "%.10g", (uSSM == 3 ? -1.0 : 1.0) * ulValue * psuParam->dResolution);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static char * pchDecodeDiscrete(const SuA429Param * psuParam, uint32_t uData, uint32_t uSSM, char * pchText)
+    {
+    (void)uSSM;
+    return pchText + sprintf(pchText, "0x%5.5x", uData & psuParam->ulMask);
+    }
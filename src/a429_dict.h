@@ -0,0 +1,116 @@
+/*==========================================================================
+
+  a429_dict.h - Decode ARINC 429 words into engineering units using a
+    label dictionary
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _A429_DICT_H
+#define _A429_DICT_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define A429_DICT_MAX_NAME      64
+#define A429_DICT_MAX_UNITS     16
+#define A429_DICT_ANY           -1          // "*" for bus or SDI
+#define A429_DICT_NUM_BUSES     0x100
+#define A429_DICT_NUM_LABELS    0x100
+#define A429_DICT_NUM_SDIS      4
+
+typedef enum
+    {
+    A429_ENC_BNR            = 0,            // Two's complement, sign in bit 29
+    A429_ENC_UBNR           = 1,            // Unsigned binary
+    A429_ENC_BCD            = 2,            // Digits, SSM 3 is minus
+    A429_ENC_DISCRETE       = 3,            // Bits from bit 11 up, as hex
+    } EnA429Encoding;
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+struct SuA429Param_S;
+
+// Decode the 19 data bits and SSM of a word into text, returns the end of the text
+typedef char * (*PFA429Decode)(const struct SuA429Param_S * psuParam, uint32_t uData, uint32_t uSSM, char * pchText);
+
+// One dictionary entry
+typedef struct SuA429Param_S
+    {
+    int32_t             iBus;               // A429_DICT_ANY for all buses
+    uint32_t            uLabel;             // Octal label as written, not bit reversed
+    int32_t             iSDI;               // A429_DICT_ANY for all SDIs
+    char                szName[A429_DICT_MAX_NAME];
+    char                szUnits[A429_DICT_MAX_UNITS];
+    uint32_t            uEncoding;          // EnA429Encoding
+    uint32_t            uBits;              // Data bits, or BCD digits
+    double              dResolution;        // Value of the LSB or least significant digit
+    PFA429Decode        pfDecode;
+    uint32_t            uShift;             // Shift and mask for the data bits
+    uint32_t            ulMask;
+    uint32_t            ulSignBit;          // Already shifted down, 0 if unsigned
+    } SuA429Param;
+
+// A dense lookup table for each bus. Buses without their own entries
+// share the table for entries on any bus.
+typedef struct
+    {
+    uint32_t            uNumParams;
+    SuA429Param       * pasuParams;
+    uint16_t          * pauAnyBus;          // Param index + 1, 0 for none
+    uint16_t          * apauBus[A429_DICT_NUM_BUSES];
+    } SuA429Dict;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vA429Dict_Init(SuA429Dict * psuDict);
+EnI106Status    enA429Dict_Load(SuA429Dict * psuDict, const char * szFileName);
+EnI106Status    enA429Dict_Compile(SuA429Dict * psuDict);
+SuA429Param   * psuA429Dict_Find(SuA429Dict * psuDict, unsigned int uBus, unsigned int uLabelField, unsigned int uSDI);
+void            vA429Dict_Free(SuA429Dict * psuDict);
+
+#endif
@@ -0,0 +1,673 @@
+/*==========================================================================
+
+  can_dbc.c - Decode CAN signals using a plan made from a DBC file
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+/*
+A DBC file lists the messages on a CAN bus (BO_ lines) and the signals in
+each one (SG_ lines under them). A signal is a run of bits at a start bit
+with a byte order, signedness, scale and offset. Only the parts of the
+file needed to get engineering values out are read. Value tables,
+comments, attributes and the rest are skipped.
+
+Requested signals are compiled once into a list of taps for each CAN ID,
+found with a hash table. The up to 8 data bytes of a frame are read as a
+little endian and a big endian 64 bit word, so every tap is then a shift
+and a mask of one of the two words, a sign extension and a scale. Intel
+start bits count up from the LSB of byte 0. Motorola start bits give the
+MSB of the signal in the same numbering, with the signal running toward
+later bytes.
+
+Simple multiplexing is supported. The multiplexor switch (M) is read
+first and signals marked mN are only decoded when it equals N.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "can_dbc.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define DBC_LINE_LEN        4096
+#define COLUMN_TEXT_LEN     24          // ',' and the longest value
+#define CAN_DBC_MAX_BYTES   8
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static EnI106Status enParseMessage(SuCanDbc * psuDbc, const char * szLine);
+static EnI106Status enParseSignal(SuCanDbc * psuDbc, const char * szLine);
+static void         vParseValType(SuCanDbc * psuDbc, const char * szLine);
+static int          bMatchSignal(SuCanDbc * psuDbc, uint32_t uSigIdx, const char * szName);
+static int          bGetBits(SuCanDbcSignal * psuSignal, SuCanDbcBits * psuBits);
+static int          iComparePlanTaps(const void * pvTap1, const void * pvTap2);
+static uint32_t     uHashCanID(uint32_t uCanID);
+
+
+/* ======================================================================== */
+
+void vCanDbc_Init(SuCanDbc * psuDbc)
+    {
+    memset(psuDbc, 0, sizeof(SuCanDbc));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the messages and signals from a DBC file
+
+EnI106Status enCanDbc_Load(SuCanDbc * psuDbc, const char * szFileName)
+    {
+    EnI106Status        enStatus;
+    FILE              * psuDbcFile;
+    char                szLine[DBC_LINE_LEN];
+    char              * pchLine;
+    int                 bInMessage;
+    int                 bLongLine;
+
+    psuDbcFile = fopen(szFileName, "r");
+    if (psuDbcFile == NULL)
+        return I106_OPEN_ERROR;
+
+    enStatus   = I106_OK;
+    bInMessage = bFALSE;
+    bLongLine  = bFALSE;
+    while ((enStatus == I106_OK) && (fgets(szLine, sizeof(szLine), psuDbcFile) != NULL))
+        {
+        // Skip the rest of lines too long for the buffer, only long
+        // comments and value tables should be that long
+        if (bLongLine)
+            {
+            bLongLine = strchr(szLine, '\n') == NULL;
+            continue;
+            }
+        bLongLine = strchr(szLine, '\n') == NULL;
+
+        pchLine = szLine;
+        while ((*pchLine == ' ') || (*pchLine == '\t'))
+            pchLine++;
+
+        // Signals belong to the message above them
+        if ((strncmp(pchLine, "SG_ ", 4) == 0) && bInMessage)
+            enStatus = enParseSignal(psuDbc, pchLine + 4);
+
+        else if (strncmp(pchLine, "BO_ ", 4) == 0)
+            {
+            enStatus   = enParseMessage(psuDbc, pchLine + 4);
+            bInMessage = bTRUE;
+            }
+
+        else
+            {
+            bInMessage = bFALSE;
+            if (strncmp(pchLine, "SIG_VALTYPE_ ", 13) == 0)
+                vParseValType(psuDbc, pchLine + 13);
+            }
+        } // end while reading lines
+
+    fclose(psuDbcFile);
+
+    if ((enStatus == I106_OK) && (psuDbc->uNumSignals == 0))
+        enStatus = I106_INVALID_DATA;
+
+    return enStatus;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make the extraction plans. Columns are numbered by the order of aszNames,
+// each a signal name or a message.signal name. A plain signal name takes
+// that signal from every message that has it. With no names every signal
+// gets a column in DBC file order.
+
+EnI106Status enCanDbc_Compile(SuCanDbc * psuDbc, const char * const aszNames[], unsigned int uNumNames)
+    {
+    SuCanDbcSignal    * psuSignal;
+    SuCanDbcSignal    * psuMuxSignal;
+    SuCanDbcTap       * pasuMsgTaps;
+    SuCanDbcTap         suTap;
+    SuCanDbcPlan      * psuPlan;
+    uint32_t            uMsgIdx;
+    uint32_t            uSigIdx;
+    uint32_t            uColumn;
+    uint32_t            uNumMsgTaps;
+    uint32_t            uTapIdx;
+    uint32_t            uHashIdx;
+
+    psuDbc->uNumColumns     = (uNumNames == 0) ? psuDbc->uNumSignals : uNumNames;
+    psuDbc->paiColumnSignal = (int32_t *)malloc(psuDbc->uNumColumns * sizeof(int32_t));
+    psuDbc->pasuPlans       = (SuCanDbcPlan *)calloc(psuDbc->uNumMessages + 1, sizeof(SuCanDbcPlan));
+    pasuMsgTaps             = (SuCanDbcTap *)malloc((psuDbc->uNumColumns + 1) * sizeof(SuCanDbcTap));
+    if ((psuDbc->paiColumnSignal == NULL) || (psuDbc->pasuPlans == NULL) || (pasuMsgTaps == NULL))
+        {
+        free(pasuMsgTaps);
+        return I106_BUFFER_TOO_SMALL;
+        }
+
+    for (uColumn=0; uColumn<psuDbc->uNumColumns; uColumn++)
+        psuDbc->paiColumnSignal[uColumn] = (uNumNames == 0) ? (int32_t)uColumn : -1;
+
+    // Go through the messages, making a plan for each one with requested signals
+    for (uMsgIdx=0; uMsgIdx<psuDbc->uNumMessages; uMsgIdx++)
+        {
+        uNumMsgTaps  = 0;
+        psuMuxSignal = NULL;
+        for (uSigIdx=0; uSigIdx<psuDbc->uNumSignals; uSigIdx++)
+            {
+            psuSignal = &psuDbc->pasuSignals[uSigIdx];
+            if (psuSignal->uMessage != uMsgIdx)
+                continue;
+            if (psuSignal->bMuxSwitch)
+                psuMuxSignal = psuSignal;
+
+            memset(&suTap, 0, sizeof(suTap));
+            if (bGetBits(psuSignal, &suTap.suBits) == bFALSE)
+                {
+                fprintf(stderr, "Signal %s.%s doesn't fit in %d bytes\n", 
+                    psuDbc->pasuMessages[uMsgIdx].szName, psuSignal->szName, CAN_DBC_MAX_BYTES);
+                continue;
+                }
+            if (psuSignal->bSigned && (psuSignal->uValType == CAN_DBC_VAL_INTEGER))
+                suTap.ullSignBit = 1ULL << (psuSignal->uBits - 1);
+            suTap.uValType  = psuSignal->uValType;
+            suTap.iMuxValue = psuSignal->iMuxValue;
+            suTap.dScale    = psuSignal->dScale;
+            suTap.dOffset   = psuSignal->dOffset;
+            suTap.bInteger  = (psuSignal->uValType == CAN_DBC_VAL_INTEGER) &&
+                              (floor(psuSignal->dScale)  == psuSignal->dScale) &&
+                              (floor(psuSignal->dOffset) == psuSignal->dOffset);
+
+            // A tap for each column that wants this signal
+            for (uColumn=0; uColumn<psuDbc->uNumColumns; uColumn++)
+                {
+                if (uNumNames == 0)
+                    {
+                    if (uColumn != uSigIdx)
+                        continue;
+                    }
+                else if (bMatchSignal(psuDbc, uSigIdx, aszNames[uColumn]) == bFALSE)
+                    continue;
+
+                // Signal names should be unique in a message but check
+                for (uTapIdx=0; uTapIdx<uNumMsgTaps; uTapIdx++)
+                    if (pasuMsgTaps[uTapIdx].uColumn == uColumn)
+                        break;
+                if (uTapIdx < uNumMsgTaps)
+                    continue;
+
+                if (psuDbc->paiColumnSignal[uColumn] < 0)
+                    psuDbc->paiColumnSignal[uColumn] = (int32_t)uSigIdx;
+                suTap.uColumn = uColumn;
+                pasuMsgTaps[uNumMsgTaps++] = suTap;
+                }
+            } // end for all signals
+
+        if (uNumMsgTaps == 0)
+            continue;
+
+        // Taps in column order so a row can be written in one pass
+        qsort(pasuMsgTaps, uNumMsgTaps, sizeof(SuCanDbcTap), iComparePlanTaps);
+
+        psuDbc->pasuTaps = (SuCanDbcTap *)realloc(psuDbc->pasuTaps, 
+                                                  (psuDbc->uNumTaps + uNumMsgTaps) * sizeof(SuCanDbcTap));
+        if (psuDbc->pasuTaps == NULL)
+            {
+            free(pasuMsgTaps);
+            return I106_BUFFER_TOO_SMALL;
+            }
+        memcpy(&psuDbc->pasuTaps[psuDbc->uNumTaps], pasuMsgTaps, uNumMsgTaps * sizeof(SuCanDbcTap));
+
+        psuPlan = &psuDbc->pasuPlans[psuDbc->uNumPlans++];
+        psuPlan->uCanID    = psuDbc->pasuMessages[uMsgIdx].uCanID;
+        psuPlan->uFirstTap = psuDbc->uNumTaps;
+        psuPlan->uNumTaps  = uNumMsgTaps;
+        psuPlan->bHaveMux  = (psuMuxSignal != NULL) && bGetBits(psuMuxSignal, &psuPlan->suMux);
+        psuDbc->uNumTaps  += uNumMsgTaps;
+        if (uNumMsgTaps > psuDbc->uMaxTaps)
+            psuDbc->uMaxTaps = uNumMsgTaps;
+
+        // Without a switch multiplexed signals are always there
+        if (psuPlan->bHaveMux == bFALSE)
+            for (uTapIdx=0; uTapIdx<uNumMsgTaps; uTapIdx++)
+                psuDbc->pasuTaps[psuPlan->uFirstTap + uTapIdx].iMuxValue = -1;
+        } // end for all messages
+
+    free(pasuMsgTaps);
+
+    // Hash the plans by CAN ID, at most half full
+    psuDbc->uHashSize = 16;
+    while (psuDbc->uHashSize < psuDbc->uNumPlans * 2)
+        psuDbc->uHashSize *= 2;
+    psuDbc->pauHash = (uint32_t *)calloc(psuDbc->uHashSize, sizeof(uint32_t));
+    if (psuDbc->pauHash == NULL)
+        return I106_BUFFER_TOO_SMALL;
+
+    for (uMsgIdx=0; uMsgIdx<psuDbc->uNumPlans; uMsgIdx++)
+        {
+        uHashIdx = uHashCanID(psuDbc->pasuPlans[uMsgIdx].uCanID) & (psuDbc->uHashSize - 1);
+        while (psuDbc->pauHash[uHashIdx] != 0)
+            uHashIdx = (uHashIdx + 1) & (psuDbc->uHashSize - 1);
+        psuDbc->pauHash[uHashIdx] = uMsgIdx + 1;
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The plan for a CAN ID, NULL if it has no requested signals. Extended IDs
+// have CAN_DBC_ID_EXTENDED set, the same as in the DBC file.
+
+SuCanDbcPlan * psuCanDbc_FindPlan(SuCanDbc * psuDbc, uint32_t uCanID)
+    {
+    SuCanDbcPlan      * psuPlan;
+    uint32_t            uHashIdx;
+
+    if (psuDbc->pauHash == NULL)
+        return NULL;
+
+    uHashIdx = uHashCanID(uCanID) & (psuDbc->uHashSize - 1);
+    while (psuDbc->pauHash[uHashIdx] != 0)
+        {
+        psuPlan = &psuDbc->pasuPlans[psuDbc->pauHash[uHashIdx] - 1];
+        if (psuPlan->uCanID == uCanID)
+            return psuPlan;
+        uHashIdx = (uHashIdx + 1) & (psuDbc->uHashSize - 1);
+        }
+
+    return NULL;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Longest text pchCanDbc_Row() can write, with the terminating null
+
+uint32_t ulCanDbc_RowLen(SuCanDbc * psuDbc)
+    {
+    return psuDbc->uNumColumns + psuDbc->uMaxTaps * COLUMN_TEXT_LEN + 2;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Write ",value" for every column, empty for columns not in this message,
+// and a new line. Returns the end of the text.
+
+char * pchCanDbc_Row(SuCanDbc * psuDbc, SuCanDbcPlan * psuPlan, const uint8_t * pauData, 
+                     unsigned int uLength, char * pchText)
+    {
+    SuCanDbcTap       * psuTap;
+    SuCanDbcTap       * psuLastTap;
+    uint8_t             abyData[CAN_DBC_MAX_BYTES];
+    uint64_t            aullWord[2];
+    uint64_t            ullRaw;
+    int64_t             llRaw;
+    int32_t             iMuxValue;
+    uint32_t            uNextColumn;
+    uint32_t            uByteIdx;
+    int                 iDigits;
+    float               fValue;
+    double              dValue;
+
+    // Both byte orders of the data, zero filled
+    if (uLength > CAN_DBC_MAX_BYTES)
+        uLength = CAN_DBC_MAX_BYTES;
+    memset(abyData, 0, sizeof(abyData));
+    memcpy(abyData, pauData, uLength);
+    aullWord[CAN_DBC_ORDER_INTEL]    = 0;
+    aullWord[CAN_DBC_ORDER_MOTOROLA] = 0;
+    for (uByteIdx=0; uByteIdx<CAN_DBC_MAX_BYTES; uByteIdx++)
+        {
+        aullWord[CAN_DBC_ORDER_INTEL]    |= (uint64_t)abyData[uByteIdx] << (uByteIdx * 8);
+        aullWord[CAN_DBC_ORDER_MOTOROLA]  = (aullWord[CAN_DBC_ORDER_MOTOROLA] << 8) | abyData[uByteIdx];
+        }
+
+    iMuxValue = -1;
+    if (psuPlan->bHaveMux && (uLength >= psuPlan->suMux.uBytes))
+        iMuxValue = (int32_t)((aullWord[psuPlan->suMux.uOrder] >> psuPlan->suMux.uShift) & psuPlan->suMux.ullMask);
+
+    uNextColumn = 0;
+    psuTap      = &psuDbc->pasuTaps[psuPlan->uFirstTap];
+    psuLastTap  = psuTap + psuPlan->uNumTaps;
+    for (; psuTap<psuLastTap; psuTap++)
+        {
+        // Commas for the columns in between
+        memset(pchText, ',', psuTap->uColumn - uNextColumn + 1);
+        pchText    += psuTap->uColumn - uNextColumn + 1;
+        uNextColumn = psuTap->uColumn + 1;
+
+        // Leave it empty if it isn't in this frame
+        if ((uLength < psuTap->suBits.uBytes) || 
+            ((psuTap->iMuxValue >= 0) && (psuTap->iMuxValue != iMuxValue)))
+            continue;
+
+        ullRaw = (aullWord[psuTap->suBits.uOrder] >> psuTap->suBits.uShift) & psuTap->suBits.ullMask;
+        switch (psuTap->uValType)
+            {
+            case CAN_DBC_VAL_FLOAT :
+                {
+                uint32_t    ulRaw = (uint32_t)ullRaw;
+                memcpy(&fValue, &ulRaw, sizeof(fValue));
+                dValue = fValue;
+                }
+                break;
+            case CAN_DBC_VAL_DOUBLE :
+                memcpy(&dValue, &ullRaw, sizeof(dValue));
+                break;
+            default :
+                if (psuTap->ullSignBit != 0)
+                    {
+                    llRaw  = (int64_t)((ullRaw ^ psuTap->ullSignBit) - psuTap->ullSignBit);
+                    dValue = (double)llRaw;
+                    }
+                else
+                    dValue = (double)ullRaw;
+                break;
+            }
+        dValue = dValue * psuTap->dScale + psuTap->dOffset;
+
+        // Whole numbers too big to print in full fall back to %g, and the
+        // text is kept to the column budget either way
+        if (psuTap->bInteger && (fabs(dValue) < 1e15))
+            iDigits = snprintf(pchText, COLUMN_TEXT_LEN - 1, "%.0f", dValue);
+        else
+            iDigits = snprintf(pchText, COLUMN_TEXT_LEN - 1, "%.10g", dValue);
+        if ((iDigits < 0) || (iDigits >= COLUMN_TEXT_LEN - 1))
+            iDigits = (int)strlen(pchText);
+        pchText += iDigits;
+        } // end for all taps
+
+    memset(pchText, ',', psuDbc->uNumColumns - uNextColumn);
+    pchText   += psuDbc->uNumColumns - uNextColumn;
+    *pchText++ = '\n';
+    *pchText   = '\0';
+
+    return pchText;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vCanDbc_Free(SuCanDbc * psuDbc)
+    {
+    free(psuDbc->pasuMessages);
+    free(psuDbc->pasuSignals);
+    free(psuDbc->paiColumnSignal);
+    free(psuDbc->pasuPlans);
+    free(psuDbc->pasuTaps);
+    free(psuDbc->pauHash);
+    vCanDbc_Init(psuDbc);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// BO_ <ID> <Name>: <Length> <Transmitter>
+
+static EnI106Status enParseMessage(SuCanDbc * psuDbc, const char * szLine)
+    {
+    SuCanDbcMessage   * psuMessage;
+    unsigned long       ulCanID;
+    unsigned int        uLength;
+    char                szName[CAN_DBC_MAX_NAME];
+
+    if (sscanf(szLine, "%lu %127[^: \t] : %u", &ulCanID, szName, &uLength) != 3)
+        return I106_OK;
+
+    psuDbc->pasuMessages = (SuCanDbcMessage *)realloc(psuDbc->pasuMessages, 
+                                                      (psuDbc->uNumMessages + 1) * sizeof(SuCanDbcMessage));
+    if (psuDbc->pasuMessages == NULL)
+        return I106_BUFFER_TOO_SMALL;
+
+    psuMessage = &psuDbc->pasuMessages[psuDbc->uNumMessages++];
+    psuMessage->uCanID  = (uint32_t)ulCanID;
+    psuMessage->uLength = uLength;
+    strcpy(psuMessage->szName, szName);
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// SG_ <Name> [M|mN] : <Start>|<Bits>@<Order><Sign> (<Scale>,<Offset>) [<Min>|<Max>] "<Units>" <Receivers>
+
+static EnI106Status enParseSignal(SuCanDbc * psuDbc, const char * szLine)
+    {
+    SuCanDbcSignal      suSignal;
+    char                szMux[CAN_DBC_MAX_NAME];
+    char                chOrder;
+    char                chSign;
+    int                 iChars;
+    const char        * pchQuote;
+    size_t              uUnitsLen;
+
+    memset(&suSignal, 0, sizeof(suSignal));
+    suSignal.iMuxValue = -1;
+
+    // Name and the multiplexor indicator if there is one
+    if (sscanf(szLine, "%127[^: \t] %n", suSignal.szName, &iChars) != 1)
+        return I106_OK;
+    szLine += iChars;
+    if (*szLine != ':')
+        {
+        if (sscanf(szLine, "%127[^: \t] %n", szMux, &iChars) != 1)
+            return I106_OK;
+        szLine += iChars;
+        if (strcmp(szMux, "M") == 0)
+            suSignal.bMuxSwitch = bTRUE;
+        else if (szMux[0] == 'm')
+            suSignal.iMuxValue = atoi(&szMux[1]);
+        }
+
+    if (sscanf(szLine, ": %u|%u@%c%c (%lf,%lf)", &suSignal.uStartBit, &suSignal.uBits,
+               &chOrder, &chSign, &suSignal.dScale, &suSignal.dOffset) != 6)
+        return I106_OK;
+    if ((suSignal.uBits == 0) || (suSignal.uBits > 64))
+        return I106_OK;
+    suSignal.uOrder  = (chOrder == '0') ? CAN_DBC_ORDER_MOTOROLA : CAN_DBC_ORDER_INTEL;
+    suSignal.bSigned = (chSign == '-');
+
+    // Units are in quotes after the range
+    pchQuote = strchr(szLine, '"');
+    if (pchQuote != NULL)
+        {
+        pchQuote++;
+        uUnitsLen = strcspn(pchQuote, "\"");
+        if (uUnitsLen >= CAN_DBC_MAX_UNITS)
+            uUnitsLen = CAN_DBC_MAX_UNITS - 1;
+        memcpy(suSignal.szUnits, pchQuote, uUnitsLen);
+        suSignal.szUnits[uUnitsLen] = '\0';
+        }
+
+    psuDbc->pasuSignals = (SuCanDbcSignal *)realloc(psuDbc->pasuSignals, 
+                                                    (psuDbc->uNumSignals + 1) * sizeof(SuCanDbcSignal));
+    if (psuDbc->pasuSignals == NULL)
+        return I106_BUFFER_TOO_SMALL;
+
+    suSignal.uMessage = psuDbc->uNumMessages - 1;
+    psuDbc->pasuSignals[psuDbc->uNumSignals++] = suSignal;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// SIG_VALTYPE_ <ID> <Name> : <1 for float, 2 for double>;
+
+static void vParseValType(SuCanDbc * psuDbc, const char * szLine)
+    {
+    SuCanDbcSignal    * psuSignal;
+    unsigned long       ulCanID;
+    unsigned int        uValType;
+    char                szName[CAN_DBC_MAX_NAME];
+    uint32_t            uSigIdx;
+
+    if (sscanf(szLine, "%lu %127s : %u", &ulCanID, szName, &uValType) != 3)
+        return;
+
+    for (uSigIdx=0; uSigIdx<psuDbc->uNumSignals; uSigIdx++)
+        {
+        psuSignal = &psuDbc->pasuSignals[uSigIdx];
+        if ((psuDbc->pasuMessages[psuSignal->uMessage].uCanID == (uint32_t)ulCanID) &&
+            (strcmp(psuSignal->szName, szName) == 0))
+            {
+            // Only whole words can be floats
+            if (((uValType == CAN_DBC_VAL_FLOAT) && (psuSignal->uBits == 32)) ||
+                ((uValType == CAN_DBC_VAL_DOUBLE) && (psuSignal->uBits == 64)))
+                psuSignal->uValType = uValType;
+            break;
+            }
+        }
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// See if a requested name, "Signal" or "Message.Signal", is this signal
+
+static int bMatchSignal(SuCanDbc * psuDbc, uint32_t uSigIdx, const char * szName)
+    {
+    SuCanDbcSignal    * psuSignal;
+    const char        * szMsgName;
+    size_t              uMsgLen;
+
+    psuSignal = &psuDbc->pasuSignals[uSigIdx];
+    if (strcmp(psuSignal->szName, szName) == 0)
+        return bTRUE;
+
+    szMsgName = psuDbc->pasuMessages[psuSignal->uMessage].szName;
+    uMsgLen   = strlen(szMsgName);
+    return (strncmp(szName, szMsgName, uMsgLen) == 0) && (szName[uMsgLen] == '.') &&
+           (strcmp(&szName[uMsgLen + 1], psuSignal->szName) == 0);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Work out the shift and mask for a signal. Returns bFALSE if it doesn't
+// fit in the data bytes.
+
+static int bGetBits(SuCanDbcSignal * psuSignal, SuCanDbcBits * psuBits)
+    {
+    int                 iMsbBit;
+    int                 iLsbBit;
+
+    psuBits->uOrder  = psuSignal->uOrder;
+    psuBits->ullMask = (psuSignal->uBits == 64) ? ~0ULL : ((1ULL << psuSignal->uBits) - 1);
+
+    if (psuSignal->uOrder == CAN_DBC_ORDER_INTEL)
+        {
+        if (psuSignal->uStartBit + psuSignal->uBits > CAN_DBC_MAX_BYTES * 8)
+            return bFALSE;
+        psuBits->uShift = psuSignal->uStartBit;
+        psuBits->uBytes = (psuSignal->uStartBit + psuSignal->uBits + 7) / 8;
+        }
+
+    // Motorola start bit is the MSB, byte 0 is the top of the big endian word
+    else
+        {
+        if (psuSignal->uStartBit >= CAN_DBC_MAX_BYTES * 8)
+            return bFALSE;
+        iMsbBit = (CAN_DBC_MAX_BYTES - 1 - psuSignal->uStartBit / 8) * 8 + psuSignal->uStartBit % 8;
+        iLsbBit = iMsbBit - (int)psuSignal->uBits + 1;
+        if (iLsbBit < 0)
+            return bFALSE;
+        psuBits->uShift = (uint32_t)iLsbBit;
+        psuBits->uBytes = CAN_DBC_MAX_BYTES - (uint32_t)iLsbBit / 8;
+        }
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int iComparePlanTaps(const void * pvTap1, const void * pvTap2)
+    {
+    const SuCanDbcTap * psuTap1 = (const SuCanDbcTap *)pvTap1;
+    const SuCanDbcTap * psuTap2 = (const SuCanDbcTap *)pvTap2;
+
+    if (psuTap1->uColumn != psuTap2->uColumn)
+        return psuTap1->uColumn < psuTap2->uColumn ? -1 : 1;
+    return 0;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static uint32_t uHashCanID(uint32_t uCanID)
+    {
+    return (uCanID * 2654435761u) ^ (uCanID >> 16);
+    }
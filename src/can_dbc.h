@@ -0,0 +1,165 @@
+/*==========================================================================
+
+  can_dbc.h - Decode CAN signals using a plan made from a DBC file
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _CAN_DBC_H
+#define _CAN_DBC_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define CAN_DBC_MAX_NAME        128
+#define CAN_DBC_MAX_UNITS       32
+#define CAN_DBC_ID_EXTENDED     0x80000000  // DBC flag for an extended (29 bit) CAN ID
+
+typedef enum
+    {
+    CAN_DBC_ORDER_INTEL     = 0,            // @1, little endian
+    CAN_DBC_ORDER_MOTOROLA  = 1,            // @0, big endian
+    } EnCanDbcOrder;
+
+typedef enum
+    {
+    CAN_DBC_VAL_INTEGER     = 0,
+    CAN_DBC_VAL_FLOAT       = 1,            // SIG_VALTYPE_ 1, IEEE single
+    CAN_DBC_VAL_DOUBLE      = 2,            // SIG_VALTYPE_ 2, IEEE double
+    } EnCanDbcValType;
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// One BO_ message from the DBC file
+typedef struct
+    {
+    uint32_t            uCanID;             // With CAN_DBC_ID_EXTENDED for 29 bit IDs
+    uint32_t            uLength;            // Bytes
+    char                szName[CAN_DBC_MAX_NAME];
+    } SuCanDbcMessage;
+
+// One SG_ signal from the DBC file
+typedef struct
+    {
+    uint32_t            uMessage;           // Index of its message
+    char                szName[CAN_DBC_MAX_NAME];
+    char                szUnits[CAN_DBC_MAX_UNITS];
+    uint32_t            uStartBit;          // As in the DBC file
+    uint32_t            uBits;
+    uint32_t            uOrder;             // EnCanDbcOrder
+    int                 bSigned;
+    uint32_t            uValType;           // EnCanDbcValType
+    double              dScale;
+    double              dOffset;
+    int                 bMuxSwitch;         // M, the multiplexor
+    int32_t             iMuxValue;          // mN, -1 if not multiplexed
+    } SuCanDbcSignal;
+
+// Where a signal is in the 8 data bytes, read as a little endian word for
+// Intel signals or a big endian word for Motorola signals
+typedef struct
+    {
+    uint32_t            uOrder;             // Which word, EnCanDbcOrder
+    uint32_t            uShift;
+    uint64_t            ullMask;            // Already shifted down
+    uint32_t            uBytes;             // Data bytes needed
+    } SuCanDbcBits;
+
+// One requested signal in one message
+typedef struct
+    {
+    SuCanDbcBits        suBits;
+    uint64_t            ullSignBit;         // Top bit of a signed integer, else 0
+    uint32_t            uValType;           // EnCanDbcValType
+    int32_t             iMuxValue;          // -1 if not multiplexed
+    int                 bInteger;           // Scaled values are always whole numbers
+    double              dScale;
+    double              dOffset;
+    uint32_t            uColumn;            // Output column
+    } SuCanDbcTap;
+
+// Extraction plan for one CAN ID. Taps are in column order.
+typedef struct
+    {
+    uint32_t            uCanID;
+    uint32_t            uFirstTap;
+    uint32_t            uNumTaps;
+    int                 bHaveMux;
+    SuCanDbcBits        suMux;              // Multiplexor switch bits
+    } SuCanDbcPlan;
+
+typedef struct
+    {
+    uint32_t            uNumMessages;
+    SuCanDbcMessage   * pasuMessages;
+    uint32_t            uNumSignals;
+    SuCanDbcSignal    * pasuSignals;
+
+    // Made by enCanDbc_Compile()
+    uint32_t            uNumColumns;
+    int32_t           * paiColumnSignal;    // A signal for each column, -1 if not found
+    uint32_t            uNumPlans;
+    SuCanDbcPlan      * pasuPlans;
+    uint32_t            uNumTaps;
+    SuCanDbcTap       * pasuTaps;
+    uint32_t            uMaxTaps;           // Most taps in one plan
+    uint32_t            uHashSize;          // Always a power of two
+    uint32_t          * pauHash;            // Plan index + 1, 0 for empty
+    } SuCanDbc;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vCanDbc_Init(SuCanDbc * psuDbc);
+EnI106Status    enCanDbc_Load(SuCanDbc * psuDbc, const char * szFileName);
+EnI106Status    enCanDbc_Compile(SuCanDbc * psuDbc, const char * const aszNames[], unsigned int uNumNames);
+SuCanDbcPlan  * psuCanDbc_FindPlan(SuCanDbc * psuDbc, uint32_t uCanID);
+uint32_t        ulCanDbc_RowLen(SuCanDbc * psuDbc);
+char          * pchCanDbc_Row(SuCanDbc * psuDbc, SuCanDbcPlan * psuPlan, const uint8_t * pauData, 
+                              unsigned int uLength, char * pchText);
+void            vCanDbc_Free(SuCanDbc * psuDbc);
+
+#endif
@@ -47,12 +47,16 @@
 #include "i106_stdint.h"
 #include "irig106ch10.h"
 #include "i106_time.h"
+#include "i106_index.h"
 
 #include "i106_decode_time.h"
 #include "i106_decode_1553f1.h"
 #include "i106_decode_arinc429.h"
 #include "i106_decode_tmats.h"
 
+#include "tmats_cache.h"
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -60,13 +64,15 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "04"
+#define MINOR_VERSION  "08"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define CHAN_TABLE_GROW     32          // Channel table entries added at a time
+
 /*
  * Data structures
  * ---------------
@@ -124,6 +130,8 @@ typedef struct
     unsigned long       ulFibreChan;
     unsigned long       ulARINC664;
     unsigned long       ulOther;
+    unsigned long       ul1553;             // Packet counts from the index,
+    unsigned long       ulARINC429;         // these are decoded in a full scan
     } SuChanInfo;
 
 
@@ -136,16 +144,30 @@ int                 m_bLogRT2RT;
 int                 m_bVerbose;
 unsigned char       m_aArincLabelMap[0x100];
 
+// Channel counts are kept together in one table, in the order the channels
+// are first seen. The slot map takes a channel ID to its table entry.
+uint32_t          * m_pauChanSlot   = NULL;     // Slot + 1, 0 if not seen yet
+SuChanInfo        * m_pasuChanInfo  = NULL;
+unsigned int        m_uNumChans     = 0;
+unsigned int        m_uMaxChans     = 0;
+
 
 /*
  * Function prototypes
  * -------------------
  */
 
+SuChanInfo * psuGetChanInfo(unsigned int uChanID);
+void     vCountPacket(SuChanInfo * psuChanInfo, unsigned int uDataType);
+int      bQuickScan(int hI106In, char * szInFile, int bUseCacheFile,
+                    SuTmatsCache * psuTmatsCache,
+                    unsigned char abyFileStartTime[], unsigned char abyStartTime[],
+                    unsigned char abyStopTime[], unsigned long * pulTotal);
 void     vPrintCounts(SuChanInfo * psuChanInfo, FILE * psuOutFile);
 void     vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
-void     vProcessTmats(SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[]);
+void     vProcessTmats(SuTmatsCache * psuTmatsCache);
 void     vMakeArincLabelMap(unsigned char m_aArincLabelMap[]);
+void     vFreeChanInfo(void);
 void     vUsage(void);
 
 
@@ -154,9 +176,6 @@ void     vUsage(void);
 int main(int argc, char ** argv)
     {
 
-    // Array of pointers to the SuChanInfo structure
-    static SuChanInfo     * apsuChanInfo[0x10000];
-
     unsigned char           abyFileStartTime[6];
     unsigned char           abyStartTime[6];
     unsigned char           abyStopTime[6];
@@ -176,12 +195,18 @@ int main(int argc, char ** argv)
     unsigned long           ulReadSize;
 
     unsigned int            uChanIdx;
+    SuChanInfo            * psuChanInfo;
 
     EnI106Status            enStatus;
     SuI106Ch10Header        suI106Hdr;
     Su1553F1_CurrMsg        su1553Msg;
     SuArinc429F0_CurrMsg    suArincMsg;
-    SuTmatsInfo             suTmatsInfo;
+    SuTmatsCache            suTmatsCache;
+    int                     bUseCacheFile;
+    int                     bBlockRead;
+    int                     bQuick;
+    int                     bIndexCounts = bFALSE;
+    SuPktFilter             suPktFilter;
     SuIrig106Time           suIrigTime;
     struct tm             * psuTmTime;
     char                    szTime[50];
@@ -198,13 +223,13 @@ int main(int argc, char ** argv)
     tzset();
 
 /*
- * Initialize the channel info array pointers to all NULL
+ * Initialize the counts
  */
 
-    memset(apsuChanInfo, 0, sizeof(apsuChanInfo));
     ulTotal      = 0L;
     ulReadErrors = 0L;
     ulBadPackets = 0L;
+    vTmatsCache_Init(&suTmatsCache);
 
 /*
  * Process the command line arguements
@@ -218,6 +243,9 @@ int main(int argc, char ** argv)
 
     m_bVerbose    = bFALSE;               // No verbosity
     m_bLogRT2RT   = bFALSE;               // Don't keep track of RT to RT
+    bUseCacheFile = bFALSE;               // Always decode TMATS
+    bBlockRead    = bFALSE;               // Read a packet at a time
+    bQuick        = bFALSE;               // Read the whole file
     szInFile[0] = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
 
@@ -240,6 +268,17 @@ int main(int argc, char ** argv)
                         m_bVerbose = bTRUE;
                         break;
 
+                    case 'C' :                   // Channel table file
+                        bUseCacheFile = bTRUE;
+                        break;
+
+                    case '-' :                   // Long flags
+                        if      (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        else if (strcmp(argv[iArgIdx], "--quick") == 0)
+                            bQuick = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -316,20 +355,33 @@ int main(int argc, char ** argv)
     // Make the ARINC label map just in case
     vMakeArincLabelMap(m_aArincLabelMap);
 
-    fprintf(stderr, "Computing histogram...\n");
+    // Every packet is read so the filter only matters for --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, (bBlockRead == bTRUE) && (bQuick == bFALSE));
+    enPktFilter_Open(&suPktFilter, hI106In, szInFile);
+
+    // Quick mode only reads the ends of the file and the index
+    if (bQuick == bTRUE)
+        {
+        fprintf(stderr, "Reading file start, end, and index...\n");
+        bIndexCounts = bQuickScan(hI106In, szInFile, bUseCacheFile, &suTmatsCache,
+                                  abyFileStartTime, abyStartTime, abyStopTime, &ulTotal);
+        }
+    else
+        fprintf(stderr, "Computing histogram...\n");
 
 
 /*
  * Loop until there are no more message whilst keeping track of all the
- * various message counts.
+ * various message counts. Skipped in quick mode.
  * --------------------------------------------------------------------
  */
 
-    while (1==1) 
+    while (bQuick == bFALSE)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -355,7 +407,7 @@ int main(int argc, char ** argv)
 
             // Read the data buffer
             ulReadSize = ulBuffSize;
-            enStatus = enI106Ch10ReadData(hI106In, ulBuffSize, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
             // Check for data read errors
             if (enStatus != I106_OK)
@@ -364,25 +416,8 @@ int main(int argc, char ** argv)
                 break;
                 }
 
-            // If this is a new channel, malloc some memory for counts and
-            // set the pointer in the channel info array to it.
-            if (apsuChanInfo[suI106Hdr.uChID] == NULL)
-                {
-                apsuChanInfo[suI106Hdr.uChID] = (SuChanInfo *)malloc(sizeof(SuChanInfo));
-                memset(apsuChanInfo[suI106Hdr.uChID], 0, sizeof(SuChanInfo));
-                apsuChanInfo[suI106Hdr.uChID]->iChanID = suI106Hdr.uChID;
-                // Now save channel type and name
-                if (suI106Hdr.uChID == 0)
-                    {
-                    strcpy(apsuChanInfo[suI106Hdr.uChID]->szChanType, "RESERVED");
-                    strcpy(apsuChanInfo[suI106Hdr.uChID]->szChanName, "SYSTEM");
-                    }
-                else
-                    {
-                    strcpy(apsuChanInfo[suI106Hdr.uChID]->szChanType, "UNKNOWN");
-                    strcpy(apsuChanInfo[suI106Hdr.uChID]->szChanName, "UNKNOWN");
-                    }
-                }
+            // Get the counts for this channel, made if it is a new one
+            psuChanInfo = psuGetChanInfo(suI106Hdr.uChID);
 
             ulTotal++;
             if (m_bVerbose) 
@@ -408,56 +443,36 @@ int main(int argc, char ** argv)
             switch (suI106Hdr.ubyDataType)
                 {
 
-                case I106CH10_DTYPE_USER_DEFINED :      // 0x00
-                    apsuChanInfo[suI106Hdr.uChID]->ulUserDefined++;
-                    break;
-
                 case I106CH10_DTYPE_TMATS :             // 0x01
-                    apsuChanInfo[suI106Hdr.uChID]->ulTMATS++;
+                    psuChanInfo->ulTMATS++;
 
                     // Only decode the first TMATS record
-                    if (apsuChanInfo[suI106Hdr.uChID]->ulTMATS != 0)
+                    if (psuChanInfo->ulTMATS == 1)
                         {
                         // Save file start time
                         memcpy((char *)&abyFileStartTime, (char *)suI106Hdr.aubyRefTime, 6);
 
-                        // Process TMATS info for later use
-                        memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-                        enI106_Decode_Tmats(&suI106Hdr, pvBuff, &suTmatsInfo);
+                        // Process TMATS info for later use. Only the channel
+                        // table is needed so it can come from the table file.
+                        enStatus = enTmatsCache_ChanTable(&suTmatsCache, &suI106Hdr, pvBuff,
+                            bUseCacheFile ? szInFile : NULL);
                         if (enStatus != I106_OK) 
                             break;
-                        vProcessTmats(&suTmatsInfo, apsuChanInfo);
+                        vProcessTmats(&suTmatsCache);
                         }
                     break;
 
-                case I106CH10_DTYPE_RECORDING_EVENT :   // 0x02
-                    apsuChanInfo[suI106Hdr.uChID]->ulEvents++;
-                    break;
-
-                case I106CH10_DTYPE_RECORDING_INDEX :   // 0x03
-                    apsuChanInfo[suI106Hdr.uChID]->ulIndex++;
-                    break;
-
-                case I106CH10_DTYPE_PCM_FMT_0 :         // 0x08
-                case I106CH10_DTYPE_PCM_FMT_1 :         // 0x09
-                    apsuChanInfo[suI106Hdr.uChID]->ulPCM++;
-                    break;
-
-                case I106CH10_DTYPE_IRIG_TIME :         // 0x11
-                    apsuChanInfo[suI106Hdr.uChID]->ulIrigTime++;
-                    break;
-
                 case I106CH10_DTYPE_1553_FMT_1 :        // 0x19
 
                     // If first 1553 message for this channel, setup the 1553 counts
-                    if (apsuChanInfo[suI106Hdr.uChID]->psu1553Info == NULL)
+                    if (psuChanInfo->psu1553Info == NULL)
                         {
-                        apsuChanInfo[suI106Hdr.uChID]->psu1553Info = 
+                        psuChanInfo->psu1553Info = 
                             malloc(sizeof(SuChanInfo1553));
-                        memset(apsuChanInfo[suI106Hdr.uChID]->psu1553Info, 0x00, sizeof(SuChanInfo1553));
+                        memset(psuChanInfo->psu1553Info, 0x00, sizeof(SuChanInfo1553));
                         }
 
-                    apsuChanInfo[suI106Hdr.uChID]->psu1553Info->ulTotalIrigPackets++;
+                    psuChanInfo->psu1553Info->ulTotalIrigPackets++;
 
                     // Step through all 1553 messages
                     enStatus = enI106_Decode_First1553F1(&suI106Hdr, pvBuff, &su1553Msg);
@@ -466,26 +481,26 @@ int main(int argc, char ** argv)
                         while (enStatus == I106_OK)
                             {
                             // Update message count
-                            apsuChanInfo[suI106Hdr.uChID]->psu1553Info->ulTotalBusMsgs++;
+                            psuChanInfo->psu1553Info->ulTotalBusMsgs++;
                             usPackedIdx = (su1553Msg.psuCmdWord1->uValue >> 5) & 0x3FFF;
-                            apsuChanInfo[suI106Hdr.uChID]->psu1553Info->aulMsgs[usPackedIdx]++;
+                            psuChanInfo->psu1553Info->aulMsgs[usPackedIdx]++;
 
                             // Update the error counts
                             if (su1553Msg.psu1553Hdr->bMsgError != 0) 
-                                apsuChanInfo[suI106Hdr.uChID]->psu1553Info->aulErrs[usPackedIdx]++;
+                                psuChanInfo->psu1553Info->aulErrs[usPackedIdx]++;
 
                             if (su1553Msg.psu1553Hdr->bRespTimeout != 0)
-                                apsuChanInfo[suI106Hdr.uChID]->psu1553Info->ulErr1553Timeout++;
+                                psuChanInfo->psu1553Info->ulErr1553Timeout++;
 
                             // If logging RT to RT then do it for second command word
                             if (su1553Msg.psu1553Hdr->bRT2RT == 1)
                                 {
-                                apsuChanInfo[suI106Hdr.uChID]->psu1553Info->bRT2RTFound = bTRUE;
+                                psuChanInfo->psu1553Info->bRT2RTFound = bTRUE;
 
                                 if (m_bLogRT2RT==bTRUE) 
                                     {
                                     usPackedIdx = (su1553Msg.psuCmdWord2->uValue >> 5) & 0x3FFF;
-                                    apsuChanInfo[suI106Hdr.uChID]->psu1553Info->aulMsgs[usPackedIdx]++;
+                                    psuChanInfo->psu1553Info->aulMsgs[usPackedIdx]++;
                                     } // end if logging RT to RT
                                 } // end if RT to RT
 
@@ -497,22 +512,18 @@ int main(int argc, char ** argv)
                     // Decode not good so mark it as a packet error
                     else
                         {
-                        apsuChanInfo[suI106Hdr.uChID]->psu1553Info->ulTotalIrigPacketErrors++;
+                        psuChanInfo->psu1553Info->ulTotalIrigPacketErrors++;
                         }
 
                     break;
 
-                case I106CH10_DTYPE_ANALOG :            // 0x21
-                    apsuChanInfo[suI106Hdr.uChID]->ulAnalog++;
-                    break;
-
                 case I106CH10_DTYPE_ARINC_429_FMT_0 :   // 0x38
                     // If first ARINC 429 message for this channel, setup the counts
-                    if (apsuChanInfo[suI106Hdr.uChID]->paARINC429 == NULL)
+                    if (psuChanInfo->paARINC429 == NULL)
                         {
-                        apsuChanInfo[suI106Hdr.uChID]->paARINC429 = 
+                        psuChanInfo->paARINC429 = 
                             malloc(sizeof(SuARINC429));
-                        memset(apsuChanInfo[suI106Hdr.uChID]->paARINC429, 0x00, sizeof(SuARINC429));
+                        memset(psuChanInfo->paARINC429, 0x00, sizeof(SuARINC429));
                         }
 
                     // Step through all ARINC 429 messages
@@ -527,7 +538,7 @@ int main(int argc, char ** argv)
                             // Update message count
                             uBus   = (unsigned char)suArincMsg.psu429Hdr->uBusNum;
                             uLabel = (unsigned char)m_aArincLabelMap[suArincMsg.psu429Data->uLabel];
-                            apsuChanInfo[suI106Hdr.uChID]->paARINC429->aulMsgs[uBus][uLabel]++;
+                            psuChanInfo->paARINC429->aulMsgs[uBus][uLabel]++;
 
                             // Get the next ARINC 429 message
                             enStatus = enI106_Decode_NextArinc429F0(&suArincMsg);
@@ -536,64 +547,9 @@ int main(int argc, char ** argv)
 
                     break;
 
-                case I106CH10_DTYPE_VIDEO_FMT_0 :       // 0x40
-                case I106CH10_DTYPE_VIDEO_FMT_1 :       // 0x41
-                case I106CH10_DTYPE_VIDEO_FMT_2 :       // 0x42
-                case I106CH10_DTYPE_VIDEO_FMT_3 :       // 0x43
-                case I106CH10_DTYPE_VIDEO_FMT_4 :       // 0x44
-                    apsuChanInfo[suI106Hdr.uChID]->ulMPEG2++;
-                    break;
-
-                case I106CH10_DTYPE_UART_FMT_0 :        // 0x50
-                    apsuChanInfo[suI106Hdr.uChID]->ulUART++;
-                    break;
-
-                case I106CH10_DTYPE_ETHERNET_FMT_0 :    // 0x68
-                    apsuChanInfo[suI106Hdr.uChID]->ulEthernet++;
-                    break;
-
-                case I106CH10_DTYPE_16PP194 :           // 0x1A
-                    apsuChanInfo[suI106Hdr.uChID]->ul16PP194++;
-                    break;
-
-                case I106CH10_DTYPE_DISCRETE :          // 0x29
-                    apsuChanInfo[suI106Hdr.uChID]->ulDiscrete++;
-                    break;
-
-                case I106CH10_DTYPE_PARALLEL_FMT_0 :    // 0x60
-                    apsuChanInfo[suI106Hdr.uChID]->ulParallel++;
-                    break;
-
-                case I106CH10_DTYPE_MESSAGE :           // 0x30
-                    apsuChanInfo[suI106Hdr.uChID]->ulMessage++;
-                    break;
-
-                case I106CH10_DTYPE_IMAGE_FMT_1 :       // 0x48
-                case I106CH10_DTYPE_IMAGE_FMT_2 :       // 0x49
-                    apsuChanInfo[suI106Hdr.uChID]->ulImage++;
-                    break;
-
-                case I106CH10_DTYPE_TSPI_FMT_0 :        // 0x70
-                case I106CH10_DTYPE_TSPI_FMT_1 :        // 0x71
-                case I106CH10_DTYPE_TSPI_FMT_2 :        // 0x72
-                    apsuChanInfo[suI106Hdr.uChID]->ulTSPI++;
-                    break;
-
-                case I106CH10_DTYPE_CAN :               // 0x78
-                    apsuChanInfo[suI106Hdr.uChID]->ulCAN++;
-                    break;
-
-                case I106CH10_DTYPE_FC_FMT_0 :          // 0x79
-                case I106CH10_DTYPE_FC_FMT_1 :          // 0x7A
-                    apsuChanInfo[suI106Hdr.uChID]->ulFibreChan++;
-                    break;
-
-                case I106CH10_DTYPE_ETHERNET_A664 :     // 0x69
-                    apsuChanInfo[suI106Hdr.uChID]->ulARINC664++;
-                    break;
-
+                // Everything else is just counted
                 default:
-                    apsuChanInfo[suI106Hdr.uChID]->ulOther++;
+                    vCountPacket(psuChanInfo, suI106Hdr.ubyDataType);
                     break;
 
                 } // end switch on message type
@@ -614,14 +570,23 @@ int main(int argc, char ** argv)
  * ---------------------------------------
  */
 
-//    vPrintTmats(&suTmatsInfo, psuOutFile);
+//    if (suTmatsCache.bDecoded)
+//        vPrintTmats(&suTmatsCache.suTmatsInfo, psuOutFile);
 
-    fprintf(psuOutFile,"\n=-=-= Message Totals by Channel and Type =-=-=\n\n");
-    for (uChanIdx=0; uChanIdx<0x1000; uChanIdx++)
+    if (bQuick == bFALSE)
+        fprintf(psuOutFile,"\n=-=-= Message Totals by Channel and Type =-=-=\n\n");
+    else if (bIndexCounts == bTRUE)
+        fprintf(psuOutFile,"\n=-=-= Indexed Packet Totals by Channel and Type =-=-=\n\n");
+    else
+        fprintf(psuOutFile,"\n=-=-= Channels (no index, packets not counted) =-=-=\n\n");
+    if (m_pauChanSlot != NULL)
         {
-        if (apsuChanInfo[uChanIdx] != NULL)
+        for (uChanIdx=0; uChanIdx<0x10000; uChanIdx++)
             {
-            vPrintCounts(apsuChanInfo[uChanIdx], psuOutFile);
+            if (m_pauChanSlot[uChanIdx] != 0)
+                {
+                vPrintCounts(&m_pasuChanInfo[m_pauChanSlot[uChanIdx] - 1], psuOutFile);
+                }
             }
         }
 
@@ -647,12 +612,18 @@ int main(int argc, char ** argv)
     strftime(szTime, 50, szTimeFmt, psuTmTime);
     fprintf(psuOutFile,"Data Stop  %s\n\n",  szTime);
 
-    fprintf(psuOutFile,"\nTOTAL PACKETS:    %10lu\n\n", ulTotal);
+    if (bQuick == bFALSE)
+        fprintf(psuOutFile,"\nTOTAL PACKETS:    %10lu\n\n", ulTotal);
+    else if (bIndexCounts == bTRUE)
+        fprintf(psuOutFile,"\nTOTAL INDEXED PACKETS: %10lu\n\n", ulTotal);
 
 /*
  *  Free dynamic memory.
  */
 
+    vFreeChanInfo();
+    vTmatsCache_Free(&suTmatsCache);
+    vPktFilter_Free(&suPktFilter);
     free(pvBuff);
     pvBuff = NULL;
 
@@ -663,6 +634,307 @@ int main(int argc, char ** argv)
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Get the counts for a channel, making them the first time it is seen.
+// The table moves when it grows so don't hold on to the pointer across
+// anything that might add a channel.
+
+SuChanInfo * psuGetChanInfo(unsigned int uChanID)
+    {
+    SuChanInfo        * psuChanInfo;
+
+    uChanID &= 0xffff;
+
+    // Slot map is made the first time through
+    if (m_pauChanSlot == NULL)
+        m_pauChanSlot = (uint32_t *)calloc(0x10000, sizeof(uint32_t));
+
+    if (m_pauChanSlot[uChanID] != 0)
+        return &m_pasuChanInfo[m_pauChanSlot[uChanID] - 1];
+
+    // Grow the table if it is full
+    if (m_uNumChans == m_uMaxChans)
+        {
+        m_uMaxChans   += CHAN_TABLE_GROW;
+        m_pasuChanInfo = (SuChanInfo *)realloc(m_pasuChanInfo, m_uMaxChans * sizeof(SuChanInfo));
+        }
+
+    psuChanInfo = &m_pasuChanInfo[m_uNumChans];
+    memset(psuChanInfo, 0, sizeof(SuChanInfo));
+    psuChanInfo->iChanID = uChanID;
+
+    // Channel type and name until TMATS says otherwise
+    if (uChanID == 0)
+        {
+        strcpy(psuChanInfo->szChanType, "RESERVED");
+        strcpy(psuChanInfo->szChanName, "SYSTEM");
+        }
+    else
+        {
+        strcpy(psuChanInfo->szChanType, "UNKNOWN");
+        strcpy(psuChanInfo->szChanName, "UNKNOWN");
+        }
+
+    m_uNumChans++;
+    m_pauChanSlot[uChanID] = m_uNumChans;
+    return psuChanInfo;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vFreeChanInfo(void)
+    {
+    unsigned int        uSlotIdx;
+
+    for (uSlotIdx=0; uSlotIdx<m_uNumChans; uSlotIdx++)
+        {
+        free(m_pasuChanInfo[uSlotIdx].psu1553Info);
+        free(m_pasuChanInfo[uSlotIdx].paARINC429);
+        }
+
+    free(m_pasuChanInfo);
+    free(m_pauChanSlot);
+    m_pasuChanInfo = NULL;
+    m_pauChanSlot  = NULL;
+    m_uNumChans    = 0;
+    m_uMaxChans    = 0;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Count a packet by data type. A full scan decodes TMATS, 1553, and ARINC
+// 429 packets itself so here those are only counted from the index.
+
+void vCountPacket(SuChanInfo * psuChanInfo, unsigned int uDataType)
+    {
+    switch (uDataType)
+        {
+        case I106CH10_DTYPE_USER_DEFINED :      // 0x00
+            psuChanInfo->ulUserDefined++;
+            break;
+
+        case I106CH10_DTYPE_TMATS :             // 0x01
+            psuChanInfo->ulTMATS++;
+            break;
+
+        case I106CH10_DTYPE_RECORDING_EVENT :   // 0x02
+            psuChanInfo->ulEvents++;
+            break;
+
+        case I106CH10_DTYPE_RECORDING_INDEX :   // 0x03
+            psuChanInfo->ulIndex++;
+            break;
+
+        case I106CH10_DTYPE_PCM_FMT_0 :         // 0x08
+        case I106CH10_DTYPE_PCM_FMT_1 :         // 0x09
+            psuChanInfo->ulPCM++;
+            break;
+
+        case I106CH10_DTYPE_IRIG_TIME :         // 0x11
+            psuChanInfo->ulIrigTime++;
+            break;
+
+        case I106CH10_DTYPE_1553_FMT_1 :        // 0x19
+            psuChanInfo->ul1553++;
+            break;
+
+        case I106CH10_DTYPE_ANALOG :            // 0x21
+            psuChanInfo->ulAnalog++;
+            break;
+
+        case I106CH10_DTYPE_ARINC_429_FMT_0 :   // 0x38
+            psuChanInfo->ulARINC429++;
+            break;
+
+        case I106CH10_DTYPE_VIDEO_FMT_0 :       // 0x40
+        case I106CH10_DTYPE_VIDEO_FMT_1 :       // 0x41
+        case I106CH10_DTYPE_VIDEO_FMT_2 :       // 0x42
+        case I106CH10_DTYPE_VIDEO_FMT_3 :       // 0x43
+        case I106CH10_DTYPE_VIDEO_FMT_4 :       // 0x44
+            psuChanInfo->ulMPEG2++;
+            break;
+
+        case I106CH10_DTYPE_UART_FMT_0 :        // 0x50
+            psuChanInfo->ulUART++;
+            break;
+
+        case I106CH10_DTYPE_ETHERNET_FMT_0 :    // 0x68
+            psuChanInfo->ulEthernet++;
+            break;
+
+        case I106CH10_DTYPE_16PP194 :           // 0x1A
+            psuChanInfo->ul16PP194++;
+            break;
+
+        case I106CH10_DTYPE_DISCRETE :          // 0x29
+            psuChanInfo->ulDiscrete++;
+            break;
+
+        case I106CH10_DTYPE_PARALLEL_FMT_0 :    // 0x60
+            psuChanInfo->ulParallel++;
+            break;
+
+        case I106CH10_DTYPE_MESSAGE :           // 0x30
+            psuChanInfo->ulMessage++;
+            break;
+
+        case I106CH10_DTYPE_IMAGE_FMT_1 :       // 0x48
+        case I106CH10_DTYPE_IMAGE_FMT_2 :       // 0x49
+            psuChanInfo->ulImage++;
+            break;
+
+        case I106CH10_DTYPE_TSPI_FMT_0 :        // 0x70
+        case I106CH10_DTYPE_TSPI_FMT_1 :        // 0x71
+        case I106CH10_DTYPE_TSPI_FMT_2 :        // 0x72
+            psuChanInfo->ulTSPI++;
+            break;
+
+        case I106CH10_DTYPE_CAN :               // 0x78
+            psuChanInfo->ulCAN++;
+            break;
+
+        case I106CH10_DTYPE_FC_FMT_0 :          // 0x79
+        case I106CH10_DTYPE_FC_FMT_1 :          // 0x7A
+            psuChanInfo->ulFibreChan++;
+            break;
+
+        case I106CH10_DTYPE_ETHERNET_A664 :     // 0x69
+            psuChanInfo->ulARINC664++;
+            break;
+
+        default:
+            psuChanInfo->ulOther++;
+            break;
+
+        } // end switch on data type
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Quick summary without reading the whole file. Packets are read from the
+// start up to the first data packet, picking up TMATS on the way, and then
+// the last packet is read. If there is a recording index the per channel
+// packet counts come from it and the last indexed data packet gives the data
+// stop time. Returns bTRUE if the counts came from an index.
+
+int bQuickScan(int hI106In, char * szInFile, int bUseCacheFile,
+               SuTmatsCache * psuTmatsCache,
+               unsigned char abyFileStartTime[], unsigned char abyStartTime[],
+               unsigned char abyStopTime[], unsigned long * pulTotal)
+    {
+    EnI106Status            enStatus;
+    SuI106Ch10Header        suI106Hdr;
+    unsigned long           ulBuffSize = 0L;
+    unsigned char         * pvBuff = NULL;
+    int                     bFoundTmats = bFALSE;
+    int                     bFoundIndex;
+    SuPacketIndexInfo     * asuPacketIndex;
+    uint32_t                uNumIndexes;
+    uint32_t                uIndexIdx;
+    int64_t                 llLastOffset;
+
+    *pulTotal = 0L;
+
+    // Read from the start up to the first data packet
+    enStatus = enI106Ch10FirstMsg(hI106In);
+    while (enStatus == I106_OK)
+        {
+        enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+        if (enStatus != I106_OK)
+            break;
+
+        // The first data packet is the data start
+        if ((suI106Hdr.ubyDataType != I106CH10_DTYPE_TMATS          ) &&
+            (suI106Hdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME      ) &&
+            (suI106Hdr.ubyDataType != I106CH10_DTYPE_RECORDING_INDEX))
+            {
+            memcpy((char *)abyStartTime, (char *)suI106Hdr.aubyRefTime, 6);
+            memcpy((char *)abyStopTime,  (char *)suI106Hdr.aubyRefTime, 6);
+            break;
+            }
+
+        // Only the first TMATS record is read
+        if ((suI106Hdr.ubyDataType != I106CH10_DTYPE_TMATS) || (bFoundTmats == bTRUE))
+            continue;
+
+        if (ulBuffSize < uGetDataLen(&suI106Hdr))
+            {
+            pvBuff = realloc(pvBuff, uGetDataLen(&suI106Hdr));
+            ulBuffSize = uGetDataLen(&suI106Hdr);
+            }
+
+        enStatus = enI106Ch10ReadData(hI106In, ulBuffSize, pvBuff);
+        if (enStatus != I106_OK)
+            break;
+
+        bFoundTmats = bTRUE;
+        memcpy((char *)abyFileStartTime, (char *)suI106Hdr.aubyRefTime, 6);
+        if (enTmatsCache_ChanTable(psuTmatsCache, &suI106Hdr, pvBuff,
+                bUseCacheFile ? szInFile : NULL) == I106_OK)
+            vProcessTmats(psuTmatsCache);
+        } // end while reading the start of the file
+
+    free(pvBuff);
+
+    // Without an index the last packet is the best guess at data stop
+    enStatus = enI106Ch10LastMsg(hI106In);
+    if (enStatus == I106_OK)
+        enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+    if (enStatus == I106_OK)
+        memcpy((char *)abyStopTime, (char *)suI106Hdr.aubyRefTime, 6);
+
+    // Count packets from the index if there is one
+    enStatus = enIndexPresent(hI106In, &bFoundIndex);
+    if ((enStatus != I106_OK) || (bFoundIndex == bFALSE))
+        return bFALSE;
+
+    InitIndex(hI106In);
+    enStatus = enReadIndexes(hI106In);
+    if (enStatus == I106_OK)
+        enStatus = enGetIndexArray(hI106In, &asuPacketIndex, &uNumIndexes);
+    if (enStatus != I106_OK)
+        return bFALSE;
+
+    llLastOffset = -1;
+    for (uIndexIdx=0; uIndexIdx<uNumIndexes; uIndexIdx++)
+        {
+        vCountPacket(psuGetChanInfo(asuPacketIndex[uIndexIdx].uChID),
+                     asuPacketIndex[uIndexIdx].ubyDataType);
+
+        if ((asuPacketIndex[uIndexIdx].ubyDataType != I106CH10_DTYPE_TMATS          ) &&
+            (asuPacketIndex[uIndexIdx].ubyDataType != I106CH10_DTYPE_IRIG_TIME      ) &&
+            (asuPacketIndex[uIndexIdx].ubyDataType != I106CH10_DTYPE_RECORDING_INDEX) &&
+            (asuPacketIndex[uIndexIdx].lFileOffset > llLastOffset))
+            llLastOffset = asuPacketIndex[uIndexIdx].lFileOffset;
+        }
+    *pulTotal = uNumIndexes;
+
+    // Data stop from the last indexed data packet
+    if (llLastOffset >= 0)
+        {
+        enStatus = enI106Ch10SetPos(hI106In, llLastOffset);
+        if (enStatus == I106_OK)
+            enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+        if (enStatus == I106_OK)
+            memcpy((char *)abyStopTime, (char *)suI106Hdr.aubyRefTime, 6);
+        }
+
+    return bTRUE;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 void vPrintCounts(SuChanInfo * psuChanInfo, FILE * psuOutFile)
@@ -685,6 +957,9 @@ void vPrintCounts(SuChanInfo * psuChanInfo, FILE * psuOutFile)
     if (psuChanInfo->ulIrigTime != 0)
         fprintf(psuOutFile,"    IRIG Time         %10lu\n",   psuChanInfo->ulIrigTime);
 
+    if (psuChanInfo->ul1553 != 0)
+        fprintf(psuOutFile,"    1553 Packets      %10lu\n",   psuChanInfo->ul1553);
+
     if ((psuChanInfo->psu1553Info != NULL)  &&
         (psuChanInfo->psu1553Info->ulTotalBusMsgs != 0))
         {
@@ -729,6 +1004,9 @@ void vPrintCounts(SuChanInfo * psuChanInfo, FILE * psuOutFile)
     if (psuChanInfo->ulAnalog != 0)
         fprintf(psuOutFile,"    Analog            %10lu\n",   psuChanInfo->ulAnalog);
 
+    if (psuChanInfo->ulARINC429 != 0)
+        fprintf(psuOutFile,"    ARINC 429 Packets %10lu\n",   psuChanInfo->ulARINC429);
+
     if (psuChanInfo->paARINC429 != NULL)
         {
         unsigned int    uBus;
@@ -854,44 +1132,28 @@ void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
 
 /* ------------------------------------------------------------------------ */
 
-void vProcessTmats(SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[])
+void vProcessTmats(SuTmatsCache * psuTmatsCache)
     {
-//    unsigned            uArrayIdx;
-//    unsigned char       u1553ChanIdx;
-    SuRRecord         * psuRRecord;
-    SuRDataSource     * psuRDataSrc;
-    int                 iTrackNumber;
+    uint32_t            uChanIdx;
+    SuTmatsChan       * psuChan;
+    SuChanInfo        * psuChanInfo;
+    unsigned int        uTrackNumber;
 
     // Find channels mentioned in TMATS record
-    psuRRecord   = psuTmatsInfo->psuFirstRRecord;
-    while (psuRRecord != NULL)
+    for (uChanIdx=0; uChanIdx<psuTmatsCache->uNumChans; uChanIdx++)
         {
-        // Get the first data source for this R record
-        psuRDataSrc = psuRRecord->psuFirstDataSource;
-        while (psuRDataSrc != NULL)
-            {
-            iTrackNumber = atoi(psuRDataSrc->szTrackNumber);
-
-            // Make sure a message count structure exists
-            if (apsuChanInfo[iTrackNumber] == NULL)
-                {
-                apsuChanInfo[iTrackNumber] = malloc(sizeof(SuChanInfo));
-                memset(apsuChanInfo[iTrackNumber], 0, sizeof(SuChanInfo));
-                apsuChanInfo[iTrackNumber]->iChanID = iTrackNumber;
-                }
-
-            // Now save channel type and name
-            strcpy(apsuChanInfo[iTrackNumber]->szChanType, psuRDataSrc->szChannelDataType);
-            strcpy(apsuChanInfo[iTrackNumber]->szChanName, psuRDataSrc->szDataSourceID);
-
-            // Get the next R record data source
-            psuRDataSrc = psuRDataSrc->psuNext;
-            } // end while walking R data source linked list
+        psuChan      = &psuTmatsCache->pasuChans[uChanIdx];
+        uTrackNumber = psuChan->uChanID;
+        if (uTrackNumber > 0xffff)
+            continue;
 
-        // Get the next R record
-        psuRRecord = psuRRecord->psuNext;
+        // Make sure a message count structure exists
+        psuChanInfo = psuGetChanInfo(uTrackNumber);
 
-        } // end while walking R record linked list
+        // Now save channel type and name
+        strcpy((char *)psuChanInfo->szChanType, psuChan->szChanType);
+        strcpy((char *)psuChanInfo->szChanName, psuChan->szDataSourceID);
+        } // end for all TMATS channels
 
     return;
     }
@@ -938,6 +1200,9 @@ void vUsage(void)
     printf("   <filename> Input/output file names\n");
     printf("   -r         Log both sides of RT to RT transfers\n");
     printf("   -v         Verbose\n");
+    printf("   -C         Read or make a channel table file beside the data file\n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
+    printf("   --quick       Only read the file start, end, and recording index\n");
     }
 
 
@@ -40,6 +40,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <memory.h>
 #include <sys/types.h>
@@ -51,13 +52,15 @@
 #include "i106_time.h"
 #include "i106_decode_time.h"
 
+#include "time_map.h"
+
 /*
  * Macros and definitions
  * ----------------------
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "02"
+#define MINOR_VERSION  "04"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -69,6 +72,21 @@
  * ---------------
  */
 
+// One time window to extract when trimming multiple segments in one pass
+typedef struct
+    {
+    int                 iStartHour, iStartMin, iStartSec;
+    int                 iStopHour,  iStopMin,  iStopSec;
+    SuIrig106Time       suStartTime;
+    SuIrig106Time       suStopTime;
+    int64_t             llStartTime;
+    int64_t             llStopTime;
+    char                szOutFile[256];
+    int                 iI106_Out;
+    int                 bOpen;
+    int                 bDone;
+    long                lWriteMsgs;
+    } SuTrimWindow;
 
 /*
  * Module data
@@ -77,6 +95,7 @@
 
 void          * m_pvBuff     = NULL;
 unsigned long   m_ulBuffSize = 0L;
+SuTimeMap       m_suTimeMap;            // Empty unless -M
 
 /*
  * Function prototypes
@@ -85,6 +104,9 @@ unsigned long   m_ulBuffSize = 0L;
 
 // void vStats(char *szFileName);
 int64_t GetCh10FileSize(char * szFilename);
+int     iReadWindowFile(char * szWindowFile, char * szOutBase, SuTrimWindow ** ppsuWindows);
+void    vWindowLimits(int iI106_In, SuTrimWindow * psuWindow);
+int     iTrimWindows(int iI106_In, SuTrimWindow * asuWindows, int iNumWindows);
 void    vUsage(void);
 
 
@@ -113,8 +135,6 @@ int main (int argc, char *argv[])
 
     long                lWriteMsgs = 0L;
 
-    uint8_t             abyStartTime[6];
-    uint8_t             abyStopTime[6];
     SuIrig106Time       suStartTime;
     SuIrig106Time       suStopTime;
     int64_t             llStartTime      = -1L;
@@ -123,6 +143,7 @@ int main (int argc, char *argv[])
 
     int                 bUseStartTime;
     int                 bUseStopTime;
+    int                 bUseTimeMap;
     int                 iStartHour, iStartMin, iStartSec;
     int                 iStopHour,  iStopMin,  iStopSec;
 
@@ -141,6 +162,10 @@ int main (int argc, char *argv[])
 
     int                 iStatus;
 
+    char              * szWindowFile = NULL;
+    SuTrimWindow      * asuWindows   = NULL;
+    int                 iNumWindows;
+
 
 /*
  * Process the command line arguments
@@ -154,6 +179,8 @@ int main (int argc, char *argv[])
 
     bUseStartTime = bFALSE;
     bUseStopTime  = bFALSE;
+    bUseTimeMap   = bFALSE;
+    vTimeMap_Init(&m_suTimeMap);
 
     for (iArgIdx=3; iArgIdx<argc; iArgIdx++) 
         {
@@ -187,6 +214,26 @@ int main (int argc, char *argv[])
                 break;
 
             case '-' :
+                // Time window file
+                if (argv[iArgIdx][1] == 'w')
+                    {
+                    iArgIdx++;
+                    if (iArgIdx >= argc)
+                        {
+                        vUsage();
+                        return 1;
+                        }
+                    szWindowFile = argv[iArgIdx];
+                    break;
+                    }
+
+                // Time map
+                if (argv[iArgIdx][1] == 'M')
+                    {
+                    bUseTimeMap = bTRUE;
+                    break;
+                    }
+
                 // Try to decode a time
                 iStatus = sscanf(argv[iArgIdx],"-%d:%d:%d",
                     &iStopHour,&iStopMin,&iStopSec);
@@ -248,6 +295,42 @@ int main (int argc, char *argv[])
         return 1;
         }
 
+    // With a map of all the time packets the start and stop times are
+    // converted once, not again at every time packet
+    if (bUseTimeMap == bTRUE)
+        {
+        enStatus = enTimeMap_Get(&m_suTimeMap, iI106_In, argv[1], TIME_MAP_ANY_CHAN);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error making time map : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
+/*
+ * If a time window file was given then cut all the windows in one pass
+ */
+
+    if (szWindowFile != NULL)
+        {
+        iNumWindows = iReadWindowFile(szWindowFile, argv[2], &asuWindows);
+        if (iNumWindows <= 0)
+            {
+            fprintf(stderr, "Error reading time window file '%s'\n", szWindowFile);
+            return 1;
+            }
+
+        printf("Input Data File  '%s'\n",argv[1]);
+        printf("Time Window File '%s'\n",szWindowFile);
+
+        iStatus = iTrimWindows(iI106_In, asuWindows, iNumWindows);
+
+        enI106Ch10Close(iI106_In);
+        vTimeMap_Free(&m_suTimeMap);
+        free(asuWindows);
+        return iStatus;
+        }
+
 /*
  * Open the output file
  */
@@ -287,7 +370,7 @@ int main (int argc, char *argv[])
         }
 
     // Figure out start/stop counts
-    enStatus = enI106_Rel2IrigTime(iI106_In, suI106Hdr.aubyRefTime, &suTime);
+    enStatus = enTimeMap_Rel2IrigTime(&m_suTimeMap, iI106_In, suI106Hdr.aubyRefTime, &suTime);
     psuTmTime = gmtime((time_t *)&suTime.ulSecs);
 
     if (bUseStartTime == bTRUE)
@@ -297,9 +380,7 @@ int main (int argc, char *argv[])
         psuTmTime->tm_sec  = iStartSec;
         suStartTime.ulFrac = 0L;
         suStartTime.ulSecs = mkgmtime(psuTmTime);
-        enI106_Irig2RelTime(iI106_In, &suStartTime, abyStartTime);
-        llStartTime = 0L;
-        memcpy((char *)&(llStartTime), (char *)&abyStartTime, 6);
+        enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &suStartTime, &llStartTime);
         }
 
     if (bUseStopTime == bTRUE)
@@ -309,9 +390,7 @@ int main (int argc, char *argv[])
         psuTmTime->tm_sec  = iStopSec;
         suStopTime.ulFrac = 0L;
         suStopTime.ulSecs = mkgmtime(psuTmTime);
-        enI106_Irig2RelTime(iI106_In, &suStopTime, abyStopTime);
-        llStopTime = 0L;
-        memcpy((char *)&(llStopTime), (char *)&abyStopTime, 6);
+        enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &suStopTime, &llStopTime);
         // Handle midnight rollover
         if ((bUseStartTime == bTRUE) && (llStopTime < llStartTime))
             llStopTime += (int64_t)(60 * 60 * 24) * (int64_t)10000000;
@@ -404,23 +483,21 @@ int main (int argc, char *argv[])
                 enStatus = enI106Ch10ReadData(iI106_In, ulTimeBuffSize, pvTimeBuff);
                 bHaveTime = bTRUE;
 
-                // Update the relative to clock time mapping and update the time limit values
-                enI106_Decode_TimeF1(&suTimeHdr, pvTimeBuff, &suTime);
-                enI106_SetRelTime(iI106_In, &suTime, suI106Hdr.aubyRefTime);
-                if (bUseStartTime == bTRUE)
+                // Update the relative to clock time mapping and update the time
+                // limit values. A time map already has every time packet.
+                if (bUseTimeMap == bFALSE)
                     {
-                    enI106_Irig2RelTime(iI106_In, &suStartTime, abyStartTime);
-                    llStartTime = 0L;
-                    memcpy((char *)&(llStartTime), (char *)&abyStartTime, 6);
-                    }
-                if (bUseStopTime == bTRUE)
-                    {
-                    enI106_Irig2RelTime(iI106_In, &suStopTime, abyStopTime);
-                    llStopTime = 0L;
-                    memcpy((char *)&(llStopTime), (char *)&abyStopTime, 6);
-                    // Handle midnight rollover
-                    if ((bUseStartTime == bTRUE) && (llStopTime < llStartTime))
-                        llStopTime += (int64_t)(60 * 60 * 24) * (int64_t)10000000;
+                    enI106_Decode_TimeF1(&suTimeHdr, pvTimeBuff, &suTime);
+                    enI106_SetRelTime(iI106_In, &suTime, suI106Hdr.aubyRefTime);
+                    if (bUseStartTime == bTRUE)
+                        enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &suStartTime, &llStartTime);
+                    if (bUseStopTime == bTRUE)
+                        {
+                        enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &suStopTime, &llStopTime);
+                        // Handle midnight rollover
+                        if ((bUseStartTime == bTRUE) && (llStopTime < llStartTime))
+                            llStopTime += (int64_t)(60 * 60 * 24) * (int64_t)10000000;
+                        }
                     }
                 } // end if IRIG time packet
 
@@ -494,6 +571,7 @@ int main (int argc, char *argv[])
 
     enI106Ch10Close(iI106_In);
     enI106Ch10Close(iI106_Out);
+    vTimeMap_Free(&m_suTimeMap);
 
 
   return 0;
@@ -501,6 +579,356 @@ int main (int argc, char *argv[])
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Read a file of time windows. Each line is a start and stop time and an
+// optional output file name.  If no output file name is given then one is
+// made from the output file name on the command line with a segment number
+// appended.  Blank lines and lines starting with '#' are ignored.
+//
+//   hh:mm:ss hh:mm:ss [outfile]
+
+int iReadWindowFile(char * szWindowFile, char * szOutBase, SuTrimWindow ** ppsuWindows)
+    {
+    FILE              * psuWindowFile;
+    char                szLine[512];
+    char                szOutFile[256];
+    char                szBaseName[256];
+    char              * szExtension;
+    char              * pchExt;
+    SuTrimWindow      * psuWindow;
+    int                 iNumWindows;
+    int                 iTokens;
+
+    psuWindowFile = fopen(szWindowFile, "r");
+    if (psuWindowFile == NULL)
+        return -1;
+
+    // Split the output base name into name and extension
+    strncpy(szBaseName, szOutBase, sizeof(szBaseName)-1);
+    szBaseName[sizeof(szBaseName)-1] = '\0';
+    pchExt = strrchr(szBaseName, '.');
+    if ((pchExt != NULL) && (strpbrk(pchExt, "/\\") == NULL))
+        {
+        szExtension = &szOutBase[pchExt - szBaseName];
+        *pchExt = '\0';
+        }
+    else
+        szExtension = ".ch10";
+
+    iNumWindows  = 0;
+    *ppsuWindows = NULL;
+    while (fgets(szLine, sizeof(szLine), psuWindowFile) != NULL)
+        {
+        if ((szLine[0] == '#') || (szLine[0] == '\n') || (szLine[0] == '\r'))
+            continue;
+
+        *ppsuWindows = (SuTrimWindow *)realloc(*ppsuWindows, (iNumWindows+1) * sizeof(SuTrimWindow));
+        psuWindow = &((*ppsuWindows)[iNumWindows]);
+        memset(psuWindow, 0, sizeof(SuTrimWindow));
+
+        szOutFile[0] = '\0';
+        iTokens = sscanf(szLine, "%d:%d:%d %d:%d:%d %255s",
+            &psuWindow->iStartHour, &psuWindow->iStartMin, &psuWindow->iStartSec,
+            &psuWindow->iStopHour,  &psuWindow->iStopMin,  &psuWindow->iStopSec,
+            szOutFile);
+        if (iTokens < 6)
+            {
+            fprintf(stderr, "Bad time window '%s'\n", szLine);
+            continue;
+            }
+
+        if (iTokens == 7)
+            strcpy(psuWindow->szOutFile, szOutFile);
+        else
+            sprintf(psuWindow->szOutFile, "%.200s_%2.2d%.20s", szBaseName, iNumWindows+1, szExtension);
+
+        iNumWindows++;
+        } // end while reading lines
+
+    fclose(psuWindowFile);
+
+    return iNumWindows;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Convert a window's clock start and stop times to relative time counts.
+// Without a time map this needs to be redone every time the relative time
+// reference changes.
+
+void vWindowLimits(int iI106_In, SuTrimWindow * psuWindow)
+    {
+    enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &psuWindow->suStartTime, &psuWindow->llStartTime);
+    enTimeMap_Irig2RelInt(&m_suTimeMap, iI106_In, &psuWindow->suStopTime,  &psuWindow->llStopTime);
+
+    // Handle midnight rollover
+    if (psuWindow->llStopTime < psuWindow->llStartTime)
+        psuWindow->llStopTime += (int64_t)(60 * 60 * 24) * (int64_t)10000000;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Copy every time window to its own output file in a single pass through
+// the input file.  Each output file starts with the TMATS packet and the most
+// recent time packet, same as a single trim.  Packets that fall outside of
+// all windows are skipped without reading their data.
+
+int iTrimWindows(int iI106_In, SuTrimWindow * asuWindows, int iNumWindows)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suI106Hdr;
+    SuIrig106Time       suTime;
+    struct tm         * psuTmTime;
+    unsigned long       ulBuffSize = 0;
+    void              * pvBuff = NULL;
+    int64_t             llPacketTime;
+
+    SuI106Ch10Header    suTmatsHdr;
+    void              * pvTmatsBuff = NULL;
+    int                 bHaveTmats = bFALSE;
+
+    SuI106Ch10Header    suTimeHdr;
+    void              * pvTimeBuff = NULL;
+    unsigned long       ulTimeBuffSize = 0;
+    int                 bHaveTime = bFALSE;
+
+    SuTrimWindow      * psuWindow;
+    int                 iWindowIdx;
+    int                 iWindowsLeft;
+    int                 bInWindow;
+    int                 iStatus = 0;
+
+    // Read the first message header
+    enStatus = enI106Ch10ReadNextHeader(iI106_In, &suI106Hdr);
+    if (enStatus != I106_OK)
+        {
+        fprintf(stderr, "Error reading header : Status = %d\n", enStatus);
+        return 1;
+        }
+
+    // Use the first packet time to fill in the day for all the windows
+    enTimeMap_Rel2IrigTime(&m_suTimeMap, iI106_In, suI106Hdr.aubyRefTime, &suTime);
+    psuTmTime = gmtime((time_t *)&suTime.ulSecs);
+    for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+        {
+        psuWindow = &asuWindows[iWindowIdx];
+
+        psuTmTime->tm_hour = psuWindow->iStartHour;
+        psuTmTime->tm_min  = psuWindow->iStartMin;
+        psuTmTime->tm_sec  = psuWindow->iStartSec;
+        psuWindow->suStartTime.ulFrac = 0L;
+        psuWindow->suStartTime.ulSecs = mkgmtime(psuTmTime);
+
+        psuTmTime->tm_hour = psuWindow->iStopHour;
+        psuTmTime->tm_min  = psuWindow->iStopMin;
+        psuTmTime->tm_sec  = psuWindow->iStopSec;
+        psuWindow->suStopTime.ulFrac = 0L;
+        psuWindow->suStopTime.ulSecs = mkgmtime(psuTmTime);
+
+        vWindowLimits(iI106_In, psuWindow);
+        }
+
+    iWindowsLeft = iNumWindows;
+    while (iWindowsLeft > 0)
+        {
+
+        do
+            {
+            vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llPacketTime);
+
+            // Keep a copy of the first TMATS packet for each output file
+            if ((suI106Hdr.ubyDataType == I106CH10_DTYPE_TMATS) &&
+                (bHaveTmats            == bFALSE              ))
+                {
+                pvTmatsBuff = malloc(suI106Hdr.ulPacketLen);
+                enStatus = enI106Ch10ReadData(iI106_In, suI106Hdr.ulPacketLen, pvTmatsBuff);
+                if (enStatus != I106_OK)
+                    {
+                    fprintf(stderr, " Error reading data : Status = %d\n", enStatus);
+                    free(pvTmatsBuff);
+                    pvTmatsBuff = NULL;
+                    break;
+                    }
+                memcpy(&suTmatsHdr, &suI106Hdr, sizeof(SuI106Ch10Header));
+                bHaveTmats = bTRUE;
+                break;
+                }
+
+            // Keep a copy of the latest time packet and update time limits
+            if (suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+                {
+                if (ulTimeBuffSize < suI106Hdr.ulPacketLen)
+                    {
+                    pvTimeBuff = realloc(pvTimeBuff, suI106Hdr.ulPacketLen);
+                    ulTimeBuffSize = suI106Hdr.ulPacketLen;
+                    }
+
+                enStatus = enI106Ch10ReadData(iI106_In, ulTimeBuffSize, pvTimeBuff);
+                if (enStatus != I106_OK)
+                    {
+                    fprintf(stderr, " Error reading data : Status = %d\n", enStatus);
+                    break;
+                    }
+                memcpy(&suTimeHdr, &suI106Hdr, sizeof(SuI106Ch10Header));
+                bHaveTime = bTRUE;
+
+                // A time map already has every time packet
+                if (m_suTimeMap.uNumPoints == 0)
+                    {
+                    enI106_Decode_TimeF1(&suTimeHdr, pvTimeBuff, &suTime);
+                    enI106_SetRelTime(iI106_In, &suTime, suI106Hdr.aubyRefTime);
+                    for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+                        vWindowLimits(iI106_In, &asuWindows[iWindowIdx]);
+                    }
+                }
+
+            // Open and close windows based on this packet's time
+            bInWindow = bFALSE;
+            for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+                {
+                psuWindow = &asuWindows[iWindowIdx];
+                if (psuWindow->bDone == bTRUE)
+                    continue;
+
+                // Past the stop time so this window is finished
+                if (llPacketTime > psuWindow->llStopTime)
+                    {
+                    if (psuWindow->bOpen == bTRUE)
+                        {
+                        enI106Ch10Close(psuWindow->iI106_Out);
+                        psuWindow->bOpen = bFALSE;
+                        printf("Wrote %8ld packets to '%s'\n", psuWindow->lWriteMsgs, psuWindow->szOutFile);
+                        }
+                    psuWindow->bDone = bTRUE;
+                    iWindowsLeft--;
+                    continue;
+                    }
+
+                if (llPacketTime < psuWindow->llStartTime)
+                    continue;
+
+                // Inside the window. If first packet then get the output file going.
+                if (psuWindow->bOpen == bFALSE)
+                    {
+                    enStatus = enI106Ch10Open(&psuWindow->iI106_Out, psuWindow->szOutFile, I106_OVERWRITE);
+                    if (enStatus != I106_OK)
+                        {
+                        fprintf(stderr, "Error opening output data file '%s' : Status = %d\n",
+                            psuWindow->szOutFile, enStatus);
+                        psuWindow->bDone = bTRUE;
+                        iWindowsLeft--;
+                        iStatus = 1;
+                        continue;
+                        }
+                    psuWindow->bOpen = bTRUE;
+
+                    if (bHaveTmats == bTRUE)
+                        {
+                        enI106Ch10WriteMsg(psuWindow->iI106_Out, &suTmatsHdr, pvTmatsBuff);
+                        psuWindow->lWriteMsgs++;
+                        }
+
+                    // If the current packet is itself time it gets written below
+                    if ((bHaveTime == bTRUE) && (suI106Hdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME))
+                        {
+                        enI106Ch10WriteMsg(psuWindow->iI106_Out, &suTimeHdr, pvTimeBuff);
+                        psuWindow->lWriteMsgs++;
+                        }
+                    } // end if window not open yet
+
+                bInWindow = bTRUE;
+                } // end for all windows
+
+            // Nothing wants this packet so don't bother reading the data
+            if (bInWindow == bFALSE)
+                break;
+
+            // Get the data if it wasn't already read as a time packet
+            if (suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+                {
+                for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+                    {
+                    psuWindow = &asuWindows[iWindowIdx];
+                    if (psuWindow->bOpen == bTRUE)
+                        {
+                        enI106Ch10WriteMsg(psuWindow->iI106_Out, &suTimeHdr, pvTimeBuff);
+                        psuWindow->lWriteMsgs++;
+                        }
+                    }
+                break;
+                }
+
+            // Make sure our buffer is big enough, size *does* matter
+            if (ulBuffSize < suI106Hdr.ulPacketLen)
+                {
+                pvBuff = realloc(pvBuff, suI106Hdr.ulPacketLen);
+                ulBuffSize = suI106Hdr.ulPacketLen;
+                }
+
+            enStatus = enI106Ch10ReadData(iI106_In, ulBuffSize, pvBuff);
+            if (enStatus != I106_OK)
+                {
+                fprintf(stderr, " Error reading data : Status = %d\n", enStatus);
+                break;
+                }
+
+            // Write it to every open window
+            for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+                {
+                psuWindow = &asuWindows[iWindowIdx];
+                if (psuWindow->bOpen == bTRUE)
+                    {
+                    enI106Ch10WriteMsg(psuWindow->iI106_Out, &suI106Hdr, pvBuff);
+                    psuWindow->lWriteMsgs++;
+                    }
+                }
+
+            } while (bFALSE); // end one time loop
+
+        // Read the next message header
+        enStatus = enI106Ch10ReadNextHeader(iI106_In, &suI106Hdr);
+
+        if (enStatus == I106_EOF)
+            break;
+
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, " Error reading header : Status = %d\n", enStatus);
+            break;
+            }
+
+        } // end while windows left to fill
+
+    // Close out any windows still open at the end of the file
+    for (iWindowIdx=0; iWindowIdx<iNumWindows; iWindowIdx++)
+        {
+        psuWindow = &asuWindows[iWindowIdx];
+        if (psuWindow->bOpen == bTRUE)
+            {
+            enI106Ch10Close(psuWindow->iI106_Out);
+            psuWindow->bOpen = bFALSE;
+            printf("Wrote %8ld packets to '%s'\n", psuWindow->lWriteMsgs, psuWindow->szOutFile);
+            }
+        else if (psuWindow->lWriteMsgs == 0)
+            printf("No data found for '%s'\n", psuWindow->szOutFile);
+        }
+
+    free(pvBuff);
+    free(pvTimeBuff);
+    free(pvTmatsBuff);
+
+    return iStatus;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 int64_t GetCh10FileSize(char * szFilename)
@@ -608,11 +1036,16 @@ void vUsage(void)
     printf("\nI106TRIM "MAJOR_VERSION"."MINOR_VERSION" "__DATE__" "__TIME__"\n");
     printf("Trim a Ch 10 data file based on time or file offset\n");
     printf("Freeware Copyright (C) 2006 Irig106.org\n\n");
-    printf("Usage: i106trim <infile> <outfile> [+hh:mm:ss] [-hh:mm:ss]\n");
+    printf("Usage: i106trim <infile> <outfile> [+hh:mm:ss] [-hh:mm:ss] [-w file] [-M]\n");
     printf("  +hh:mm:ss - Start copy time\n");
     printf("  -hh:mm:ss - Stop copy time\n");
     printf("  +<num>%%   - Start copy at position <num> percent into the file\n");
     printf("  -<num>%%   - Stop copy at position <num> percent into the file\n");
+    printf("  -w file   - Copy each time window listed in 'file' to its own output\n");
+    printf("              file in one pass. Each line is 'hh:mm:ss hh:mm:ss [outfile]'.\n");
+    printf("              Default output names are <outfile>_NN.\n");
+    printf("  -M        - Convert times with a map of all time packets, read or\n");
+    printf("              made beside the data file\n");
     printf("Or:    fftrim <infile> to get stats\n");
     return;
     }
@@ -38,6 +38,11 @@
 
   ==========================================================================*/
 
+// Needed for recvmmsg()
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -63,6 +68,20 @@
 #include <sys/select.h>
 #endif
 
+// Stuff for the ring buffered receiver. The Makefile packs structures so
+// put the kernel interface structures back to their natural alignment.
+#if defined(__linux__)
+#define RING_RECEIVE
+#define ROTATE_OUTPUT
+#pragma pack(push, 8)
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#pragma pack(pop)
+#endif
+
 // IRIG library
 #include "i106_stdint.h"
 #include "config.h"
@@ -75,7 +94,7 @@
 // ----------------------
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "01"
+#define MINOR_VERSION  "05"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -83,9 +102,139 @@
 #endif
 
 
+#if defined(RING_RECEIVE)
+#define RING_SLOT_SIZE      0x10000     // Big enough for any UDP datagram
+#define RING_DEFAULT_SLOTS  2048        // Must be a power of 2
+#define RING_BATCH          64          // Max datagrams per recvmmsg() call
+#define RING_CONSUMERS      2           // Decode thread and writer thread
+#define MAX_PACKET_SIZE     0x80000     // Biggest Ch 10 packet to reassemble
+#endif
+
+#define STATS_SLOTS         4096        // Channel / data type combinations, power of 2
+
+#if defined(ROTATE_OUTPUT)
+#define WRITE_BUFF_SIZE     0x400000    // Bytes per write, a multiple of the disk block size
+#define WRITE_BUFF_ALIGN    4096
+#define PREALLOC_CHUNK      0x10000000  // Grow files this much at a time
+#endif
+
+// Statistics counters are bumped by the decode thread and read by whoever
+// prints them, so use atomic access where there are threads.
+#if defined(__GNUC__)
+#define STATS_ADD(pul, ulVal)   __atomic_add_fetch((pul), (ulVal), __ATOMIC_RELAXED)
+#define STATS_GET(pul)          __atomic_load_n((pul), __ATOMIC_RELAXED)
+#define STATS_PUBLISH(pu, uVal) __atomic_store_n((pu), (uVal), __ATOMIC_RELEASE)
+#define STATS_ACQUIRE(pu)       __atomic_load_n((pu), __ATOMIC_ACQUIRE)
+#else
+#define STATS_ADD(pul, ulVal)   (*(pul) += (ulVal))
+#define STATS_GET(pul)          (*(pul))
+#define STATS_PUBLISH(pu, uVal) (*(pu) = (uVal))
+#define STATS_ACQUIRE(pu)       (*(pu))
+#endif
+
+
 // Data structures
 // ---------------
 
+// Counters for one channel and data type combination
+typedef struct
+    {
+    uint32_t            uKey;           // (ChanID << 8 | DataType) + 1, 0 = unused
+    unsigned long       ulPackets;
+    unsigned long long  ullBytes;
+    unsigned long       ulSeqErrs;
+    unsigned long       ulChksumErrs;
+    unsigned long       ulPrevPackets;  // Used by the report for rates
+    unsigned long long  ullPrevBytes;
+    } SuPacketStats;
+
+#if defined(RING_RECEIVE)
+
+// Datagram ring. There is one producer (the receive thread) and one read
+// index for each consumer thread. A slot is free again when all consumers
+// are done with it.
+typedef struct
+    {
+    uint8_t           * pabySlab;       // RING_SLOT_SIZE bytes for each slot
+    uint32_t          * aulSlotLen;     // Datagram length in each slot
+    uint32_t            uNumSlots;
+    uint32_t            uHead;          // Next slot to fill
+    uint32_t            auTail[RING_CONSUMERS]; // Next slot to read
+    int                 iSocket;
+    int                 bStop;          // Tell the receive thread to quit
+    int                 bRcvDone;       // Receive thread has quit
+    unsigned long       ulDatagrams;    // Datagrams received
+    unsigned long long  ullBytes;       // Bytes received
+    unsigned long       ulRingDrops;    // Datagrams dropped, ring full
+    unsigned long       ulTruncated;    // Datagrams too big for a slot
+    } SuUdpRing;
+
+// Ch 10 UDP transfer header format 1 values
+typedef enum
+    {
+    UDP_MSG_FULL      = 0,              // One or more complete Ch 10 packets
+    UDP_MSG_SEGMENTED = 1,              // Part of one Ch 10 packet
+    } EnUdpMsgType;
+
+// State for one consumer of the datagram ring
+typedef struct SuUdpConsumer_S
+    {
+    int                 iConsumer;      // Index into the ring tails
+    SuUdpRing         * psuRing;
+
+    // Segmented packet reassembly
+    uint8_t           * pabyPacket;
+    uint32_t            ulPacketLen;
+    uint32_t            ulNextOffset;
+    int                 bAssembling;
+
+    // Callback for each complete Ch 10 packet
+    void             (* pfPacket)(struct SuUdpConsumer_S * psuConsumer,
+                                  SuI106Ch10Header * psuHdr, void * pvData);
+
+    // Stream statistics
+    int                 bHaveUdpSeq;
+    uint32_t            uPrevUdpSeq;
+    unsigned long       ulUdpSeqGaps;   // Missing UDP transfer sequence numbers
+    unsigned long       ulFormatErrs;   // Unknown transfer format or bad packet
+    unsigned long       ulSegmentErrs;  // Segments lost or out of order
+    unsigned long       ulPackets;      // Ch 10 packets delivered
+    } SuUdpConsumer;
+
+#endif
+
+#if defined(ROTATE_OUTPUT)
+
+// Rotating output file writer. Packets are gathered into a big aligned
+// buffer and written a buffer at a time. A new file is started at a size
+// or time boundary and begins with the TMATS packet and the latest time
+// packet so that each file can be used on its own.
+typedef struct
+    {
+    char                szStem[256];    // Output file name without extension
+    char                szExt[32];      // Output file name extension
+    int                 iFile;          // Current output file, -1 = none open
+    int                 iFileNum;       // Number of the current output file
+    int64_t             llFileSize;     // Bytes written to the current file
+    int64_t             llAllocSize;    // Bytes preallocated for the current file
+    int                 bPrealloc;      // Preallocation works on this file system
+    unsigned long       ulFilePackets;  // Stream packets in the current file
+    int64_t             llRollSize;     // Start a new file at this size, 0 = never
+    int                 iRollSecs;      // Start a new file after this long, 0 = never
+    time_t              lFileStart;     // When the current file was started
+    uint8_t           * pabyBuff;       // Aligned write buffer
+    uint32_t            ulBuffUsed;
+    int                 bWriteErr;      // Write error reported
+    uint8_t           * pabyTmats;      // Whole TMATS packet to start each file
+    uint32_t            ulTmatsLen;
+    uint32_t            ulTmatsSize;
+    int                 bTmatsFromFile; // TMATS came from -c so keep it
+    uint8_t           * pabyTime;       // Latest whole time packet
+    uint32_t            ulTimeLen;
+    uint32_t            ulTimeSize;
+    } SuCh10Writer;
+
+#endif
 
 
 // Module data
@@ -113,10 +262,54 @@ char * aszPacketType[] = {
     "CAN",          "Fibre Channel Fmt 0","UNDEFINED","UNDEFINED",  "UNDEFINED",    "UNDEFINED",    "UNDEFINED",    "UNDEFINED",
 	"UNDEFINED" };
 
+int             m_bQuiet = bFALSE;              // Statistics instead of packet lines
+int16_t         m_aiPrevChanSeq[0x10000];       // Last sequence number per channel, -1 = none
+SuPacketStats   m_asuStats[STATS_SLOTS];        // Hashed by channel and data type
+uint32_t        m_auStatsOrder[STATS_SLOTS];    // Slots in the order they were first seen
+uint32_t        m_uNumStats = 0;
+unsigned long   m_ulStatsOverflow = 0L;
+
+#if defined(ROTATE_OUTPUT)
+int             m_bRollOutput = bFALSE;         // Write through the rotating writer
+SuCh10Writer    m_suWriter;
+#endif
+
+#if defined(RING_RECEIVE)
+int             m_iI106_Out;        // Output file handle for the writer thread
+int             m_bWriteFile;
+int             m_bHaveTmats;
+int             m_bHaveTime;
+#endif
+
 // Function prototypes
 // -------------------
 
 void    vUsage(void);
+void    vUpdateStats(SuI106Ch10Header * psuHdr);
+void    vPrintStats(FILE * psuOutFile, double dInterval, int bFinal);
+
+#if defined(RING_RECEIVE)
+int     iRingReceive(unsigned int uPort, unsigned int uRingSlots, int iRcvBufSize, int iBusyPoll);
+void  * pvReceiveThread(void * pvRing);
+void  * pvConsumerThread(void * pvConsumer);
+void    vProcessDatagram(SuUdpConsumer * psuConsumer, uint8_t * pabyDgram, uint32_t ulDgramLen);
+void    vProcessPackets(SuUdpConsumer * psuConsumer, uint8_t * pabyData, uint32_t ulDataLen);
+void    vPrintPacket(SuUdpConsumer * psuConsumer, SuI106Ch10Header * psuHdr, void * pvData);
+void    vWritePacket(SuUdpConsumer * psuConsumer, SuI106Ch10Header * psuHdr, void * pvData);
+#endif
+
+#if defined(ROTATE_OUTPUT)
+int     bWriterInit(SuCh10Writer * psuWriter, char * szOutFile, int64_t llRollSize, int iRollSecs);
+void    vWriterSetTmats(SuCh10Writer * psuWriter, SuI106Ch10Header * psuHdr, void * pvData);
+void    vWriterPacket(SuCh10Writer * psuWriter, SuI106Ch10Header * psuHdr, void * pvData, int bWrite);
+void    vWriterClose(SuCh10Writer * psuWriter);
+int     bWriterNewFile(SuCh10Writer * psuWriter, unsigned int uDataType);
+void    vWriterCloseFile(SuCh10Writer * psuWriter);
+void    vWriterAppend(SuCh10Writer * psuWriter, void * pvData, uint32_t ulDataLen);
+void    vWriterFlush(SuCh10Writer * psuWriter, uint32_t ulFlushLen);
+void    vCopyPacket(uint8_t ** ppabyCopy, uint32_t * pulCopyLen, uint32_t * pulCopySize,
+                    SuI106Ch10Header * psuHdr, void * pvData);
+#endif
 
 #if defined(__GNUC__)
 int _kbhit();
@@ -147,6 +340,13 @@ int main (int argc, char *argv[])
     int                 bHaveTime     = bTRUE;
     int                 bWriteFile    = bFALSE;
 	int                 bReadFromPcap = bFALSE;
+    int                 bRingReceive  = bFALSE;
+    unsigned int        uRingSlots    = 0;
+    int                 iRcvBufSize   = 0;
+    int                 iBusyPoll     = 0;
+    int                 iRollMBytes   = 0;
+    int                 iRollSecs     = 0;
+    time_t              lLastReport;
 
 // Process the command line arguments
 // ----------------------------------
@@ -191,12 +391,77 @@ int main (int argc, char *argv[])
                         bHaveTime = bFALSE;
                         break;
 
+                    case 'q' :                  // Quiet, statistics only
+                        m_bQuiet = bTRUE;
+                        break;
+
                     case 'P':                   // Read from pcap file
                         iArgIdx++;
                         bReadFromPcap = bTRUE;
                         szPcapFile = argv[iArgIdx];
                         break;
 
+#if defined(RING_RECEIVE)
+                    case 'R' :                  // Ring buffered receive
+                        bRingReceive = bTRUE;
+                        break;
+
+                    case 'N' :                  // Number of ring slots
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%u",&uRingSlots) != 1) ||
+                            (uRingSlots == 0) || ((uRingSlots & (uRingSlots-1)) != 0))
+                            {
+                            printf("Ring size must be a power of 2\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 'B' :                  // Socket receive buffer size
+                        iArgIdx++;
+                        if (sscanf(argv[iArgIdx],"%d",&iRcvBufSize) != 1)
+                            {
+                            printf("Bad receive buffer size\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 'b' :                  // Busy poll time
+                        iArgIdx++;
+                        if (sscanf(argv[iArgIdx],"%d",&iBusyPoll) != 1)
+                            {
+                            printf("Bad busy poll time\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+#endif
+
+#if defined(ROTATE_OUTPUT)
+                    case 'S' :                  // Roll output file size
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%d",&iRollMBytes) != 1) || (iRollMBytes <= 0))
+                            {
+                            printf("Bad output file size\n");
+                            vUsage();
+                            return 1;
+                            }
+                        m_bRollOutput = bTRUE;
+                        break;
+
+                    case 'D' :                  // Roll output file duration
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%d",&iRollSecs) != 1) || (iRollSecs <= 0))
+                            {
+                            printf("Bad output file duration\n");
+                            vUsage();
+                            return 1;
+                            }
+                        m_bRollOutput = bTRUE;
+                        break;
+#endif
+
                     default :
                         break;
                     } // end switch on flag character
@@ -220,8 +485,27 @@ int main (int argc, char *argv[])
 
 // Open the input UDPstream and get things setup
 
+#if defined(ROTATE_OUTPUT)
+    // Rotating output is written on the ring receiver's write thread so file
+    // opens and big writes at each new file don't hold up receiving
+    if (m_bRollOutput && (bRingReceive == bFALSE))
+        {
+        fprintf(stderr, "Rotating output files (-S, -D) need ring buffered receive (-R)\n");
+        return 1;
+        }
+#endif
+
     // Open the input data stream
-    if (bReadFromPcap == bFALSE)
+    if (bRingReceive == bTRUE)
+        {
+        if (bReadFromPcap == bTRUE)
+            {
+            fprintf(stderr, "Ring buffered receive can't read a pcap file\n");
+            return 1;
+            }
+        } // end if ring buffered receive
+
+    else if (bReadFromPcap == bFALSE)
         {
         enStatus = enI106Ch10OpenStreamRead(&iI106_In, uPort);
         if (enStatus != I106_OK)
@@ -246,6 +530,13 @@ int main (int argc, char *argv[])
 
     if (szOutFile != NULL)
         {
+#if defined(ROTATE_OUTPUT)
+        // Rotating output files are opened as packets come in
+        if (m_bRollOutput)
+            enStatus = bWriterInit(&m_suWriter, szOutFile,
+                (int64_t)iRollMBytes * 1024 * 1024, iRollSecs) ? I106_OK : I106_OPEN_ERROR;
+        else
+#endif
         enStatus = enI106Ch10Open(&iI106_Out, szOutFile, I106_OVERWRITE);
         if (enStatus != I106_OK)
             {
@@ -346,6 +637,11 @@ int main (int argc, char *argv[])
                     enI106_Free_TmatsInfo(&suTmatsInfo);
 
                     // Write it to the output file
+#if defined(ROTATE_OUTPUT)
+                    if (m_bRollOutput)
+                        vWriterSetTmats(&m_suWriter, &suI106Hdr, pvBuff);
+                    else
+#endif
                     enStatus = enI106Ch10WriteMsg(iI106_Out, &suI106Hdr, pvBuff);
 
                     // Close the TMATS file
@@ -361,6 +657,17 @@ int main (int argc, char *argv[])
 
     if (bWriteFile)
         {
+#if defined(ROTATE_OUTPUT)
+        if (m_bRollOutput)
+            {
+            fprintf(stderr, "Writing packets to files '%s_NNNN%s'\n", m_suWriter.szStem, m_suWriter.szExt);
+            if (iRollMBytes != 0)
+                fprintf(stderr, "New file every %d MB\n", iRollMBytes);
+            if (iRollSecs != 0)
+                fprintf(stderr, "New file every %d seconds\n", iRollSecs);
+            }
+        else
+#endif
         fprintf(stderr, "Writing packets to file '%s'\n", szOutFile);
         if (!bHaveTmats)
             fprintf(stderr, "Wait for first TMATS packet\n");
@@ -369,9 +676,36 @@ int main (int argc, char *argv[])
         fprintf(stderr, "\n");
         }
 
+#if defined(RING_RECEIVE)
+// Ring buffered receive runs on its own threads until a key is pressed
+// --------------------------------------------------------------------
+
+    if (bRingReceive == bTRUE)
+        {
+        int     iStatus;
+
+        m_iI106_Out  = iI106_Out;
+        m_bWriteFile = bWriteFile;
+        m_bHaveTmats = bHaveTmats;
+        m_bHaveTime  = bHaveTime;
+
+        iStatus = iRingReceive(uPort, uRingSlots, iRcvBufSize, iBusyPoll);
+
+        if (bWriteFile && m_bRollOutput)
+            vWriterClose(&m_suWriter);
+        else if (bWriteFile)
+            enI106Ch10Close(iI106_Out);
+
+        return iStatus;
+        }
+#endif
+
 // Read data packets until EOF
 // ---------------------------
 
+    memset(m_aiPrevChanSeq, 0xff, sizeof(m_aiPrevChanSeq));
+    lLastReport = time(NULL);
+
     lPackets = 0L;
     enStatus = I106_OK;
     while ((!_kbhit()) && (enStatus != I106_EOF))
@@ -407,12 +741,13 @@ int main (int argc, char *argv[])
                 break;
                 }
 
-uint16_t uHdrChksum  = uCalcHeaderChecksum(&suI106Hdr);
-uint16_t uSHdrChksum = uCalcSecHeaderChecksum(&suI106Hdr);
+            // Count packets, bytes, and errors
+            vUpdateStats(&suI106Hdr);
 
             // Print some general information
-            printf("Ch %2d %-20s (0x%2.2x)", suI106Hdr.uChID, 
-                aszPacketType[suI106Hdr.ubyDataType], suI106Hdr.ubyDataType);
+            if (!m_bQuiet)
+                printf("Ch %2d %-20s (0x%2.2x)", suI106Hdr.uChID, 
+                    aszPacketType[suI106Hdr.ubyDataType], suI106Hdr.ubyDataType);
 
             // Decode some selected message types
             switch (suI106Hdr.ubyDataType)
@@ -436,7 +771,8 @@ uint16_t uSHdrChksum = uCalcSecHeaderChecksum(&suI106Hdr);
                     enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
                     enI106_SetRelTime(iI106_In, &suTime, suI106Hdr.aubyRefTime);
 
-                    printf(" %s", IrigTime2String(&suTime));
+                    if (!m_bQuiet)
+                        printf(" %s", IrigTime2String(&suTime));
                     break;
 
                 case I106CH10_DTYPE_NETWORK_TIME :
@@ -449,7 +785,8 @@ uint16_t uSHdrChksum = uCalcSecHeaderChecksum(&suI106Hdr);
                     enI106_Decode_TimeF2(&suI106Hdr, pvBuff, &suTime); 
                     enI106_SetRelTime(iI106_In, &suTime, suI106Hdr.aubyRefTime);
 
-                    printf(" %s", IrigTime2String(&suTime));
+                    if (!m_bQuiet)
+                        printf(" %s", IrigTime2String(&suTime));
                     break;
 
                 case I106CH10_DTYPE_PCM_FMT_0 :
@@ -483,21 +820,30 @@ uint16_t uSHdrChksum = uCalcSecHeaderChecksum(&suI106Hdr);
 //                    printf("Data Type 0x%2.2x\n", suI106Hdr.ubyDataType);
                     break;
                 } // end switch on data type
-            printf("\n");
+            if (!m_bQuiet)
+                printf("\n");
 
-                // Write packet to Ch 10 file
-                if (bWriteFile && bHaveTmats && bHaveTime)
-                    enStatus = enI106Ch10WriteMsg(iI106_Out, &suI106Hdr, pvBuff);
+            // Write packet to Ch 10 file
+            if (bWriteFile && bHaveTmats && bHaveTime)
+                enStatus = enI106Ch10WriteMsg(iI106_Out, &suI106Hdr, pvBuff);
 
-                lPackets++;
+            lPackets++;
 
             } while (bFALSE); // end one time loop
 
+        // Once a second show the statistics
+        if (m_bQuiet && (time(NULL) != lLastReport))
+            {
+            vPrintStats(stdout, (double)(time(NULL) - lLastReport), bFALSE);
+            lLastReport = time(NULL);
+            }
+
         }   // End while waiting for keypress
 
 // Print some stats, close the files, and get outa here
 // ----------------------------------------------------
 
+    vPrintStats(stdout, 0.0, bTRUE);
     printf("Packets Read %ld\n",lPackets);
 
     enI106Ch10Close(iI106_In);
@@ -517,17 +863,154 @@ void vUsage(void)
     printf("\nI106UDPRCV "MAJOR_VERSION"."MINOR_VERSION" "__DATE__" "__TIME__"\n");
     printf("Receive Ch 10 UDP data stream\n");
     printf("Freeware Copyright (C) 2015 Irig106.org\n\n");
-    printf("Usage: i106udprcv -p port [-c filename] [-T] [-t] [-P filename] [outfile]\n");
+    printf("Usage: i106udprcv -p port [-c filename] [-T] [-t] [-P filename] [-q] [-R]\n");
+    printf("                  [-S MB] [-D sec] [outfile]\n");
     printf("  -p port      Receive UDP port number\n");
     printf("  -c filename  Prepend TMATS config file to output file\n");
     printf("  -T           Wait for TMATS packet before recording\n");
     printf("  -t           Wait for time packet before recording\n");
 	printf("  -P filename  Read network data from pcap file\n");
+    printf("  -q           Quiet, show statistics once a second instead of packets\n");
+#if defined(RING_RECEIVE)
+    printf("  -R           Ring buffered receive with separate receive, decode,\n");
+    printf("               and write threads\n");
+    printf("  -N slots     Number of datagram ring slots (default %d)\n", RING_DEFAULT_SLOTS);
+    printf("  -B bytes     Socket receive buffer size for -R\n");
+    printf("  -b usec      Socket busy poll time for -R\n");
+#endif
+#if defined(ROTATE_OUTPUT)
+    printf("  -S MB        Start a new output file every 'MB' megabytes, with -R\n");
+    printf("  -D sec       Start a new output file every 'sec' seconds, with -R\n");
+#endif
 	printf("  outfile      Output Ch 10 file name\n");
     return;
     }
 
 
+
+// ----------------------------------------------------------------------------
+
+// Update the counters for this packet's channel and data type. Only one
+// thread updates counters. A new slot's key is published last so a reader
+// never sees a half made slot.
+
+void vUpdateStats(SuI106Ch10Header * psuHdr)
+    {
+    SuPacketStats     * psuStats;
+    uint32_t            uKey;
+    uint32_t            uSlot;
+    uint32_t            uProbe;
+    int                 iPrevSeq;
+
+    // Find the slot for this channel and data type
+    uKey  = (((uint32_t)psuHdr->uChID << 8) | psuHdr->ubyDataType) + 1;
+    uSlot = (uKey * 2654435761u) >> 20;
+    for (uProbe=0; uProbe<STATS_SLOTS; uProbe++)
+        {
+        psuStats = &m_asuStats[(uSlot + uProbe) & (STATS_SLOTS - 1)];
+        if (psuStats->uKey == uKey)
+            break;
+        if (psuStats->uKey == 0)
+            {
+            memset(psuStats, 0, sizeof(SuPacketStats));
+            STATS_PUBLISH(&psuStats->uKey, uKey);
+            m_auStatsOrder[m_uNumStats] = (uSlot + uProbe) & (STATS_SLOTS - 1);
+            STATS_PUBLISH(&m_uNumStats, m_uNumStats + 1);
+            break;
+            }
+        }
+    if (uProbe == STATS_SLOTS)
+        {
+        m_ulStatsOverflow++;
+        return;
+        }
+
+    STATS_ADD(&psuStats->ulPackets, 1);
+    STATS_ADD(&psuStats->ullBytes,  psuHdr->ulPacketLen);
+
+    // Sequence numbers count up per channel
+    iPrevSeq = m_aiPrevChanSeq[psuHdr->uChID];
+    if ((iPrevSeq != -1) && (((iPrevSeq + 1) & 0xff) != psuHdr->ubySeqNum))
+        STATS_ADD(&psuStats->ulSeqErrs, 1);
+    m_aiPrevChanSeq[psuHdr->uChID] = psuHdr->ubySeqNum;
+
+    // Check the header checksums
+    if (uCalcHeaderChecksum(psuHdr) != psuHdr->uChecksum)
+        STATS_ADD(&psuStats->ulChksumErrs, 1);
+    else if (((psuHdr->ubyPacketFlags & I106CH10_PFLAGS_SEC_HEADER) != 0) &&
+             (uCalcSecHeaderChecksum(psuHdr) != psuHdr->uSecChecksum))
+        STATS_ADD(&psuStats->ulChksumErrs, 1);
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Print the statistics table, either rates over the last interval or the
+// final totals
+
+void vPrintStats(FILE * psuOutFile, double dInterval, int bFinal)
+    {
+    SuPacketStats     * psuStats;
+    uint32_t            uNumStats;
+    uint32_t            uStatsIdx;
+    unsigned int        uChanID;
+    unsigned int        uDataType;
+    unsigned long       ulPackets;
+    unsigned long long  ullBytes;
+    unsigned long       ulTotalPackets = 0L;
+    unsigned long long  ullTotalBytes  = 0L;
+
+    uNumStats = STATS_ACQUIRE(&m_uNumStats);
+    if (uNumStats == 0)
+        return;
+
+    if (bFinal)
+        fprintf(psuOutFile, "\n   Ch  Type                   Packets          Bytes   Seq Errs  Chksum Errs\n");
+    else
+        fprintf(psuOutFile, "\n   Ch  Type                 Pkts/sec       Mbps   Packets  Seq Errs  Chksum Errs\n");
+
+    for (uStatsIdx=0; uStatsIdx<uNumStats; uStatsIdx++)
+        {
+        psuStats  = &m_asuStats[m_auStatsOrder[uStatsIdx]];
+        uChanID   = (STATS_ACQUIRE(&psuStats->uKey) - 1) >> 8;
+        uDataType = (STATS_ACQUIRE(&psuStats->uKey) - 1) & 0xff;
+        ulPackets = STATS_GET(&psuStats->ulPackets);
+        ullBytes  = STATS_GET(&psuStats->ullBytes);
+
+        if (bFinal)
+            fprintf(psuOutFile, "%5u  %-20s %9lu %14llu %10lu %12lu\n",
+                uChanID,
+                uDataType < sizeof(aszPacketType)/sizeof(char *) ? aszPacketType[uDataType] : "UNDEFINED",
+                ulPackets, ullBytes,
+                STATS_GET(&psuStats->ulSeqErrs), STATS_GET(&psuStats->ulChksumErrs));
+        else
+            fprintf(psuOutFile, "%5u  %-20s %10.0f %10.3f %9lu %9lu %12lu\n",
+                uChanID,
+                uDataType < sizeof(aszPacketType)/sizeof(char *) ? aszPacketType[uDataType] : "UNDEFINED",
+                (ulPackets - psuStats->ulPrevPackets) / dInterval,
+                (ullBytes - psuStats->ullPrevBytes) * 8.0 / dInterval / 1000000.0,
+                ulPackets,
+                STATS_GET(&psuStats->ulSeqErrs), STATS_GET(&psuStats->ulChksumErrs));
+
+        psuStats->ulPrevPackets = ulPackets;
+        psuStats->ullPrevBytes  = ullBytes;
+        ulTotalPackets += ulPackets;
+        ullTotalBytes  += ullBytes;
+        } // end for all channel and type combinations
+
+    if (bFinal)
+        fprintf(psuOutFile, "Total Packets %lu  Bytes %llu\n", ulTotalPackets, ullTotalBytes);
+    if (m_ulStatsOverflow != 0)
+        fprintf(psuOutFile, "Packets not counted, too many channels %lu\n", m_ulStatsOverflow);
+    fflush(psuOutFile);
+
+    return;
+    }
+
+
 // ----------------------------------------------------------------------------
 
 #if defined(__GNUC__)
@@ -556,3 +1039,829 @@ int _kbhit()
     }
 
 #endif
+
+
+
+// ----------------------------------------------------------------------------
+// Ring buffered receive
+// ----------------------------------------------------------------------------
+
+#if defined(RING_RECEIVE)
+
+// A dedicated receive thread pulls datagrams off the socket in batches with
+// recvmmsg() straight into a preallocated ring. A decode thread prints
+// packets and a writer thread writes them to the output file, each working
+// at its own pace from its own read index. If the ring fills up, datagrams
+// are read and thrown away so the socket never backs up, and the drop is
+// counted.
+
+int iRingReceive(unsigned int uPort, unsigned int uRingSlots, int iRcvBufSize, int iBusyPoll)
+    {
+    SuUdpRing               suRing;
+    SuUdpConsumer           asuConsumer[RING_CONSUMERS];
+    pthread_t               hRcvThread;
+    pthread_t               ahConsumerThread[RING_CONSUMERS];
+    int                     iNumConsumers;
+    int                     iConsumerIdx;
+    struct sockaddr_in      suAddr;
+    struct timeval          suTimeout;
+    int                     iActualBufSize;
+    socklen_t               iOptLen;
+    uint32_t                uDepth;
+    uint32_t                uMaxDepth;
+    unsigned long           ulPrevDatagrams = 0L;
+    int                     iTicks = 0;
+
+    memset(&suRing, 0, sizeof(suRing));
+    memset(asuConsumer, 0, sizeof(asuConsumer));
+    memset(m_aiPrevChanSeq, 0xff, sizeof(m_aiPrevChanSeq));
+
+    // Make the ring
+    suRing.uNumSlots  = (uRingSlots != 0) ? uRingSlots : RING_DEFAULT_SLOTS;
+    suRing.pabySlab   = (uint8_t *)malloc((size_t)suRing.uNumSlots * RING_SLOT_SIZE);
+    suRing.aulSlotLen = (uint32_t *)malloc(suRing.uNumSlots * sizeof(uint32_t));
+    if ((suRing.pabySlab == NULL) || (suRing.aulSlotLen == NULL))
+        {
+        fprintf(stderr, "Error allocating %u slot receive ring\n", suRing.uNumSlots);
+        return 1;
+        }
+
+    // Open the socket
+    suRing.iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (suRing.iSocket == -1)
+        {
+        fprintf(stderr, "Error opening socket : %s\n", strerror(errno));
+        return 1;
+        }
+
+    // Make the socket buffer big enough to ride out scheduling hiccups. Try
+    // to go past the system limit first, then settle for what we can get.
+    if (iRcvBufSize > 0)
+        {
+        if (setsockopt(suRing.iSocket, SOL_SOCKET, SO_RCVBUFFORCE, &iRcvBufSize, sizeof(iRcvBufSize)) != 0)
+            setsockopt(suRing.iSocket, SOL_SOCKET, SO_RCVBUF, &iRcvBufSize, sizeof(iRcvBufSize));
+        }
+    iOptLen = sizeof(iActualBufSize);
+    getsockopt(suRing.iSocket, SOL_SOCKET, SO_RCVBUF, &iActualBufSize, &iOptLen);
+    fprintf(stderr, "Socket receive buffer %d bytes\n", iActualBufSize);
+
+#if defined(SO_BUSY_POLL)
+    if (iBusyPoll > 0)
+        {
+        if (setsockopt(suRing.iSocket, SOL_SOCKET, SO_BUSY_POLL, &iBusyPoll, sizeof(iBusyPoll)) != 0)
+            fprintf(stderr, "Warning, can't set busy poll : %s\n", strerror(errno));
+        }
+#endif
+
+    // Time out now and then so the receive thread can check for stop
+    suTimeout.tv_sec  = 0;
+    suTimeout.tv_usec = 100000;
+    setsockopt(suRing.iSocket, SOL_SOCKET, SO_RCVTIMEO, &suTimeout, sizeof(suTimeout));
+
+    memset(&suAddr, 0, sizeof(suAddr));
+    suAddr.sin_family      = AF_INET;
+    suAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    suAddr.sin_port        = htons((uint16_t)uPort);
+    if (bind(suRing.iSocket, (struct sockaddr *)&suAddr, sizeof(suAddr)) != 0)
+        {
+        fprintf(stderr, "Error binding to port %u : %s\n", uPort, strerror(errno));
+        close(suRing.iSocket);
+        return 1;
+        }
+
+    // Setup the consumers. The writer is only needed when writing a file.
+    iNumConsumers = m_bWriteFile ? 2 : 1;
+    for (iConsumerIdx=0; iConsumerIdx<iNumConsumers; iConsumerIdx++)
+        {
+        asuConsumer[iConsumerIdx].iConsumer  = iConsumerIdx;
+        asuConsumer[iConsumerIdx].psuRing    = &suRing;
+        asuConsumer[iConsumerIdx].pabyPacket = (uint8_t *)malloc(MAX_PACKET_SIZE);
+        }
+    asuConsumer[0].pfPacket = vPrintPacket;
+    asuConsumer[1].pfPacket = vWritePacket;
+
+    // Unused consumers never hold up the receive thread
+    for (iConsumerIdx=iNumConsumers; iConsumerIdx<RING_CONSUMERS; iConsumerIdx++)
+        suRing.auTail[iConsumerIdx] = (uint32_t)-1;
+
+    // Start the threads
+    for (iConsumerIdx=0; iConsumerIdx<iNumConsumers; iConsumerIdx++)
+        pthread_create(&ahConsumerThread[iConsumerIdx], NULL, pvConsumerThread, &asuConsumer[iConsumerIdx]);
+    pthread_create(&hRcvThread, NULL, pvReceiveThread, &suRing);
+
+    fprintf(stderr, "Ring receive on port %u, %u slots, press any key to exit...\n\n",
+        uPort, suRing.uNumSlots);
+
+    // Report status once a second until a key is pressed
+    while (!_kbhit())
+        {
+        usleep(100000);
+        if (++iTicks < 10)
+            continue;
+        iTicks = 0;
+
+        uMaxDepth = 0;
+        for (iConsumerIdx=0; iConsumerIdx<iNumConsumers; iConsumerIdx++)
+            {
+            uDepth = __atomic_load_n(&suRing.uHead, __ATOMIC_ACQUIRE) -
+                     __atomic_load_n(&suRing.auTail[iConsumerIdx], __ATOMIC_ACQUIRE);
+            if (uDepth > uMaxDepth)
+                uMaxDepth = uDepth;
+            }
+
+        fprintf(stderr, "Rcv %8lu dgrams/s  Queue %5u/%u  Ring drops %lu  UDP seq gaps %lu\n",
+            __atomic_load_n(&suRing.ulDatagrams, __ATOMIC_RELAXED) - ulPrevDatagrams,
+            uMaxDepth, suRing.uNumSlots,
+            __atomic_load_n(&suRing.ulRingDrops, __ATOMIC_RELAXED),
+            __atomic_load_n(&asuConsumer[0].ulUdpSeqGaps, __ATOMIC_RELAXED));
+        ulPrevDatagrams = __atomic_load_n(&suRing.ulDatagrams, __ATOMIC_RELAXED);
+
+        if (m_bQuiet)
+            vPrintStats(stdout, 1.0, bFALSE);
+        } // end while waiting for keypress
+
+    // Stop receiving and let the consumers drain the ring
+    __atomic_store_n(&suRing.bStop, bTRUE, __ATOMIC_RELEASE);
+    pthread_join(hRcvThread, NULL);
+    for (iConsumerIdx=0; iConsumerIdx<iNumConsumers; iConsumerIdx++)
+        pthread_join(ahConsumerThread[iConsumerIdx], NULL);
+    close(suRing.iSocket);
+
+    // Print the final statistics
+    fprintf(stderr, "\nDatagrams Received   %lu\n",  suRing.ulDatagrams);
+    fprintf(stderr, "Bytes Received       %llu\n", suRing.ullBytes);
+    fprintf(stderr, "Ring Drops           %lu\n",  suRing.ulRingDrops);
+    fprintf(stderr, "Truncated Datagrams  %lu\n",  suRing.ulTruncated);
+    fprintf(stderr, "UDP Sequence Gaps    %lu\n",  asuConsumer[0].ulUdpSeqGaps);
+    fprintf(stderr, "Segment Errors       %lu\n",  asuConsumer[0].ulSegmentErrs);
+    fprintf(stderr, "Format Errors        %lu\n",  asuConsumer[0].ulFormatErrs);
+    fprintf(stderr, "Packets Decoded      %lu\n",  asuConsumer[0].ulPackets);
+    if (m_bWriteFile)
+        fprintf(stderr, "Packets Written      %lu\n",  asuConsumer[1].ulPackets);
+
+    vPrintStats(stdout, 0.0, bTRUE);
+
+    for (iConsumerIdx=0; iConsumerIdx<iNumConsumers; iConsumerIdx++)
+        free(asuConsumer[iConsumerIdx].pabyPacket);
+    free(suRing.pabySlab);
+    free(suRing.aulSlotLen);
+
+    return 0;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Receive datagrams into the ring as fast as they come in
+
+void * pvReceiveThread(void * pvRing)
+    {
+    SuUdpRing         * psuRing = (SuUdpRing *)pvRing;
+    struct mmsghdr      asuMsgs[RING_BATCH];
+    struct iovec        asuIov[RING_BATCH];
+    uint8_t           * pabyScratch;
+    uint32_t            uHead;
+    uint32_t            uTail;
+    uint32_t            uFree;
+    uint32_t            uBatch;
+    uint32_t            uSlot;
+    int                 iConsumerIdx;
+    int                 iMsgIdx;
+    int                 iRcvd;
+    int                 bDropping;
+
+    // Somewhere to put datagrams when there's no room in the ring
+    pabyScratch = (uint8_t *)malloc(RING_SLOT_SIZE);
+
+    while (!__atomic_load_n(&psuRing->bStop, __ATOMIC_ACQUIRE))
+        {
+        // Figure out how much room the slowest consumer left us
+        uHead = psuRing->uHead;
+        uFree = psuRing->uNumSlots;
+        for (iConsumerIdx=0; iConsumerIdx<RING_CONSUMERS; iConsumerIdx++)
+            {
+            uTail = __atomic_load_n(&psuRing->auTail[iConsumerIdx], __ATOMIC_ACQUIRE);
+            if (uTail == (uint32_t)-1)
+                continue;
+            if (psuRing->uNumSlots - (uHead - uTail) < uFree)
+                uFree = psuRing->uNumSlots - (uHead - uTail);
+            }
+
+        // Point the message vector at free ring slots, or at scratch if full
+        bDropping = (uFree == 0);
+        uBatch    = bDropping ? RING_BATCH : (uFree < RING_BATCH ? uFree : RING_BATCH);
+        memset(asuMsgs, 0, uBatch * sizeof(struct mmsghdr));
+        for (iMsgIdx=0; iMsgIdx<(int)uBatch; iMsgIdx++)
+            {
+            uSlot = (uHead + iMsgIdx) & (psuRing->uNumSlots - 1);
+            asuIov[iMsgIdx].iov_base = bDropping ? pabyScratch : &psuRing->pabySlab[(size_t)uSlot * RING_SLOT_SIZE];
+            asuIov[iMsgIdx].iov_len  = RING_SLOT_SIZE;
+            asuMsgs[iMsgIdx].msg_hdr.msg_iov    = &asuIov[iMsgIdx];
+            asuMsgs[iMsgIdx].msg_hdr.msg_iovlen = 1;
+            }
+
+        iRcvd = recvmmsg(psuRing->iSocket, asuMsgs, uBatch, MSG_WAITFORONE, NULL);
+        if (iRcvd <= 0)
+            continue;
+
+        if (bDropping)
+            {
+            __atomic_add_fetch(&psuRing->ulRingDrops, iRcvd, __ATOMIC_RELAXED);
+            continue;
+            }
+
+        for (iMsgIdx=0; iMsgIdx<iRcvd; iMsgIdx++)
+            {
+            uSlot = (uHead + iMsgIdx) & (psuRing->uNumSlots - 1);
+            psuRing->aulSlotLen[uSlot] = asuMsgs[iMsgIdx].msg_len;
+            if ((asuMsgs[iMsgIdx].msg_hdr.msg_flags & MSG_TRUNC) != 0)
+                {
+                psuRing->aulSlotLen[uSlot] = 0;
+                __atomic_add_fetch(&psuRing->ulTruncated, 1, __ATOMIC_RELAXED);
+                }
+            __atomic_add_fetch(&psuRing->ullBytes, asuMsgs[iMsgIdx].msg_len, __ATOMIC_RELAXED);
+            }
+        __atomic_add_fetch(&psuRing->ulDatagrams, iRcvd, __ATOMIC_RELAXED);
+
+        // Hand the new slots to the consumers
+        __atomic_store_n(&psuRing->uHead, uHead + iRcvd, __ATOMIC_RELEASE);
+        } // end while not stopped
+
+    free(pabyScratch);
+    __atomic_store_n(&psuRing->bRcvDone, bTRUE, __ATOMIC_RELEASE);
+
+    return NULL;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Pull datagrams off the ring and hand the Ch 10 packets in them to the
+// consumer's packet callback.
+
+void * pvConsumerThread(void * pvConsumer)
+    {
+    SuUdpConsumer     * psuConsumer = (SuUdpConsumer *)pvConsumer;
+    SuUdpRing         * psuRing     = psuConsumer->psuRing;
+    uint32_t          * puTail      = &psuRing->auTail[psuConsumer->iConsumer];
+    uint32_t            uHead;
+    uint32_t            uTail;
+    uint32_t            uSlot;
+    int                 bRcvDone;
+
+    while (bTRUE)
+        {
+        // Check receive done before head so the last datagrams aren't missed
+        bRcvDone = __atomic_load_n(&psuRing->bRcvDone, __ATOMIC_ACQUIRE);
+        uHead    = __atomic_load_n(&psuRing->uHead,    __ATOMIC_ACQUIRE);
+        uTail    = *puTail;
+
+        if (uTail == uHead)
+            {
+            if (bRcvDone)
+                break;
+            usleep(1000);
+            continue;
+            }
+
+        // Process everything that's ready, then give the slots back
+        while (uTail != uHead)
+            {
+            uSlot = uTail & (psuRing->uNumSlots - 1);
+            if (psuRing->aulSlotLen[uSlot] != 0)
+                vProcessDatagram(psuConsumer,
+                    &psuRing->pabySlab[(size_t)uSlot * RING_SLOT_SIZE], psuRing->aulSlotLen[uSlot]);
+            uTail++;
+            }
+        __atomic_store_n(puTail, uTail, __ATOMIC_RELEASE);
+        } // end while receiving
+
+    return NULL;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Decode the Ch 10 UDP transfer header (format 1) and pull out the packets.
+// Full messages hold one or more whole Ch 10 packets. Segmented messages
+// hold part of one Ch 10 packet which gets reassembled here.
+
+void vProcessDatagram(SuUdpConsumer * psuConsumer, uint8_t * pabyDgram, uint32_t ulDgramLen)
+    {
+    uint32_t            uVersion;
+    uint32_t            uMsgType;
+    uint32_t            uUdpSeq;
+    uint32_t            ulSegOffset;
+    uint32_t            ulSegLen;
+    SuI106Ch10Header  * psuHdr;
+
+    if (ulDgramLen < 4)
+        {
+        psuConsumer->ulFormatErrs++;
+        return;
+        }
+
+    uVersion = pabyDgram[0] & 0x0f;
+    uMsgType = (pabyDgram[0] >> 4) & 0x0f;
+    uUdpSeq  = pabyDgram[1] | (pabyDgram[2] << 8) | (pabyDgram[3] << 16);
+
+    if (uVersion != 1)
+        {
+        psuConsumer->ulFormatErrs++;
+        return;
+        }
+
+    // Check for lost datagrams
+    if (psuConsumer->bHaveUdpSeq && (((psuConsumer->uPrevUdpSeq + 1) & 0x00ffffff) != uUdpSeq))
+        __atomic_add_fetch(&psuConsumer->ulUdpSeqGaps,
+            (uUdpSeq - psuConsumer->uPrevUdpSeq - 1) & 0x00ffffff, __ATOMIC_RELAXED);
+    psuConsumer->uPrevUdpSeq = uUdpSeq;
+    psuConsumer->bHaveUdpSeq = bTRUE;
+
+    switch (uMsgType)
+        {
+        case UDP_MSG_FULL :
+            vProcessPackets(psuConsumer, &pabyDgram[4], ulDgramLen - 4);
+            break;
+
+        case UDP_MSG_SEGMENTED :
+            if (ulDgramLen < 12)
+                {
+                psuConsumer->ulFormatErrs++;
+                break;
+                }
+            ulSegOffset = pabyDgram[8] | (pabyDgram[9] << 8) | (pabyDgram[10] << 16) | ((uint32_t)pabyDgram[11] << 24);
+            ulSegLen    = ulDgramLen - 12;
+
+            // First segment has the header so we know how long the packet is
+            if (ulSegOffset == 0)
+                {
+                if (psuConsumer->bAssembling)
+                    psuConsumer->ulSegmentErrs++;
+                psuHdr = (SuI106Ch10Header *)&pabyDgram[12];
+                if ((ulSegLen < HEADER_SIZE) || (psuHdr->ulPacketLen > MAX_PACKET_SIZE))
+                    {
+                    psuConsumer->bAssembling = bFALSE;
+                    psuConsumer->ulFormatErrs++;
+                    break;
+                    }
+                psuConsumer->ulPacketLen  = psuHdr->ulPacketLen;
+                psuConsumer->ulNextOffset = 0;
+                psuConsumer->bAssembling  = bTRUE;
+                }
+
+            // Anything out of order means the packet is lost
+            if (!psuConsumer->bAssembling)
+                break;
+            if ((ulSegOffset != psuConsumer->ulNextOffset) ||
+                (ulSegOffset + ulSegLen > psuConsumer->ulPacketLen))
+                {
+                psuConsumer->bAssembling = bFALSE;
+                psuConsumer->ulSegmentErrs++;
+                break;
+                }
+
+            memcpy(&psuConsumer->pabyPacket[ulSegOffset], &pabyDgram[12], ulSegLen);
+            psuConsumer->ulNextOffset += ulSegLen;
+
+            if (psuConsumer->ulNextOffset == psuConsumer->ulPacketLen)
+                {
+                psuConsumer->bAssembling = bFALSE;
+                vProcessPackets(psuConsumer, psuConsumer->pabyPacket, psuConsumer->ulPacketLen);
+                }
+            break;
+
+        default :
+            psuConsumer->ulFormatErrs++;
+            break;
+        } // end switch on message type
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Step through a buffer of whole Ch 10 packets
+
+void vProcessPackets(SuUdpConsumer * psuConsumer, uint8_t * pabyData, uint32_t ulDataLen)
+    {
+    SuI106Ch10Header    suI106Hdr;
+    uint32_t            ulOffset = 0;
+    uint32_t            ulHdrLen;
+    uint32_t            ulPacketLen;
+
+    while (ulOffset + HEADER_SIZE <= ulDataLen)
+        {
+        memset(&suI106Hdr, 0, sizeof(suI106Hdr));
+        memcpy(&suI106Hdr, &pabyData[ulOffset], HEADER_SIZE);
+        ulPacketLen = suI106Hdr.ulPacketLen;
+
+        if ((suI106Hdr.uSignature != IRIG106_SYNC) ||
+            (ulPacketLen < HEADER_SIZE) || (ulOffset + ulPacketLen > ulDataLen))
+            {
+            psuConsumer->ulFormatErrs++;
+            break;
+            }
+
+        // The headers and the data have to fit in the packet. The packet
+        // length is good so just this packet is skipped.
+        ulHdrLen = iGetHeaderLen(&suI106Hdr);
+        if ((ulHdrLen > ulPacketLen) || (ulOffset + ulHdrLen > ulDataLen) ||
+            (suI106Hdr.ulDataLen > ulPacketLen - ulHdrLen))
+            {
+            psuConsumer->ulFormatErrs++;
+            ulOffset += ulPacketLen;
+            continue;
+            }
+
+        // Pick up the secondary header if there is one
+        if (ulHdrLen > HEADER_SIZE)
+            memcpy(&suI106Hdr, &pabyData[ulOffset], ulHdrLen);
+
+        psuConsumer->pfPacket(psuConsumer, &suI106Hdr, &pabyData[ulOffset + ulHdrLen]);
+        psuConsumer->ulPackets++;
+
+        ulOffset += ulPacketLen;
+        }
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Decode thread packet handler
+
+void vPrintPacket(SuUdpConsumer * psuConsumer, SuI106Ch10Header * psuHdr, void * pvData)
+    {
+    SuIrig106Time       suTime;
+
+    // Count packets, bytes, and errors
+    vUpdateStats(psuHdr);
+    if (m_bQuiet)
+        return;
+
+    printf("Ch %2d %-20s (0x%2.2x)", psuHdr->uChID,
+        psuHdr->ubyDataType < sizeof(aszPacketType)/sizeof(char *) ? aszPacketType[psuHdr->ubyDataType] : "UNDEFINED",
+        psuHdr->ubyDataType);
+
+    switch (psuHdr->ubyDataType)
+        {
+        case I106CH10_DTYPE_IRIG_TIME :
+            enI106_Decode_TimeF1(psuHdr, pvData, &suTime);
+            printf(" %s", IrigTime2String(&suTime));
+            break;
+
+        case I106CH10_DTYPE_NETWORK_TIME :
+            enI106_Decode_TimeF2(psuHdr, pvData, &suTime);
+            printf(" %s", IrigTime2String(&suTime));
+            break;
+
+        default :
+            break;
+        } // end switch on data type
+    printf("\n");
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Writer thread packet handler
+
+void vWritePacket(SuUdpConsumer * psuConsumer, SuI106Ch10Header * psuHdr, void * pvData)
+    {
+    if ((m_bHaveTmats == bFALSE) && (psuHdr->ubyDataType == I106CH10_DTYPE_TMATS))
+        {
+        m_bHaveTmats = bTRUE;
+        fprintf(stderr, "Got first TMATS packet\n");
+        }
+
+    if ((m_bHaveTime == bFALSE) &&
+        ((psuHdr->ubyDataType == I106CH10_DTYPE_IRIG_TIME) ||
+         (psuHdr->ubyDataType == I106CH10_DTYPE_NETWORK_TIME)))
+        {
+        m_bHaveTime = bTRUE;
+        fprintf(stderr, "Got first Time packet\n");
+        }
+
+    if (m_bRollOutput)
+        vWriterPacket(&m_suWriter, psuHdr, pvData, m_bHaveTmats && m_bHaveTime);
+    else if (m_bHaveTmats && m_bHaveTime)
+        enI106Ch10WriteMsg(m_iI106_Out, psuHdr, pvData);
+
+    return;
+    }
+
+#endif
+
+
+
+// ----------------------------------------------------------------------------
+// Rotating output files
+// ----------------------------------------------------------------------------
+
+#if defined(ROTATE_OUTPUT)
+
+// Output files are named from the output file name on the command line with
+// a file number stuck in before the extension. Files are preallocated so
+// they don't fragment as they grow over a long capture. Preallocation
+// doesn't change the file size so a file cut short by a crash is still a
+// good Ch 10 file.
+
+int bWriterInit(SuCh10Writer * psuWriter, char * szOutFile, int64_t llRollSize, int iRollSecs)
+    {
+    char              * szDot;
+    char              * szSlash;
+
+    memset(psuWriter, 0, sizeof(SuCh10Writer));
+    psuWriter->iFile      = -1;
+    psuWriter->bPrealloc  = bTRUE;
+    psuWriter->llRollSize = llRollSize;
+    psuWriter->iRollSecs  = iRollSecs;
+
+    // Split the file name into stem and extension
+    strncpy(psuWriter->szStem, szOutFile, sizeof(psuWriter->szStem) - 1);
+    szDot   = strrchr(psuWriter->szStem, '.');
+    szSlash = strrchr(psuWriter->szStem, '/');
+    if ((szDot != NULL) && ((szSlash == NULL) || (szDot > szSlash)) &&
+        (strlen(szDot) < sizeof(psuWriter->szExt)))
+        {
+        strcpy(psuWriter->szExt, szDot);
+        *szDot = '\0';
+        }
+
+    if (posix_memalign((void **)&psuWriter->pabyBuff, WRITE_BUFF_ALIGN, WRITE_BUFF_SIZE) != 0)
+        return bFALSE;
+
+    return bTRUE;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Use this TMATS packet to start every file instead of one from the stream
+
+void vWriterSetTmats(SuCh10Writer * psuWriter, SuI106Ch10Header * psuHdr, void * pvData)
+    {
+    vCopyPacket(&psuWriter->pabyTmats, &psuWriter->ulTmatsLen, &psuWriter->ulTmatsSize, psuHdr, pvData);
+    psuWriter->bTmatsFromFile = bTRUE;
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Keep track of the latest TMATS and time packets for starting new files,
+// and if bWrite is set write the packet, starting a new file first if it's
+// time for one.
+
+void vWriterPacket(SuCh10Writer * psuWriter, SuI106Ch10Header * psuHdr, void * pvData, int bWrite)
+    {
+    uint32_t            ulHdrLen;
+    int                 bRoll;
+
+    switch (psuHdr->ubyDataType)
+        {
+        case I106CH10_DTYPE_TMATS :
+            if (!psuWriter->bTmatsFromFile)
+                vCopyPacket(&psuWriter->pabyTmats, &psuWriter->ulTmatsLen, &psuWriter->ulTmatsSize, psuHdr, pvData);
+            break;
+
+        case I106CH10_DTYPE_IRIG_TIME :
+        case I106CH10_DTYPE_NETWORK_TIME :
+            vCopyPacket(&psuWriter->pabyTime, &psuWriter->ulTimeLen, &psuWriter->ulTimeSize, psuHdr, pvData);
+            break;
+
+        default :
+            break;
+        } // end switch on data type
+
+    if (!bWrite)
+        return;
+
+    // See if it's time for a new file. Always put at least one packet in a
+    // file so a big packet can't make files roll forever.
+    bRoll = bFALSE;
+    if ((psuWriter->iFile != -1) && (psuWriter->ulFilePackets > 0))
+        {
+        if ((psuWriter->llRollSize != 0) &&
+            (psuWriter->llFileSize + psuWriter->ulBuffUsed + psuHdr->ulPacketLen > psuWriter->llRollSize))
+            bRoll = bTRUE;
+        if ((psuWriter->iRollSecs != 0) &&
+            (time(NULL) - psuWriter->lFileStart >= psuWriter->iRollSecs))
+            bRoll = bTRUE;
+        }
+
+    if (bRoll)
+        vWriterCloseFile(psuWriter);
+
+    if (psuWriter->iFile == -1)
+        {
+        if (!bWriterNewFile(psuWriter, psuHdr->ubyDataType))
+            return;
+        }
+
+    ulHdrLen = iGetHeaderLen(psuHdr);
+    vWriterAppend(psuWriter, psuHdr, ulHdrLen);
+    vWriterAppend(psuWriter, pvData, psuHdr->ulPacketLen - ulHdrLen);
+    psuWriter->ulFilePackets++;
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Finish up the last file and free everything
+
+void vWriterClose(SuCh10Writer * psuWriter)
+    {
+    vWriterCloseFile(psuWriter);
+
+    free(psuWriter->pabyBuff);
+    free(psuWriter->pabyTmats);
+    free(psuWriter->pabyTime);
+    psuWriter->pabyBuff  = NULL;
+    psuWriter->pabyTmats = NULL;
+    psuWriter->pabyTime  = NULL;
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Open the next output file and start it with the TMATS and time packets.
+// Don't repeat the one that is about to be written anyway.
+
+int bWriterNewFile(SuCh10Writer * psuWriter, unsigned int uDataType)
+    {
+    char                szFileName[300];
+
+    psuWriter->iFileNum++;
+    sprintf(szFileName, "%s_%04d%s", psuWriter->szStem, psuWriter->iFileNum, psuWriter->szExt);
+
+    psuWriter->iFile = open(szFileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (psuWriter->iFile == -1)
+        {
+        if (!psuWriter->bWriteErr)
+            fprintf(stderr, "Error opening output data file '%s' : %s\n", szFileName, strerror(errno));
+        psuWriter->bWriteErr = bTRUE;
+        return bFALSE;
+        }
+
+    psuWriter->llFileSize    = 0;
+    psuWriter->llAllocSize   = 0;
+    psuWriter->ulFilePackets = 0L;
+    psuWriter->ulBuffUsed    = 0;
+    psuWriter->lFileStart    = time(NULL);
+    psuWriter->bWriteErr     = bFALSE;
+
+    // Reserve room for the whole file if we know how big it will get
+    if (psuWriter->bPrealloc)
+        {
+        psuWriter->llAllocSize = (psuWriter->llRollSize != 0) ? psuWriter->llRollSize : PREALLOC_CHUNK;
+        if (fallocate(psuWriter->iFile, FALLOC_FL_KEEP_SIZE, 0, psuWriter->llAllocSize) != 0)
+            psuWriter->bPrealloc = bFALSE;
+        }
+
+    fprintf(stderr, "Opened output file '%s'\n", szFileName);
+
+    if ((uDataType != I106CH10_DTYPE_TMATS) && (psuWriter->ulTmatsLen != 0))
+        vWriterAppend(psuWriter, psuWriter->pabyTmats, psuWriter->ulTmatsLen);
+
+    if ((uDataType != I106CH10_DTYPE_IRIG_TIME) && (uDataType != I106CH10_DTYPE_NETWORK_TIME) &&
+        (psuWriter->ulTimeLen != 0))
+        vWriterAppend(psuWriter, psuWriter->pabyTime, psuWriter->ulTimeLen);
+
+    return bTRUE;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Write out what's left in the buffer and close the current file. Trim off
+// preallocated space that didn't get used.
+
+void vWriterCloseFile(SuCh10Writer * psuWriter)
+    {
+    if (psuWriter->iFile == -1)
+        return;
+
+    vWriterFlush(psuWriter, psuWriter->ulBuffUsed);
+    if (psuWriter->llAllocSize > psuWriter->llFileSize)
+        ftruncate(psuWriter->iFile, psuWriter->llFileSize);
+    close(psuWriter->iFile);
+    psuWriter->iFile = -1;
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Add data to the write buffer, writing out each buffer as it fills
+
+void vWriterAppend(SuCh10Writer * psuWriter, void * pvData, uint32_t ulDataLen)
+    {
+    uint8_t           * pabyData = (uint8_t *)pvData;
+    uint32_t            ulCopyLen;
+
+    while (ulDataLen > 0)
+        {
+        ulCopyLen = WRITE_BUFF_SIZE - psuWriter->ulBuffUsed;
+        if (ulCopyLen > ulDataLen)
+            ulCopyLen = ulDataLen;
+        memcpy(&psuWriter->pabyBuff[psuWriter->ulBuffUsed], pabyData, ulCopyLen);
+        psuWriter->ulBuffUsed += ulCopyLen;
+        pabyData              += ulCopyLen;
+        ulDataLen             -= ulCopyLen;
+
+        if (psuWriter->ulBuffUsed == WRITE_BUFF_SIZE)
+            vWriterFlush(psuWriter, WRITE_BUFF_SIZE);
+        }
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Write the write buffer to the current file, growing the preallocated
+// space first if needed
+
+void vWriterFlush(SuCh10Writer * psuWriter, uint32_t ulFlushLen)
+    {
+    uint32_t            ulWritten = 0;
+    ssize_t             iStatus;
+
+    if ((psuWriter->bPrealloc) &&
+        (psuWriter->llFileSize + ulFlushLen > psuWriter->llAllocSize))
+        {
+        if (fallocate(psuWriter->iFile, FALLOC_FL_KEEP_SIZE,
+                      psuWriter->llAllocSize, PREALLOC_CHUNK) == 0)
+            psuWriter->llAllocSize += PREALLOC_CHUNK;
+        }
+
+    while (ulWritten < ulFlushLen)
+        {
+        iStatus = write(psuWriter->iFile, &psuWriter->pabyBuff[ulWritten], ulFlushLen - ulWritten);
+        if (iStatus <= 0)
+            {
+            if ((iStatus < 0) && (errno == EINTR))
+                continue;
+            if (!psuWriter->bWriteErr)
+                fprintf(stderr, "Error writing output data file : %s\n", strerror(errno));
+            psuWriter->bWriteErr = bTRUE;
+            break;
+            }
+        ulWritten += iStatus;
+        }
+
+    psuWriter->llFileSize += ulWritten;
+    psuWriter->ulBuffUsed  = 0;
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Save a copy of a whole packet, header and data
+
+void vCopyPacket(uint8_t ** ppabyCopy, uint32_t * pulCopyLen, uint32_t * pulCopySize,
+                 SuI106Ch10Header * psuHdr, void * pvData)
+    {
+    uint32_t            ulHdrLen;
+
+    ulHdrLen = iGetHeaderLen(psuHdr);
+    if (*pulCopySize < psuHdr->ulPacketLen)
+        {
+        *ppabyCopy   = (uint8_t *)realloc(*ppabyCopy, psuHdr->ulPacketLen);
+        *pulCopySize = psuHdr->ulPacketLen;
+        }
+    memcpy(*ppabyCopy, psuHdr, ulHdrLen);
+    memcpy(&(*ppabyCopy)[ulHdrLen], pvData, psuHdr->ulPacketLen - ulHdrLen);
+    *pulCopyLen = psuHdr->ulPacketLen;
+
+    return;
+    }
+
+#endif
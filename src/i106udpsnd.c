@@ -0,0 +1,613 @@
+/*==========================================================================
+
+  I106UDPSND.C - A program to replay a Ch 10 data file as an IRIG 106 Ch 10
+    UDP live data stream at a controlled rate.
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+  ==========================================================================*/
+
+// Needed for sendmmsg()
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Socket stuff. The Makefile packs structures so put the kernel interface
+// structures back to their natural alignment.
+#pragma pack(push, 8)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#pragma pack(pop)
+
+// IRIG library
+#include "i106_stdint.h"
+#include "config.h"
+#include "irig106ch10.h"
+#include "i106_time.h"
+
+// Macros and definitions
+// ----------------------
+
+#define MAJOR_VERSION  "01"
+#define MINOR_VERSION  "00"
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define UDP_HDR_FULL_LEN    4           // Format 1 full message header
+#define UDP_HDR_SEG_LEN     12          // Format 1 segmented message header
+#define DEFAULT_MAX_DGRAM   8192        // Default max UDP payload size
+#define MAX_DGRAM           65000       // Biggest UDP payload allowed
+#define DEFAULT_BATCH       32          // Datagrams per sendmmsg() call
+#define MAX_BATCH           1024
+
+// Ch 10 UDP transfer header format 1 message types
+#define UDP_MSG_FULL        0
+#define UDP_MSG_SEGMENTED   1
+
+
+// Data structures
+// ---------------
+
+// A batch of datagrams waiting to go out
+typedef struct
+    {
+    int                 iSocket;
+    struct sockaddr_in  suDest;
+    unsigned int        uMaxBatch;
+    unsigned int        uNumDgrams;
+    uint8_t           * pabyBuffs;      // uMaxBatch buffers of MAX_DGRAM bytes
+    unsigned int      * auDgramLen;
+#if defined(__linux__)
+    struct mmsghdr    * asuMsgs;
+    struct iovec      * asuIov;
+#endif
+    uint32_t            uUdpSeq;        // 24 bit UDP transfer sequence number
+    unsigned long       ulDatagrams;
+    unsigned long long  ullBytes;
+    unsigned long       ulSendErrors;
+    } SuUdpSender;
+
+
+// Module data
+// -----------
+
+
+// Function prototypes
+// -------------------
+
+uint8_t * pabyNextDgram(SuUdpSender * psuSender);
+void      vFlushDgrams(SuUdpSender * psuSender);
+void      vSendPacket(SuUdpSender * psuSender, SuI106Ch10Header * psuHdr, void * pvData, unsigned int uMaxDgram);
+double    dNow(void);
+void      vSleepUntil(double dWakeTime);
+void      vUsage(void);
+
+
+/* ======================================================================== */
+
+int main (int argc, char *argv[])
+    {
+    char              * szInFile    = NULL;
+    char              * szDestAddr  = "127.0.0.1";
+    unsigned int        uPort       = 0;
+    double              dSpeed      = 1.0;
+    unsigned int        uMaxDgram   = DEFAULT_MAX_DGRAM;
+    unsigned int        uBatch      = DEFAULT_BATCH;
+    int                 iLoops      = 1;
+    int                 iLoopIdx;
+    int                 iSndBufSize = 4000000;
+
+    int                 iI106_In;
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suI106Hdr;
+    unsigned long       ulBuffSize = 0;
+    void              * pvBuff     = NULL;
+
+    SuUdpSender         suSender;
+    int64_t             llRelTime;
+    int64_t             llStartRelTime = 0;
+    int                 bHaveStartTime;
+    double              dStartTime;
+    double              dSendTime;
+    double              dElapsed;
+    unsigned long       ulPackets = 0L;
+
+    int                 iArgIdx;
+
+// Process the command line arguments
+// ----------------------------------
+    if (argc < 2)
+        {
+        vUsage();
+        return 1;
+        }
+
+    for (iArgIdx=1; iArgIdx<argc; iArgIdx++)
+        {
+        switch (argv[iArgIdx][0])
+            {
+
+            case '-' :
+                if (iArgIdx+1 >= argc)
+                    {
+                    vUsage();
+                    return 1;
+                    }
+
+                switch (argv[iArgIdx][1])
+                    {
+                    case 'a' :                  // Destination address
+                        iArgIdx++;
+                        szDestAddr = argv[iArgIdx];
+                        break;
+
+                    case 'p' :                  // Port number
+                        iArgIdx++;
+                        if (sscanf(argv[iArgIdx],"%u",&uPort) != 1)
+                            {
+                            printf("Bad port number\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 's' :                  // Speed multiple
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%lf",&dSpeed) != 1) || (dSpeed < 0.0))
+                            {
+                            printf("Bad speed\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 'm' :                  // Max datagram size
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%u",&uMaxDgram) != 1) ||
+                            (uMaxDgram < UDP_HDR_SEG_LEN + HEADER_SIZE + 4) || (uMaxDgram > MAX_DGRAM))
+                            {
+                            printf("Bad max datagram size\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 'b' :                  // Batch size
+                        iArgIdx++;
+                        if ((sscanf(argv[iArgIdx],"%u",&uBatch) != 1) || (uBatch < 1) || (uBatch > MAX_BATCH))
+                            {
+                            printf("Bad batch size\n");
+                            vUsage();
+                            return 1;
+                            }
+                        break;
+
+                    case 'l' :                  // Loop count
+                        iArgIdx++;
+                        sscanf(argv[iArgIdx],"%d",&iLoops);
+                        break;
+
+                    default :
+                        break;
+                    } // end switch on flag character
+                break;
+
+            // Anything else must be the input file name
+            default :
+                szInFile = argv[iArgIdx];
+                break;
+
+            } // end switch on first character
+        } // end for all arguments
+
+    if ((szInFile == NULL) || (uPort == 0))
+        {
+        vUsage();
+        return 1;
+        }
+
+    // UDP payload is kept a multiple of 4 so segments stay aligned
+    uMaxDgram &= ~0x03;
+
+// Get setup to run
+// ----------------
+
+    fprintf(stderr, "\nI106UDPSND "MAJOR_VERSION"."MINOR_VERSION"\n");
+    fprintf(stderr, "Freeware Copyright (C) 2019 Irig106.org\n\n");
+
+    enStatus = enI106Ch10Open(&iI106_In, szInFile, I106_READ);
+    switch (enStatus)
+        {
+        case I106_OPEN_WARNING :
+            fprintf(stderr, "Warning opening data file : Status = %d\n", enStatus);
+            break;
+        case I106_OK :
+            break;
+        default :
+            fprintf(stderr, "Error opening data file : Status = %d\n", enStatus);
+            return 1;
+            break;
+        }
+
+    // Make the socket and the datagram batch buffers
+    memset(&suSender, 0, sizeof(suSender));
+    suSender.iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (suSender.iSocket == -1)
+        {
+        fprintf(stderr, "Error opening socket : %s\n", strerror(errno));
+        return 1;
+        }
+    setsockopt(suSender.iSocket, SOL_SOCKET, SO_SNDBUF, &iSndBufSize, sizeof(iSndBufSize));
+
+    suSender.suDest.sin_family = AF_INET;
+    suSender.suDest.sin_port   = htons((uint16_t)uPort);
+    if (inet_aton(szDestAddr, &suSender.suDest.sin_addr) == 0)
+        {
+        fprintf(stderr, "Bad destination address '%s'\n", szDestAddr);
+        return 1;
+        }
+
+    suSender.uMaxBatch  = uBatch;
+    suSender.pabyBuffs  = (uint8_t *)malloc((size_t)uBatch * MAX_DGRAM);
+    suSender.auDgramLen = (unsigned int *)malloc(uBatch * sizeof(unsigned int));
+#if defined(__linux__)
+    suSender.asuMsgs    = (struct mmsghdr *)malloc(uBatch * sizeof(struct mmsghdr));
+    suSender.asuIov     = (struct iovec *)malloc(uBatch * sizeof(struct iovec));
+#endif
+
+    fprintf(stderr, "Sending '%s' to %s:%u ", szInFile, szDestAddr, uPort);
+    if (dSpeed == 0.0)
+        fprintf(stderr, "as fast as possible\n");
+    else
+        fprintf(stderr, "at %gx real time\n", dSpeed);
+
+// Send data packets until EOF
+// ---------------------------
+
+    dStartTime = dNow();
+    for (iLoopIdx=0; (iLoops <= 0) || (iLoopIdx < iLoops); iLoopIdx++)
+        {
+        enI106Ch10FirstMsg(iI106_In);
+        bHaveStartTime = bFALSE;
+        dSendTime      = dNow();
+
+        while (bTRUE)
+            {
+            enStatus = enI106Ch10ReadNextHeader(iI106_In, &suI106Hdr);
+            if (enStatus == I106_EOF)
+                break;
+            if (enStatus != I106_OK)
+                {
+                fprintf(stderr, "Error enI106Ch10ReadNextHeader() : %s\n", szI106ErrorStr(enStatus));
+                break;
+                }
+
+            if (ulBuffSize < suI106Hdr.ulPacketLen)
+                {
+                pvBuff = realloc(pvBuff, suI106Hdr.ulPacketLen);
+                ulBuffSize = suI106Hdr.ulPacketLen;
+                }
+
+            enStatus = enI106Ch10ReadData(iI106_In, ulBuffSize, pvBuff);
+            if (enStatus != I106_OK)
+                {
+                fprintf(stderr, "Error enI106Ch10ReadData() : %s\n", szI106ErrorStr(enStatus));
+                break;
+                }
+
+            // Pace by relative time counter. When a packet is due in the
+            // future send what's queued up then wait for it.
+            if (dSpeed != 0.0)
+                {
+                vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llRelTime);
+                if (bHaveStartTime == bFALSE)
+                    {
+                    llStartRelTime = llRelTime;
+                    bHaveStartTime = bTRUE;
+                    }
+                if (llRelTime > llStartRelTime)
+                    {
+                    double  dDueTime = dSendTime + (double)(llRelTime - llStartRelTime) / 10000000.0 / dSpeed;
+                    if (dDueTime > dNow())
+                        {
+                        vFlushDgrams(&suSender);
+                        vSleepUntil(dDueTime);
+                        }
+                    }
+                }
+
+            vSendPacket(&suSender, &suI106Hdr, pvBuff, uMaxDgram);
+            ulPackets++;
+            } // end while reading packets
+
+        vFlushDgrams(&suSender);
+        } // end for each loop
+
+    dElapsed = dNow() - dStartTime;
+
+// Print some stats, close the files, and get outa here
+// ----------------------------------------------------
+
+    fprintf(stderr, "Packets Sent     %lu\n",   ulPackets);
+    fprintf(stderr, "Datagrams Sent   %lu\n",   suSender.ulDatagrams);
+    fprintf(stderr, "Bytes Sent       %llu\n",  suSender.ullBytes);
+    fprintf(stderr, "Send Errors      %lu\n",   suSender.ulSendErrors);
+    fprintf(stderr, "Elapsed Time     %.3f sec\n", dElapsed);
+    if (dElapsed > 0.0)
+        fprintf(stderr, "Rate             %.0f dgrams/sec  %.1f Mbps\n",
+            suSender.ulDatagrams / dElapsed, suSender.ullBytes * 8.0 / dElapsed / 1000000.0);
+
+    enI106Ch10Close(iI106_In);
+    close(suSender.iSocket);
+
+    free(pvBuff);
+    free(suSender.pabyBuffs);
+    free(suSender.auDgramLen);
+#if defined(__linux__)
+    free(suSender.asuMsgs);
+    free(suSender.asuIov);
+#endif
+
+    return 0;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Put a Ch 10 packet into one or more datagrams. Packets that fit go out as
+// a full message. Bigger packets get chopped up into segmented messages.
+
+void vSendPacket(SuUdpSender * psuSender, SuI106Ch10Header * psuHdr, void * pvData, unsigned int uMaxDgram)
+    {
+    uint8_t           * pabyDgram;
+    uint8_t           * pabyPacket;
+    uint32_t            ulHdrLen;
+    uint32_t            ulPacketLen;
+    uint32_t            ulSegOffset;
+    uint32_t            ulSegLen;
+    uint32_t            ulCopied;
+    uint32_t            ulChunk;
+
+    ulHdrLen    = iGetHeaderLen(psuHdr);
+    ulPacketLen = psuHdr->ulPacketLen;
+
+    // The whole packet fits so send it as a full message
+    if (ulPacketLen + UDP_HDR_FULL_LEN <= uMaxDgram)
+        {
+        pabyDgram = pabyNextDgram(psuSender);
+        pabyDgram[0] = 0x01 | (UDP_MSG_FULL << 4);
+        pabyDgram[1] = (uint8_t)( psuSender->uUdpSeq        & 0xff);
+        pabyDgram[2] = (uint8_t)((psuSender->uUdpSeq >>  8) & 0xff);
+        pabyDgram[3] = (uint8_t)((psuSender->uUdpSeq >> 16) & 0xff);
+        memcpy(&pabyDgram[UDP_HDR_FULL_LEN], psuHdr, ulHdrLen);
+        memcpy(&pabyDgram[UDP_HDR_FULL_LEN + ulHdrLen], pvData, ulPacketLen - ulHdrLen);
+        psuSender->auDgramLen[psuSender->uNumDgrams-1] = UDP_HDR_FULL_LEN + ulPacketLen;
+        psuSender->uUdpSeq = (psuSender->uUdpSeq + 1) & 0x00ffffff;
+        return;
+        }
+
+    // Too big so send it in segments. The packet is header then data so
+    // pretend it's one buffer when chopping it up.
+    ulSegOffset = 0;
+    while (ulSegOffset < ulPacketLen)
+        {
+        ulSegLen = ulPacketLen - ulSegOffset;
+        if (ulSegLen > uMaxDgram - UDP_HDR_SEG_LEN)
+            ulSegLen = uMaxDgram - UDP_HDR_SEG_LEN;
+
+        pabyDgram = pabyNextDgram(psuSender);
+        pabyDgram[ 0] = 0x01 | (UDP_MSG_SEGMENTED << 4);
+        pabyDgram[ 1] = (uint8_t)( psuSender->uUdpSeq        & 0xff);
+        pabyDgram[ 2] = (uint8_t)((psuSender->uUdpSeq >>  8) & 0xff);
+        pabyDgram[ 3] = (uint8_t)((psuSender->uUdpSeq >> 16) & 0xff);
+        pabyDgram[ 4] = (uint8_t)( psuHdr->uChID       & 0xff);
+        pabyDgram[ 5] = (uint8_t)((psuHdr->uChID >> 8) & 0xff);
+        pabyDgram[ 6] = psuHdr->ubySeqNum;
+        pabyDgram[ 7] = 0;
+        pabyDgram[ 8] = (uint8_t)( ulSegOffset        & 0xff);
+        pabyDgram[ 9] = (uint8_t)((ulSegOffset >>  8) & 0xff);
+        pabyDgram[10] = (uint8_t)((ulSegOffset >> 16) & 0xff);
+        pabyDgram[11] = (uint8_t)((ulSegOffset >> 24) & 0xff);
+
+        // Copy the part of the header and data in this segment
+        pabyPacket = &pabyDgram[UDP_HDR_SEG_LEN];
+        ulCopied   = 0;
+        if (ulSegOffset < ulHdrLen)
+            {
+            ulChunk = ulHdrLen - ulSegOffset;
+            if (ulChunk > ulSegLen)
+                ulChunk = ulSegLen;
+            memcpy(pabyPacket, (uint8_t *)psuHdr + ulSegOffset, ulChunk);
+            ulCopied = ulChunk;
+            }
+        if (ulCopied < ulSegLen)
+            memcpy(&pabyPacket[ulCopied], (uint8_t *)pvData + (ulSegOffset + ulCopied - ulHdrLen), ulSegLen - ulCopied);
+
+        psuSender->auDgramLen[psuSender->uNumDgrams-1] = UDP_HDR_SEG_LEN + ulSegLen;
+        psuSender->uUdpSeq = (psuSender->uUdpSeq + 1) & 0x00ffffff;
+        ulSegOffset += ulSegLen;
+        } // end while segments left to send
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Get the next free datagram buffer in the batch, sending the batch first
+// if it's full
+
+uint8_t * pabyNextDgram(SuUdpSender * psuSender)
+    {
+    if (psuSender->uNumDgrams >= psuSender->uMaxBatch)
+        vFlushDgrams(psuSender);
+
+    psuSender->uNumDgrams++;
+    return &psuSender->pabyBuffs[(size_t)(psuSender->uNumDgrams-1) * MAX_DGRAM];
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Send all the datagrams in the batch
+
+void vFlushDgrams(SuUdpSender * psuSender)
+    {
+    unsigned int        uDgramIdx;
+    int                 iSent;
+
+    if (psuSender->uNumDgrams == 0)
+        return;
+
+#if defined(__linux__)
+    memset(psuSender->asuMsgs, 0, psuSender->uNumDgrams * sizeof(struct mmsghdr));
+    for (uDgramIdx=0; uDgramIdx<psuSender->uNumDgrams; uDgramIdx++)
+        {
+        psuSender->asuIov[uDgramIdx].iov_base = &psuSender->pabyBuffs[(size_t)uDgramIdx * MAX_DGRAM];
+        psuSender->asuIov[uDgramIdx].iov_len  = psuSender->auDgramLen[uDgramIdx];
+        psuSender->asuMsgs[uDgramIdx].msg_hdr.msg_name    = &psuSender->suDest;
+        psuSender->asuMsgs[uDgramIdx].msg_hdr.msg_namelen = sizeof(psuSender->suDest);
+        psuSender->asuMsgs[uDgramIdx].msg_hdr.msg_iov     = &psuSender->asuIov[uDgramIdx];
+        psuSender->asuMsgs[uDgramIdx].msg_hdr.msg_iovlen  = 1;
+        }
+
+    // Keep going until everything is sent. If the socket buffer is full
+    // back off a little and try again rather than lose datagrams.
+    uDgramIdx = 0;
+    while (uDgramIdx < psuSender->uNumDgrams)
+        {
+        iSent = sendmmsg(psuSender->iSocket, &psuSender->asuMsgs[uDgramIdx], psuSender->uNumDgrams - uDgramIdx, 0);
+        if (iSent <= 0)
+            {
+            if ((errno == ENOBUFS) || (errno == EAGAIN) || (errno == EINTR))
+                {
+                usleep(100);
+                continue;
+                }
+            psuSender->ulSendErrors += psuSender->uNumDgrams - uDgramIdx;
+            break;
+            }
+        for (; iSent > 0; iSent--, uDgramIdx++)
+            {
+            psuSender->ulDatagrams++;
+            psuSender->ullBytes += psuSender->auDgramLen[uDgramIdx];
+            }
+        }
+#else
+    for (uDgramIdx=0; uDgramIdx<psuSender->uNumDgrams; uDgramIdx++)
+        {
+        iSent = sendto(psuSender->iSocket, &psuSender->pabyBuffs[(size_t)uDgramIdx * MAX_DGRAM],
+            psuSender->auDgramLen[uDgramIdx], 0, (struct sockaddr *)&psuSender->suDest, sizeof(psuSender->suDest));
+        if (iSent < 0)
+            psuSender->ulSendErrors++;
+        else
+            {
+            psuSender->ulDatagrams++;
+            psuSender->ullBytes += psuSender->auDgramLen[uDgramIdx];
+            }
+        }
+#endif
+
+    psuSender->uNumDgrams = 0;
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+// Monotonic clock in seconds
+
+double dNow(void)
+    {
+    struct timespec     suNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &suNow);
+    return (double)suNow.tv_sec + (double)suNow.tv_nsec / 1000000000.0;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+void vSleepUntil(double dWakeTime)
+    {
+    struct timespec     suSleep;
+    double              dSleep;
+
+    dSleep = dWakeTime - dNow();
+    if (dSleep <= 0.0)
+        return;
+
+    suSleep.tv_sec  = (time_t)dSleep;
+    suSleep.tv_nsec = (long)((dSleep - (double)suSleep.tv_sec) * 1000000000.0);
+    nanosleep(&suSleep, NULL);
+
+    return;
+    }
+
+
+
+// ----------------------------------------------------------------------------
+
+void vUsage(void)
+    {
+    printf("\nI106UDPSND "MAJOR_VERSION"."MINOR_VERSION" "__DATE__" "__TIME__"\n");
+    printf("Replay a Ch 10 data file as a Ch 10 UDP data stream\n");
+    printf("Freeware Copyright (C) 2019 Irig106.org\n\n");
+    printf("Usage: i106udpsnd <infile> -p port [-a addr] [-s speed] [-m size] [-b num] [-l num]\n");
+    printf("  <infile>     Input Ch 10 file name\n");
+    printf("  -p port      Destination UDP port number\n");
+    printf("  -a addr      Destination IP address (default 127.0.0.1)\n");
+    printf("  -s speed     Multiple of real time, 0 for as fast as possible (default 1)\n");
+    printf("  -m size      Max UDP payload size, bigger packets are segmented\n");
+    printf("               (default %d)\n", DEFAULT_MAX_DGRAM);
+    printf("  -b num       Datagrams sent per system call (default %d)\n", DEFAULT_BATCH);
+    printf("  -l num       Number of times to send the file, 0 for forever (default 1)\n");
+    return;
+    }
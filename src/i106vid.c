@@ -52,6 +52,8 @@
 #include "i106_decode_video.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 #define inline __inline  // Make Microsoft happy
 #define int64_t_C(c)     (c ## i64)
 #define uint64_t_C(c)    (c ## ui64)
@@ -63,7 +65,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "02"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -108,6 +110,7 @@ int main(int argc, char ** argv)
     unsigned long           lMsgs = 0;        // Total message
     int                     bVerbose;
     int                     bPrintTMATS;
+    int                     bBlockRead;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -116,6 +119,7 @@ int main(int argc, char ** argv)
     unsigned char         * pvBuff  = NULL;
 //    SuIrig106Time           suTime;
     SuTmatsInfo             suTmatsInfo;
+    SuPktFilter             suPktFilter;
     SuVideoF0_CurrMsg       suCurrMsgF0;
 
     char                    achTSBuff[188];
@@ -133,6 +137,7 @@ int main(int argc, char ** argv)
     iChannel        = -1;
     bVerbose        = bFALSE;            /* No verbosity                      */
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -160,6 +165,11 @@ int main(int argc, char ** argv)
                     bPrintTMATS = bTRUE;
                     break;
 
+                    case '-' :                   /* Long flags */
+                    if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                        bBlockRead = bTRUE;
+                    break;
+
                     default :
                     break;
                     } /* end flag switch */
@@ -232,8 +242,15 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Only video packets are read, the rest are skipped over in big blocks.
+    // With --block-read the blocks are 8 MB instead of 1 MB.
+    vPktFilter_Init(&suPktFilter);
+    enPktFilter_Add(&suPktFilter, iChannel, I106CH10_DTYPE_VIDEO_FMT_0);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, hI106In, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -246,7 +263,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(hI106In, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -289,7 +306,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(hI106In, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -314,7 +331,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(hI106In, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -369,6 +386,7 @@ int main(int argc, char ** argv)
 
     enI106Ch10Close(hI106In);
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
 
     return 0;
     }
@@ -449,5 +467,6 @@ void vUsage(void)
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("                                             \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     }
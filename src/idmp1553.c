@@ -52,6 +52,9 @@
 #include "i106_decode_1553f1.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+#include "out_buff.h"
+
 
 /*
  * Macros and definitions
@@ -59,19 +62,39 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "03"
+#define MINOR_VERSION  "08"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define BIN_MAGIC       "I1553BIN"  // Binary output file identifier
+#define BIN_VERSION     1
+#define BIN_MAX_FILES   (32*32)     // One binary file per RT and subaddress
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Binary output record, following the out_buff.h file header
+typedef struct
+    {
+    int64_t         llTime;             // Nanoseconds since 1 Jan 1970
+    uint16_t        uChanID;
+    uint8_t         ubyBus;             // 0 = A, 1 = B
+    uint8_t         ubyErrFlags;        // Same bits as the text output
+    uint16_t        uCmdWord1;
+    uint16_t        uCmdWord2;          // RT to RT only, else 0
+    uint16_t        uStatWord1;
+    uint16_t        uStatWord2;         // RT to RT only, else 0
+    uint16_t        uWordCnt;           // Number of data words
+    uint16_t        uReserved;
+    uint16_t        auData[32];         // Unused words are 0
+    } Su1553BinRecord;                  // 88 bytes
+
 
 /*
  * Module data
@@ -83,6 +106,9 @@ int           m_usMaxBuffSize;
 
 int           m_iI106Handle;
 
+SuBinOut      m_asuBinFile[BIN_MAX_FILES];  // Binary output, only [0] if not split
+int           m_bBinOpenErr = bFALSE;
+
 
 /*
  * Function prototypes
@@ -91,6 +117,8 @@ int           m_iI106Handle;
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
 void vUsage(void);
+void vBinWriteMsg(SuI106Ch10Header * psuHdr, Su1553F1_CurrMsg * psu1553Msg,
+                  SuIrig106Time * psuTime, int bSplitRTSA, char * szOutFile);
 
 
 /* ------------------------------------------------------------------------ */
@@ -119,8 +147,14 @@ int main(int argc, char ** argv)
     int                     bDecimal;         // Hex/decimal flag
     int                     bStatusResponse;
     int                     bPrintTMATS;
+    int                     bBlockRead;
     int                     bInOrder;         // Dump out in order
     int                     bCSV;
+    int                     bLineBuffered;    // Flush every line for live tailing
+    int                     bBinary;          // Binary record output
+    int                     bSplitRTSA;       // Binary file per RT/SA
+    int                     iFileIdx;
+    SuOutBuff               suOutBuff;
     unsigned long           ulBuffSize = 0L;
     unsigned int            uErrorFlags;
 
@@ -132,6 +166,7 @@ int main(int argc, char ** argv)
     SuIrig106Time           suTime;
     Su1553F1_CurrMsg        su1553Msg;
     SuTmatsInfo             suTmatsInfo;
+    SuPktFilter             suPktFilter;
 
 /*
  * Process the command line arguements
@@ -153,9 +188,13 @@ int main(int argc, char ** argv)
     bDecimal        = bFALSE;
     bStatusResponse = bFALSE;
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
     bInOrder        = bFALSE;
     bDecimal        = bFALSE;
     bCSV            = bFALSE;
+    bLineBuffered   = bFALSE;
+    bBinary         = bFALSE;
+    bSplitRTSA      = bFALSE;
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -230,6 +269,22 @@ int main(int argc, char ** argv)
               bCSV = bTRUE;
               break;
 
+          case 'B' :                   /* Binary record output */
+            bBinary = bTRUE;
+            break;
+
+          case 'P' :                   /* Binary file per RT/SA */
+            bBinary    = bTRUE;
+            bSplitRTSA = bTRUE;
+            break;
+
+          case '-' :                   /* Long flags */
+            if (strcmp(argv[iArgIdx], "--line-buffered") == 0)
+              bLineBuffered = bTRUE;
+            else if (strcmp(argv[iArgIdx], "--block-read") == 0)
+              bBlockRead = bTRUE;
+            break;
+
           default :
             break;
           } /* end flag switch */
@@ -249,6 +304,13 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    if (bBinary && (strlen(szOutFile)==0))
+        {
+        printf("Binary output needs an output file name\n");
+        vUsage();
+        return 1;
+        }
+
   uDecCnt = uDecimation;
 
 /*
@@ -320,8 +382,14 @@ int main(int argc, char ** argv)
  * Open the output file
  */
 
+    // Binary output files are opened as they are needed
+    if (bBinary)
+        {
+        psuOutFile = stdout;
+        }
+
     // If output file specified then open it    
-    if (strlen(szOutFile) != 0)
+    else if (strlen(szOutFile) != 0)
         {
         psuOutFile = fopen(szOutFile,"w");
         if (psuOutFile == NULL) 
@@ -337,13 +405,24 @@ int main(int argc, char ** argv)
         psuOutFile = stdout;
         }
 
+    // Output is written in big blocks unless it's being watched live
+    vOutBuff_Setup(&suOutBuff, psuOutFile, bLineBuffered);
+
 
 /*
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Only 1553 packets are read, the rest are skipped over in big blocks.
+    // In order reads go through the index so there the library skips them.
+    // With --block-read the blocks are 8 MB instead of 1 MB.
+    vPktFilter_Init(&suPktFilter);
+    enPktFilter_Add(&suPktFilter, iChannel, I106CH10_DTYPE_1553_FMT_1);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, bInOrder ? NULL : szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -356,7 +435,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -388,11 +467,11 @@ int main(int argc, char ** argv)
 
     lMsgs = 1;
 
-    while (1==1) 
+    while (!bOutBuff_Stopped()) 
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -417,7 +496,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -449,110 +528,117 @@ int main(int argc, char ** argv)
                             // Maybe for 1553 messages periodicity checking ?
                             enI106_Rel2IrigTime(m_iI106Handle,
                                 su1553Msg.psu1553Hdr->aubyIntPktTime, &suTime);
-                            szTime = ctime((time_t *)&suTime.ulSecs);
-							szTime[19] = '\0';
-							iMicroSec = (int)(suTime.ulFrac / 10.0);
+
+                            // Binary output is a fixed size record instead of a line of text
+                            if (bBinary)
+                                vBinWriteMsg(&suI106Hdr, &su1553Msg, &suTime, bSplitRTSA, szOutFile);
+
+                            else
+                                {
+                                szTime = ctime((time_t *)&suTime.ulSecs);
+                                szTime[19] = '\0';
+                                iMicroSec = (int)(suTime.ulFrac / 10.0);
                            
 
-                            if (bCSV) {
-                                fprintf(psuOutFile, "%ld.%6.6d", suTime.ulSecs, iMicroSec); //Print time_t in raw format
-                            }
-                            else {
-                                fprintf(psuOutFile, "%s.%6.6d", &szTime[11], iMicroSec);
-                            }
+                                if (bCSV) {
+                                    fprintf(psuOutFile, "%ld.%6.6d", suTime.ulSecs, iMicroSec); //Print time_t in raw format
+                                }
+                                else {
+                                    fprintf(psuOutFile, "%s.%6.6d", &szTime[11], iMicroSec);
+                                }
 
 
-                            // Print out the command word
-                            if (bCSV) {
                                 // Print out the command word
-                                fprintf(psuOutFile, ";Ch;%d-%c;%2.2d;%c;%2.2d;%2.2d",
-                                    suI106Hdr.uChID,
-                                    su1553Msg.psu1553Hdr->iBusID ? 'B' : 'A',
-                                    su1553Msg.psuCmdWord1->suStruct.uRTAddr,
-                                    su1553Msg.psuCmdWord1->suStruct.bTR ? 'T' : 'R',
-                                    su1553Msg.psuCmdWord1->suStruct.uSubAddr,
-                                    su1553Msg.psuCmdWord1->suStruct.uWordCnt);
-                            }
-                            else {
-                                // Print out the command word
-                                fprintf(psuOutFile, " Ch %d-%c %2.2d %c %2.2d %2.2d",
-                                    suI106Hdr.uChID,
-                                    su1553Msg.psu1553Hdr->iBusID ? 'B' : 'A',
-                                    su1553Msg.psuCmdWord1->suStruct.uRTAddr,
-                                    su1553Msg.psuCmdWord1->suStruct.bTR ? 'T' : 'R',
-                                    su1553Msg.psuCmdWord1->suStruct.uSubAddr,
-                                    su1553Msg.psuCmdWord1->suStruct.uWordCnt);
-                            }
-
-                            // Print out the error flags
-                            uErrorFlags = 
-                                su1553Msg.psu1553Hdr->bWordError          |
-                                su1553Msg.psu1553Hdr->bSyncError    << 1  |
-                                su1553Msg.psu1553Hdr->bWordCntError << 2  |
-                                su1553Msg.psu1553Hdr->bRespTimeout  << 3  |
-                                su1553Msg.psu1553Hdr->bFormatError  << 4  |
-                                su1553Msg.psu1553Hdr->bMsgError     << 5  |
-                                su1553Msg.psu1553Hdr->bRT2RT        << 7;
-                            
-                            if (bCSV) {
-                                if (bDecimal)
-                                    fprintf(psuOutFile, ";%2d", uErrorFlags);
-                                else
-                                    fprintf(psuOutFile, ";%2.2x", uErrorFlags);
-                            }
-                            else {
-                                if (bDecimal)
-                                    fprintf(psuOutFile, " %2d", uErrorFlags);
-                                else
-                                    fprintf(psuOutFile, " %2.2x", uErrorFlags);
-                            }
-                            
+                                if (bCSV) {
+                                    // Print out the command word
+                                    fprintf(psuOutFile, ";Ch;%d-%c;%2.2d;%c;%2.2d;%2.2d",
+                                        suI106Hdr.uChID,
+                                        su1553Msg.psu1553Hdr->iBusID ? 'B' : 'A',
+                                        su1553Msg.psuCmdWord1->suStruct.uRTAddr,
+                                        su1553Msg.psuCmdWord1->suStruct.bTR ? 'T' : 'R',
+                                        su1553Msg.psuCmdWord1->suStruct.uSubAddr,
+                                        su1553Msg.psuCmdWord1->suStruct.uWordCnt);
+                                }
+                                else {
+                                    // Print out the command word
+                                    fprintf(psuOutFile, " Ch %d-%c %2.2d %c %2.2d %2.2d",
+                                        suI106Hdr.uChID,
+                                        su1553Msg.psu1553Hdr->iBusID ? 'B' : 'A',
+                                        su1553Msg.psuCmdWord1->suStruct.uRTAddr,
+                                        su1553Msg.psuCmdWord1->suStruct.bTR ? 'T' : 'R',
+                                        su1553Msg.psuCmdWord1->suStruct.uSubAddr,
+                                        su1553Msg.psuCmdWord1->suStruct.uWordCnt);
+                                }
+
+                                // Print out the error flags
+                                uErrorFlags = 
+                                    su1553Msg.psu1553Hdr->bWordError          |
+                                    su1553Msg.psu1553Hdr->bSyncError    << 1  |
+                                    su1553Msg.psu1553Hdr->bWordCntError << 2  |
+                                    su1553Msg.psu1553Hdr->bRespTimeout  << 3  |
+                                    su1553Msg.psu1553Hdr->bFormatError  << 4  |
+                                    su1553Msg.psu1553Hdr->bMsgError     << 5  |
+                                    su1553Msg.psu1553Hdr->bRT2RT        << 7;
                             
-                            if (bCSV) {
-                                // Print out the status response
-                                if (bStatusResponse == bTRUE)
+                                if (bCSV) {
                                     if (bDecimal)
-                                        fprintf(psuOutFile, ";%4d", *su1553Msg.puStatWord1);
+                                        fprintf(psuOutFile, ";%2d", uErrorFlags);
                                     else
-                                        fprintf(psuOutFile, ";%4.4x", *su1553Msg.puStatWord1);
-
-                                // Print out the data
-    //                            iWordCnt = i1553WordCnt(ptCmdWord1->tStruct);
-                                for (iWordIdx = 0; iWordIdx < su1553Msg.uWordCnt; iWordIdx++) {
+                                        fprintf(psuOutFile, ";%2.2x", uErrorFlags);
+                                }
+                                else {
                                     if (bDecimal)
-                                        fprintf(psuOutFile, ";%5.5u", su1553Msg.pauData[iWordIdx]);
+                                        fprintf(psuOutFile, " %2d", uErrorFlags);
                                     else
-                                        fprintf(psuOutFile, ";%4.4x", su1553Msg.pauData[iWordIdx]);
+                                        fprintf(psuOutFile, " %2.2x", uErrorFlags);
                                 }
+                            
+                            
+                                if (bCSV) {
+                                    // Print out the status response
+                                    if (bStatusResponse == bTRUE)
+                                        if (bDecimal)
+                                            fprintf(psuOutFile, ";%4d", *su1553Msg.puStatWord1);
+                                        else
+                                            fprintf(psuOutFile, ";%4.4x", *su1553Msg.puStatWord1);
+
+                                    // Print out the data
+        //                            iWordCnt = i1553WordCnt(ptCmdWord1->tStruct);
+                                    for (iWordIdx = 0; iWordIdx < su1553Msg.uWordCnt; iWordIdx++) {
+                                        if (bDecimal)
+                                            fprintf(psuOutFile, ";%5.5u", su1553Msg.pauData[iWordIdx]);
+                                        else
+                                            fprintf(psuOutFile, ";%4.4x", su1553Msg.pauData[iWordIdx]);
+                                    }
 
-                                int Idxcmpl = 0;
-                                if (su1553Msg.uWordCnt < 32) {
-                                    for (Idxcmpl = 0; Idxcmpl < (32 - su1553Msg.uWordCnt); Idxcmpl++) {
-                                        fprintf(psuOutFile, ";");
+                                    int Idxcmpl = 0;
+                                    if (su1553Msg.uWordCnt < 32) {
+                                        for (Idxcmpl = 0; Idxcmpl < (32 - su1553Msg.uWordCnt); Idxcmpl++) {
+                                            fprintf(psuOutFile, ";");
+                                        }
                                     }
                                 }
-                            }
-                            else {
-                                // Print out the status response
-                                if (bStatusResponse == bTRUE)
-                                    if (bDecimal)
-                                        fprintf(psuOutFile, " %4d", *su1553Msg.puStatWord1);
-                                    else
-                                        fprintf(psuOutFile, " %4.4x", *su1553Msg.puStatWord1);
-
-                                // Print out the data
-    //                            iWordCnt = i1553WordCnt(ptCmdWord1->tStruct);
-                                for (iWordIdx = 0; iWordIdx < su1553Msg.uWordCnt; iWordIdx++) {
-                                    if (bDecimal)
-                                        fprintf(psuOutFile, " %5.5u", su1553Msg.pauData[iWordIdx]);
-                                    else
-                                        fprintf(psuOutFile, " %4.4x", su1553Msg.pauData[iWordIdx]);
+                                else {
+                                    // Print out the status response
+                                    if (bStatusResponse == bTRUE)
+                                        if (bDecimal)
+                                            fprintf(psuOutFile, " %4d", *su1553Msg.puStatWord1);
+                                        else
+                                            fprintf(psuOutFile, " %4.4x", *su1553Msg.puStatWord1);
+
+                                    // Print out the data
+        //                            iWordCnt = i1553WordCnt(ptCmdWord1->tStruct);
+                                    for (iWordIdx = 0; iWordIdx < su1553Msg.uWordCnt; iWordIdx++) {
+                                        if (bDecimal)
+                                            fprintf(psuOutFile, " %5.5u", su1553Msg.pauData[iWordIdx]);
+                                        else
+                                            fprintf(psuOutFile, " %4.4x", su1553Msg.pauData[iWordIdx]);
+                                    }
                                 }
-                            }
                             
                                 
-                            fprintf(psuOutFile,"\n");
-                            fflush(psuOutFile);
+                                fprintf(psuOutFile,"\n");
+                                } // end if text output
 
                             l1553Msgs++;
                             if (bVerbose) printf("%8.8ld 1553 Messages \r",l1553Msgs);
@@ -572,6 +658,9 @@ int main(int argc, char ** argv)
                     enStatus = enI106_Decode_Next1553F1(&su1553Msg);
                     } // end while processing 1553 messages from an IRIG packet
 
+                // Don't let block output sit in the buffer too long
+                vOutBuff_Poll(&suOutBuff);
+
                 } // end if logging RT to RT
 
 
@@ -599,12 +688,92 @@ int main(int argc, char ** argv)
 
     enI106Ch10Close(m_iI106Handle);
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
+
+    for (iFileIdx=0; iFileIdx<BIN_MAX_FILES; iFileIdx++)
+        vBinOut_Close(&m_asuBinFile[iFileIdx]);
 
     return 0;
     }
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Make a binary record for a 1553 message and put it in the right file
+
+void vBinWriteMsg(SuI106Ch10Header * psuHdr, Su1553F1_CurrMsg * psu1553Msg,
+                  SuIrig106Time * psuTime, int bSplitRTSA, char * szOutFile)
+    {
+    SuBinOut          * psuBinFile;
+    Su1553BinRecord   * psuRec;
+    unsigned int        uRTAddr;
+    unsigned int        uSubAddr;
+    unsigned int        uWordCnt;
+    char                szFileName[300];
+    char              * pchExt;
+
+    uRTAddr  = psu1553Msg->psuCmdWord1->suStruct.uRTAddr;
+    uSubAddr = psu1553Msg->psuCmdWord1->suStruct.uSubAddr;
+
+    // Find the output file, opening it the first time through
+    psuBinFile = bSplitRTSA ? &m_asuBinFile[uRTAddr * 32 + uSubAddr] : &m_asuBinFile[0];
+    if (psuBinFile->psuFile == NULL)
+        {
+        if (m_bBinOpenErr)
+            return;
+
+        // Split files are named like "out_RT05_SA16.bin"
+        strcpy(szFileName, szOutFile);
+        if (bSplitRTSA)
+            {
+            pchExt = strrchr(szOutFile, '.');
+            if (pchExt != NULL)
+                szFileName[pchExt - szOutFile] = '\0';
+            sprintf(&szFileName[strlen(szFileName)], "_RT%2.2u_SA%2.2u%s",
+                uRTAddr, uSubAddr, pchExt != NULL ? pchExt : "");
+            }
+
+        if (!bBinOut_Open(psuBinFile, szFileName, BIN_MAGIC, BIN_VERSION, sizeof(Su1553BinRecord)))
+            {
+            fprintf(stderr, "Error opening binary output file '%s'\n", szFileName);
+            m_bBinOpenErr = bTRUE;
+            return;
+            }
+        } // end if file not open
+
+    // Fill in the record
+    psuRec = (Su1553BinRecord *)pvBinOut_NewRecord(psuBinFile);
+
+    psuRec->llTime      = (int64_t)psuTime->ulSecs * 1000000000 + (int64_t)psuTime->ulFrac * 100;
+    psuRec->uChanID     = psuHdr->uChID;
+    psuRec->ubyBus      = psu1553Msg->psu1553Hdr->iBusID;
+    psuRec->ubyErrFlags = 
+        psu1553Msg->psu1553Hdr->bWordError          |
+        psu1553Msg->psu1553Hdr->bSyncError    << 1  |
+        psu1553Msg->psu1553Hdr->bWordCntError << 2  |
+        psu1553Msg->psu1553Hdr->bRespTimeout  << 3  |
+        psu1553Msg->psu1553Hdr->bFormatError  << 4  |
+        psu1553Msg->psu1553Hdr->bMsgError     << 5  |
+        psu1553Msg->psu1553Hdr->bRT2RT        << 7;
+    psuRec->uCmdWord1   = psu1553Msg->psuCmdWord1->uValue;
+    if (psu1553Msg->psuCmdWord2 != NULL)
+        psuRec->uCmdWord2  = psu1553Msg->psuCmdWord2->uValue;
+    if (psu1553Msg->puStatWord1 != NULL)
+        psuRec->uStatWord1 = *psu1553Msg->puStatWord1;
+    if (psu1553Msg->puStatWord2 != NULL)
+        psuRec->uStatWord2 = *psu1553Msg->puStatWord2;
+
+    uWordCnt = psu1553Msg->uWordCnt <= 32 ? psu1553Msg->uWordCnt : 32;
+    psuRec->uWordCnt = uWordCnt;
+    if (psu1553Msg->pauData != NULL)
+        memcpy(psuRec->auData, psu1553Msg->pauData, uWordCnt * sizeof(uint16_t));
+
+    return;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
@@ -686,6 +855,10 @@ void vUsage(void)
     printf("   -u         Dump status response           \n");
     printf("   -o         Dump in time order             \n");
     printf("   -S         Dump in CSV (fixed 32 DW column num.)        \n");
+    printf("   --line-buffered  Write output a line at a time\n");
+    printf("   --block-read     Read the data file in 8 MB blocks\n");
+    printf("   -B         Dump binary records, see i106utils.txt\n");
+    printf("   -P         Dump binary records, one file per RT/SA\n");
     printf("                                             \n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
@@ -52,6 +52,9 @@
 #include "i106_decode_16pp194.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+#include "out_buff.h"
+
 
 /*
  * Macros and definitions
@@ -59,19 +62,41 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "03"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define BIN_MAGIC       "I16PPBIN"  // Binary output file identifier
+#define BIN_VERSION     1
+
+// The address and subaddress used for selection are in the low half of
+// message word 1, subaddress in bits 0-4 and address in bits 5-9
+#define ADDR_WORD       1
+#define MSG_ADDR(w)     (((w) >> 5) & 0x1f)
+#define MSG_SUBADDR(w)  ((w) & 0x1f)
+
+#define MAX_LINE_LEN    128         // Longest text output line
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Binary output record, following the out_buff.h file header
+typedef struct
+    {
+    int64_t         llTime;             // Nanoseconds since 1 Jan 1970
+    uint16_t        uChanID;
+    uint8_t         ubyAddr;
+    uint8_t         ubySubAddr;
+    uint16_t        auData[12];         // Message words as recorded
+    uint32_t        ulReserved;
+    } Su16PPBinRecord;                  // 40 bytes
+
 
 /*
  * Module data
@@ -83,6 +108,14 @@ int           m_usMaxBuffSize;
 
 int           m_iI106Handle;
 
+// Address/subaddress selection, indexed by address * 32 + subaddress
+int           m_bSelect = bFALSE;
+uint8_t       m_abySelect[32*32];
+
+SuBinOut      m_suBinFile;
+
+const char    m_achHex[] = "0123456789abcdef";
+
 
 /*
  * Function prototypes
@@ -91,6 +124,9 @@ int           m_iI106Handle;
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
 void vUsage(void);
+int  bParseSelect(char * szSelect);
+int  iFormatMsg(char * szLine, const char * szSecs, uint32_t ulFrac, const char * szChan, uint16_t * auData);
+void vBinWriteMsg(SuI106Ch10Header * psuHdr, Su16PP194_Msg * psuMsg, SuIrig106Time * psuTime);
 
 
 /* ------------------------------------------------------------------------ */
@@ -103,13 +139,23 @@ int main(int argc, char ** argv)
     int                     iArgIdx;
     FILE                  * psuOutFile;        // Output file handle
     char                  * szTime;
-    int                     iWordIdx;
-    int                     iMicroSec;
+    char                    szSecs[16];       // Cached "HH:MM:SS" for ulLastSecs
+    uint32_t                ulLastSecs;
+    time_t                  lSecs;
+    char                    szChan[16];       // " Ch nn " for the current packet
+    char                    szLine[MAX_LINE_LEN];
+    int                     iLineLen;
+    uint16_t                uAddrWord;
     int                     iChannel;         // Channel number
     unsigned long           lMsgs = 0;        // Total message
     unsigned long           l16PP194Msgs = 0;
     int                     bVerbose;
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    SuPktFilter             suPktFilter;
+    int                     bBinary;          // Binary record output
+    int                     bLineBuffered;    // Flush each line for live viewing
+    SuOutBuff               suOutBuff;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -133,6 +179,11 @@ int main(int argc, char ** argv)
     iChannel        = -1;
     bVerbose        = bFALSE;            // No verbosity
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
+    bBinary         = bFALSE;
+    bLineBuffered   = bFALSE;
+    memset(m_abySelect, 0, sizeof(m_abySelect));
+    vBinOut_Init(&m_suBinFile);
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -153,10 +204,30 @@ int main(int argc, char ** argv)
             sscanf(argv[iArgIdx],"%d",&iChannel);
             break;
 
+          case 'a' :                   /* Address/subaddress selection */
+            iArgIdx++;
+            if ((iArgIdx >= argc) || !bParseSelect(argv[iArgIdx]))
+                {
+                vUsage();
+                return 1;
+                }
+            break;
+
           case 'T' :                   /* Print TMATS flag */
             bPrintTMATS = bTRUE;
             break;
 
+          case 'B' :                   /* Binary record output */
+            bBinary = bTRUE;
+            break;
+
+          case '-' :                   /* Long flags */
+            if (strcmp(argv[iArgIdx], "--line-buffered") == 0)
+              bLineBuffered = bTRUE;
+            else if (strcmp(argv[iArgIdx], "--block-read") == 0)
+              bBlockRead = bTRUE;
+            break;
+
           default :
             break;
           } /* end flag switch */
@@ -176,6 +247,13 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    if (bBinary && (strlen(szOutFile)==0))
+        {
+        printf("Binary output needs an output file name\n");
+        vUsage();
+        return 1;
+        }
+
 /*
  * Opening banner
  * --------------
@@ -216,8 +294,19 @@ int main(int argc, char ** argv)
  * Open the output file
  */
 
+    // Binary output goes to its own file
+    if (bBinary)
+        {
+        psuOutFile = stdout;
+        if (!bBinOut_Open(&m_suBinFile, szOutFile, BIN_MAGIC, BIN_VERSION, sizeof(Su16PPBinRecord)))
+            {
+            fprintf(stderr, "Error opening binary output file '%s'\n", szOutFile);
+            return 1;
+            }
+        }
+
     // If output file specified then open it    
-    if (strlen(szOutFile) != 0)
+    else if (strlen(szOutFile) != 0)
         {
         psuOutFile = fopen(szOutFile,"w");
         if (psuOutFile == NULL) 
@@ -233,13 +322,21 @@ int main(int argc, char ** argv)
         psuOutFile = stdout;
         }
 
+    // Output is written in big blocks unless it's being watched live
+    vOutBuff_Setup(&suOutBuff, psuOutFile, bLineBuffered);
+
 
 /*
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -252,7 +349,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -283,12 +380,14 @@ int main(int argc, char ** argv)
  */
 
     lMsgs = 1;
+    ulLastSecs = 0;
+    szSecs[0]  = '\0';
 
-    while (1==1) 
+    while (!bOutBuff_Stopped()) 
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -313,7 +412,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -323,39 +422,56 @@ int main(int argc, char ** argv)
                 if (bVerbose) 
                     fprintf(stderr, "%8.8ld Messages \r",lMsgs);
 
-                    // Step through all 1553 messages
+                // The channel part of the line is the same for the whole packet
+                sprintf(szChan, " Ch %-3d", suI106Hdr.uChID);
+
+                // Step through all 16PP194 messages
                 enStatus = enI106_Decode_First16PP194(&suI106Hdr, pvBuff, &su16PP194Msg);
                 while (enStatus == I106_OK)
                     {
 
-                        // Print out the time
+                    // Check for matching parameters
+                    uAddrWord = su16PP194Msg.psu16PP194Msg->suData[ADDR_WORD];
+                    if (!m_bSelect ||
+                        m_abySelect[MSG_ADDR(uAddrWord) * 32 + MSG_SUBADDR(uAddrWord)])
+                        {
+
                         // PROBABLY REALLY OUGHT TO CHECK FOR THAT GOOFY SECONDARY
                         // HEADER FORMAT TIME REPRESENTATION. DOES ANYONE USE THAT???
                         enI106_Rel2IrigTime(m_iI106Handle, su16PP194Msg.psu16PP194Msg->aubyIntPktTime, &suTime);
-                        szTime = ctime((time_t *)&suTime.ulSecs);
-						szTime[19] = '\0';
-						iMicroSec = (int)(suTime.ulFrac / 10.0);
-                        fprintf(psuOutFile,"%s.%6.6d", &szTime[11], iMicroSec);
-
-                        // Print out the Channel ID
-                        fprintf(psuOutFile," Ch %-3d", suI106Hdr.uChID);
-
-                        // Print out the data words
-                        for (iWordIdx=0; iWordIdx<12; iWordIdx++)
-                            fprintf(psuOutFile," %4.4x", su16PP194Msg.psu16PP194Msg->suData[iWordIdx]);
 
-                        fprintf(psuOutFile,"\n");
-                        fflush(psuOutFile);
+                        // Binary output is a fixed size record instead of a line of text
+                        if (bBinary)
+                            vBinWriteMsg(&suI106Hdr, su16PP194Msg.psu16PP194Msg, &suTime);
+
+                        else
+                            {
+                            // Only make a new time string when the second changes
+                            if ((suTime.ulSecs != ulLastSecs) || (szSecs[0] == '\0'))
+                                {
+                                lSecs  = (time_t)suTime.ulSecs;
+                                szTime = ctime(&lSecs);
+                                memcpy(szSecs, &szTime[11], 8);
+                                szSecs[8]  = '\0';
+                                ulLastSecs = suTime.ulSecs;
+                                }
+
+                            iLineLen = iFormatMsg(szLine, szSecs, suTime.ulFrac, szChan,
+                                                  su16PP194Msg.psu16PP194Msg->suData);
+                            fwrite(szLine, 1, iLineLen, psuOutFile);
+                            }
 
                         l16PP194Msgs++;
                         if (bVerbose) printf("%8.8ld 16PP194 Messages \r",l16PP194Msgs);
 
-#if 0
                         } // end if parameters match
-#endif
+
                     // Get the next 16PP194 message
                     enStatus = enI106_Decode_Next16PP194(&su16PP194Msg);
-                    } // end while processing 1553 messages from an IRIG packet
+                    } // end while processing 16PP194 messages from an IRIG packet
+
+                // Don't let block output sit in the buffer too long
+                vOutBuff_Poll(&suOutBuff);
 
                 } // end if 16PP194 data packet type
 
@@ -383,13 +499,123 @@ int main(int argc, char ** argv)
  */
 
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&suPktFilter);
     fclose(psuOutFile);
+    vBinOut_Close(&m_suBinFile);
 
     return 0;
     }
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Add a comma separated list of "Addr[/SubAddr]" to the selection table.
+// No subaddress selects all subaddresses for that address.
+
+int bParseSelect(char * szSelect)
+    {
+    char              * szEntry;
+    int                 iAddr;
+    int                 iSubAddr;
+    int                 iFields;
+
+    for (szEntry = strtok(szSelect, ","); szEntry != NULL; szEntry = strtok(NULL, ","))
+        {
+        iSubAddr = -1;
+        iFields  = sscanf(szEntry, "%d/%d", &iAddr, &iSubAddr);
+        if ((iFields < 1) || (iAddr < 0) || (iAddr > 31) || (iSubAddr < -1) || (iSubAddr > 31))
+            {
+            printf("Bad address/subaddress '%s'\n", szEntry);
+            return bFALSE;
+            }
+
+        if (iSubAddr == -1)
+            memset(&m_abySelect[iAddr * 32], 1, 32);
+        else
+            m_abySelect[iAddr * 32 + iSubAddr] = 1;
+        } // end for all entries
+
+    m_bSelect = bTRUE;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make a text output line for one message and return its length. This is
+// the same as "%s.%6.6d%s" and 12 " %4.4x" but without the printf overhead
+// for every message.
+
+int iFormatMsg(char * szLine, const char * szSecs, uint32_t ulFrac, const char * szChan, uint16_t * auData)
+    {
+    char              * pchOut;
+    uint32_t            ulMicroSec;
+    int                 iDigitIdx;
+    int                 iWordIdx;
+
+    pchOut = szLine;
+
+    // Time
+    memcpy(pchOut, szSecs, 8);
+    pchOut += 8;
+    *pchOut++ = '.';
+    ulMicroSec = ulFrac / 10;
+    for (iDigitIdx=5; iDigitIdx>=0; iDigitIdx--)
+        {
+        pchOut[iDigitIdx] = (char)('0' + ulMicroSec % 10);
+        ulMicroSec /= 10;
+        }
+    pchOut += 6;
+
+    // Channel ID
+    while (*szChan != '\0')
+        *pchOut++ = *szChan++;
+
+    // Data words
+    for (iWordIdx=0; iWordIdx<12; iWordIdx++)
+        {
+        pchOut[0] = ' ';
+        pchOut[1] = m_achHex[(auData[iWordIdx] >> 12) & 0x0f];
+        pchOut[2] = m_achHex[(auData[iWordIdx] >>  8) & 0x0f];
+        pchOut[3] = m_achHex[(auData[iWordIdx] >>  4) & 0x0f];
+        pchOut[4] = m_achHex[ auData[iWordIdx]        & 0x0f];
+        pchOut += 5;
+        }
+
+    *pchOut++ = '\n';
+
+    return (int)(pchOut - szLine);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make a binary record for a 16PP194 message
+
+void vBinWriteMsg(SuI106Ch10Header * psuHdr, Su16PP194_Msg * psuMsg, SuIrig106Time * psuTime)
+    {
+    Su16PPBinRecord   * psuRec;
+
+    if (m_suBinFile.psuFile == NULL)
+        return;
+
+    psuRec = (Su16PPBinRecord *)pvBinOut_NewRecord(&m_suBinFile);
+
+    psuRec->llTime     = (int64_t)psuTime->ulSecs * 1000000000 + (int64_t)psuTime->ulFrac * 100;
+    psuRec->uChanID    = psuHdr->uChID;
+    psuRec->ubyAddr    = MSG_ADDR(psuMsg->suData[ADDR_WORD]);
+    psuRec->ubySubAddr = MSG_SUBADDR(psuMsg->suData[ADDR_WORD]);
+    memcpy(psuRec->auData, psuMsg->suData, sizeof(psuRec->auData));
+
+    return;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
@@ -468,6 +694,10 @@ void vUsage(void)
     printf("   <filename> Input/output file names        \n");
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
+    printf("   -a Addrs   Addr[/SubAddr] list, like 3,5/1 (default all)\n");
+    printf("   -B         Binary record output (needs output file name)\n");
+    printf("   --line-buffered  Write output a line at a time\n");
+    printf("   --block-read     Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     }
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 #include <assert.h>
 
 #include "config.h"
@@ -52,6 +53,10 @@
 #include "i106_decode_arinc429.h"
 #include "i106_decode_tmats.h"
 
+#include "a429_dict.h"
+#include "time_map.h"
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -59,19 +64,68 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "01"
+#define MINOR_VERSION  "07"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define LABEL_STATS_INITIAL 1024        // Hash slots to start, a power of two
+#define LABEL_STATS_MIN_GAPS 4          // Intervals to average before looking for long gaps
+#define MAX_CHANNELS        0x10000
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// A label asked for with -l, -1 for any channel, bus, or SDI
+typedef struct
+    {
+    int32_t                 iChID;
+    int32_t                 iBus;
+    uint32_t                uLabel;         // Octal label as written, not bit reversed
+    int32_t                 iSDI;
+    } SuLabelSpec;
+
+// Labels selected on one channel, a bit for each SDI
+typedef struct
+    {
+    uint8_t                 aabySDIs[0x100][0x100];     // [bus][label field]
+    } SuLabelSelect;
+
+// Update statistics for one label. Times are relative time counts. The
+// mean and variance of the update interval are kept with Welford's method.
+typedef struct
+    {
+    uint16_t                uChID;
+    uint8_t                 uBus;
+    uint8_t                 uLabelField;    // As received, bit reversed
+    uint8_t                 uSDI;
+    uint8_t                 uLastSSM;
+    uint64_t                ullMsgs;        // 0 for an empty hash slot
+    int64_t                 llFirstTime;
+    int64_t                 llLastTime;
+    int64_t                 llMinGap;
+    int64_t                 llMaxGap;
+    int64_t                 llMaxGapTime;   // Last update before the longest gap
+    double                  dMeanGap;
+    double                  dGapM2;         // Sum of squared differences from the mean
+    uint32_t                ulSSMChanges;
+    uint32_t                ulLongGaps;
+    } SuLabelStats;
+
+// Open addressed hash table of label statistics
+typedef struct
+    {
+    uint32_t                uNumLabels;
+    uint32_t                uHashSize;      // Always a power of two
+    double                  dGapMult;       // Long gap is this many mean intervals
+    SuLabelStats          * pasuLabels;
+    } SuLabelStatsTable;
+
 
 /*
  * Module data
@@ -83,13 +137,28 @@ int           m_usMaxBuffSize;
 
 int           m_iI106Handle;
 
+SuTimeMap     m_suTimeMap;          // Empty unless -M
+
+unsigned char m_aArincLabelMap[0x100];
+
+SuLabelSelect * m_psuAnyChanSelect;                  // Labels on any channel
+SuLabelSelect * m_apsuLabelSelect[MAX_CHANNELS];     // NULL if nothing selected
+
 
 /*
  * Function prototypes
  * -------------------
  */
 
-unsigned char ReverseLabel(unsigned char uLabel);
+void vMakeArincLabelMap(unsigned char m_aArincLabelMap[]);
+int  bParseLabelSpec(char * szSpec, SuLabelSpec * psuSpec);
+int  bMakeLabelSelect(const SuLabelSpec * pasuSpecs, unsigned int uNumSpecs);
+void vFreeLabelSelect(void);
+SuLabelStats * psuFindLabelStats(SuLabelStatsTable * psuTable, unsigned int uChID, unsigned int uBus, 
+                                 unsigned int uLabelField, unsigned int uSDI);
+void vAddLabelStats(SuLabelStatsTable * psuTable, unsigned int uChID, SuArinc429F0_CurrMsg * psuMsg);
+void vPrintLabelStats(SuLabelStatsTable * psuTable, SuA429Dict * psuDict, FILE * psuOutFile);
+int iCompareLabelStats(const void * pvStats1, const void * pvStats2);
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
 void vUsage(void);
 
@@ -112,6 +181,20 @@ int main(int argc, char ** argv)
     int                     bVerbose;
     int                     bDecimal;         // Hex/decimal flag
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    char                    szDictFile[256];  // Label dictionary file name
+    SuA429Dict              suA429Dict;
+    SuA429Param           * psuParam;
+    char                    szLine[256];
+    char                  * pchLine;
+    int                     bStatistics;
+    SuLabelStatsTable       suLabelStats;
+    SuLabelSpec           * pasuLabelSpecs;
+    unsigned int            uNumLabelSpecs;
+    char                  * szLabelSpec;
+    SuLabelSelect         * psuLabelSelect;
+    int                     bUseTimeMap;
+    unsigned int            uChanIdx;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -121,6 +204,7 @@ int main(int argc, char ** argv)
     SuIrig106Time           suTime;
 	SuArinc429F0_CurrMsg    suArinc429Msg;
     SuTmatsInfo             suTmatsInfo;
+    SuPktFilter             suPktFilter;
 
 /*
  * Process the command line arguements
@@ -138,6 +222,16 @@ int main(int argc, char ** argv)
     bVerbose        = bFALSE;            /* No verbosity                      */
     bDecimal        = bFALSE;
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
+
+    szDictFile[0]   = '\0';              /* Raw data words                    */
+    bStatistics     = bFALSE;
+    memset(&suLabelStats, 0, sizeof(suLabelStats));
+    pasuLabelSpecs  = NULL;               /* All labels                        */
+    uNumLabelSpecs  = 0;
+    vA429Dict_Init(&suA429Dict);
+    bUseTimeMap     = bFALSE;
+    vTimeMap_Init(&m_suTimeMap);
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -166,10 +260,64 @@ int main(int argc, char ** argv)
                         sscanf(argv[iArgIdx],"%d",&iBus);
                         break;
 
+                    case 'd' :                   /* Label dictionary */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        strcpy(szDictFile, argv[iArgIdx]);
+                        break;
+
+                    case 'a' :                   /* Label rate analysis */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        sscanf(argv[iArgIdx],"%lf",&suLabelStats.dGapMult);
+                        if (suLabelStats.dGapMult <= 1.0)
+                            {
+                            fprintf(stderr, "Gap multiple must be more than 1\n");
+                            return 1;
+                            }
+                        bStatistics = bTRUE;
+                        break;
+
+                    case 'l' :                   /* Labels to print */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        for (szLabelSpec = strtok(argv[iArgIdx], ","); szLabelSpec != NULL; szLabelSpec = strtok(NULL, ","))
+                            {
+                            pasuLabelSpecs = (SuLabelSpec *)realloc(pasuLabelSpecs, (uNumLabelSpecs + 1) * sizeof(SuLabelSpec));
+                            if (bParseLabelSpec(szLabelSpec, &pasuLabelSpecs[uNumLabelSpecs]) == bFALSE)
+                                {
+                                fprintf(stderr, "Bad label %s\n", szLabelSpec);
+                                return 1;
+                                }
+                            uNumLabelSpecs++;
+                            }
+                        break;
+
+                    case 'M' :                   /* Time map */
+                        bUseTimeMap = bTRUE;
+                        break;
+
                     case 'T' :                   /* Print TMATS flag */
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   /* Long flags */
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -200,6 +348,33 @@ int main(int argc, char ** argv)
 	putenv("TZ=GMT0");
 	tzset();
 
+    vMakeArincLabelMap(m_aArincLabelMap);
+
+    if (uNumLabelSpecs != 0)
+        {
+        if (bMakeLabelSelect(pasuLabelSpecs, uNumLabelSpecs) == bFALSE)
+            {
+            fprintf(stderr, "Error allocating label selection\n");
+            return 1;
+            }
+        }
+
+/*
+ * Load the label dictionary and make the lookup tables
+ */
+
+    if (szDictFile[0] != '\0')
+        {
+        enStatus = enA429Dict_Load(&suA429Dict, szDictFile);
+        if (enStatus == I106_OK)
+            enStatus = enA429Dict_Compile(&suA429Dict);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error reading label dictionary : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
 /*
  *  Open file and allocate a buffer for reading data.
  */
@@ -226,6 +401,17 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    // Time from a map of all the time packets instead of the last one seen
+    if (bUseTimeMap)
+        {
+        enStatus = enTimeMap_Get(&m_suTimeMap, m_iI106Handle, szInFile, TIME_MAP_ANY_CHAN);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error making time map : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
 
 /*
  * Open the output file
@@ -253,8 +439,25 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Only packets with selected labels are read, the rest are skipped over
+    // in big blocks. Time packets aren't needed when time comes from the map.
+    // With --block-read the blocks are 8 MB instead of 1 MB.
+    vPktFilter_Init(&suPktFilter);
+    if (!bUseTimeMap)
+        enPktFilter_Add(&suPktFilter, PKT_FILTER_ANY, I106CH10_DTYPE_IRIG_TIME);
+    if ((uNumLabelSpecs == 0) || (m_psuAnyChanSelect != NULL))
+        enPktFilter_Add(&suPktFilter, iChannel, I106CH10_DTYPE_ARINC_429_FMT_0);
+    else
+        {
+        for (uChanIdx=0; uChanIdx<MAX_CHANNELS; uChanIdx++)
+            if ((m_apsuLabelSelect[uChanIdx] != NULL) && ((iChannel == -1) || (iChannel == (int)uChanIdx)))
+                enPktFilter_Add(&suPktFilter, (int)uChanIdx, I106CH10_DTYPE_ARINC_429_FMT_0);
+        }
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -267,7 +470,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -303,7 +506,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -326,14 +529,16 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer and decode time
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
                 enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
                 enI106_SetRelTime(m_iI106Handle, &suTime, suI106Hdr.aubyRefTime);
                 }
 
             // If ARINC 429 message then process it
+            // Skip channels with none of the selected labels without reading them
             if ((suI106Hdr.ubyDataType == I106CH10_DTYPE_ARINC_429_FMT_0) &&
-                ((iChannel == -1) || (iChannel == (int)suI106Hdr.uChID)))
+                ((iChannel == -1) || (iChannel == (int)suI106Hdr.uChID)) &&
+                ((uNumLabelSpecs == 0) || (m_apsuLabelSelect[suI106Hdr.uChID] != NULL)))
                 {
 
                 // Make sure our buffer is big enough, size *does* matter
@@ -344,7 +549,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -355,28 +560,73 @@ int main(int argc, char ** argv)
                     fprintf(stderr, "%8.8ld Messages \r",lMsgs);
 
                     // Step through all ARINC 429 messages
+                psuLabelSelect = m_apsuLabelSelect[suI106Hdr.uChID];
                 enStatus = enI106_Decode_FirstArinc429F0(&suI106Hdr, pvBuff, &suArinc429Msg);
                 while (enStatus == I106_OK)
                     {
 
+                    // Skip labels that weren't asked for before doing anything else
+                    if ((psuLabelSelect != NULL) &&
+                        ((psuLabelSelect->aabySDIs[suArinc429Msg.psu429Hdr->uBusNum][suArinc429Msg.psu429Data->uLabel] &
+                          (1 << suArinc429Msg.psu429Data->uSDI)) == 0))
+                        {
+                        enStatus = enI106_Decode_NextArinc429F0(&suArinc429Msg);
+                        continue;
+                        }
+
+                    // Just collect update statistics
+                    if (bStatistics)
+                        {
+                        if ((iBus == -1) || (iBus == (int)suArinc429Msg.psu429Hdr->uBusNum))
+                            {
+                            vAddLabelStats(&suLabelStats, suI106Hdr.uChID, &suArinc429Msg);
+                            l429Msgs++;
+                            }
+                        }
+
+                    // Engineering units for labels in the dictionary
+                    else if (szDictFile[0] != '\0')
+                        {
+                        psuParam = psuA429Dict_Find(&suA429Dict, suArinc429Msg.psu429Hdr->uBusNum, 
+                                                    suArinc429Msg.psu429Data->uLabel, suArinc429Msg.psu429Data->uSDI);
+                        if ((psuParam != NULL) && 
+                            ((iBus == -1) || (iBus == (int)suArinc429Msg.psu429Hdr->uBusNum)))
+                            {
+                            enTimeMap_RelInt2IrigTime(&m_suTimeMap, m_iI106Handle, suArinc429Msg.llIntPktTime, &suTime);
+                            pchLine  = szLine;
+                            pchLine += sprintf(pchLine, "%s %5.1u %3.1u %3.3o %1.1u %1.1u %s ", 
+                                IrigTime2String(&suTime), suI106Hdr.uChID, 
+                                suArinc429Msg.psu429Hdr->uBusNum, 
+                                m_aArincLabelMap[suArinc429Msg.psu429Data->uLabel],
+                                suArinc429Msg.psu429Data->uSDI, suArinc429Msg.psu429Data->uSSM,
+                                psuParam->szName);
+                            pchLine  = psuParam->pfDecode(psuParam, suArinc429Msg.psu429Data->uData, 
+                                                          suArinc429Msg.psu429Data->uSSM, pchLine);
+                            if (psuParam->szUnits[0] != '\0')
+                                pchLine += sprintf(pchLine, " %s", psuParam->szUnits);
+                            strcpy(pchLine, "\n");
+                            fputs(szLine, psuOutFile);
+                            l429Msgs++;
+                            }
+                        }
+
                     // If bus number specified then only print those
-                    if ((iBus == -1) || (iBus == (int)suArinc429Msg.psu429Hdr->uBusNum))
+                    else if ((iBus == -1) || (iBus == (int)suArinc429Msg.psu429Hdr->uBusNum))
                         {
                         // Print out the time
-                        enI106_RelInt2IrigTime(m_iI106Handle, suArinc429Msg.llIntPktTime, &suTime);
+                        enTimeMap_RelInt2IrigTime(&m_suTimeMap, m_iI106Handle, suArinc429Msg.llIntPktTime, &suTime);
                         szTime = IrigTime2String(&suTime);
                         fprintf(psuOutFile,"%s", szTime);
 
                         // Print out the data
                         fprintf(psuOutFile," %5.1u",   suI106Hdr.uChID);
                         fprintf(psuOutFile," %3.1u",   suArinc429Msg.psu429Hdr->uBusNum);
-                        fprintf(psuOutFile," %3.3o",   ReverseLabel((unsigned char)suArinc429Msg.psu429Data->uLabel));
+                        fprintf(psuOutFile," %3.3o",   m_aArincLabelMap[suArinc429Msg.psu429Data->uLabel]);
                         fprintf(psuOutFile," %1.1u",   suArinc429Msg.psu429Data->uSDI);
                         fprintf(psuOutFile," 0x%5.5x", suArinc429Msg.psu429Data->uData);
                         fprintf(psuOutFile," %1.1u",   suArinc429Msg.psu429Data->uSSM);
 
                         fprintf(psuOutFile,"\n");
-                        fflush(psuOutFile);
 
                         l429Msgs++;
                         if (bVerbose) printf("%8.8ld AIRNC 429 Messages \r",l429Msgs);
@@ -404,6 +654,10 @@ int main(int argc, char ** argv)
  * Print out some summaries
  */
 
+    if (bStatistics)
+        vPrintLabelStats(&suLabelStats, &suA429Dict, psuOutFile);
+    free(suLabelStats.pasuLabels);
+
     printf("\nTotal Message %lu\n", lMsgs);
 
 
@@ -413,6 +667,11 @@ int main(int argc, char ** argv)
 
     enI106Ch10Close(m_iI106Handle);
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
+    vA429Dict_Free(&suA429Dict);
+    vFreeLabelSelect();
+    vTimeMap_Free(&m_suTimeMap);
+    free(pasuLabelSpecs);
 
     return 0;
     }
@@ -484,20 +743,376 @@ void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
 
 /* ------------------------------------------------------------------------ */
 
-unsigned char ReverseLabel(unsigned char uLabel)
+// The ARINC 429 label field is bit reversed. This array maps the ARINC
+// label field to its non-reversed bretheren.
+
+void vMakeArincLabelMap(unsigned char m_aArincLabelMap[])
     {
+    unsigned int    uLabelIdx;
     unsigned char   uRLabel;
+    unsigned char   uLabel;
     int             iBitIdx;
 
-    uRLabel = 0;
-    for (iBitIdx=0; iBitIdx<8; iBitIdx++)
+    for (uLabelIdx=0; uLabelIdx<0x100; uLabelIdx++)
+        {
+        uLabel = (unsigned char)uLabelIdx;
+        uRLabel = 0;
+        for (iBitIdx=0; iBitIdx<8; iBitIdx++)
+            {
+            uRLabel <<= 1;
+            uRLabel  |= uLabel & 0x01;
+            uLabel  >>= 1;
+            } // end for each bit in the label
+        m_aArincLabelMap[uLabelIdx] = uRLabel;
+        } // end for each label
+
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Parse a -l label, [[Chan/]Bus/]Label[:SDI] with the label in octal
+
+int bParseLabelSpec(char * szLabelSpec, SuLabelSpec * psuSpec)
+    {
+    char                    szSpec[64];
+    char                  * pchSDI;
+    char                  * pchLabel;
+    char                  * pchBus;
+    char                    chExtra;
+
+    psuSpec->iChID = -1;
+    psuSpec->iBus  = -1;
+    psuSpec->iSDI  = -1;
+
+    if (strlen(szLabelSpec) >= sizeof(szSpec))
+        return bFALSE;
+    strcpy(szSpec, szLabelSpec);
+
+    pchSDI = strchr(szSpec, ':');
+    if (pchSDI != NULL)
+        {
+        *pchSDI++ = '\0';
+        if ((sscanf(pchSDI, "%d%c", &psuSpec->iSDI, &chExtra) != 1) || 
+            (psuSpec->iSDI < 0) || (psuSpec->iSDI > 3))
+            return bFALSE;
+        }
+
+    pchLabel = strrchr(szSpec, '/');
+    if (pchLabel != NULL)
+        {
+        *pchLabel++ = '\0';
+        pchBus = strrchr(szSpec, '/');
+        if (pchBus != NULL)
+            {
+            *pchBus++ = '\0';
+            if ((sscanf(szSpec, "%d%c", &psuSpec->iChID, &chExtra) != 1) || 
+                (psuSpec->iChID < 0) || (psuSpec->iChID >= MAX_CHANNELS))
+                return bFALSE;
+            }
+        else
+            pchBus = szSpec;
+        if ((sscanf(pchBus, "%d%c", &psuSpec->iBus, &chExtra) != 1) || 
+            (psuSpec->iBus < 0) || (psuSpec->iBus > 0xff))
+            return bFALSE;
+        }
+    else
+        pchLabel = szSpec;
+
+    if ((sscanf(pchLabel, "%o%c", &psuSpec->uLabel, &chExtra) != 1) || (psuSpec->uLabel > 0xff))
+        return bFALSE;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make the [bus][label field] SDI bitmaps for each channel. Channels with
+// their own labels get their own bitmap, starting with the labels for any
+// channel. The rest share the any channel bitmap, or NULL if there is none.
+
+int bMakeLabelSelect(const SuLabelSpec * pasuSpecs, unsigned int uNumSpecs)
+    {
+    const SuLabelSpec     * psuSpec;
+    SuLabelSelect         * psuSelect;
+    unsigned int            uSpecIdx;
+    unsigned int            uChanIdx;
+    int                     iPass;
+    int                     iBus;
+    uint8_t                 bySDIs;
+
+    for (iPass=0; iPass<2; iPass++)
+        {
+        for (uSpecIdx=0; uSpecIdx<uNumSpecs; uSpecIdx++)
+            {
+            psuSpec = &pasuSpecs[uSpecIdx];
+            if ((psuSpec->iChID != -1) != (iPass == 1))
+                continue;
+
+            if (psuSpec->iChID == -1)
+                {
+                if (m_psuAnyChanSelect == NULL)
+                    m_psuAnyChanSelect = (SuLabelSelect *)calloc(1, sizeof(SuLabelSelect));
+                psuSelect = m_psuAnyChanSelect;
+                }
+            else
+                {
+                if (m_apsuLabelSelect[psuSpec->iChID] == NULL)
+                    {
+                    m_apsuLabelSelect[psuSpec->iChID] = (SuLabelSelect *)calloc(1, sizeof(SuLabelSelect));
+                    if ((m_apsuLabelSelect[psuSpec->iChID] != NULL) && (m_psuAnyChanSelect != NULL))
+                        memcpy(m_apsuLabelSelect[psuSpec->iChID], m_psuAnyChanSelect, sizeof(SuLabelSelect));
+                    }
+                psuSelect = m_apsuLabelSelect[psuSpec->iChID];
+                }
+            if (psuSelect == NULL)
+                return bFALSE;
+
+            bySDIs = (uint8_t)((psuSpec->iSDI == -1) ? 0x0f : (1 << psuSpec->iSDI));
+            for (iBus=0; iBus<0x100; iBus++)
+                if ((psuSpec->iBus == -1) || (psuSpec->iBus == iBus))
+                    psuSelect->aabySDIs[iBus][m_aArincLabelMap[psuSpec->uLabel]] |= bySDIs;
+            } // end for all label specs
+        } // end for both passes
+
+    for (uChanIdx=0; uChanIdx<MAX_CHANNELS; uChanIdx++)
+        if (m_apsuLabelSelect[uChanIdx] == NULL)
+            m_apsuLabelSelect[uChanIdx] = m_psuAnyChanSelect;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vFreeLabelSelect(void)
+    {
+    unsigned int            uChanIdx;
+
+    for (uChanIdx=0; uChanIdx<MAX_CHANNELS; uChanIdx++)
+        {
+        if (m_apsuLabelSelect[uChanIdx] != m_psuAnyChanSelect)
+            free(m_apsuLabelSelect[uChanIdx]);
+        m_apsuLabelSelect[uChanIdx] = NULL;
+        }
+    free(m_psuAnyChanSelect);
+    m_psuAnyChanSelect = NULL;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Find the statistics for a label, adding it if it isn't there yet.
+// Returns NULL if out of memory.
+
+SuLabelStats * psuFindLabelStats(SuLabelStatsTable * psuTable, unsigned int uChID, unsigned int uBus, 
+                                 unsigned int uLabelField, unsigned int uSDI)
+    {
+    SuLabelStats          * pasuOldLabels;
+    SuLabelStats          * psuLabel;
+    uint32_t                uOldSize;
+    uint32_t                uHashIdx;
+    uint32_t                uOldIdx;
+    uint32_t                uKey;
+
+    // Grow the table when it gets half full
+    if ((psuTable->uNumLabels + 1) * 2 > psuTable->uHashSize)
+        {
+        pasuOldLabels = psuTable->pasuLabels;
+        uOldSize      = psuTable->uHashSize;
+        psuTable->uHashSize  = (uOldSize == 0) ? LABEL_STATS_INITIAL : uOldSize * 2;
+        psuTable->pasuLabels = (SuLabelStats *)calloc(psuTable->uHashSize, sizeof(SuLabelStats));
+        if (psuTable->pasuLabels == NULL)
+            {
+            psuTable->pasuLabels = pasuOldLabels;
+            psuTable->uHashSize  = uOldSize;
+            return NULL;
+            }
+        for (uOldIdx=0; uOldIdx<uOldSize; uOldIdx++)
+            {
+            psuLabel = &pasuOldLabels[uOldIdx];
+            if (psuLabel->ullMsgs == 0)
+                continue;
+            uKey     = (psuLabel->uChID << 18) ^ (psuLabel->uBus << 10) ^ (psuLabel->uLabelField << 2) ^ psuLabel->uSDI;
+            uHashIdx = (uKey * 2654435761u) & (psuTable->uHashSize - 1);
+            while (psuTable->pasuLabels[uHashIdx].ullMsgs != 0)
+                uHashIdx = (uHashIdx + 1) & (psuTable->uHashSize - 1);
+            psuTable->pasuLabels[uHashIdx] = *psuLabel;
+            }
+        free(pasuOldLabels);
+        }
+
+    uKey     = (uChID << 18) ^ (uBus << 10) ^ (uLabelField << 2) ^ uSDI;
+    uHashIdx = (uKey * 2654435761u) & (psuTable->uHashSize - 1);
+    while (bTRUE)
+        {
+        psuLabel = &psuTable->pasuLabels[uHashIdx];
+        if (psuLabel->ullMsgs == 0)
+            break;
+        if ((psuLabel->uLabelField == uLabelField) && (psuLabel->uBus == uBus) && 
+            (psuLabel->uSDI == uSDI) && (psuLabel->uChID == uChID))
+            return psuLabel;
+        uHashIdx = (uHashIdx + 1) & (psuTable->uHashSize - 1);
+        }
+
+    // New one, the caller counts the first message
+    psuLabel->uChID       = (uint16_t)uChID;
+    psuLabel->uBus        = (uint8_t)uBus;
+    psuLabel->uLabelField = (uint8_t)uLabelField;
+    psuLabel->uSDI        = (uint8_t)uSDI;
+    psuTable->uNumLabels++;
+
+    return psuLabel;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Count one 429 word. A long gap is one more than the gap multiple times
+// the mean interval so far.
+
+void vAddLabelStats(SuLabelStatsTable * psuTable, unsigned int uChID, SuArinc429F0_CurrMsg * psuMsg)
+    {
+    SuLabelStats          * psuLabel;
+    int64_t                 llGap;
+    double                  dDelta;
+
+    psuLabel = psuFindLabelStats(psuTable, uChID, psuMsg->psu429Hdr->uBusNum, 
+                                 psuMsg->psu429Data->uLabel, psuMsg->psu429Data->uSDI);
+    if (psuLabel == NULL)
+        return;
+
+    if (psuLabel->ullMsgs == 0)
         {
-        uRLabel <<= 1;
-        uRLabel  |= uLabel & 0x01;
-        uLabel  >>= 1;
+        psuLabel->llFirstTime = psuMsg->llIntPktTime;
+        psuLabel->llMinGap    = -1;
+        psuLabel->uLastSSM    = (uint8_t)psuMsg->psu429Data->uSSM;
         }
+    else
+        {
+        llGap = psuMsg->llIntPktTime - psuLabel->llLastTime;
+        if ((psuLabel->ullMsgs > LABEL_STATS_MIN_GAPS) && 
+            (llGap > psuTable->dGapMult * psuLabel->dMeanGap))
+            psuLabel->ulLongGaps++;
+        if ((psuLabel->llMinGap < 0) || (llGap < psuLabel->llMinGap))
+            psuLabel->llMinGap = llGap;
+        if (llGap > psuLabel->llMaxGap)
+            {
+            psuLabel->llMaxGap     = llGap;
+            psuLabel->llMaxGapTime = psuLabel->llLastTime;
+            }
+
+        // Running mean and variance, ullMsgs intervals with this one
+        dDelta              = llGap - psuLabel->dMeanGap;
+        psuLabel->dMeanGap += dDelta / psuLabel->ullMsgs;
+        psuLabel->dGapM2   += dDelta * (llGap - psuLabel->dMeanGap);
 
-    return uRLabel;
+        if (psuLabel->uLastSSM != psuMsg->psu429Data->uSSM)
+            {
+            psuLabel->ulSSMChanges++;
+            psuLabel->uLastSSM = (uint8_t)psuMsg->psu429Data->uSSM;
+            }
+        }
+    psuLabel->llLastTime = psuMsg->llIntPktTime;
+    psuLabel->ullMsgs++;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Print the update statistics for each label. Intervals are in milliseconds,
+// jitter is the standard deviation of the interval.
+
+void vPrintLabelStats(SuLabelStatsTable * psuTable, SuA429Dict * psuDict, FILE * psuOutFile)
+    {
+    SuLabelStats          * pasuLabels;
+    SuLabelStats          * psuLabel;
+    SuA429Param           * psuParam;
+    SuIrig106Time           suTime;
+    uint32_t                uHashIdx;
+    uint32_t                uNumLabels;
+    uint32_t                uLabelIdx;
+    double                  dSpan;
+
+    // Pack the used slots together and sort them
+    pasuLabels = (SuLabelStats *)malloc((psuTable->uNumLabels + 1) * sizeof(SuLabelStats));
+    if (pasuLabels == NULL)
+        return;
+    uNumLabels = 0;
+    for (uHashIdx=0; uHashIdx<psuTable->uHashSize; uHashIdx++)
+        if (psuTable->pasuLabels[uHashIdx].ullMsgs != 0)
+            pasuLabels[uNumLabels++] = psuTable->pasuLabels[uHashIdx];
+    qsort(pasuLabels, uNumLabels, sizeof(SuLabelStats), iCompareLabelStats);
+
+    fprintf(psuOutFile,"\n=-=-= ARINC 429 Label Update Statistics =-=-=\n\n");
+    fprintf(psuOutFile,"Long gaps are over %g times the mean interval\n\n", psuTable->dGapMult);
+    fprintf(psuOutFile,"ChanID Bus Label SDI       Msgs    Rate/s   Min mSec  Mean mSec   Max mSec  Jitter mSec SSMChg LongGaps  Longest Gap After    Name\n");
+    fprintf(psuOutFile,"------ --- ----- --- ---------- --------- ---------- ---------- ---------- ------------ ------ -------- ---------------------- ----\n");
+
+    for (uLabelIdx=0; uLabelIdx<uNumLabels; uLabelIdx++)
+        {
+        psuLabel = &pasuLabels[uLabelIdx];
+        fprintf(psuOutFile,"%6u %3u  %3.3o   %1u %10llu", psuLabel->uChID, psuLabel->uBus,
+            m_aArincLabelMap[psuLabel->uLabelField], psuLabel->uSDI, (unsigned long long)psuLabel->ullMsgs);
+
+        // Times are in 100 nSec counts
+        if (psuLabel->ullMsgs > 1)
+            {
+            dSpan = (double)(psuLabel->llLastTime - psuLabel->llFirstTime) / 10000.0;
+            fprintf(psuOutFile," %9.2f %10.3f %10.3f %10.3f %12.3f", 
+                dSpan > 0.0 ? (psuLabel->ullMsgs - 1) * 1000.0 / dSpan : 0.0,
+                psuLabel->llMinGap / 10000.0, psuLabel->dMeanGap / 10000.0, psuLabel->llMaxGap / 10000.0,
+                sqrt(psuLabel->dGapM2 / (psuLabel->ullMsgs - 1)) / 10000.0);
+            enTimeMap_RelInt2IrigTime(&m_suTimeMap, m_iI106Handle, psuLabel->llMaxGapTime, &suTime);
+            fprintf(psuOutFile," %6lu %8lu %s", (unsigned long)psuLabel->ulSSMChanges, 
+                (unsigned long)psuLabel->ulLongGaps, IrigTime2String(&suTime));
+            }
+        else
+            fprintf(psuOutFile," %9s %10s %10s %10s %12s %6s %8s %s", "-", "-", "-", "-", "-", "-", "-", "-");
+
+        // Name from the dictionary if there is one
+        psuParam = psuA429Dict_Find(psuDict, psuLabel->uBus, psuLabel->uLabelField, psuLabel->uSDI);
+        if (psuParam != NULL)
+            fprintf(psuOutFile," %s", psuParam->szName);
+        fprintf(psuOutFile,"\n");
+        } // end for all labels
+
+    free(pasuLabels);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Sort by channel, bus, label, then SDI
+
+int iCompareLabelStats(const void * pvStats1, const void * pvStats2)
+    {
+    const SuLabelStats    * psuStats1 = (const SuLabelStats *)pvStats1;
+    const SuLabelStats    * psuStats2 = (const SuLabelStats *)pvStats2;
+
+    if (psuStats1->uChID != psuStats2->uChID)
+        return psuStats1->uChID < psuStats2->uChID ? -1 : 1;
+    if (psuStats1->uBus  != psuStats2->uBus)
+        return psuStats1->uBus  < psuStats2->uBus  ? -1 : 1;
+    if (m_aArincLabelMap[psuStats1->uLabelField] != m_aArincLabelMap[psuStats2->uLabelField])
+        return m_aArincLabelMap[psuStats1->uLabelField] < m_aArincLabelMap[psuStats2->uLabelField] ? -1 : 1;
+    if (psuStats1->uSDI  != psuStats2->uSDI)
+        return psuStats1->uSDI  < psuStats2->uSDI  ? -1 : 1;
+    return 0;
     }
 
 
@@ -514,11 +1129,23 @@ void vUsage(void)
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("   -b BusNum  429 Bus Number (default all)   \n");
-    printf("                                             \n");
+    printf("   -l Labels  Labels to print, comma separated, \n");
+    printf("              [[Chan/]Bus/]Label[:SDI] with the  \n");
+    printf("              label in octal (default all)   \n");
+    printf("   -d File    Label dictionary, print labels in  \n");
+    printf("              it in engineering units        \n");
+    printf("   -a Mult    Print label update statistics, \n");
+    printf("              counting gaps over Mult times  \n");
+    printf("              the mean interval              \n");
+    printf("   -M         Time from a map of all time packets, \n");
+    printf("              read or made beside the data file \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("The output data fields are:                  \n");
     printf("Time  ChanID  BusNum  Label  SDI  Data  SSM  \n");
+    printf("With -d they are:                            \n");
+    printf("Time  ChanID  BusNum  Label  SDI  SSM  Name  Value  Units\n");
     }
 
 
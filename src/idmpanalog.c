@@ -56,6 +56,10 @@
 #include "i106_decode_tmats.h"
 #include "i106_decode_analogf1.h"
 
+#include "tmats_attr.h"
+#include "pkt_filter.h"
+#include "time_map.h"
+
 
 #ifdef __cplusplus
 namespace Irig106 {
@@ -68,7 +72,7 @@ extern "C" {
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "03"
 
 #if defined(__GNUC__)
 #define _MAX_PATH    4096
@@ -94,6 +98,7 @@ extern "C" {
  */
 
 int           m_iI106Handle;
+SuTimeMap     m_suTimeMap;          // Empty unless -M
 
 // Per channel statistics
 typedef struct              _SuChanInfo         // Channel info
@@ -110,8 +115,9 @@ typedef struct              _SuChanInfo         // Channel info
  * -------------------
  */
 
-void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
-EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo);
+void vPrintTmats(SuTmatsAttrs * psuTmatsAttrs, FILE * psuOutFile);
+EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuTmatsAttrs * psuTmatsAttrs, 
+                                         SuChanInfo * apsuChanInfo[], int MaxSuChanInfo, unsigned int uChannel);
 EnI106Status PrintChanAttributes_ANALOGF1(SuChanInfo * psuChanInfo, FILE * psuOutFile);
 void vUsage(void);
 
@@ -129,6 +135,9 @@ int main(int argc, char ** argv)
     unsigned int            uChannel;          // Channel number
     int                     bVerbose;
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    int                     bUseTimeMap;
+    SuPktFilter             suPktFilter;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -137,6 +146,7 @@ int main(int argc, char ** argv)
     unsigned char         * pvBuff  = NULL;
     SuIrig106Time           suTime;
     SuTmatsInfo             suTmatsInfo;
+    SuTmatsAttrs            suTmatsAttrs;
 
     // Channel Info array
     #define MAX_SUCHANINFO  0x10000             // 64kb, ... a rather great pointer table for the channel infos 
@@ -156,11 +166,15 @@ int main(int argc, char ** argv)
     uChannel         = -1;
     bVerbose         = bFALSE;            /* No verbosity                      */
     bPrintTMATS      = bFALSE;
+    bBlockRead       = bFALSE;
+    bUseTimeMap      = bFALSE;
+    vTimeMap_Init(&m_suTimeMap);
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                // Default is stdout
 
     memset(&suTmatsInfo, 0, sizeof(suTmatsInfo) );
+    vTmatsAttr_Init(&suTmatsAttrs);
     memset(apsuChanInfo, 0, sizeof(apsuChanInfo));
 
     for (iArgIdx=1; iArgIdx<argc; iArgIdx++) 
@@ -189,6 +203,15 @@ int main(int argc, char ** argv)
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case 'M' :                   /* Time map */
+                        bUseTimeMap = bTRUE;
+                        break;
+
+                    case '-' :                   /* Long flags */
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -245,6 +268,17 @@ int main(int argc, char ** argv)
         return 1;
     }
 
+    // Time from a map of all the time packets instead of the last one seen
+    if (bUseTimeMap)
+    {
+        enStatus = enTimeMap_Get(&m_suTimeMap, m_iI106Handle, szInFile, TIME_MAP_ANY_CHAN);
+        if (enStatus != I106_OK)
+        {
+            fprintf(stderr, "Error making time map : Status = %d\n", enStatus);
+            return 1;
+        }
+    }
+
 
 /*
  * Open the output file
@@ -273,8 +307,13 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -284,13 +323,12 @@ int main(int argc, char ** argv)
         pvBuff = (unsigned char *)malloc(suI106Hdr.ulPacketLen);
 
         // Read the data buffer and check for read errors
-        enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+        enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
         if (enStatus != I106_OK)
             return 1;
 
-        // Process the TMATS info
-        memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-        enStatus = enI106_Decode_Tmats(&suI106Hdr, pvBuff, &suTmatsInfo);
+        // Split TMATS into attributes for quick channel lookups
+        enStatus = enTmatsAttr_ParsePacket(&suTmatsAttrs, &suI106Hdr, pvBuff);
         if (enStatus != I106_OK) 
         {
             fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
@@ -306,6 +344,8 @@ int main(int argc, char ** argv)
         return 1;
     }
 
+    // The analog attributes need the full TMATS decode
+    memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
     enStatus = enI106_Decode_Tmats(&suI106Hdr, pvBuff, &suTmatsInfo);
     if (enStatus != I106_OK) 
     {
@@ -313,7 +353,7 @@ int main(int argc, char ** argv)
         return 1;
     }
 
-    enStatus = AssembleAttributesFromTMATS(psuOutFile, &suTmatsInfo, apsuChanInfo, MAX_SUCHANINFO);
+    enStatus = AssembleAttributesFromTMATS(psuOutFile, &suTmatsInfo, &suTmatsAttrs, apsuChanInfo, MAX_SUCHANINFO, uChannel);
     if (enStatus != I106_OK) 
         {
         fprintf(stderr, " Error assembling Analog attributes from TMATS record : Status = %d\n", enStatus);
@@ -331,7 +371,7 @@ int main(int argc, char ** argv)
 	    iChanIdx++;
         } while ( iChanIdx < 256 ); //
 	
-	vPrintTmats(&suTmatsInfo, psuOutFile);
+	vPrintTmats(&suTmatsAttrs, psuOutFile);
 
         return(0);
 
@@ -350,7 +390,7 @@ int main(int argc, char ** argv)
         printf("nMessages is %i\n", nMessages);
       
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one-time loop to make it easy to break out on error
         do
@@ -362,8 +402,9 @@ int main(int argc, char ** argv)
             if (enStatus != I106_OK)
                 break;
 
-            // If IRIG time message then process it
-            if (suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME)
+            // If IRIG time message then process it. A time map already has
+            // every time packet.
+            if ((suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME) && !bUseTimeMap)
             {
                 // Make sure our buffer is big enough
                 if (ulBuffSize < suI106Hdr.ulPacketLen)
@@ -373,7 +414,7 @@ int main(int argc, char ** argv)
                 }
 
                 // Read the data buffer and decode time
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
                 enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
                 enI106_SetRelTime(m_iI106Handle, &suTime, suI106Hdr.aubyRefTime);
 	    }
@@ -396,7 +437,7 @@ int main(int argc, char ** argv)
 		}
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -409,6 +450,10 @@ int main(int argc, char ** argv)
  
                 assert(suAnalogF1Msg.psuAttributes != NULL);
 
+                // Packet time from the map
+                if (bUseTimeMap)
+                    enTimeMap_Rel2IrigTime(&m_suTimeMap, m_iI106Handle, suI106Hdr.aubyRefTime, &suTime);
+
                 // Step through all ANALOGF1 messages
 		
 		if( apsuChanInfo[suI106Hdr.uChID]->bFirst )
@@ -457,7 +502,10 @@ int main(int argc, char ** argv)
  *  Close files
  */
 
+    vTmatsAttr_Free(&suTmatsAttrs);
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&suPktFilter);
+    vTimeMap_Free(&m_suTimeMap);
     fclose(psuOutFile);
 
     return 0;
@@ -467,14 +515,11 @@ int main(int argc, char ** argv)
 
 /* ------------------------------------------------------------------------ */
 /* Note: Most of the code below is from Irig106.org / Bob Baggerman */
-void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
+void vPrintTmats(SuTmatsAttrs * psuTmatsAttrs, FILE * psuOutFile)
 {
-    int                     iGIndex;
-    int                     iRIndex;
-    int                     iRDsiIndex;
-    SuGDataSource         * psuGDataSource;
-    SuRRecord             * psuRRecord;
-    SuRDataSource         * psuRDataSource;
+    uint32_t                uChanIdx;
+    SuTmatsAttrChan       * psuChan;
+    const char            * szProgramName;
 
     // Print out the TMATS info
     // ------------------------
@@ -482,46 +527,23 @@ void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
     fprintf(psuOutFile,"\n=-=-= ANALOGF1 Channel Summary =-=-=\n\n");
 
     // G record
-    fprintf(psuOutFile,"Program Name - %s\n",psuTmatsInfo->psuFirstGRecord->szProgramName);
+    szProgramName = szTmatsAttr_Get(psuTmatsAttrs, "G\\PN");
+    fprintf(psuOutFile,"Program Name - %s\n", szProgramName != NULL ? szProgramName : "");
     fprintf(psuOutFile,"\n");
     fprintf(psuOutFile,"Channel  Data Source         \n");
     fprintf(psuOutFile,"-------  --------------------\n");
 
-    // Data sources
-    psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource;
-    do  {
-        if (psuGDataSource == NULL) break;
-
-        // G record data source info
-        iGIndex = psuGDataSource->iDataSourceNum;
-
-        // R record info
-        psuRRecord = psuGDataSource->psuRRecord;
-        do  {
-            if (psuRRecord == NULL) break;
-            iRIndex = psuRRecord->iRecordNum;
-
-            // R record data sources
-            psuRDataSource = psuRRecord->psuFirstDataSource;
-            do  {
-                if (psuRDataSource == NULL) 
-                    break;
-                if (strcasecmp(psuRDataSource->szChannelDataType,"ANAIN") == 0)
-                    {
-                    iRDsiIndex = psuRDataSource->iDataSourceNum;
-                    fprintf(psuOutFile," %5i ",   psuRDataSource->iTrackNumber);
-                    fprintf(psuOutFile,"  %-20s", psuRDataSource->szDataSourceID);
-                    fprintf(psuOutFile,"\n");
-                    }
-                psuRDataSource = psuRDataSource->psuNextRDataSource;
-                } while (bTRUE);
-
-            psuRRecord = psuRRecord->psuNextRRecord;
-            } while (bTRUE);
-
-
-        psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource->psuNextGDataSource;
-        } while (bTRUE);
+    // R record data sources
+    for (uChanIdx=0; uChanIdx<psuTmatsAttrs->uNumChans; uChanIdx++)
+        {
+        psuChan = &psuTmatsAttrs->pasuChans[uChanIdx];
+        if ((psuChan->szChanType != NULL) && (strcasecmp(psuChan->szChanType,"ANAIN") == 0))
+            {
+            fprintf(psuOutFile," %5u ",   psuChan->uChanID);
+            fprintf(psuOutFile,"  %-20s", psuChan->szDataSourceID != NULL ? psuChan->szDataSourceID : "");
+            fprintf(psuOutFile,"\n");
+            }
+        } // end for all recorder channels
 
     return;
 }
@@ -557,7 +579,8 @@ void FreeChanInfoTable(SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
 
 /* ------------------------------------------------------------------------ */
 
-EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
+EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuTmatsAttrs * psuTmatsAttrs, 
+                                         SuChanInfo * apsuChanInfo[], int MaxSuChanInfo, unsigned int uChannel)
 {
     static char                   * szModuleText = "Assemble Attributes From TMATS";
     char                          szText[_MAX_PATH + _MAX_PATH];
@@ -567,6 +590,7 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
     SuRRecord                     * psuRRecord;
     SuRDataSource                 * psuRDataSrc;
     int                           iTrackNumber; 
+    SuTmatsAttrChan               * psuAttrChan;
     EnI106Status                  enStatus;
 
     memset(szText, 0, SizeOfText--); // init and set the size to one less
@@ -585,7 +609,7 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
 
         // Get the first data source for this R record
         psuRDataSrc = psuRRecord->psuFirstDataSource;
-        while (psuRDataSrc != NULL)
+        for ( ; psuRDataSrc != NULL; psuRDataSrc = psuRDataSrc->psuNextRDataSource)
             {
             if(psuRDataSrc->szTrackNumber == NULL)
                 continue;
@@ -595,6 +619,15 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
             if(iTrackNumber >= MaxSuChanInfo)
                 return(I106_BUFFER_TOO_SMALL);
 
+            // Only set up the selected channel, and only analog channels. The
+            // attribute store answers this without touching the other records.
+            if ((uChannel != (unsigned int)-1) && (uChannel != (unsigned int)iTrackNumber))
+                continue;
+            psuAttrChan = psuTmatsAttr_FindChan(psuTmatsAttrs, iTrackNumber);
+            if ((psuAttrChan == NULL) || (psuAttrChan->szChanType == NULL) || 
+                (strcasecmp(psuAttrChan->szChanType,"ANAIN") != 0))
+                continue;
+
             // Make sure a message count structure exists
             if (apsuChanInfo[iTrackNumber] == NULL)
                 {
@@ -612,25 +645,19 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
                 apsuChanInfo[iTrackNumber]->psuRDataSrc = psuRDataSrc;
 		apsuChanInfo[iTrackNumber]->bFirst = bTRUE;
 
-                if (strcasecmp(psuRDataSrc->szChannelDataType,"ANAIN") == 0)
+                // Create the correspondent attributes structure
+                if((apsuChanInfo[iTrackNumber]->psuAttributes = calloc(1, sizeof(SuAnalogF1_Attributes))) == NULL)
                     {
-                    // Create the correspondent attributes structure
-                    if((apsuChanInfo[iTrackNumber]->psuAttributes = calloc(1, sizeof(SuAnalogF1_Attributes))) == NULL)
-                        {
-                        _snprintf(&szText[TextLen], SizeOfText - TextLen, "%s: %s\n", szModuleText, szI106ErrorStr(I106_BUFFER_TOO_SMALL));
-                        fprintf(psuOutFile, szText);
-                        FreeChanInfoTable(apsuChanInfo, MaxSuChanInfo);
-                        return(I106_BUFFER_TOO_SMALL);
-                        }
-                    // Fill the attributes, don't check the return status I106_INVALID_PARAMETER
-                    enStatus = Set_Attributes_AnalogF1(psuRDataSrc, (SuAnalogF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes);
-
+                    _snprintf(&szText[TextLen], SizeOfText - TextLen, "%s: %s\n", szModuleText, szI106ErrorStr(I106_BUFFER_TOO_SMALL));
+                    fprintf(psuOutFile, szText);
+                    FreeChanInfoTable(apsuChanInfo, MaxSuChanInfo);
+                    return(I106_BUFFER_TOO_SMALL);
                     }
+                // Fill the attributes, don't check the return status I106_INVALID_PARAMETER
+                enStatus = Set_Attributes_AnalogF1(psuRDataSrc, (SuAnalogF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes);
                 }
 
-            // Get the next R record data source
-            psuRDataSrc = psuRDataSrc->psuNextRDataSource;
-            } // end while walking R data source linked list
+            } // end for walking R data source linked list
 
         // Get the next R record
         psuRRecord = psuRRecord->psuNextRRecord;
@@ -667,6 +694,9 @@ void vUsage(void)
     printf("   <filename> Input/output file names        \n");
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
+    printf("   -M         Time from a map of all time packets, \n");
+    printf("              read or made beside the data file \n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("The output data fields are:                  \n");
@@ -52,6 +52,8 @@
 #include "i106_decode_ethernet.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -59,7 +61,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "01"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -115,6 +117,8 @@ int main(int argc, char ** argv)
     int                     bVerbose;
 //    int                     bDecimal;           // Hex/decimal flag
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    SuPktFilter             suPktFilter;
     unsigned long           ulBuffSize = 0L;
 
 //    int                     iStatus;
@@ -141,6 +145,7 @@ int main(int argc, char ** argv)
     bVerbose     = bFALSE;            /* No verbosity                      */
 //    bDecimal     = bFALSE;
     bPrintTMATS  = bFALSE;
+    bBlockRead   = bFALSE;
     m_bDumpHex   = bFALSE;
     m_bDumpInt   = bFALSE;
 
@@ -183,6 +188,11 @@ int main(int argc, char ** argv)
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   /* Long flags */
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -267,8 +277,13 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -281,7 +296,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -317,7 +332,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -340,7 +355,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer and decode time
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
                 enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
                 enI106_SetRelTime(m_iI106Handle, &suTime, suI106Hdr.aubyRefTime);
                 }
@@ -358,7 +373,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -414,6 +429,7 @@ int main(int argc, char ** argv)
  */
 
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&suPktFilter);
     fclose(m_psuOutFile);
 
     return 0;
@@ -561,6 +577,7 @@ void vUsage(void)
     printf("   -x         Dump data as hexi-decimal integers \n");
     printf("   -i         Dump data as decimal integers      \n");
     printf("   -V VNum    Dump VNum virtual channels only    \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit       \n");
     printf("                                                 \n");
     printf("The output data fields are:                      \n");
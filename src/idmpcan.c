@@ -54,6 +54,9 @@
 #include "i106_decode_can.h"
 #include "i106_decode_tmats.h"
 
+#include "can_dbc.h"
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -61,19 +64,47 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "04"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define CAN_ID_EXTENDED     0x80000000  // Flag on an extended (29 bit) CAN ID
+#define CAN_STATS_INITIAL   1024        // Hash slots to start, a power of two
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Statistics for one CAN ID on one subchannel. Times are relative time
+// counts.
+typedef struct
+    {
+    uint16_t                uChID;
+    uint16_t                uSubChannel;
+    uint32_t                uCanID;         // With CAN_ID_EXTENDED for 29 bit IDs
+    uint64_t                ullMsgs;        // 0 for an empty hash slot
+    uint64_t                ullBytes;
+    int64_t                 llFirstTime;
+    int64_t                 llLastTime;
+    int64_t                 llMinGap;       // Time between messages
+    int64_t                 llMaxGap;
+    uint32_t                ulFormatErrors;
+    uint32_t                ulDataErrors;
+    } SuCanIdStats;
+
+// Open addressed hash table of CAN ID statistics
+typedef struct
+    {
+    uint32_t                uNumIds;
+    uint32_t                uHashSize;      // Always a power of two
+    SuCanIdStats          * pasuIds;
+    } SuCanStats;
+
 
 /*
  * Module data
@@ -92,6 +123,10 @@ int           m_iI106Handle;
  */
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
+SuCanIdStats * psuFindCanStats(SuCanStats * psuStats, unsigned int uChID, unsigned int uSubChannel, uint32_t uCanID);
+void vAddCanStats(SuCanStats * psuStats, unsigned int uChID, SuCan_CurrMsg * psuCanMsg);
+void vPrintCanStats(SuCanStats * psuStats, FILE * psuOutFile);
+int iCompareCanStats(const void * pvStats1, const void * pvStats2);
 void vUsage(void);
 
 
@@ -112,7 +147,18 @@ int main(int argc, char ** argv)
     unsigned                uWordIdx;
 
     int                     bPrintTMATS;
+    int                     bBlockRead;
     int                     bPrintRTC;
+    int                     bStatistics;
+    char                    szDbcFile[256];     // DBC file name
+    const char           ** aszSignals;         // Signal names to pull out
+    unsigned int            uNumSignals;
+    char                  * szSignal;
+    unsigned int            uColumn;
+    char                  * pchRowText = NULL;
+    SuCanDbc                suCanDbc;
+    SuCanDbcPlan          * psuPlan;
+    uint32_t                uCanID;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -121,6 +167,8 @@ int main(int argc, char ** argv)
     unsigned char         * pvBuff  = NULL;
     SuCan_CurrMsg           suCanMsg;
     SuTmatsInfo             suTmatsInfo;
+    SuPktFilter             suPktFilter;
+    SuCanStats              suCanStats;
 
 
 /*
@@ -137,7 +185,16 @@ int main(int argc, char ** argv)
 
     bVerbose        = bFALSE;            // No verbosity
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
     bPrintRTC       = bFALSE;
+    bStatistics     = bFALSE;
+
+    memset(&suCanStats, 0, sizeof(suCanStats));
+
+    szDbcFile[0]     = '\0';             // Dump all messages as hex
+    aszSignals       = NULL;
+    uNumSignals      = 0;
+    vCanDbc_Init(&suCanDbc);
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -167,6 +224,39 @@ int main(int argc, char ** argv)
                         bPrintRTC = bTRUE;
                         break;
 
+                    case 's' :                   // Statistics instead of messages
+                        bStatistics = bTRUE;
+                        break;
+
+                    case 'd' :                   // DBC file to decode signals
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        strcpy(szDbcFile, argv[iArgIdx]);
+                        break;
+
+                    case 'n' :                   // Signals to pull out
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        for (szSignal = strtok(argv[iArgIdx], ","); szSignal != NULL; szSignal = strtok(NULL, ","))
+                            {
+                            aszSignals = (const char **)realloc((void *)aszSignals, (uNumSignals + 1) * sizeof(char *));
+                            aszSignals[uNumSignals++] = szSignal;
+                            }
+                        break;
+
+                    case '-' :                   // Long flags
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } // end flag switch
@@ -186,6 +276,18 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    if ((uNumSignals != 0) && (szDbcFile[0] == '\0'))
+        {
+        fprintf(stderr, "Signal names need a DBC file\n");
+        return 1;
+        }
+
+    if (bStatistics && (szDbcFile[0] != '\0'))
+        {
+        fprintf(stderr, "Use -s or -d, not both\n");
+        return 1;
+        }
+
 //  uDecCnt = uDecimation;
 
 /*
@@ -196,6 +298,38 @@ int main(int argc, char ** argv)
     fprintf(stderr, "\nIDMPCAN "MAJOR_VERSION"."MINOR_VERSION"\n");
     fprintf(stderr, "Freeware Copyright (C) 2014 Irig106.org\n\n");
 
+/*
+ * Load the DBC file and make the signal extraction plans
+ */
+
+    if (szDbcFile[0] != '\0')
+        {
+        enStatus = enCanDbc_Load(&suCanDbc, szDbcFile);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error reading DBC file : Status = %d\n", enStatus);
+            return 1;
+            }
+
+        enStatus = enCanDbc_Compile(&suCanDbc, aszSignals, uNumSignals);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error making signal plans : Status = %d\n", enStatus);
+            return 1;
+            }
+
+        for (uColumn=0; uColumn<suCanDbc.uNumColumns; uColumn++)
+            if (suCanDbc.paiColumnSignal[uColumn] < 0)
+                fprintf(stderr, "Signal %s not found in DBC file\n", aszSignals[uColumn]);
+
+        pchRowText = (char *)malloc(ulCanDbc_RowLen(&suCanDbc));
+        if (pchRowText == NULL)
+            {
+            fprintf(stderr, "Error allocating signal buffer\n");
+            return 1;
+            }
+        }
+
 /*
  *  Open file and allocate a buffer for reading data.
  */
@@ -245,12 +379,35 @@ int main(int argc, char ** argv)
         }
 
 
+    // Column header for decoded signals
+    if (pchRowText != NULL)
+        {
+        fprintf(psuOutFile, "Time,Channel,Subchannel");
+        for (uColumn=0; uColumn<suCanDbc.uNumColumns; uColumn++)
+            {
+            if (uNumSignals != 0)
+                fprintf(psuOutFile, ",%s", aszSignals[uColumn]);
+            else
+                fprintf(psuOutFile, ",%s.%s", 
+                    suCanDbc.pasuMessages[suCanDbc.pasuSignals[uColumn].uMessage].szName, 
+                    suCanDbc.pasuSignals[uColumn].szName);
+            }
+        fprintf(psuOutFile, "\n");
+        }
+
 /*
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Only CAN packets are read, the rest are skipped over in big blocks.
+    // With --block-read the blocks are 8 MB instead of 1 MB.
+    vPktFilter_Init(&suPktFilter);
+    enPktFilter_Add(&suPktFilter, iChannel, I106CH10_DTYPE_CAN);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -263,7 +420,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -299,7 +456,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -326,7 +483,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -341,6 +498,38 @@ int main(int argc, char ** argv)
                 while (enStatus == I106_OK)
                     {
 
+                    // Just count it
+                    if (bStatistics)
+                        {
+                        vAddCanStats(&suCanStats, suI106Hdr.uChID, &suCanMsg);
+                        enStatus = enI106_Decode_NextCan(&suCanMsg);
+                        continue;
+                        }
+
+                    // Decode signals from frames that have any requested
+                    if (pchRowText != NULL)
+                        {
+                        uCanID = suCanMsg.psuCanIdWord->uID;
+                        if (suCanMsg.psuCanIdWord->bIDE)
+                            uCanID |= CAN_DBC_ID_EXTENDED;
+                        psuPlan = psuCanDbc_FindPlan(&suCanDbc, uCanID);
+                        if ((psuPlan != NULL) && (suCanMsg.psuCanHdr->bFormatError == 0))
+                            {
+                            if (bPrintRTC == bFALSE)
+                                {
+                                enI106_RelInt2IrigTime(m_iI106Handle, suCanMsg.suTimeRef.uRelTime, &suCanMsg.suTimeRef.suIrigTime);
+                                fprintf(psuOutFile,"%s", IrigTime2String(&suCanMsg.suTimeRef.suIrigTime));
+                                }
+                            else
+                                fprintf(psuOutFile,"%lld", (long long)suCanMsg.suTimeRef.uRelTime);
+                            fprintf(psuOutFile,",%d,%d", suI106Hdr.uChID, suCanMsg.psuCanHdr->uSubChannel);
+                            pchCanDbc_Row(&suCanDbc, psuPlan, suCanMsg.pauData, suCanMsg.psuCanHdr->uMsgLength, pchRowText);
+                            fputs(pchRowText, psuOutFile);
+                            }
+                        enStatus = enI106_Decode_NextCan(&suCanMsg);
+                        continue;
+                        }
+
                     if (bPrintRTC == bFALSE)
                         {
                         enI106_RelInt2IrigTime(m_iI106Handle, suCanMsg.suTimeRef.uRelTime, &suCanMsg.suTimeRef.suIrigTime);
@@ -385,6 +574,13 @@ int main(int argc, char ** argv)
 /*
  * Print out some summaries
  */
+    if (bStatistics)
+        vPrintCanStats(&suCanStats, psuOutFile);
+    free(suCanStats.pasuIds);
+    free(pchRowText);
+    free((void *)aszSignals);
+    vCanDbc_Free(&suCanDbc);
+
     printf("\nTotal Message %lu\n", lMsgs);
 
 /*
@@ -393,6 +589,7 @@ int main(int argc, char ** argv)
 
     enI106Ch10Close(m_iI106Handle);
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
 
     return 0;
     }
@@ -459,6 +656,220 @@ void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
     }
 
 
+/* ------------------------------------------------------------------------ */
+
+// Find the statistics for a CAN ID, adding it if it isn't there yet.
+// Returns NULL if out of memory.
+
+SuCanIdStats * psuFindCanStats(SuCanStats * psuStats, unsigned int uChID, unsigned int uSubChannel, uint32_t uCanID)
+    {
+    SuCanIdStats          * pasuOldIds;
+    SuCanIdStats          * psuId;
+    uint32_t                uOldSize;
+    uint32_t                uHashIdx;
+    uint32_t                uOldIdx;
+
+    // Grow the table when it gets half full
+    if ((psuStats->uNumIds + 1) * 2 > psuStats->uHashSize)
+        {
+        pasuOldIds = psuStats->pasuIds;
+        uOldSize   = psuStats->uHashSize;
+        psuStats->uHashSize = (uOldSize == 0) ? CAN_STATS_INITIAL : uOldSize * 2;
+        psuStats->pasuIds   = (SuCanIdStats *)calloc(psuStats->uHashSize, sizeof(SuCanIdStats));
+        if (psuStats->pasuIds == NULL)
+            {
+            psuStats->pasuIds   = pasuOldIds;
+            psuStats->uHashSize = uOldSize;
+            return NULL;
+            }
+        for (uOldIdx=0; uOldIdx<uOldSize; uOldIdx++)
+            {
+            if (pasuOldIds[uOldIdx].ullMsgs == 0)
+                continue;
+            uHashIdx = ((pasuOldIds[uOldIdx].uCanID * 2654435761u) ^ 
+                        (pasuOldIds[uOldIdx].uChID << 16) ^ pasuOldIds[uOldIdx].uSubChannel) & (psuStats->uHashSize - 1);
+            while (psuStats->pasuIds[uHashIdx].ullMsgs != 0)
+                uHashIdx = (uHashIdx + 1) & (psuStats->uHashSize - 1);
+            psuStats->pasuIds[uHashIdx] = pasuOldIds[uOldIdx];
+            }
+        free(pasuOldIds);
+        }
+
+    uHashIdx = ((uCanID * 2654435761u) ^ (uChID << 16) ^ uSubChannel) & (psuStats->uHashSize - 1);
+    while (bTRUE)
+        {
+        psuId = &psuStats->pasuIds[uHashIdx];
+        if (psuId->ullMsgs == 0)
+            break;
+        if ((psuId->uCanID == uCanID) && (psuId->uChID == uChID) && (psuId->uSubChannel == uSubChannel))
+            return psuId;
+        uHashIdx = (uHashIdx + 1) & (psuStats->uHashSize - 1);
+        }
+
+    // New one, the caller counts the first message
+    psuId->uChID       = (uint16_t)uChID;
+    psuId->uSubChannel = (uint16_t)uSubChannel;
+    psuId->uCanID      = uCanID;
+    psuStats->uNumIds++;
+
+    return psuId;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Count one CAN message
+
+void vAddCanStats(SuCanStats * psuStats, unsigned int uChID, SuCan_CurrMsg * psuCanMsg)
+    {
+    SuCanIdStats          * psuId;
+    uint32_t                uCanID;
+    int64_t                 llGap;
+
+    uCanID = psuCanMsg->psuCanIdWord->uID;
+    if (psuCanMsg->psuCanIdWord->bIDE)
+        uCanID |= CAN_ID_EXTENDED;
+
+    psuId = psuFindCanStats(psuStats, uChID, psuCanMsg->psuCanHdr->uSubChannel, uCanID);
+    if (psuId == NULL)
+        return;
+
+    if (psuId->ullMsgs == 0)
+        {
+        psuId->llFirstTime = psuCanMsg->suTimeRef.uRelTime;
+        psuId->llMinGap    = -1;
+        }
+    else
+        {
+        llGap = psuCanMsg->suTimeRef.uRelTime - psuId->llLastTime;
+        if ((psuId->llMinGap < 0) || (llGap < psuId->llMinGap))
+            psuId->llMinGap = llGap;
+        if (llGap > psuId->llMaxGap)
+            psuId->llMaxGap = llGap;
+        }
+    psuId->llLastTime = psuCanMsg->suTimeRef.uRelTime;
+
+    psuId->ullMsgs++;
+    psuId->ullBytes       += psuCanMsg->psuCanHdr->uMsgLength;
+    psuId->ulFormatErrors += psuCanMsg->psuCanHdr->bFormatError;
+    psuId->ulDataErrors   += psuCanMsg->psuCanHdr->bDataError;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Print the statistics for each subchannel, busiest CAN IDs first
+
+void vPrintCanStats(SuCanStats * psuStats, FILE * psuOutFile)
+    {
+    SuCanIdStats          * pasuIds;
+    SuCanIdStats          * psuId;
+    SuCanIdStats          * psuSub;
+    uint32_t                uHashIdx;
+    uint32_t                uNumIds;
+    uint32_t                uIdIdx;
+    uint32_t                uSubIdx;
+    uint64_t                ullMsgs;
+    uint64_t                ullBytes;
+    uint32_t                ulFormatErrors;
+    uint32_t                ulDataErrors;
+    double                  dSpan;
+
+    // Pack the used slots together and sort them
+    pasuIds = (SuCanIdStats *)malloc((psuStats->uNumIds + 1) * sizeof(SuCanIdStats));
+    if (pasuIds == NULL)
+        return;
+    uNumIds = 0;
+    for (uHashIdx=0; uHashIdx<psuStats->uHashSize; uHashIdx++)
+        if (psuStats->pasuIds[uHashIdx].ullMsgs != 0)
+            pasuIds[uNumIds++] = psuStats->pasuIds[uHashIdx];
+    qsort(pasuIds, uNumIds, sizeof(SuCanIdStats), iCompareCanStats);
+
+    fprintf(psuOutFile,"\n=-=-= CAN Bus Statistics =-=-=\n");
+
+    for (uSubIdx=0; uSubIdx<uNumIds; uSubIdx=uIdIdx)
+        {
+        // Subchannel totals
+        psuSub         = &pasuIds[uSubIdx];
+        ullMsgs        = 0;
+        ullBytes       = 0;
+        ulFormatErrors = 0;
+        ulDataErrors   = 0;
+        for (uIdIdx=uSubIdx; uIdIdx<uNumIds; uIdIdx++)
+            {
+            psuId = &pasuIds[uIdIdx];
+            if ((psuId->uChID != psuSub->uChID) || (psuId->uSubChannel != psuSub->uSubChannel))
+                break;
+            ullMsgs        += psuId->ullMsgs;
+            ullBytes       += psuId->ullBytes;
+            ulFormatErrors += psuId->ulFormatErrors;
+            ulDataErrors   += psuId->ulDataErrors;
+            }
+
+        fprintf(psuOutFile,"\nChan%d-%d  %u IDs  %llu Msgs  %llu Bytes  %lu Format Errors  %lu Data Errors\n",
+            psuSub->uChID, psuSub->uSubChannel, uIdIdx - uSubIdx, 
+            (unsigned long long)ullMsgs, (unsigned long long)ullBytes, 
+            (unsigned long)ulFormatErrors, (unsigned long)ulDataErrors);
+        fprintf(psuOutFile,"   CAN ID        Msgs       Bytes   Msgs/Sec   Min mSec  Mean mSec   Max mSec  FmtErr DataErr\n");
+        fprintf(psuOutFile,"  --------  ----------  ----------  ---------  ---------  ---------  ---------  ------ -------\n");
+
+        // Each ID, times are in 100 nSec counts
+        for (uIdIdx=uSubIdx; uIdIdx<uNumIds; uIdIdx++)
+            {
+            psuId = &pasuIds[uIdIdx];
+            if ((psuId->uChID != psuSub->uChID) || (psuId->uSubChannel != psuSub->uSubChannel))
+                break;
+
+            if (psuId->uCanID & CAN_ID_EXTENDED)
+                fprintf(psuOutFile,"  %08X", psuId->uCanID & ~CAN_ID_EXTENDED);
+            else
+                fprintf(psuOutFile,"       %03X", psuId->uCanID);
+            fprintf(psuOutFile,"  %10llu  %10llu", (unsigned long long)psuId->ullMsgs, (unsigned long long)psuId->ullBytes);
+
+            dSpan = (double)(psuId->llLastTime - psuId->llFirstTime) / 10000.0;
+            if (psuId->ullMsgs > 1)
+                fprintf(psuOutFile,"  %9.2f  %9.3f  %9.3f  %9.3f", 
+                    dSpan > 0.0 ? (psuId->ullMsgs - 1) * 1000.0 / dSpan : 0.0,
+                    psuId->llMinGap / 10000.0, dSpan / (psuId->ullMsgs - 1), psuId->llMaxGap / 10000.0);
+            else
+                fprintf(psuOutFile,"  %9s  %9s  %9s  %9s", "-", "-", "-", "-");
+            fprintf(psuOutFile,"  %6lu %7lu\n", (unsigned long)psuId->ulFormatErrors, (unsigned long)psuId->ulDataErrors);
+            }
+        } // end for all subchannels
+
+    free(pasuIds);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Sort by channel, subchannel, then most messages first
+
+int iCompareCanStats(const void * pvStats1, const void * pvStats2)
+    {
+    const SuCanIdStats    * psuStats1 = (const SuCanIdStats *)pvStats1;
+    const SuCanIdStats    * psuStats2 = (const SuCanIdStats *)pvStats2;
+
+    if (psuStats1->uChID       != psuStats2->uChID)
+        return psuStats1->uChID       < psuStats2->uChID       ? -1 : 1;
+    if (psuStats1->uSubChannel != psuStats2->uSubChannel)
+        return psuStats1->uSubChannel < psuStats2->uSubChannel ? -1 : 1;
+    if (psuStats1->ullMsgs     != psuStats2->ullMsgs)
+        return psuStats1->ullMsgs     > psuStats2->ullMsgs     ? -1 : 1;
+    if (psuStats1->uCanID      != psuStats2->uCanID)
+        return psuStats1->uCanID      < psuStats2->uCanID      ? -1 : 1;
+    return 0;
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 void vUsage(void)
@@ -471,10 +882,18 @@ void vUsage(void)
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("   -R         Print Relative Time Counter    \n");
+    printf("   -s         Print bus statistics for each  \n");
+    printf("              CAN ID instead of messages     \n");
+    printf("   -d DbcFile Decode signals from a DBC file \n");
+    printf("   -n Names   Signals to decode, comma       \n");
+    printf("              separated (default all)        \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("The output data fields are:                  \n");
     printf("  Time Chan-Subchan Data...                  \n");
+    printf("With -d they are comma separated:            \n");
+    printf("  Time,Channel,Subchannel,Signal...          \n");
     printf("                                             \n");
     }
 
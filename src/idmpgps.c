@@ -53,6 +53,8 @@
 #include "i106_decode_uart.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -60,7 +62,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "01"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -225,6 +227,8 @@ int main(int argc, char ** argv)
     int                     iWordIdx;
 
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    SuPktFilter             suPktFilter;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -269,6 +273,7 @@ int main(int argc, char ** argv)
     bVerbose        = bFALSE;            // No verbosity
     bString         = bFALSE;
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
 
     m_bDumpGGA       = bFALSE;
     m_bDumpRMC       = bFALSE;
@@ -329,6 +334,11 @@ int main(int argc, char ** argv)
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   // Long flags
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } // end flag switch
@@ -424,8 +434,13 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -438,7 +453,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -513,7 +528,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -538,7 +553,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -658,6 +673,7 @@ int main(int argc, char ** argv)
  */
 
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&suPktFilter);
     fclose(psuOutFile);
 
     return 0;
@@ -1629,6 +1645,7 @@ void vUsage(void)
     printf("                      of ground target position. Can be used \n");
     printf("                      multiple times for multiple ground     \n");
     printf("                      targets.                               \n");
+    printf("   --block-read     Read the data file in 8 MB blocks\n");
     printf("   -T               Print TMATS summary and exit             \n");
     }
 
@@ -53,6 +53,8 @@
 #include "i106_decode_1553f1.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -60,7 +62,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "03"
+#define MINOR_VERSION  "04"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -250,6 +252,8 @@ int main (int argc, char *argv[])
     int                 bInRange;
     int                 bInRangePrev;
     int                 bPrintTMATS;
+    int                 bBlockRead;
+    SuPktFilter         suPktFilter;
     unsigned            uChannel;           // Channel number
     unsigned            uRTAddr;            // RT address of INS
     unsigned            uTR;                // Transmit bit
@@ -310,6 +314,7 @@ int main (int argc, char *argv[])
     uINSType    =  1;
     bVerbose    = bFALSE;               // No verbosity
     bPrintTMATS = bFALSE;
+    bBlockRead  = bFALSE;
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"con");            // Default is stdout
@@ -410,6 +415,11 @@ int main (int argc, char *argv[])
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   // Long flags
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } // end flag switch
@@ -489,8 +499,13 @@ int main (int argc, char *argv[])
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -504,7 +519,7 @@ int main (int argc, char *argv[])
             ulBuffSize = suI106Hdr.ulPacketLen;
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -619,7 +634,7 @@ int main (int argc, char *argv[])
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -644,7 +659,7 @@ int main (int argc, char *argv[])
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -897,6 +912,7 @@ int main (int argc, char *argv[])
  */
 
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
 
     return 0;
     }
@@ -988,6 +1004,7 @@ void vUsage(void)
     printf("   -m Dist          Only dump within this many nautical miles\n");
     printf("                      of ground target position              \n");
     printf("                                                             \n");
+    printf("   --block-read     Read the data file in 8 MB blocks\n");
     printf("   -T               Print TMATS summary and exit             \n");
     return;
     }
@@ -48,6 +48,16 @@
 #include <time.h>
 #include <assert.h>
 
+// Threaded decode uses pthreads. The Makefile packs structures so put the
+// system structures back to their natural alignment.
+#if defined(__linux__)
+#define THREADED_DECODE
+#pragma pack(push, 8)
+#include <pthread.h>
+#include <unistd.h>
+#pragma pack(pop)
+#endif
+
 #include "config.h"
 #include "i106_stdint.h"
 #include "irig106ch10.h"
@@ -57,6 +67,11 @@
 #include "i106_decode_tmats.h"
 #include "i106_decode_pcmf1.h"
 
+#include "tmats_attr.h"
+#include "pcm_decom.h"
+#include "time_map.h"
+#include "pkt_filter.h"
+
 
 #ifdef __cplusplus
 namespace Irig106 {
@@ -69,7 +84,7 @@ extern "C" {
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "01"
+#define MINOR_VERSION  "08"
 
 #if defined(__GNUC__)
 #define _MAX_PATH    4096
@@ -83,11 +98,111 @@ extern "C" {
 
 #define BOOL int
 
+// Count the one bits in a word
+#if defined(__GNUC__)
+#define POPCOUNT64(ull)     __builtin_popcountll(ull)
+#else
+#define POPCOUNT64(ull)     iPopCount64(ull)
+#endif
+
+// Sync quality counters
+#define PCM_STAT_FRAMES     0           // Minor frames decoded
+#define PCM_STAT_PARITY     1           // Words with parity errors
+#define PCM_STAT_SYNCLOSS   2           // Decoder lost minor frame sync
+#define PCM_STAT_SFIDGAP    3           // Subframe ID counter out of sequence
+#define PCM_STAT_COUNT      4
+
+#if defined(THREADED_DECODE)
+#define MAX_THREADS     64
+#define JOB_SLOTS       256             // Packets in flight, must be a power of 2
+#endif
+
 /*
  * Data structures
  * ---------------
  */
 
+// Decoded minor frames from one PCM packet, formatted and ready to print
+// except for the time. Time is done when printing so that it always uses
+// the time reference in effect at that point in the file.
+typedef struct
+    {
+    uint32_t                uFrames;
+    uint32_t                uMaxFrames;
+    int64_t               * pallFrameTime;  // Relative time of each frame
+    uint32_t              * paulTextOffset; // Start of each frame's text, uFrames+1 entries
+    char                  * pchText;
+    uint32_t                ulTextSize;
+    int                     bColumns;       // Measurand or statistics columns instead of hex words
+    } SuPcmText;
+
+// Sync quality for one channel, counted for each time bucket and for the
+// whole file
+typedef struct
+    {
+    int64_t                 llBucketLen;    // Relative time ticks per bucket
+    int64_t                 llBucket;       // Current bucket number
+    int                     bStarted;       // Seen a frame
+    uint32_t                aulBucket[PCM_STAT_COUNT];
+    uint64_t                aullTotal[PCM_STAT_COUNT];
+    int32_t                 lSyncErrors;    // Decoder sync error count after the last frame
+    SuPcmFrameFormat        suFormat;       // Where the subframe ID counter is
+    int                     bHaveSfid;      // uSfid is from the last frame
+    uint32_t                uSfid;
+    } SuPcmStats;
+
+// Minor frame kernels for one channel, picked once from the TMATS word
+// length and parity type instead of being worked out again for every word
+typedef int    (* PFPcmPostProcess)(SuPcmF1_Attributes * psuAttributes);
+typedef char * (* PFPcmFormat)(SuPcmF1_Attributes * psuAttributes, char * pchText);
+
+typedef struct
+    {
+    PFPcmPostProcess        pfPostProcess;  // Parity check and word mask
+    PFPcmFormat             pfFormat;       // Hex text of one minor frame
+    int                     iPrintDigits;
+    SuPcmDecom            * psuDecom;       // Measurands to pull out, NULL to dump hex
+    SuPcmStats            * psuStats;       // Sync quality counters, NULL to dump hex
+    } SuPcmKernel;
+
+#if defined(THREADED_DECODE)
+
+// One packet in the job ring. Jobs are taken in file order and printed in
+// the same order when they are done.
+typedef enum
+    {
+    JOB_FREE    = 0,
+    JOB_QUEUED  = 1,                    // Waiting for a worker
+    JOB_DONE    = 2,                    // Ready to print
+    } EnJobState;
+
+typedef struct
+    {
+    uint32_t                uState;     // EnJobState, atomic
+    SuI106Ch10Header        suHdr;
+    unsigned char         * pabyData;
+    unsigned long           ulDataSize;
+    SuPcmF1_Attributes    * psuAttributes;
+    SuPcmKernel           * psuKernel;
+    SuPcmText               suText;
+    } SuPcmJob;
+
+// Each worker has its own queue of job numbers. A channel always goes to
+// the same worker because the decoder carries partial frames from one
+// packet to the next.
+typedef struct
+    {
+    SuPcmJob              * pasuJobs;
+    uint32_t                auQueue[JOB_SLOTS];
+    uint32_t                uHead;      // Written by the reader
+    uint32_t                uTail;      // Written by the worker
+    int                     bStop;
+    int                     bDontSwapRawData;
+    pthread_t               hThread;
+    } SuPcmWorker;
+
+#endif
+
 
 /*
  * Module data
@@ -95,6 +210,9 @@ extern "C" {
  */
 
 int           m_iI106Handle;
+SuPktFilter   m_suPktFilter;
+
+SuTimeMap     m_suTimeMap;          // Empty unless -M
 
 // Per channel statistics
 typedef struct              _SuChanInfo         // Channel info
@@ -103,6 +221,7 @@ typedef struct              _SuChanInfo         // Channel info
     BOOL                    bEnabled;           // Flag for channel enabled
     SuRDataSource           * psuRDataSrc;      // Pointer to the corresponding TMATS RRecord
     void                    * psuAttributes;    // Pointer to the corresponding Attributes (if present)
+    SuPcmKernel             suKernel;           // Frame kernels for these attributes
 } SuChanInfo;
 
 /*
@@ -110,9 +229,32 @@ typedef struct              _SuChanInfo         // Channel info
  * -------------------
  */
 
-void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
-EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo);
+void vPrintTmats(SuTmatsAttrs * psuTmatsAttrs, FILE * psuOutFile);
+EnI106Status enMakeDecomPlans(FILE * psuOutFile, SuTmatsAttrs * psuTmatsAttrs, SuChanInfo * apsuChanInfo[], 
+                              int MaxSuChanInfo, const char * const aszParams[], unsigned int uNumParams);
+void FreeChanInfoTable(SuChanInfo * apsuChanInfo[], int MaxSuChanInfo);
+void vFreeChanInfo(SuChanInfo * psuChanInfo);
+EnI106Status enMakePcmStats(FILE * psuOutFile, SuTmatsAttrs * psuTmatsAttrs, SuChanInfo * apsuChanInfo[], 
+                            int MaxSuChanInfo, double dBucketSecs);
+uint32_t ulPcmStatsFrame(SuPcmStats * psuStats, SuPcmF1_Attributes * psuAttributes, int64_t llTime, 
+                         int iParityErrors, SuPcmText * psuText, uint32_t ulTextLen);
+uint32_t ulPcmStatsRow(SuPcmStats * psuStats, SuPcmText * psuText, uint32_t ulTextLen);
+void vPrintPcmStats(FILE * psuOutFile, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo);
+EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuTmatsAttrs * psuTmatsAttrs, 
+                                         SuChanInfo * apsuChanInfo[], int MaxSuChanInfo, unsigned int uChannel);
 int PostProcessFrame_PcmF1(SuPcmF1_CurrMsg * psuCurrMsg);
+void vPickPcmKernel(SuPcmF1_Attributes * psuAttributes, SuPcmKernel * psuKernel);
+void vDecodePcmPacket(SuI106Ch10Header * psuHdr, void * pvBuff, SuPcmF1_Attributes * psuAttributes, 
+                      SuPcmKernel * psuKernel, int bDontSwapRawData, SuPcmText * psuText);
+char * pchAddPcmText(SuPcmText * psuText, uint32_t ulTextLen, uint32_t ulMaxLen, int64_t llTime);
+void vWritePcmText(unsigned int uChID, SuPcmText * psuText, FILE * psuOutFile);
+void vFreePcmText(SuPcmText * psuText);
+#if defined(THREADED_DECODE)
+void vDecodeThreaded(FILE * psuOutFile, SuChanInfo * apsuChanInfo[], unsigned int uChannel, 
+                     int bDontSwapRawData, int iThreads);
+void vFinishJob(SuPcmJob * psuJob, FILE * psuOutFile);
+void * pvWorkerThread(void * pvWorker);
+#endif
 void vUsage(void);
 
 
@@ -125,11 +267,17 @@ int main(int argc, char ** argv)
     char                    szOutFile[256];    // Output file name
     int                     iArgIdx;
     FILE                  * psuOutFile;        // Output file handle
-    char                  * szTime;
     unsigned int            uChannel;          // Channel number
     int                     bVerbose;
     int                     bPrintTMATS;
+    int                     bBlockRead;
     int                     bDontSwapRawData;
+    int                     iThreads;          // Decode threads, 0 for none
+    const char           ** aszParams;         // Measurand names to pull out
+    unsigned int            uNumParams;
+    char                  * szParam;
+    double                  dStatSecs;         // Sync quality bucket length, 0 for none
+    int                     bUseTimeMap;
     unsigned long           ulBuffSize = 0L;
 
     EnI106Status            enStatus;
@@ -138,6 +286,8 @@ int main(int argc, char ** argv)
     unsigned char         * pvBuff  = NULL;
     SuIrig106Time           suTime;
     SuTmatsInfo             suTmatsInfo;
+    SuPcmText               suPcmText;
+    SuTmatsAttrs            suTmatsAttrs;
 
     // Channel Info array
     #define MAX_SUCHANINFO  0x10000             // 64kb, ... a rather great pointer table for the channel infos 
@@ -157,12 +307,21 @@ int main(int argc, char ** argv)
     uChannel         = -1;
     bVerbose         = bFALSE;            /* No verbosity                      */
     bPrintTMATS      = bFALSE;
+    bBlockRead       = bFALSE;
     bDontSwapRawData = bFALSE;            /* don't swap the raw input data           */
+    iThreads         = 0;                 /* Decode in this thread             */
+    aszParams        = NULL;              /* Dump all words as hex             */
+    uNumParams       = 0;
+    dStatSecs        = 0.0;               /* No sync quality timeline          */
+    bUseTimeMap      = bFALSE;            /* Time from the last time packet    */
+    vTimeMap_Init(&m_suTimeMap);
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                // Default is stdout
 
     memset(&suTmatsInfo, 0, sizeof(suTmatsInfo) );
+    vTmatsAttr_Init(&suTmatsAttrs);
+    memset(&suPcmText, 0, sizeof(suPcmText));
     memset(apsuChanInfo, 0, sizeof(apsuChanInfo));
 
     for (iArgIdx=1; iArgIdx<argc; iArgIdx++) 
@@ -191,11 +350,69 @@ int main(int argc, char ** argv)
                         bDontSwapRawData = 1;
                         break;
 
+                    case 'j' :                   /* Decode threads */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        sscanf(argv[iArgIdx],"%d",&iThreads);
+#if defined(THREADED_DECODE)
+                        if ((iThreads < 0) || (iThreads > MAX_THREADS))
+                            {
+                            fprintf(stderr, "Decode threads must be 0 to %d\n", MAX_THREADS);
+                            return 1;
+                            }
+#else
+                        fprintf(stderr, "Threaded decode not supported on this platform\n");
+                        iThreads = 0;
+#endif
+                        break;
+
+
+                    case 'p' :                   /* Measurands to pull out */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        for (szParam = strtok(argv[iArgIdx], ","); szParam != NULL; szParam = strtok(NULL, ","))
+                            {
+                            aszParams = (const char **)realloc((void *)aszParams, (uNumParams + 1) * sizeof(char *));
+                            aszParams[uNumParams++] = szParam;
+                            }
+                        break;
+
+                    case 'q' :                   /* Sync quality timeline */
+                        iArgIdx++;
+                        if(iArgIdx >= argc)
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        sscanf(argv[iArgIdx],"%lf",&dStatSecs);
+                        if (dStatSecs <= 0.0)
+                            {
+                            fprintf(stderr, "Sync quality time must be more than 0 seconds\n");
+                            return 1;
+                            }
+                        break;
+
+                    case 'M' :                   /* Time map */
+                        bUseTimeMap = bTRUE;
+                        break;
 
                     case 'T' :                   /* Print TMATS flag */
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   /* Long flags */
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -215,6 +432,12 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    if ((uNumParams > 0) && (dStatSecs > 0.0))
+        {
+        fprintf(stderr, "Use -p or -q, not both\n");
+        return 1;
+        }
+
 /*
  * Opening banner
  * --------------
@@ -252,6 +475,17 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    // Time from a map of all the time packets instead of the last one seen
+    if (bUseTimeMap)
+        {
+        enStatus = enTimeMap_Get(&m_suTimeMap, m_iI106Handle, szInFile, TIME_MAP_ANY_CHAN);
+        if (enStatus != I106_OK)
+            {
+            fprintf(stderr, "Error making time map : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
 
 /*
  * Open the output file
@@ -280,8 +514,13 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&m_suPktFilter);
+    vPktFilter_BlockRead(&m_suPktFilter, bBlockRead);
+    enPktFilter_Open(&m_suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&m_suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -291,13 +530,12 @@ int main(int argc, char ** argv)
         pvBuff = (unsigned char *)malloc(suI106Hdr.ulPacketLen);
 
         // Read the data buffer and check for read errors
-        enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+        enStatus = enPktFilter_ReadData(&m_suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
         if (enStatus != I106_OK)
             return 1;
 
-        // Process the TMATS info
-        memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-        enStatus = enI106_Decode_Tmats(&suI106Hdr, pvBuff, &suTmatsInfo);
+        // Split TMATS into attributes for quick channel lookups
+        enStatus = enTmatsAttr_ParsePacket(&suTmatsAttrs, &suI106Hdr, pvBuff);
         if (enStatus != I106_OK) 
             {
             fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
@@ -315,10 +553,11 @@ int main(int argc, char ** argv)
 
     if (bPrintTMATS == bTRUE)
         { 
-        vPrintTmats(&suTmatsInfo, psuOutFile);
+        vPrintTmats(&suTmatsAttrs, psuOutFile);
         return(0);
         }
 
+    // The PCM attributes need the full TMATS decode
     enStatus = enI106_Decode_Tmats(&suI106Hdr, pvBuff, &suTmatsInfo);
     if (enStatus != I106_OK) 
         {
@@ -326,23 +565,49 @@ int main(int argc, char ** argv)
         return 1;
         }
 
-    enStatus = AssembleAttributesFromTMATS(psuOutFile, &suTmatsInfo, apsuChanInfo, MAX_SUCHANINFO);
+    enStatus = AssembleAttributesFromTMATS(psuOutFile, &suTmatsInfo, &suTmatsAttrs, apsuChanInfo, MAX_SUCHANINFO, uChannel);
     if (enStatus != I106_OK) 
         {
         fprintf(stderr, " Error assembling Pcm attributes from TMATS record : Status = %d\n", enStatus);
         return 1;
         }
 
+    if (uNumParams > 0)
+        {
+        enStatus = enMakeDecomPlans(psuOutFile, &suTmatsAttrs, apsuChanInfo, MAX_SUCHANINFO, aszParams, uNumParams);
+        if (enStatus != I106_OK) 
+            {
+            fprintf(stderr, " Error making measurand plans from TMATS record : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
+    if (dStatSecs > 0.0)
+        {
+        enStatus = enMakePcmStats(psuOutFile, &suTmatsAttrs, apsuChanInfo, MAX_SUCHANINFO, dStatSecs);
+        if (enStatus != I106_OK) 
+            {
+            fprintf(stderr, " Error setting up sync quality counters : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
 
 /*
  * Read messages until error or EOF
  */
 
-    while (1==1) 
+#if defined(THREADED_DECODE)
+    if (iThreads > 0)
+        vDecodeThreaded(psuOutFile, apsuChanInfo, uChannel, bDontSwapRawData, iThreads);
+#endif
+
+    // Without threads, read and decode here
+    while (iThreads == 0) 
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&m_suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -365,17 +630,16 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer and decode time
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&m_suPktFilter, ulBuffSize, pvBuff);
                 enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
                 enI106_SetRelTime(m_iI106Handle, &suTime, suI106Hdr.aubyRefTime);
                 }
 
             // If PCMF1 message then process it
             if ((suI106Hdr.ubyDataType == I106CH10_DTYPE_PCM_FMT_1) &&
-                ((uChannel == -1) || (uChannel == (int)suI106Hdr.uChID)))
+                ((uChannel == -1) || (uChannel == (int)suI106Hdr.uChID)) &&
+                (apsuChanInfo[suI106Hdr.uChID] != NULL))
                 {
-                SuPcmF1_CurrMsg suPcmF1Msg;
-
                 // Make sure our buffer is big enough, size *does* matter
                 if (ulBuffSize < suI106Hdr.ulPacketLen)
                     {
@@ -384,76 +648,18 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&m_suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
                     break;
 
-                assert(apsuChanInfo[suI106Hdr.uChID] != NULL);
-
-                // Get the attributes
-                suPcmF1Msg.psuAttributes = (SuPcmF1_Attributes *)apsuChanInfo[suI106Hdr.uChID]->psuAttributes;
- 
-                assert(suPcmF1Msg.psuAttributes != NULL);
+                assert(apsuChanInfo[suI106Hdr.uChID]->psuAttributes != NULL);
 
-                if (bDontSwapRawData)
-                    {
-                    // Add / modify attributes not covered by the TMATS
-                    // Special for Example_1.c10 we need the byte swap
-                    suPcmF1Msg.psuAttributes->bDontSwapRawData = 1;
-                    //#ifdef TEST_EXT_DEFINITIONS
-                        // Another method to set the attributes
-                        enStatus = Set_Attributes_Ext_PcmF1(suPcmF1Msg.psuAttributes->psuRDataSrc, suPcmF1Msg.psuAttributes,
-                        -1, -1, -1, -1,
-                        -1, -1,
-                        -1, - 1, -1, -1,
-                        -1, -1, -1, 
-                        // External additional data
-                        -1, bDontSwapRawData);
-                    //#endif
-
-                    // End special for Example_1.c10
-                    }
-
-                // Step through all PCMF1 messages
-                enStatus = enI106_Decode_FirstPcmF1(&suI106Hdr, pvBuff, &suPcmF1Msg);
-                while (enStatus == I106_OK)
-                    {
-                    int       PrintDigits;
-                    int       Remainder;
-                    uint32_t  Count;
-
-                    /*nParityErrors =*/ PostProcessFrame_PcmF1(&suPcmF1Msg); // Applies the word mask, checks for errors
-                    PrintDigits = suPcmF1Msg.psuAttributes->ulCommonWordLen / 4; // 4 bits: a half byte
-                    Remainder   = suPcmF1Msg.psuAttributes->ulCommonWordLen % 4;
-                    if(Remainder)
-                        PrintDigits += 2;
-
-                     // Print the channel
-                     fprintf(psuOutFile, "PCMIN-%d: ", suI106Hdr.uChID);
-
-                     // Print out the time
-                     enI106_RelInt2IrigTime(m_iI106Handle, suPcmF1Msg.llIntPktTime, &suTime);
-//                   szTime = IrigTime2StringF(&suTime, -1);
-                     szTime = IrigTime2String(&suTime);
-                     fprintf(psuOutFile,"%s ", szTime);
-
-                     // Print out the data
-                     for(Count = 0; Count < suPcmF1Msg.psuAttributes->ulWordsInMinorFrame - 1; Count++)
-                         {
-                        static char cParityError;
-                        cParityError = suPcmF1Msg.psuAttributes->pauOutBufErr[Count] ? '?' : ' ';
-                        // Note the I64 in the format
-                        fprintf(psuOutFile, "%0*I64X%c", PrintDigits, 
-                             suPcmF1Msg.psuAttributes->paullOutBuf[Count], cParityError);
-                         }
-                     fprintf(psuOutFile,"\n");
-
-                     // Get the next PCMF1 message
-                    enStatus = enI106_Decode_NextPcmF1(&suPcmF1Msg);
-
-                    } // end while processing PCMF1 messages from an IRIG packet
+                // Decode the minor frames and print them
+                vDecodePcmPacket(&suI106Hdr, pvBuff, (SuPcmF1_Attributes *)apsuChanInfo[suI106Hdr.uChID]->psuAttributes,
+                                 &apsuChanInfo[suI106Hdr.uChID]->suKernel, bDontSwapRawData, &suPcmText);
+                vWritePcmText(suI106Hdr.uChID, &suPcmText, psuOutFile);
 
                 } // end if PCMF1
 
@@ -472,11 +678,20 @@ int main(int argc, char ** argv)
  * Print out some summaries
  */
 
+    if (dStatSecs > 0.0)
+        vPrintPcmStats(psuOutFile, apsuChanInfo, MAX_SUCHANINFO);
+
 /*
  *  Close files
  */
 
+    vFreePcmText(&suPcmText);
+    FreeChanInfoTable(apsuChanInfo, MAX_SUCHANINFO);
+    vTmatsAttr_Free(&suTmatsAttrs);
+    free((void *)aszParams);
+    vTimeMap_Free(&m_suTimeMap);
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&m_suPktFilter);
     fclose(psuOutFile);
 
     return 0;
@@ -486,14 +701,11 @@ int main(int argc, char ** argv)
 
 /* ------------------------------------------------------------------------ */
 /* Note: Most of the code below is from Irig106.org / Bob Baggerman */
-void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
+void vPrintTmats(SuTmatsAttrs * psuTmatsAttrs, FILE * psuOutFile)
     {
-    int                     iGIndex;
-    int                     iRIndex;
-    int                     iRDsiIndex;
-    SuGDataSource         * psuGDataSource;
-    SuRRecord             * psuRRecord;
-    SuRDataSource         * psuRDataSource;
+    uint32_t                uChanIdx;
+    SuTmatsAttrChan       * psuChan;
+    const char            * szProgramName;
 
     // Print out the TMATS info
     // ------------------------
@@ -501,46 +713,23 @@ void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
     fprintf(psuOutFile,"\n=-=-= PCMF1 Channel Summary =-=-=\n\n");
 
     // G record
-    fprintf(psuOutFile,"Program Name - %s\n",psuTmatsInfo->psuFirstGRecord->szProgramName);
+    szProgramName = szTmatsAttr_Get(psuTmatsAttrs, "G\\PN");
+    fprintf(psuOutFile,"Program Name - %s\n", szProgramName != NULL ? szProgramName : "");
     fprintf(psuOutFile,"\n");
     fprintf(psuOutFile,"Channel  Data Source         \n");
     fprintf(psuOutFile,"-------  --------------------\n");
 
-    // Data sources
-    psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource;
-    do  {
-        if (psuGDataSource == NULL) break;
-
-        // G record data source info
-        iGIndex = psuGDataSource->iIndex;
-
-        // R record info
-        psuRRecord = psuGDataSource->psuRRecord;
-        do  {
-            if (psuRRecord == NULL) break;
-            iRIndex = psuRRecord->iIndex;
-
-            // R record data sources
-            psuRDataSource = psuRRecord->psuFirstDataSource;
-            do  {
-                if (psuRDataSource == NULL) 
-                    break;
-                if (strcasecmp(psuRDataSource->szChannelDataType,"PCMIN") == 0)
-                    {
-                    iRDsiIndex = psuRDataSource->iIndex;
-                    fprintf(psuOutFile," %5s ",   psuRDataSource->szTrackNumber);
-                    fprintf(psuOutFile,"  %-20s", psuRDataSource->szDataSourceID);
-                    fprintf(psuOutFile,"\n");
-                    }
-                psuRDataSource = psuRDataSource->psuNext;
-                } while (bTRUE);
-
-            psuRRecord = psuRRecord->psuNext;
-            } while (bTRUE);
-
-
-        psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource->psuNext;
-        } while (bTRUE);
+    // R record data sources
+    for (uChanIdx=0; uChanIdx<psuTmatsAttrs->uNumChans; uChanIdx++)
+        {
+        psuChan = &psuTmatsAttrs->pasuChans[uChanIdx];
+        if ((psuChan->szChanType != NULL) && (strcasecmp(psuChan->szChanType,"PCMIN") == 0))
+            {
+            fprintf(psuOutFile," %5u ",   psuChan->uChanID);
+            fprintf(psuOutFile,"  %-20s", psuChan->szDataSourceID != NULL ? psuChan->szDataSourceID : "");
+            fprintf(psuOutFile,"\n");
+            }
+        } // end for all recorder channels
 
     return;
     }
@@ -558,16 +747,7 @@ void FreeChanInfoTable(SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
         {
         if(apsuChanInfo[iTrackNumber] != NULL)
             {
-            if(apsuChanInfo[iTrackNumber]->psuAttributes != NULL)
-                {
-                // Pcm special
-                if (strcasecmp(apsuChanInfo[iTrackNumber]->psuRDataSrc->szChannelDataType,"PCMIN") == 0)
-                    FreeOutputBuffers_PcmF1((SuPcmF1_Attributes *) apsuChanInfo[iTrackNumber]->psuAttributes);
-                free(apsuChanInfo[iTrackNumber]->psuAttributes);
-                apsuChanInfo[iTrackNumber]->psuAttributes = NULL;
-                } 
-
-            free(apsuChanInfo[iTrackNumber]);
+            vFreeChanInfo(apsuChanInfo[iTrackNumber]);
             apsuChanInfo[iTrackNumber] = NULL;
             } // end if channel info not null
         } // end for all track numbers
@@ -576,7 +756,35 @@ void FreeChanInfoTable(SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
 
 /* ------------------------------------------------------------------------ */
 
-EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
+void vFreeChanInfo(SuChanInfo * psuChanInfo)
+    {
+    if(psuChanInfo->psuAttributes != NULL)
+        {
+        // Pcm special
+        if (strcasecmp(psuChanInfo->psuRDataSrc->szChannelDataType,"PCMIN") == 0)
+            FreeOutputBuffers_PcmF1((SuPcmF1_Attributes *) psuChanInfo->psuAttributes);
+        free(psuChanInfo->psuAttributes);
+        psuChanInfo->psuAttributes = NULL;
+        } 
+
+    if(psuChanInfo->suKernel.psuDecom != NULL)
+        {
+        vPcmDecom_Free(psuChanInfo->suKernel.psuDecom);
+        free(psuChanInfo->suKernel.psuDecom);
+        psuChanInfo->suKernel.psuDecom = NULL;
+        }
+
+    free(psuChanInfo->suKernel.psuStats);
+    psuChanInfo->suKernel.psuStats = NULL;
+
+    free(psuChanInfo);
+    } // End vFreeChanInfo
+
+
+/* ------------------------------------------------------------------------ */
+
+EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmatsInfo, SuTmatsAttrs * psuTmatsAttrs, 
+                                         SuChanInfo * apsuChanInfo[], int MaxSuChanInfo, unsigned int uChannel)
     {
     static char                   * szModuleText = "Assemble Attributes From TMATS";
     char                          szText[_MAX_PATH + _MAX_PATH];
@@ -586,6 +794,7 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
     SuRRecord                     * psuRRecord;
     SuRDataSource                 * psuRDataSrc;
     int                           iTrackNumber; 
+    SuTmatsAttrChan               * psuAttrChan;
     EnI106Status                  enStatus;
 
     memset(szText, 0, SizeOfText--); // init and set the size to one less
@@ -604,7 +813,7 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
 
         // Get the first data source for this R record
         psuRDataSrc = psuRRecord->psuFirstDataSource;
-        while (psuRDataSrc != NULL)
+        for ( ; psuRDataSrc != NULL; psuRDataSrc = psuRDataSrc->psuNext)
             {
             if(psuRDataSrc->szTrackNumber == NULL)
                 continue;
@@ -614,6 +823,15 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
             if(iTrackNumber >= MaxSuChanInfo)
                 return(I106_BUFFER_TOO_SMALL);
 
+            // Only set up the selected channel, and only PCM channels. The
+            // attribute store answers this without touching the P records.
+            if ((uChannel != (unsigned int)-1) && (uChannel != (unsigned int)iTrackNumber))
+                continue;
+            psuAttrChan = psuTmatsAttr_FindChan(psuTmatsAttrs, iTrackNumber);
+            if ((psuAttrChan == NULL) || (psuAttrChan->szChanType == NULL) || 
+                (strcasecmp(psuAttrChan->szChanType,"PCMIN") != 0))
+                continue;
+
             // Make sure a message count structure exists
             if (apsuChanInfo[iTrackNumber] == NULL)
                 {
@@ -627,27 +845,24 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
 
                 // Now save channel type and name
                 apsuChanInfo[iTrackNumber]->uChID = iTrackNumber;
-                apsuChanInfo[iTrackNumber]->bEnabled = psuRDataSrc->szEnabled[0] == 'T';
+                apsuChanInfo[iTrackNumber]->bEnabled = (psuAttrChan->szEnabled != NULL) && (psuAttrChan->szEnabled[0] == 'T');
                 apsuChanInfo[iTrackNumber]->psuRDataSrc = psuRDataSrc;
 
-                if (strcasecmp(psuRDataSrc->szChannelDataType,"PCMIN") == 0)
+                // Create the correspondent attributes structure
+                if((apsuChanInfo[iTrackNumber]->psuAttributes = calloc(1, sizeof(SuPcmF1_Attributes))) == NULL)
                     {
-                    // Create the correspondent attributes structure
-                    if((apsuChanInfo[iTrackNumber]->psuAttributes = calloc(1, sizeof(SuPcmF1_Attributes))) == NULL)
-                        {
-                        _snprintf(&szText[TextLen], SizeOfText - TextLen, "%s: %s\n", szModuleText, szI106ErrorStr(I106_BUFFER_TOO_SMALL));
-                        fprintf(psuOutFile, szText);
-                        FreeChanInfoTable(apsuChanInfo, MaxSuChanInfo);
-                        return(I106_BUFFER_TOO_SMALL);
-                        }
-                    // Fill the attributes, don't check the return status I106_INVALID_PARAMETER
-                    enStatus = Set_Attributes_PcmF1(psuRDataSrc, (SuPcmF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes);
+                    _snprintf(&szText[TextLen], SizeOfText - TextLen, "%s: %s\n", szModuleText, szI106ErrorStr(I106_BUFFER_TOO_SMALL));
+                    fprintf(psuOutFile, szText);
+                    FreeChanInfoTable(apsuChanInfo, MaxSuChanInfo);
+                    return(I106_BUFFER_TOO_SMALL);
                     }
+                // Fill the attributes, don't check the return status I106_INVALID_PARAMETER
+                enStatus = Set_Attributes_PcmF1(psuRDataSrc, (SuPcmF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes);
+                vPickPcmKernel((SuPcmF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes, 
+                               &apsuChanInfo[iTrackNumber]->suKernel);
                 }
 
-            // Get the next R record data source
-            psuRDataSrc = psuRDataSrc->psuNext;
-            } // end while walking R data source linked list
+            } // end for walking R data source linked list
 
         // Get the next R record
         psuRRecord = psuRRecord->psuNext;
@@ -659,6 +874,229 @@ EnI106Status AssembleAttributesFromTMATS(FILE *psuOutFile, SuTmatsInfo * psuTmat
 
 /* ------------------------------------------------------------------------ */
 
+// Make a measurand extraction plan for each PCM channel set up so far.
+// Channels without any of the measurands are dropped so their packets are
+// skipped. Prints the column heading line.
+
+EnI106Status enMakeDecomPlans(FILE * psuOutFile, SuTmatsAttrs * psuTmatsAttrs, SuChanInfo * apsuChanInfo[], 
+                              int MaxSuChanInfo, const char * const aszParams[], unsigned int uNumParams)
+    {
+    int                     iTrackNumber;
+    unsigned int            uParamIdx;
+    int                   * abFound;
+    SuPcmF1_Attributes    * psuAttributes;
+    SuPcmDecom            * psuDecom;
+    EnI106Status            enStatus;
+
+    abFound = (int *)calloc(uNumParams, sizeof(int));
+    if (abFound == NULL)
+        return(I106_BUFFER_TOO_SMALL);
+
+    for (iTrackNumber = 0; iTrackNumber < MaxSuChanInfo; iTrackNumber++)
+        {
+        if (apsuChanInfo[iTrackNumber] == NULL)
+            continue;
+
+        psuAttributes = (SuPcmF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes;
+        psuDecom      = (SuPcmDecom *)malloc(sizeof(SuPcmDecom));
+        if (psuDecom == NULL)
+            {
+            free(abFound);
+            return(I106_BUFFER_TOO_SMALL);
+            }
+        vPcmDecom_Init(psuDecom);
+        apsuChanInfo[iTrackNumber]->suKernel.psuDecom = psuDecom;
+
+        enStatus = enPcmDecom_Compile(psuDecom, psuTmatsAttrs, iTrackNumber, psuAttributes->ulCommonWordLen, 
+                                      psuAttributes->ullCommonWordMask, psuAttributes->ulWordsInMinorFrame, 
+                                      aszParams, uNumParams);
+        if (enStatus != I106_OK)
+            {
+            free(abFound);
+            return(enStatus);
+            }
+
+        // Nothing wanted from this channel
+        if (psuDecom->uNumParams == 0)
+            {
+            vFreeChanInfo(apsuChanInfo[iTrackNumber]);
+            apsuChanInfo[iTrackNumber] = NULL;
+            continue;
+            }
+
+        for (uParamIdx = 0; uParamIdx < uNumParams; uParamIdx++)
+            if (psuDecom->paiColumnParam[uParamIdx] >= 0)
+                abFound[uParamIdx] = bTRUE;
+        } // end for all track numbers
+
+    // Column headings
+    fprintf(psuOutFile, "Time,Channel");
+    for (uParamIdx = 0; uParamIdx < uNumParams; uParamIdx++)
+        {
+        fprintf(psuOutFile, ",%s", aszParams[uParamIdx]);
+        if (!abFound[uParamIdx])
+            fprintf(stderr, "Measurand %s not found in TMATS\n", aszParams[uParamIdx]);
+        }
+    fprintf(psuOutFile, "\n");
+
+    free(abFound);
+
+    return(I106_OK);
+    }
+
+/* ------------------------------------------------------------------------ */
+
+// Set up sync quality counters for each PCM channel and print the column
+// heading line
+
+EnI106Status enMakePcmStats(FILE * psuOutFile, SuTmatsAttrs * psuTmatsAttrs, SuChanInfo * apsuChanInfo[], 
+                            int MaxSuChanInfo, double dBucketSecs)
+    {
+    int                     iTrackNumber;
+    SuPcmF1_Attributes    * psuAttributes;
+    SuPcmStats            * psuStats;
+
+    for (iTrackNumber = 0; iTrackNumber < MaxSuChanInfo; iTrackNumber++)
+        {
+        if (apsuChanInfo[iTrackNumber] == NULL)
+            continue;
+
+        psuStats = (SuPcmStats *)calloc(1, sizeof(SuPcmStats));
+        if (psuStats == NULL)
+            return(I106_BUFFER_TOO_SMALL);
+        apsuChanInfo[iTrackNumber]->suKernel.psuStats = psuStats;
+
+        // Relative time counts in 100 ns ticks
+        psuStats->llBucketLen = (int64_t)(dBucketSecs * 10000000.0);
+        if (psuStats->llBucketLen < 1)
+            psuStats->llBucketLen = 1;
+
+        psuAttributes = (SuPcmF1_Attributes *)apsuChanInfo[iTrackNumber]->psuAttributes;
+        vPcmDecom_GetFormat(psuTmatsAttrs, iTrackNumber, psuAttributes->ulCommonWordLen, 
+                            psuAttributes->ulWordsInMinorFrame, &psuStats->suFormat);
+        } // end for all track numbers
+
+    fprintf(psuOutFile, "Time,Channel,Frames,ParityErrors,SyncLosses,SfidGaps\n");
+
+    return(I106_OK);
+    }
+
+/* ------------------------------------------------------------------------ */
+
+// Count one minor frame. When the frame is in a new time bucket the counts
+// for the last bucket are added to the text. A bucket without any frames
+// doesn't get a line. Returns the new text length.
+
+uint32_t ulPcmStatsFrame(SuPcmStats * psuStats, SuPcmF1_Attributes * psuAttributes, int64_t llTime, 
+                         int iParityErrors, SuPcmText * psuText, uint32_t ulTextLen)
+    {
+    int64_t                 llBucket;
+    uint32_t                uSfid;
+
+    llBucket = llTime / psuStats->llBucketLen;
+    if ((llTime < 0) && ((llTime % psuStats->llBucketLen) != 0))
+        llBucket--;
+    if (psuStats->bStarted && (llBucket != psuStats->llBucket))
+        ulTextLen = ulPcmStatsRow(psuStats, psuText, ulTextLen);
+    if (!psuStats->bStarted)
+        psuStats->lSyncErrors = psuAttributes->lSyncErrors;
+    psuStats->llBucket = llBucket;
+    psuStats->bStarted = bTRUE;
+
+    psuStats->aulBucket[PCM_STAT_FRAMES]++;
+    psuStats->aulBucket[PCM_STAT_PARITY] += iParityErrors;
+
+    // The decoder counts the times it loses sync
+    if (psuAttributes->lSyncErrors != psuStats->lSyncErrors)
+        {
+        psuStats->aulBucket[PCM_STAT_SYNCLOSS] += (uint32_t)(psuAttributes->lSyncErrors - psuStats->lSyncErrors);
+        psuStats->lSyncErrors = psuAttributes->lSyncErrors;
+        }
+
+    // Each subframe ID should follow the one before
+    if (psuStats->suFormat.bHaveSfid)
+        {
+        uSfid = uPcmDecom_Sfid(&psuStats->suFormat, psuAttributes->paullOutBuf);
+        if (psuStats->bHaveSfid && (uSfid != uPcmDecom_NextSfid(&psuStats->suFormat, psuStats->uSfid)))
+            psuStats->aulBucket[PCM_STAT_SFIDGAP]++;
+        psuStats->uSfid     = uSfid;
+        psuStats->bHaveSfid = bTRUE;
+        }
+
+    return ulTextLen;
+    }
+
+/* ------------------------------------------------------------------------ */
+
+// Add the counts for the current bucket to the text and the totals, and
+// clear them for the next bucket
+
+uint32_t ulPcmStatsRow(SuPcmStats * psuStats, SuPcmText * psuText, uint32_t ulTextLen)
+    {
+    char                  * pchText;
+    int                     iStat;
+
+    pchText = pchAddPcmText(psuText, ulTextLen, 64, psuStats->llBucket * psuStats->llBucketLen);
+    pchText += sprintf(pchText, ",%u,%u,%u,%u\n", 
+        psuStats->aulBucket[PCM_STAT_FRAMES],   psuStats->aulBucket[PCM_STAT_PARITY],
+        psuStats->aulBucket[PCM_STAT_SYNCLOSS], psuStats->aulBucket[PCM_STAT_SFIDGAP]);
+
+    for (iStat = 0; iStat < PCM_STAT_COUNT; iStat++)
+        {
+        psuStats->aullTotal[iStat] += psuStats->aulBucket[iStat];
+        psuStats->aulBucket[iStat]  = 0;
+        }
+
+    return (uint32_t)(pchText - psuText->pchText);
+    }
+
+/* ------------------------------------------------------------------------ */
+
+// At the end of the file print the last bucket for each channel and then
+// the totals
+
+void vPrintPcmStats(FILE * psuOutFile, SuChanInfo * apsuChanInfo[], int MaxSuChanInfo)
+    {
+    int                     iTrackNumber;
+    SuPcmStats            * psuStats;
+    SuPcmText               suText;
+    uint32_t                ulTextLen;
+
+    memset(&suText, 0, sizeof(suText));
+    suText.bColumns = bTRUE;
+
+    for (iTrackNumber = 0; iTrackNumber < MaxSuChanInfo; iTrackNumber++)
+        {
+        if ((apsuChanInfo[iTrackNumber] == NULL) || (apsuChanInfo[iTrackNumber]->suKernel.psuStats == NULL))
+            continue;
+        psuStats = apsuChanInfo[iTrackNumber]->suKernel.psuStats;
+        if (!psuStats->bStarted)
+            continue;
+        suText.uFrames = 0;
+        ulTextLen      = ulPcmStatsRow(psuStats, &suText, 0);
+        suText.paulTextOffset[suText.uFrames] = ulTextLen;
+        vWritePcmText(iTrackNumber, &suText, psuOutFile);
+        }
+
+    for (iTrackNumber = 0; iTrackNumber < MaxSuChanInfo; iTrackNumber++)
+        {
+        if ((apsuChanInfo[iTrackNumber] == NULL) || (apsuChanInfo[iTrackNumber]->suKernel.psuStats == NULL))
+            continue;
+        psuStats = apsuChanInfo[iTrackNumber]->suKernel.psuStats;
+        fprintf(psuOutFile, "Total,%d,%llu,%llu,%llu,%llu\n", iTrackNumber,
+            (unsigned long long)psuStats->aullTotal[PCM_STAT_FRAMES],
+            (unsigned long long)psuStats->aullTotal[PCM_STAT_PARITY],
+            (unsigned long long)psuStats->aullTotal[PCM_STAT_SYNCLOSS],
+            (unsigned long long)psuStats->aullTotal[PCM_STAT_SFIDGAP]);
+        }
+
+    vFreePcmText(&suText);
+
+    return;
+    }
+
+/* ------------------------------------------------------------------------ */
+
 /////////////////////////////////////////////////////////////////////////////
 // Post Process a Minor Frame
 // Checks for parity errors, moves to data to the output buffer, applies the word mask
@@ -694,6 +1132,590 @@ int PostProcessFrame_PcmF1(SuPcmF1_CurrMsg * psuCurrMsg)
     return(iParityErrors);
     }
 
+/* ------------------------------------------------------------------------ */
+
+// Minor frame kernels
+// -------------------
+
+// The decoder leaves each word right justified in a 64 bit word, parity bit
+// included. The kernels below do a whole minor frame per call with a
+// popcount for the parity and no per word branching, the same result as
+// PostProcessFrame_PcmF1(). The common word lengths get their own copies so
+// the compiler sees a constant length and digit count and can unroll and
+// vectorize the loops.
+
+#if !defined(__GNUC__)
+static int iPopCount64(uint64_t ullWord)
+    {
+    ullWord = ullWord - ((ullWord >> 1) & 0x5555555555555555ULL);
+    ullWord = (ullWord & 0x3333333333333333ULL) + ((ullWord >> 2) & 0x3333333333333333ULL);
+    ullWord = (ullWord + (ullWord >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((ullWord * 0x0101010101010101ULL) >> 56);
+    }
+#endif
+
+
+// Check parity and mask every word in a minor frame. A word is in error
+// when its one bit count is odd for even parity or even for odd parity.
+static int iPostProcessParity(SuPcmF1_Attributes * psuAttributes, const uint32_t ulWordLen, const int bOddParity)
+    {
+    uint64_t          * paullWord  = psuAttributes->paullOutBuf;
+    uint8_t           * pauErr     = psuAttributes->pauOutBufErr;
+    const uint64_t      ullLenMask = (ulWordLen >= 64) ? ~0ULL : (1ULL << ulWordLen) - 1;
+    const uint64_t      ullMask    = psuAttributes->ullCommonWordMask;
+    const uint32_t      ulWords    = psuAttributes->ulWordsInMinorFrame;
+    const unsigned int  uOdd       = bOddParity ? 1 : 0;
+    uint32_t            Count;
+    unsigned int        uErr;
+    int                 iParityErrors = 0;
+
+    for (Count = 0; Count < ulWords; Count++)
+        {
+        uErr = ((unsigned int)POPCOUNT64(paullWord[Count] & ullLenMask) & 1) ^ uOdd;
+        pauErr[Count]    = (uint8_t)uErr;
+        paullWord[Count] = paullWord[Count] & ullMask;
+        iParityErrors   += uErr;
+        }
+
+    return iParityErrors;
+    }
+
+#define PARITY_KERNELS(LEN)                                                                                 \
+    static int iPostProcessEven##LEN(SuPcmF1_Attributes * psuAttributes)                                    \
+        { return iPostProcessParity(psuAttributes, LEN, bFALSE); }                                          \
+    static int iPostProcessOdd##LEN(SuPcmF1_Attributes * psuAttributes)                                     \
+        { return iPostProcessParity(psuAttributes, LEN, bTRUE); }
+
+PARITY_KERNELS(8)
+PARITY_KERNELS(10)
+PARITY_KERNELS(12)
+PARITY_KERNELS(14)
+PARITY_KERNELS(16)
+
+static int iPostProcessEven(SuPcmF1_Attributes * psuAttributes)
+    { return iPostProcessParity(psuAttributes, psuAttributes->ulCommonWordLen, bFALSE); }
+
+static int iPostProcessOdd(SuPcmF1_Attributes * psuAttributes)
+    { return iPostProcessParity(psuAttributes, psuAttributes->ulCommonWordLen, bTRUE); }
+
+
+// No parity, just mask
+static int iPostProcessNone(SuPcmF1_Attributes * psuAttributes)
+    {
+    uint64_t          * paullWord = psuAttributes->paullOutBuf;
+    const uint64_t      ullMask   = psuAttributes->ullCommonWordMask;
+    const uint32_t      ulWords   = psuAttributes->ulWordsInMinorFrame;
+    uint32_t            Count;
+
+    for (Count = 0; Count < ulWords; Count++)
+        paullWord[Count] &= ullMask;
+    memset(psuAttributes->pauOutBufErr, 0, ulWords);
+
+    return 0;
+    }
+
+
+// Anything else goes through the library parity check one word at a time
+static int iPostProcessAny(SuPcmF1_Attributes * psuAttributes)
+    {
+    SuPcmF1_CurrMsg     suPcmF1Msg;
+
+    suPcmF1Msg.psuAttributes = psuAttributes;
+    return PostProcessFrame_PcmF1(&suPcmF1Msg);
+    }
+
+
+// Number of hex digits to print for a word length
+static int iPcmPrintDigits(uint32_t ulWordLen)
+    {
+    int     iPrintDigits;
+
+    iPrintDigits = ulWordLen / 4; // 4 bits: a half byte
+    if (ulWordLen % 4)
+        iPrintDigits += 2;
+
+    return iPrintDigits;
+    }
+
+
+// Format the data words of a minor frame, the same as "%0*llX" followed by
+// '?' for a parity error or ' ', but a lot quicker. The last word is the
+// sync word and isn't printed.
+static char * pchFormatFrame(SuPcmF1_Attributes * psuAttributes, char * pchText, const int iPrintDigits)
+    {
+    static const char   achHex[] = "0123456789ABCDEF";
+    const uint64_t    * paullWord = psuAttributes->paullOutBuf;
+    const uint8_t     * pauErr    = psuAttributes->pauOutBufErr;
+    const uint32_t      ulWords   = psuAttributes->ulWordsInMinorFrame - 1;
+    uint32_t            Count;
+    int                 iDigit;
+    int                 iShift;
+    uint64_t            ullDataWord;
+
+    for (Count = 0; Count < ulWords; Count++)
+        {
+        ullDataWord = paullWord[Count];
+        for (iDigit = iPrintDigits - 1; iDigit >= 0; iDigit--)
+            {
+            iShift = iDigit * 4;
+            *pchText++ = iShift < 64 ? achHex[(ullDataWord >> iShift) & 0x0f] : '0';
+            }
+        *pchText++ = pauErr[Count] ? '?' : ' ';
+        }
+    *pchText++ = '\n';
+
+    return pchText;
+    }
+
+#define FORMAT_KERNEL(DIGITS)                                                                               \
+    static char * pchFormat##DIGITS(SuPcmF1_Attributes * psuAttributes, char * pchText)                     \
+        { return pchFormatFrame(psuAttributes, pchText, DIGITS); }
+
+FORMAT_KERNEL(2)
+FORMAT_KERNEL(3)
+FORMAT_KERNEL(4)
+FORMAT_KERNEL(5)
+
+static char * pchFormatAny(SuPcmF1_Attributes * psuAttributes, char * pchText)
+    { return pchFormatFrame(psuAttributes, pchText, iPcmPrintDigits(psuAttributes->ulCommonWordLen)); }
+
+
+/* ------------------------------------------------------------------------ */
+
+// Pick the minor frame kernels for a channel's attributes. Call this again
+// if the word length or parity type change.
+
+void vPickPcmKernel(SuPcmF1_Attributes * psuAttributes, SuPcmKernel * psuKernel)
+    {
+    const uint32_t      ulWordLen = psuAttributes->ulCommonWordLen;
+
+    switch (psuAttributes->ulParityType)
+        {
+        case PCM_PARITY_NONE :
+            psuKernel->pfPostProcess = iPostProcessNone;
+            break;
+
+        case PCM_PARITY_EVEN :
+            switch (ulWordLen)
+                {
+                case  8 : psuKernel->pfPostProcess = iPostProcessEven8;  break;
+                case 10 : psuKernel->pfPostProcess = iPostProcessEven10; break;
+                case 12 : psuKernel->pfPostProcess = iPostProcessEven12; break;
+                case 14 : psuKernel->pfPostProcess = iPostProcessEven14; break;
+                case 16 : psuKernel->pfPostProcess = iPostProcessEven16; break;
+                default : psuKernel->pfPostProcess = iPostProcessEven;   break;
+                }
+            break;
+
+        case PCM_PARITY_ODD :
+            switch (ulWordLen)
+                {
+                case  8 : psuKernel->pfPostProcess = iPostProcessOdd8;  break;
+                case 10 : psuKernel->pfPostProcess = iPostProcessOdd10; break;
+                case 12 : psuKernel->pfPostProcess = iPostProcessOdd12; break;
+                case 14 : psuKernel->pfPostProcess = iPostProcessOdd14; break;
+                case 16 : psuKernel->pfPostProcess = iPostProcessOdd16; break;
+                default : psuKernel->pfPostProcess = iPostProcessOdd;   break;
+                }
+            break;
+
+        default :
+            psuKernel->pfPostProcess = iPostProcessAny;
+            break;
+        } // end switch on parity type
+
+    psuKernel->iPrintDigits = iPcmPrintDigits(ulWordLen);
+    switch (psuKernel->iPrintDigits)
+        {
+        case 2  : psuKernel->pfFormat = pchFormat2;   break;
+        case 3  : psuKernel->pfFormat = pchFormat3;   break;
+        case 4  : psuKernel->pfFormat = pchFormat4;   break;
+        case 5  : psuKernel->pfFormat = pchFormat5;   break;
+        default : psuKernel->pfFormat = pchFormatAny; break;
+        }
+
+    return;
+    }
+
+
+/* ------------------------------------------------------------------------ */
+
+// Decode all the minor frames in a PCM packet and format the data words as
+// hex text. Only touches the attributes for this packet's channel so it is
+// safe to call from a worker thread that owns the channel.
+
+void vDecodePcmPacket(SuI106Ch10Header * psuHdr, void * pvBuff, SuPcmF1_Attributes * psuAttributes, 
+                      SuPcmKernel * psuKernel, int bDontSwapRawData, SuPcmText * psuText)
+    {
+    EnI106Status        enStatus;
+    SuPcmF1_CurrMsg     suPcmF1Msg;
+    uint32_t            ulFrameTextLen;
+    uint32_t            ulTextLen;
+    char              * pchText;
+    int                 iRows;
+    int                 iRow;
+    int                 iParityErrors;
+
+    psuText->uFrames  = 0;
+    psuText->bColumns = (psuKernel->psuDecom != NULL) || (psuKernel->psuStats != NULL);
+    ulTextLen         = 0;
+
+    suPcmF1Msg.psuAttributes = psuAttributes;
+
+    if (bDontSwapRawData)
+        {
+        // Add / modify attributes not covered by the TMATS
+        // Special for Example_1.c10 we need the byte swap
+        suPcmF1Msg.psuAttributes->bDontSwapRawData = 1;
+        //#ifdef TEST_EXT_DEFINITIONS
+            // Another method to set the attributes
+            enStatus = Set_Attributes_Ext_PcmF1(suPcmF1Msg.psuAttributes->psuRDataSrc, suPcmF1Msg.psuAttributes,
+            -1, -1, -1, -1,
+            -1, -1,
+            -1, - 1, -1, -1,
+            -1, -1, -1, 
+            // External additional data
+            -1, bDontSwapRawData);
+        //#endif
+
+        // End special for Example_1.c10
+        }
+
+    if (psuKernel->psuDecom != NULL)
+        ulFrameTextLen = ulPcmDecom_RowLen(psuKernel->psuDecom);
+    else
+        ulFrameTextLen = (psuAttributes->ulWordsInMinorFrame - 1) * (psuKernel->iPrintDigits + 1) + 1;
+
+    // Step through all PCMF1 messages
+    enStatus = enI106_Decode_FirstPcmF1(psuHdr, pvBuff, &suPcmF1Msg);
+    while (enStatus == I106_OK)
+        {
+        // Only count frames and errors
+        if (psuKernel->psuStats != NULL)
+            {
+            iParityErrors = psuKernel->pfPostProcess(psuAttributes);
+            ulTextLen     = ulPcmStatsFrame(psuKernel->psuStats, psuAttributes, suPcmF1Msg.llIntPktTime, 
+                                            iParityErrors, psuText, ulTextLen);
+            }
+
+        // Pull out just the measurands asked for. The plan applies the word
+        // mask itself and only reads the words it needs.
+        else if (psuKernel->psuDecom != NULL)
+            {
+            iRows = iPcmDecom_Frame(psuKernel->psuDecom, psuAttributes->paullOutBuf);
+            for (iRow = 0; iRow < iRows; iRow++)
+                {
+                pchText   = pchAddPcmText(psuText, ulTextLen, ulFrameTextLen, suPcmF1Msg.llIntPktTime);
+                pchText   = pchPcmDecom_Row(psuKernel->psuDecom, iRow, pchText);
+                ulTextLen = (uint32_t)(pchText - psuText->pchText);
+                }
+            }
+
+        // Format all the data words
+        else
+            {
+            /*nParityErrors =*/ psuKernel->pfPostProcess(psuAttributes); // Applies the word mask, checks for errors
+
+            pchText   = pchAddPcmText(psuText, ulTextLen, ulFrameTextLen, suPcmF1Msg.llIntPktTime);
+            pchText   = psuKernel->pfFormat(psuAttributes, pchText);
+            ulTextLen = (uint32_t)(pchText - psuText->pchText);
+            }
+
+        // Get the next PCMF1 message
+        enStatus = enI106_Decode_NextPcmF1(&suPcmF1Msg);
+        } // end while processing PCMF1 messages from an IRIG packet
+
+    if (psuText->paulTextOffset != NULL)
+        psuText->paulTextOffset[psuText->uFrames] = ulTextLen;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Start a new line of text with its time, making room for up to ulMaxLen
+// characters after the ulTextLen already there. Returns where to put it.
+
+char * pchAddPcmText(SuPcmText * psuText, uint32_t ulTextLen, uint32_t ulMaxLen, int64_t llTime)
+    {
+    if (psuText->uFrames + 1 >= psuText->uMaxFrames)
+        {
+        psuText->uMaxFrames     = (psuText->uMaxFrames == 0) ? 64 : psuText->uMaxFrames * 2;
+        psuText->pallFrameTime  = (int64_t *)realloc(psuText->pallFrameTime, psuText->uMaxFrames * sizeof(int64_t));
+        psuText->paulTextOffset = (uint32_t *)realloc(psuText->paulTextOffset, psuText->uMaxFrames * sizeof(uint32_t));
+        }
+    if (ulTextLen + ulMaxLen > psuText->ulTextSize)
+        {
+        psuText->ulTextSize = 2 * (ulTextLen + ulMaxLen);
+        psuText->pchText    = (char *)realloc(psuText->pchText, psuText->ulTextSize);
+        }
+    assert((psuText->pallFrameTime != NULL) && (psuText->paulTextOffset != NULL) && (psuText->pchText != NULL));
+
+    psuText->pallFrameTime[psuText->uFrames]  = llTime;
+    psuText->paulTextOffset[psuText->uFrames] = ulTextLen;
+    psuText->uFrames++;
+
+    return &psuText->pchText[ulTextLen];
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Print decoded frames with the channel and time in front of each one
+
+void vWritePcmText(unsigned int uChID, SuPcmText * psuText, FILE * psuOutFile)
+    {
+    uint32_t            uFrameIdx;
+    SuIrig106Time       suTime;
+    char              * szTime;
+
+    for (uFrameIdx=0; uFrameIdx<psuText->uFrames; uFrameIdx++)
+        {
+        enTimeMap_RelInt2IrigTime(&m_suTimeMap, m_iI106Handle, psuText->pallFrameTime[uFrameIdx], &suTime);
+//      szTime = IrigTime2StringF(&suTime, -1);
+        szTime = IrigTime2String(&suTime);
+
+        // Measurand columns start with the time and channel
+        if (psuText->bColumns)
+            fprintf(psuOutFile, "%s,%u", szTime, uChID);
+
+        // Hex words start with the channel and time
+        else
+            fprintf(psuOutFile, "PCMIN-%d: %s ", uChID, szTime);
+
+        // Print out the data
+        fwrite(&psuText->pchText[psuText->paulTextOffset[uFrameIdx]], 1, 
+            psuText->paulTextOffset[uFrameIdx+1] - psuText->paulTextOffset[uFrameIdx], psuOutFile);
+        }
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vFreePcmText(SuPcmText * psuText)
+    {
+    free(psuText->pallFrameTime);
+    free(psuText->paulTextOffset);
+    free(psuText->pchText);
+    memset(psuText, 0, sizeof(SuPcmText));
+    return;
+    }
+
+
+
+#if defined(THREADED_DECODE)
+
+/* ------------------------------------------------------------------------ */
+
+// Read packets in this thread and hand PCM packets to the workers. Jobs go
+// into the ring in file order and are printed from the ring in the same
+// order, so the output is the same as without threads. Time packets go
+// through the ring too so the time reference changes at the right place.
+
+void vDecodeThreaded(FILE * psuOutFile, SuChanInfo * apsuChanInfo[], unsigned int uChannel, 
+                     int bDontSwapRawData, int iThreads)
+    {
+    EnI106Status        enStatus;
+    SuI106Ch10Header    suI106Hdr;
+    SuPcmJob          * pasuJobs;
+    SuPcmJob          * psuJob;
+    SuPcmWorker       * pasuWorkers;
+    SuPcmWorker       * psuWorker;
+    uint32_t            uNextJob;       // Next job to fill
+    uint32_t            uNextOut;       // Next job to print
+    int                 iWorkerIdx;
+    int                 bTimePacket;
+    int                 bFlush;
+
+    pasuJobs    = (SuPcmJob *)calloc(JOB_SLOTS, sizeof(SuPcmJob));
+    pasuWorkers = (SuPcmWorker *)calloc(iThreads, sizeof(SuPcmWorker));
+    if ((pasuJobs == NULL) || (pasuWorkers == NULL))
+        {
+        fprintf(stderr, "Error allocating decode threads\n");
+        free(pasuJobs);
+        free(pasuWorkers);
+        return;
+        }
+
+    for (iWorkerIdx=0; iWorkerIdx<iThreads; iWorkerIdx++)
+        {
+        pasuWorkers[iWorkerIdx].pasuJobs         = pasuJobs;
+        pasuWorkers[iWorkerIdx].bDontSwapRawData = bDontSwapRawData;
+        pthread_create(&pasuWorkers[iWorkerIdx].hThread, NULL, pvWorkerThread, &pasuWorkers[iWorkerIdx]);
+        }
+
+    uNextJob = 0;
+    uNextOut = 0;
+    enStatus = I106_OK;
+    while (bTRUE)
+        {
+        // Read the next header. At the end of the file flush everything.
+        if (enStatus != I106_EOF)
+            enStatus = enPktFilter_ReadNextHeader(&m_suPktFilter, &suI106Hdr);
+        bFlush      = (enStatus != I106_OK);
+        bTimePacket = !bFlush && (suI106Hdr.ubyDataType == I106CH10_DTYPE_IRIG_TIME);
+        if (bTimePacket || 
+            (!bFlush &&
+             (suI106Hdr.ubyDataType == I106CH10_DTYPE_PCM_FMT_1) &&
+             ((uChannel == -1) || (uChannel == (int)suI106Hdr.uChID)) &&
+             (apsuChanInfo[suI106Hdr.uChID] != NULL)))
+            {
+            // Wait for a free job
+            while (uNextJob - uNextOut >= JOB_SLOTS)
+                {
+                psuJob = &pasuJobs[uNextOut & (JOB_SLOTS - 1)];
+                if (__atomic_load_n(&psuJob->uState, __ATOMIC_ACQUIRE) != JOB_DONE)
+                    {
+                    usleep(100);
+                    continue;
+                    }
+                vFinishJob(psuJob, psuOutFile);
+                uNextOut++;
+                }
+
+            // Read the packet straight into the job
+            psuJob = &pasuJobs[uNextJob & (JOB_SLOTS - 1)];
+            psuJob->suHdr = suI106Hdr;
+            if (psuJob->ulDataSize < suI106Hdr.ulPacketLen)
+                {
+                psuJob->pabyData   = (unsigned char *)realloc(psuJob->pabyData, suI106Hdr.ulPacketLen);
+                psuJob->ulDataSize = suI106Hdr.ulPacketLen;
+                }
+            enStatus = enPktFilter_ReadData(&m_suPktFilter, psuJob->ulDataSize, psuJob->pabyData);
+            if (enStatus != I106_OK)
+                {
+                enStatus = I106_EOF;
+                continue;
+                }
+
+            // Time is done when it is printed, PCM goes to a worker
+            if (bTimePacket)
+                {
+                psuJob->psuAttributes = NULL;
+                psuJob->uState        = JOB_DONE;
+                }
+            else
+                {
+                psuJob->psuAttributes = (SuPcmF1_Attributes *)apsuChanInfo[suI106Hdr.uChID]->psuAttributes;
+                psuJob->psuKernel     = &apsuChanInfo[suI106Hdr.uChID]->suKernel;
+                assert(psuJob->psuAttributes != NULL);
+                psuJob->uState        = JOB_QUEUED;
+
+                psuWorker = &pasuWorkers[suI106Hdr.uChID % iThreads];
+                psuWorker->auQueue[psuWorker->uHead & (JOB_SLOTS - 1)] = uNextJob;
+                __atomic_store_n(&psuWorker->uHead, psuWorker->uHead + 1, __ATOMIC_RELEASE);
+                }
+            uNextJob++;
+            } // end if packet to decode
+
+        // Print whatever is done, in order
+        while (uNextOut != uNextJob)
+            {
+            psuJob = &pasuJobs[uNextOut & (JOB_SLOTS - 1)];
+            if (__atomic_load_n(&psuJob->uState, __ATOMIC_ACQUIRE) != JOB_DONE)
+                {
+                if (!bFlush)
+                    break;
+                usleep(100);
+                continue;
+                }
+            vFinishJob(psuJob, psuOutFile);
+            uNextOut++;
+            }
+
+        if (bFlush)
+            break;
+        } // end while reading packets
+
+    if (enStatus == I106_EOF)
+        fprintf(stderr, "End of file\n");
+
+    // Stop the workers
+    for (iWorkerIdx=0; iWorkerIdx<iThreads; iWorkerIdx++)
+        {
+        __atomic_store_n(&pasuWorkers[iWorkerIdx].bStop, bTRUE, __ATOMIC_RELEASE);
+        pthread_join(pasuWorkers[iWorkerIdx].hThread, NULL);
+        }
+
+    for (uNextJob=0; uNextJob<JOB_SLOTS; uNextJob++)
+        {
+        free(pasuJobs[uNextJob].pabyData);
+        vFreePcmText(&pasuJobs[uNextJob].suText);
+        }
+    free(pasuJobs);
+    free(pasuWorkers);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Print a finished job, or for a time packet update the time reference,
+// and free the job
+
+void vFinishJob(SuPcmJob * psuJob, FILE * psuOutFile)
+    {
+    SuIrig106Time       suTime;
+
+    if (psuJob->psuAttributes == NULL)
+        {
+        enI106_Decode_TimeF1(&psuJob->suHdr, psuJob->pabyData, &suTime);
+        enI106_SetRelTime(m_iI106Handle, &suTime, psuJob->suHdr.aubyRefTime);
+        }
+    else
+        vWritePcmText(psuJob->suHdr.uChID, &psuJob->suText, psuOutFile);
+
+    psuJob->uState = JOB_FREE;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Decode queued PCM packets until told to stop
+
+void * pvWorkerThread(void * pvWorker)
+    {
+    SuPcmWorker       * psuWorker = (SuPcmWorker *)pvWorker;
+    SuPcmJob          * psuJob;
+    uint32_t            uTail;
+
+    uTail = psuWorker->uTail;
+    while (bTRUE)
+        {
+        if (uTail == __atomic_load_n(&psuWorker->uHead, __ATOMIC_ACQUIRE))
+            {
+            if (__atomic_load_n(&psuWorker->bStop, __ATOMIC_ACQUIRE))
+                break;
+            usleep(100);
+            continue;
+            }
+
+        psuJob = &psuWorker->pasuJobs[psuWorker->auQueue[uTail & (JOB_SLOTS - 1)]  & (JOB_SLOTS - 1)];
+        vDecodePcmPacket(&psuJob->suHdr, psuJob->pabyData, psuJob->psuAttributes, psuJob->psuKernel,
+                         psuWorker->bDontSwapRawData, &psuJob->suText);
+        __atomic_store_n(&psuJob->uState, JOB_DONE, __ATOMIC_RELEASE);
+
+        uTail++;
+        __atomic_store_n(&psuWorker->uTail, uTail, __ATOMIC_RELEASE);
+        }
+
+    return NULL;
+    }
+
+#endif
+
+
 
 /* ------------------------------------------------------------------------ */
 
@@ -707,10 +1729,21 @@ void vUsage(void)
     printf("   -v         Verbose (unused)               \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("   -s         Don't swap raw data            \n");
+    printf("   -j Num     Decode with Num threads        \n");
+    printf("   -p Names   Only these measurands, comma   \n");
+    printf("              separated, from TMATS D records\n");
+    printf("   -q Secs    Sync quality timeline, frames, \n");
+    printf("              parity errors, sync losses, and\n");
+    printf("              subframe ID gaps every Secs    \n");
+    printf("   -M         Time from a map of all time packets, \n");
+    printf("              read or made beside the data file \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("The output data fields are:                  \n");
     printf("Time  ChanID  Data Data ...                  \n");
+    printf("or with -p, comma separated:                 \n");
+    printf("Time,ChanID,Measurand,Measurand...           \n");
     }
 
 
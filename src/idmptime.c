@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 #include <assert.h>
 
 #include "config.h"
@@ -52,6 +53,8 @@
 #include "i106_decode_time.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -59,19 +62,57 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "02"
+#define MINOR_VERSION  "07"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
 #define bFALSE  (1==0)
 #endif
 
+#define MAX_CHANNELS    0x10000
+#define RTC_HZ          10000000.0  // Relative time counter rate
+#define RTC_MASK        0xffffffffffffLL
+#define DEFAULT_JUMP_MS 10          // Time steps off by more than this are jumps
+
 
 /*
  * Data structures
  * ---------------
  */
 
+// Time quality for one time channel. Time is fit against the relative time
+// counter with a running least squares so state doesn't grow with file size.
+// X is relative time and Y is time, both in seconds from the first packet.
+// Time jumps are counted and then taken out of Y so they don't spoil the fit.
+
+typedef struct
+    {
+    unsigned long       ulPackets;
+    int64_t             llLastRelTime;
+    double              dX;                 // Relative time, unwrapped
+    double              dFirstTime;         // Time of the first packet
+    double              dLastTime;          // Time of the last packet
+    double              dJumpOffset;        // Total of the jumps so far
+    double              dYearOffset;        // Day format year rollovers
+    int                 iLastYDay;
+    int                 iLastYear;          // Day, month, year format only
+    double              dMeanX;             // Least squares fit
+    double              dMeanY;
+    double              dCxx;
+    double              dCxy;
+    double              dCyy;
+    double              dMaxStepErr;        // Largest step error short of a jump
+    unsigned long       ulJumps;
+    unsigned long       ulSrcChanges;
+    unsigned long       ulFmtChanges;
+    unsigned long       ulLeapErrs;         // Events, not packets
+    int                 bLeapErr;           // Leap year flag is wrong now
+    unsigned int        uTimeSrc;
+    unsigned int        uTimeFmt;
+    unsigned int        uDateFmt;
+    unsigned int        bLeapYear;
+    } SuTimeStats;
+
 
 /*
  * Module data
@@ -83,6 +124,8 @@ int           m_usMaxBuffSize;
 
 int           m_iI106Handle;
 
+SuTimeStats * m_apsuTimeStats[MAX_CHANNELS];     // Made when first seen
+
 
 /*
  * Function prototypes
@@ -91,6 +134,13 @@ int           m_iI106Handle;
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
 void vUsage(void);
+void vAnalyzeTime(FILE * psuOutFile, unsigned int uChID, int64_t llRelTime,
+                  SuTimeF1_ChanSpec * psuChanSpec, void * pvTimeMsg, double dJumpSecs);
+void vPrintTimeStats(FILE * psuOutFile);
+int  bIsLeapYear(int iYear);
+long lDaysFromCivil(int iYear, int iMon, int iMDay);
+const char * szTimeSrcName(unsigned int uTimeSrc);
+const char * szTimeFmtName(unsigned int uTimeFmt);
 
 
 /* ------------------------------------------------------------------------ */
@@ -106,12 +156,16 @@ int main(int argc, char ** argv)
     unsigned long           lTimeMsgs = 0;    // Total time messages
     int                     bVerbose;
     int                     bPrintTMATS;
+    int                     bBlockRead;
+    SuPktFilter             suPktFilter;
     int                     bFoundIndex;
     SuPacketIndexInfo     * asuPacketIndex;
     uint32_t                uCurrIndex;
     uint32_t                uNumIndexes;
     int                     bTryIndex;
     int                     bUseIndex;
+    int                     bAnalyze;          // Time quality analysis
+    double                  dJumpMs;
 
     unsigned long           ulBuffSize = 0L;
     int64_t                 llRelTime;
@@ -151,6 +205,9 @@ int main(int argc, char ** argv)
     bTryIndex       = bFALSE;
     bUseIndex       = bFALSE;
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
+    bAnalyze        = bFALSE;
+    dJumpMs         = DEFAULT_JUMP_MS;
 
     szInFile[0]  = '\0';
     strcpy(szOutFile,"");                     // Default is stdout
@@ -176,10 +233,29 @@ int main(int argc, char ** argv)
                         bTryIndex = bTRUE;
                         break;
 
+                    case 'a' :                   /* Time quality analysis */
+                        bAnalyze = bTRUE;
+                        break;
+
+                    case 'j' :                   /* Jump threshold */
+                        iArgIdx++;
+                        if ((iArgIdx >= argc) || (sscanf(argv[iArgIdx],"%lf",&dJumpMs) != 1) || (dJumpMs <= 0.0))
+                            {
+                            vUsage();
+                            return 1;
+                            }
+                        bAnalyze = bTRUE;
+                        break;
+
                     case 'T' :                   /* Print TMATS flag */
                         bPrintTMATS = bTRUE;
                         break;
 
+                    case '-' :                   /* Long flags */
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } /* end flag switch */
@@ -255,8 +331,13 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Packets are read in big blocks with --block-read
+    vPktFilter_Init(&suPktFilter);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -269,7 +350,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -349,7 +430,7 @@ int main(int argc, char ** argv)
                 }
             } // end if use index
         else
-            enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+            enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -379,19 +460,33 @@ int main(int argc, char ** argv)
                     psuTimeDmy      = (SuTime_MsgDmyFmt *)((char *)pvBuff + sizeof(SuTimeF1_ChanSpec));
                     }
  
-                // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                // Read the data buffer. Index reads seek the library handle
+                // so the data has to come from there too.
+                if (bUseIndex == bTRUE)
+                    enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                else
+                    enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
                     break;
 
+                vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llRelTime);
+
+                // Analysis only prints things worth looking at
+                if (bAnalyze)
+                    {
+                    vAnalyzeTime(psuOutFile, suI106Hdr.uChID, llRelTime, psuChanSpecTime,
+                                 (char *)pvBuff + sizeof(SuTimeF1_ChanSpec), dJumpMs / 1000.0);
+                    lTimeMsgs++;
+                    break;
+                    }
+
                 fprintf(psuOutFile,"%3d ", suI106Hdr.uChID);
 
                 // Print Channel ID
 
                 // Print out the relative time value
-                vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llRelTime);
 //              fprintf(psuOutFile,"0x%12.12llx ", llRelTime);
                 fprintf(psuOutFile,"%14lld ", llRelTime);
 
@@ -511,11 +606,15 @@ int main(int argc, char ** argv)
 
     printf("\nTime Message %lu\n", lTimeMsgs);
 
+    if (bAnalyze)
+        vPrintTimeStats(psuOutFile);
+
 /*
  *  Close files
  */
 
     enI106Ch10Close(m_iI106Handle);
+    vPktFilter_Free(&suPktFilter);
     fclose(psuOutFile);
 
     return 0;
@@ -523,6 +622,278 @@ int main(int argc, char ** argv)
 
 
 
+/* ------------------------------------------------------------------------ */
+
+// Add a time packet to the time quality for its channel. Jumps, time source
+// and format changes, and leap year flag problems are printed as they're
+// found, with channel and relative time like the normal time dump.
+
+void vAnalyzeTime(FILE * psuOutFile, unsigned int uChID, int64_t llRelTime,
+                  SuTimeF1_ChanSpec * psuChanSpec, void * pvTimeMsg, double dJumpSecs)
+    {
+    SuTimeStats           * psuStats;
+    SuTime_MsgDayFmt      * psuTimeDay;
+    SuTime_MsgDmyFmt      * psuTimeDmy;
+    int64_t                 llRelDiff;
+    int                     iYDay;
+    int                     iYear;
+    int                     bLeapErr;
+    int                     bNewYear;           // Leap year flag may change
+    double                  dTime;
+    double                  dStepErr;
+    double                  dX;
+    double                  dY;
+    double                  dDeltaX;
+    double                  dDeltaY;
+
+    psuStats = m_apsuTimeStats[uChID];
+    if (psuStats == NULL)
+        {
+        psuStats = (SuTimeStats *)calloc(1, sizeof(SuTimeStats));
+        assert(psuStats != NULL);
+        m_apsuTimeStats[uChID] = psuStats;
+        }
+
+    // Time of day, plus the day. Day format has no year so years are counted
+    // from the first packet when day of year rolls over.
+    if (psuChanSpec->uDateFmt == 0)
+        {
+        psuTimeDay = (SuTime_MsgDayFmt *)pvTimeMsg;
+        iYDay = psuTimeDay->uHDn * 100 + psuTimeDay->uTDn * 10 + psuTimeDay->uDn;
+        if ((psuStats->ulPackets > 0) && (psuStats->uDateFmt == 0) &&
+            (iYDay == 1) && (psuStats->iLastYDay >= 365))
+            psuStats->dYearOffset += psuStats->iLastYDay * 86400.0;
+        psuStats->iLastYDay = iYDay;
+
+        dTime = psuStats->dYearOffset + (iYDay - 1) * 86400.0 +
+                (psuTimeDay->uTHn * 10 + psuTimeDay->uHn) * 3600.0 +
+                (psuTimeDay->uTMn * 10 + psuTimeDay->uMn) *   60.0 +
+                (psuTimeDay->uTSn * 10 + psuTimeDay->uSn) +
+                 psuTimeDay->uHmn * 0.1 + psuTimeDay->uTmn * 0.01;
+
+        bLeapErr = (iYDay == 366) && !psuChanSpec->bLeapYear;
+        bNewYear = (iYDay == 1);
+        }
+    else
+        {
+        psuTimeDmy = (SuTime_MsgDmyFmt *)pvTimeMsg;
+        iYear = psuTimeDmy->uOYn * 1000 + psuTimeDmy->uHYn * 100 +
+                psuTimeDmy->uTYn *   10 + psuTimeDmy->uYn;
+        dTime = lDaysFromCivil(iYear, psuTimeDmy->uTOn * 10 + psuTimeDmy->uOn,
+                                      psuTimeDmy->uTDn * 10 + psuTimeDmy->uDn) * 86400.0 +
+                (psuTimeDmy->uTHn * 10 + psuTimeDmy->uHn) * 3600.0 +
+                (psuTimeDmy->uTMn * 10 + psuTimeDmy->uMn) *   60.0 +
+                (psuTimeDmy->uTSn * 10 + psuTimeDmy->uSn) +
+                 psuTimeDmy->uHmn * 0.1 + psuTimeDmy->uTmn * 0.01;
+
+        bLeapErr = bIsLeapYear(iYear) != (psuChanSpec->bLeapYear != 0);
+        bNewYear = (psuStats->uDateFmt != 0) && (iYear != psuStats->iLastYear);
+        psuStats->iLastYear = iYear;
+        }
+
+    // First packet just sets the starting point
+    if (psuStats->ulPackets == 0)
+        {
+        psuStats->dFirstTime = dTime;
+        psuStats->uTimeSrc   = psuChanSpec->uTimeSrc;
+        psuStats->uTimeFmt   = psuChanSpec->uTimeFmt;
+        psuStats->uDateFmt   = psuChanSpec->uDateFmt;
+        psuStats->bLeapYear  = psuChanSpec->bLeapYear;
+        }
+
+    // Time should step the same as relative time. The relative time counter
+    // is 48 bits and can wrap.
+    else
+        {
+        llRelDiff = (llRelTime - psuStats->llLastRelTime) & RTC_MASK;
+        if (llRelDiff > (RTC_MASK >> 1))
+            llRelDiff -= RTC_MASK + 1;
+        dDeltaX = llRelDiff / RTC_HZ;
+        psuStats->dX += dDeltaX;
+
+        dStepErr = (dTime - psuStats->dLastTime) - dDeltaX;
+        if (fabs(dStepErr) > dJumpSecs)
+            {
+            psuStats->ulJumps++;
+            psuStats->dJumpOffset += dStepErr;
+            fprintf(psuOutFile,"%3d %14lld Time jump %+.3f sec\n", uChID, (long long)llRelTime, dStepErr);
+            }
+        else if (fabs(dStepErr) > psuStats->dMaxStepErr)
+            psuStats->dMaxStepErr = fabs(dStepErr);
+
+        if (psuChanSpec->uTimeSrc != psuStats->uTimeSrc)
+            {
+            psuStats->ulSrcChanges++;
+            fprintf(psuOutFile,"%3d %14lld Time source %s to %s\n", uChID, (long long)llRelTime,
+                szTimeSrcName(psuStats->uTimeSrc), szTimeSrcName(psuChanSpec->uTimeSrc));
+            psuStats->uTimeSrc = psuChanSpec->uTimeSrc;
+            }
+
+        if ((psuChanSpec->uTimeFmt != psuStats->uTimeFmt) ||
+            (psuChanSpec->uDateFmt != psuStats->uDateFmt))
+            {
+            psuStats->ulFmtChanges++;
+            fprintf(psuOutFile,"%3d %14lld Time format %s%s to %s%s\n", uChID, (long long)llRelTime,
+                szTimeFmtName(psuStats->uTimeFmt),   psuStats->uDateFmt   ? " DMY" : "",
+                szTimeFmtName(psuChanSpec->uTimeFmt), psuChanSpec->uDateFmt ? " DMY" : "");
+            psuStats->uTimeFmt = psuChanSpec->uTimeFmt;
+            psuStats->uDateFmt = psuChanSpec->uDateFmt;
+            }
+
+        // The leap year flag should only change at the start of a year
+        if ((psuChanSpec->bLeapYear != psuStats->bLeapYear) && !bNewYear)
+            {
+            psuStats->ulLeapErrs++;
+            fprintf(psuOutFile,"%3d %14lld Leap year flag changed mid year\n", uChID, (long long)llRelTime);
+            }
+        psuStats->bLeapYear = psuChanSpec->bLeapYear;
+        }
+
+    // Leap year flag that doesn't match the date, counted and printed once
+    // when it starts, the same as a flag change
+    if (bLeapErr && !psuStats->bLeapErr)
+        {
+        psuStats->ulLeapErrs++;
+        fprintf(psuOutFile,"%3d %14lld Leap year flag doesn't match date\n", uChID, (long long)llRelTime);
+        }
+    psuStats->bLeapErr = bLeapErr;
+
+    psuStats->llLastRelTime = llRelTime;
+    psuStats->dLastTime     = dTime;
+    psuStats->ulPackets++;
+
+    // Running least squares, kept as means and sums of products of
+    // differences from the means so it stays accurate over long files
+    dX      = psuStats->dX;
+    dY      = dTime - psuStats->dJumpOffset - psuStats->dFirstTime;
+    dDeltaX = dX - psuStats->dMeanX;
+    dDeltaY = dY - psuStats->dMeanY;
+    psuStats->dMeanX += dDeltaX / psuStats->ulPackets;
+    psuStats->dMeanY += dDeltaY / psuStats->ulPackets;
+    psuStats->dCxx   += dDeltaX * (dX - psuStats->dMeanX);
+    psuStats->dCxy   += dDeltaX * (dY - psuStats->dMeanY);
+    psuStats->dCyy   += dDeltaY * (dY - psuStats->dMeanY);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Print the time quality summary for each time channel. Drift is how fast the
+// relative time counter runs compared to time, positive if it's fast. Jitter
+// is the RMS difference from the fitted line.
+
+void vPrintTimeStats(FILE * psuOutFile)
+    {
+    unsigned int            uChanIdx;
+    SuTimeStats           * psuStats;
+    double                  dSlope;
+    double                  dDrift;
+    double                  dResidVar;
+    double                  dJitter;
+
+    fprintf(psuOutFile,"\nChan  Packets   Span (sec)  Drift (ppm)  Jitter (ms)  Max Step (ms)  Jumps  Src Chg  Fmt Chg  Leap Err\n");
+
+    for (uChanIdx=0; uChanIdx<MAX_CHANNELS; uChanIdx++)
+        {
+        psuStats = m_apsuTimeStats[uChanIdx];
+        if (psuStats == NULL)
+            continue;
+
+        fprintf(psuOutFile,"%4u %8lu %12.1f", uChanIdx, psuStats->ulPackets, psuStats->dX);
+
+        // Need a few points and some span for a fit
+        if ((psuStats->ulPackets > 2) && (psuStats->dCxx > 0.0) && (psuStats->dCxy > 0.0))
+            {
+            dSlope    = psuStats->dCxy / psuStats->dCxx;
+            dDrift    = (1.0 / dSlope - 1.0) * 1.0e6;
+            dResidVar = (psuStats->dCyy - psuStats->dCxy * dSlope) / (psuStats->ulPackets - 2);
+            dJitter   = dResidVar > 0.0 ? sqrt(dResidVar) : 0.0;
+            fprintf(psuOutFile,"  %11.3f  %11.3f", dDrift, dJitter * 1000.0);
+            }
+        else
+            fprintf(psuOutFile,"  %11s  %11s", "-", "-");
+
+        fprintf(psuOutFile,"  %13.3f  %5lu  %7lu  %7lu  %8lu\n", psuStats->dMaxStepErr * 1000.0,
+            psuStats->ulJumps, psuStats->ulSrcChanges, psuStats->ulFmtChanges, psuStats->ulLeapErrs);
+
+        free(psuStats);
+        m_apsuTimeStats[uChanIdx] = NULL;
+        } // end for all channels
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+int bIsLeapYear(int iYear)
+    {
+    return ((iYear % 4 == 0) && (iYear % 100 != 0)) || (iYear % 400 == 0);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Days from 1 Jan 1970 to a date, proleptic Gregorian calendar
+
+long lDaysFromCivil(int iYear, int iMon, int iMDay)
+    {
+    long                    lEra;
+    long                    lYearOfEra;
+    long                    lDayOfYear;
+    long                    lDayOfEra;
+
+    if (iMon <= 2)
+        iYear--;
+    lEra       = (iYear >= 0 ? iYear : iYear - 399) / 400;
+    lYearOfEra = iYear - lEra * 400;
+    lDayOfYear = (153 * (iMon > 2 ? iMon - 3 : iMon + 9) + 2) / 5 + iMDay - 1;
+    lDayOfEra  = lYearOfEra * 365 + lYearOfEra / 4 - lYearOfEra / 100 + lDayOfYear;
+
+    return lEra * 146097 + lDayOfEra - 719468;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+const char * szTimeSrcName(unsigned int uTimeSrc)
+    {
+    switch (uTimeSrc)
+        {
+        case I106_TIMESRC_INTERNAL     : return "Internal";
+        case I106_TIMESRC_EXTERNAL     : return "External";
+        case I106_TIMESRC_INTERNAL_RMM : return "Internal/RMM";
+        case I106_TIMESRC_NONE         : return "None";
+        default                        : return "Unknown";
+        }
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+const char * szTimeFmtName(unsigned int uTimeFmt)
+    {
+    switch (uTimeFmt)
+        {
+        case I106_TIMEFMT_IRIG_B     : return "IRIG-B";
+        case I106_TIMEFMT_IRIG_A     : return "IRIG-A";
+        case I106_TIMEFMT_IRIG_G     : return "IRIG-G";
+        case I106_TIMEFMT_INT_RTC    : return "Internal Clock";
+        case I106_TIMEFMT_GPS_UTC    : return "UTC From GPS";
+        case I106_TIMEFMT_GPS_NATIVE : return "Native GPS";
+        default                      : return "Unknown";
+        }
+    }
+
+
+
 /* ------------------------------------------------------------------------ */
 
 void vPrintTmats(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
@@ -596,6 +967,9 @@ void vUsage(void)
     printf("   -v         Verbose                        \n");
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("   -i         Use indexes if available       \n");
+    printf("   -a         Analyze time quality instead of dumping\n");
+    printf("   -j Msec    Analysis time jump threshold (default %d)\n", DEFAULT_JUMP_MS);
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("Time columns are:                            \n");
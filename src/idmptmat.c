@@ -48,6 +48,8 @@
 #include "irig106ch10.h"
 #include "i106_decode_tmats.h"
 
+#include "tmats_cache.h"
+
 
 /*
  * Macros and definitions
@@ -55,7 +57,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "03"
+#define MINOR_VERSION  "04"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -75,9 +77,9 @@
  */
 
 void    vDumpRaw(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile);
-void    vDumpTree(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile);
-void    vDumpChannel(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile);
-void    vDumpSig(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile);
+void    vDumpTree(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile);
+void    vDumpChannel(SuTmatsCache * psuTmatsCache, FILE * psuOutFile);
+void    vDumpSig(SuTmatsCache * psuTmatsCache, FILE * psuOutFile);
 void    vUsage(void);
 
 
@@ -94,11 +96,13 @@ int main(int argc, char ** argv)
     int                     bTreeOutput;
     int                     bChannelOutput;
     int                     bSigOutput;
+    int                     bUseCacheFile;
     unsigned long           ulBuffSize = 0L;
 
     int                     iI106Ch10Handle;
     EnI106Status            enStatus;
     SuI106Ch10Header        suI106Hdr;
+    SuTmatsCache            suTmatsCache;
 
     unsigned char         * pvBuff = NULL;
 
@@ -121,6 +125,7 @@ int main(int argc, char ** argv)
     bTreeOutput    = bFALSE;
     bChannelOutput = bFALSE;
     bSigOutput     = bFALSE;
+    bUseCacheFile  = bFALSE;
     szInFile[0]    = '\0';
     strcpy(szOutFile,"");       // Default is stdout
 
@@ -147,6 +152,10 @@ int main(int argc, char ** argv)
                         bChannelOutput = bTRUE;
                         break;
 
+                    case 'C' :                   // Channel table file
+                        bUseCacheFile = bTRUE;
+                        break;
+
 #if 0
 // SIGNATURE GENERATION ISN'T CORRECT. FIX LATER.
                     case 's' :                   // Signature
@@ -259,6 +268,40 @@ int main(int argc, char ** argv)
         return 1;
         }
 
+    // Decode TMATS once for all the output formats that need it. A channel
+    // summary alone can come from the channel table file.
+    vTmatsCache_Init(&suTmatsCache);
+    if ((bTreeOutput == bTRUE) || (bSigOutput == bTRUE))
+        {
+        enStatus = enTmatsCache_Decode(&suTmatsCache, &suI106Hdr, pvBuff);
+        if (enStatus != I106_OK) 
+            {
+            fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
+    if (bChannelOutput == bTRUE)
+        {
+        enStatus = enTmatsCache_ChanTable(&suTmatsCache, &suI106Hdr, pvBuff, 
+            bUseCacheFile ? szInFile : NULL);
+        if (enStatus != I106_OK) 
+            {
+            fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
+    if (bSigOutput == bTRUE)
+        {
+        enStatus = enTmatsCache_Signature(&suTmatsCache, &suI106Hdr, pvBuff);
+        if (enStatus != I106_OK) 
+            {
+            fprintf(stderr, " Error processing TMATS signature : Status = %d\n", enStatus);
+            return 1;
+            }
+        }
+
     // Generate output
     fprintf(psuOutFile, "IDMPTMAT "MAJOR_VERSION"."MINOR_VERSION"\n");
     fprintf(psuOutFile, "TMATS from file %s\n\n", szInFile);
@@ -267,15 +310,16 @@ int main(int argc, char ** argv)
         vDumpRaw(&suI106Hdr, pvBuff, psuOutFile);
 
     if (bTreeOutput == bTRUE)
-        vDumpTree(&suI106Hdr, pvBuff, psuOutFile);
+        vDumpTree(&suTmatsCache.suTmatsInfo, psuOutFile);
 
     if (bChannelOutput == bTRUE)
-        vDumpChannel(&suI106Hdr, pvBuff, psuOutFile);
+        vDumpChannel(&suTmatsCache, psuOutFile);
 
     if (bSigOutput == bTRUE)
-        vDumpSig(&suI106Hdr, pvBuff, psuOutFile);
+        vDumpSig(&suTmatsCache, psuOutFile);
 
     // Done so clean up
+    vTmatsCache_Free(&suTmatsCache);
     free(pvBuff);
     pvBuff = NULL;
 
@@ -305,35 +349,24 @@ void  vDumpRaw(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
 
 /* ------------------------------------------------------------------------ */
 
-void vDumpTree(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
+void vDumpTree(SuTmatsInfo * psuTmatsInfo, FILE * psuOutFile)
     {
-    EnI106Status            enStatus;
     int                     iGIndex;
     int                     iRIndex;
     int                     iRDsiIndex;
-    SuTmatsInfo             suTmatsInfo;
     SuGDataSource         * psuGDataSource;
     SuRRecord             * psuRRecord;
     SuRDataSource         * psuRDataSource;
 
-    // Process the TMATS info
-    memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-    enStatus = enI106_Decode_Tmats(psuI106Hdr, pvBuff, &suTmatsInfo);
-    if (enStatus != I106_OK) 
-        {
-        fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
-        return;
-        }
-
     // Print out the TMATS info
     // ------------------------
 
     // G record
-    fprintf(psuOutFile, "(G) Program Name - %s\n",suTmatsInfo.psuFirstGRecord->szProgramName);
-    fprintf(psuOutFile, "(G) IRIG 106 Rev - %s\n",suTmatsInfo.psuFirstGRecord->szIrig106Rev);
+    fprintf(psuOutFile, "(G) Program Name - %s\n",psuTmatsInfo->psuFirstGRecord->szProgramName);
+    fprintf(psuOutFile, "(G) IRIG 106 Rev - %s\n",psuTmatsInfo->psuFirstGRecord->szIrig106Rev);
 
     // Data sources
-    psuGDataSource = suTmatsInfo.psuFirstGRecord->psuFirstGDataSource;
+    psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource;
     do  {
         if (psuGDataSource == NULL) break;
 
@@ -341,10 +374,10 @@ void vDumpTree(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
         iGIndex = psuGDataSource->iIndex;
         fprintf(psuOutFile, "  (G\\DSI-%i) Data Source ID   - %s\n",
             psuGDataSource->iIndex,
-            suTmatsInfo.psuFirstGRecord->psuFirstGDataSource->szDataSourceID);
+            psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource->szDataSourceID);
         fprintf(psuOutFile, "  (G\\DST-%i) Data Source Type - %s\n",
             psuGDataSource->iIndex,
-            suTmatsInfo.psuFirstGRecord->psuFirstGDataSource->szDataSourceType);
+            psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource->szDataSourceType);
 
         // R record info
         psuRRecord = psuGDataSource->psuRRecord;
@@ -369,7 +402,7 @@ void vDumpTree(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
             } while (bTRUE);
 
 
-        psuGDataSource = suTmatsInfo.psuFirstGRecord->psuFirstGDataSource->psuNext;
+        psuGDataSource = psuTmatsInfo->psuFirstGRecord->psuFirstGDataSource->psuNext;
         } while (bTRUE);
 
 
@@ -380,68 +413,30 @@ void vDumpTree(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
 
 /* ------------------------------------------------------------------------ */
 
-void vDumpChannel(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
+void vDumpChannel(SuTmatsCache * psuTmatsCache, FILE * psuOutFile)
     {
-    EnI106Status            enStatus;
-    int                     iGIndex;
-    int                     iRIndex;
-//    int                     iRDsiIndex;
-    SuTmatsInfo             suTmatsInfo;
-    SuGDataSource         * psuGDataSource;
-    SuRRecord             * psuRRecord;
-    SuRDataSource         * psuRDataSource;
-
-    // Process the TMATS info
-    memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-    enStatus = enI106_Decode_Tmats(psuI106Hdr, pvBuff, &suTmatsInfo);
-    if (enStatus != I106_OK) 
-        {
-        fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
-        return;
-        }
+    uint32_t                uChanIdx;
+    SuTmatsChan           * psuChan;
 
     // Print out the TMATS info
     // ------------------------
 
     // G record
-    fprintf(psuOutFile, "Program Name - %s\n",suTmatsInfo.psuFirstGRecord->szProgramName);
-    fprintf(psuOutFile, "IRIG 106 Rev - %s\n",suTmatsInfo.psuFirstGRecord->szIrig106Rev);
+    fprintf(psuOutFile, "Program Name - %s\n",psuTmatsCache->szProgramName);
+    fprintf(psuOutFile, "IRIG 106 Rev - %s\n",psuTmatsCache->szIrig106Rev);
     fprintf(psuOutFile, "Channel  Type          Enabled   Data Source         \n");
     fprintf(psuOutFile, "-------  ------------  --------  --------------------\n");
 
-    // Data sources
-    psuGDataSource = suTmatsInfo.psuFirstGRecord->psuFirstGDataSource;
-    do  {
-        if (psuGDataSource == NULL) break;
-
-        // G record data source info
-        iGIndex = psuGDataSource->iIndex;
-
-        // R record info
-        psuRRecord = psuGDataSource->psuRRecord;
-        do  {
-            if (psuRRecord == NULL) break;
-            iRIndex = psuRRecord->iIndex;
-
-            // R record data sources
-            psuRDataSource = psuRRecord->psuFirstDataSource;
-            do  {
-                if (psuRDataSource == NULL) break;
-//                iRDsiIndex = psuRDataSource->iIndex;
-                fprintf(psuOutFile, " %5s ",   psuRDataSource->szTrackNumber);
-                fprintf(psuOutFile, "  %-12s", psuRDataSource->szChannelDataType);
-                fprintf(psuOutFile, "  %-8s",  psuRDataSource->szEnabled[0]=='T' ? "Enabled" : "Disabled");
-                fprintf(psuOutFile, "  %-20s", psuRDataSource->szDataSourceID);
-                fprintf(psuOutFile, "\n");
-                psuRDataSource = psuRDataSource->psuNext;
-                } while (bTRUE);
-
-            psuRRecord = psuRRecord->psuNext;
-            } while (bTRUE);
-
-
-        psuGDataSource = suTmatsInfo.psuFirstGRecord->psuFirstGDataSource->psuNext;
-        } while (bTRUE);
+    // Channels from the R records
+    for (uChanIdx=0; uChanIdx<psuTmatsCache->uNumChans; uChanIdx++)
+        {
+        psuChan = &psuTmatsCache->pasuChans[uChanIdx];
+        fprintf(psuOutFile, " %5u ",   psuChan->uChanID);
+        fprintf(psuOutFile, "  %-12s", psuChan->szChanType);
+        fprintf(psuOutFile, "  %-8s",  psuChan->bEnabled ? "Enabled" : "Disabled");
+        fprintf(psuOutFile, "  %-20s", psuChan->szDataSourceID);
+        fprintf(psuOutFile, "\n");
+        }
 
     return;
     }
@@ -450,37 +445,14 @@ void vDumpChannel(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFil
 
 /* ------------------------------------------------------------------------ */
 
-void    vDumpSig(SuI106Ch10Header * psuI106Hdr, void * pvBuff, FILE * psuOutFile)
+void    vDumpSig(SuTmatsCache * psuTmatsCache, FILE * psuOutFile)
     {
-    EnI106Status            enStatus;
-    SuTmatsInfo             suTmatsInfo;
-    uint16_t                iOpCode;
-    uint32_t                iSignature;
-
-    // Process the TMATS info
-    memset( &suTmatsInfo, 0, sizeof(suTmatsInfo) );
-    enStatus = enI106_Decode_Tmats(psuI106Hdr, pvBuff, &suTmatsInfo);
-    if (enStatus != I106_OK) 
-        {
-        fprintf(stderr, " Error processing TMATS record : Status = %d\n", enStatus);
-        return;
-        }
-
-    // THE FIRST PARAMETER IS WRONG. FIX LATER.
-    enStatus = enI106_Tmats_Signature(&((char *)pvBuff)[4], psuI106Hdr->ulDataLen-4, TMATS_SIGVER_DEFAULT, TMATS_SIGFLAG_NONE, &iOpCode, &iSignature);
-    if (enStatus != I106_OK) 
-        {
-        fprintf(stderr, " Error processing TMATS signature : Status = %d\n", enStatus);
-        return;
-        }
-
-
     // Print out the TMATS info
     // ------------------------
 
     // G record
-    fprintf(psuOutFile, "(G) Program Name - %s\n",suTmatsInfo.psuFirstGRecord->szProgramName);
-    fprintf(psuOutFile, "%2.2X-%8.8X\n", iOpCode, iSignature);
+    fprintf(psuOutFile, "(G) Program Name - %s\n",psuTmatsCache->szProgramName);
+    fprintf(psuOutFile, "%2.2X-%8.8X\n", psuTmatsCache->uOpCode, psuTmatsCache->ulSignature);
 
     return;
     }
@@ -498,6 +470,7 @@ void vUsage(void)
     printf("  -c      Output channel summary format (default)\n");
     printf("  -t      Output tree view format\n");
     printf("  -r      Output raw TMATS\n");
+    printf("  -C      Read or make a channel table file beside the data file\n");
 //  printf("  -s      Output TMATS signature\n");
     return;
     }
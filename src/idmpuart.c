@@ -51,6 +51,8 @@
 #include "i106_decode_uart.h"
 #include "i106_decode_tmats.h"
 
+#include "pkt_filter.h"
+
 
 /*
  * Macros and definitions
@@ -58,7 +60,7 @@
  */
 
 #define MAJOR_VERSION  "01"
-#define MINOR_VERSION  "00"
+#define MINOR_VERSION  "02"
 
 #if !defined(bTRUE)
 #define bTRUE   (1==1)
@@ -111,6 +113,7 @@ int main(int argc, char ** argv)
     int                     iWordIdx;
 
     int                     bPrintTMATS;
+    int                     bBlockRead;
     int                     bPrintRTC;
     unsigned long           ulBuffSize = 0L;
 
@@ -120,6 +123,7 @@ int main(int argc, char ** argv)
     unsigned char         * pvBuff  = NULL;
     SuUartF0_CurrMsg        suUartMsg;
     SuTmatsInfo             suTmatsInfo;
+    SuPktFilter             suPktFilter;
 
 
 /*
@@ -137,6 +141,7 @@ int main(int argc, char ** argv)
     bVerbose        = bFALSE;            // No verbosity
     bString         = bFALSE;
     bPrintTMATS     = bFALSE;
+    bBlockRead      = bFALSE;
     bPrintRTC       = bFALSE;
 
     szInFile[0]  = '\0';
@@ -171,6 +176,11 @@ int main(int argc, char ** argv)
                         bPrintRTC = bTRUE;
                         break;
 
+                    case '-' :                   // Long flags
+                        if (strcmp(argv[iArgIdx], "--block-read") == 0)
+                            bBlockRead = bTRUE;
+                        break;
+
                     default :
                         break;
                     } // end flag switch
@@ -253,8 +263,15 @@ int main(int argc, char ** argv)
  * Read the first header. If TMATS flag set, print TMATS and exit
  */
 
+    // Only UART packets are read, the rest are skipped over in big blocks.
+    // With --block-read the blocks are 8 MB instead of 1 MB.
+    vPktFilter_Init(&suPktFilter);
+    enPktFilter_Add(&suPktFilter, iChannel, I106CH10_DTYPE_UART_FMT_0);
+    vPktFilter_BlockRead(&suPktFilter, bBlockRead);
+    enPktFilter_Open(&suPktFilter, m_iI106Handle, szInFile);
+
     // Read first header and check for data read errors
-    enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+    enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
     if (enStatus != I106_OK)
         return 1;
 
@@ -267,7 +284,7 @@ int main(int argc, char ** argv)
             pvBuff = malloc(suI106Hdr.ulPacketLen);
 
             // Read the data buffer and check for read errors
-            enStatus = enI106Ch10ReadData(m_iI106Handle, suI106Hdr.ulPacketLen, pvBuff);
+            enStatus = enPktFilter_ReadData(&suPktFilter, suI106Hdr.ulPacketLen, pvBuff);
             if (enStatus != I106_OK)
                 return 1;
 
@@ -303,7 +320,7 @@ int main(int argc, char ** argv)
         {
 
         // Read the next header
-        enStatus = enI106Ch10ReadNextHeader(m_iI106Handle, &suI106Hdr);
+        enStatus = enPktFilter_ReadNextHeader(&suPktFilter, &suI106Hdr);
 
         // Setup a one time loop to make it easy to break out on error
         do
@@ -328,7 +345,7 @@ int main(int argc, char ** argv)
                     }
 
                 // Read the data buffer
-                enStatus = enI106Ch10ReadData(m_iI106Handle, ulBuffSize, pvBuff);
+                enStatus = enPktFilter_ReadData(&suPktFilter, ulBuffSize, pvBuff);
 
                 // Check for data read errors
                 if (enStatus != I106_OK)
@@ -424,6 +441,7 @@ int main(int argc, char ** argv)
 
     enI106Ch10Close(m_iI106Handle);
     fclose(psuOutFile);
+    vPktFilter_Free(&suPktFilter);
 
     return 0;
     }
@@ -505,6 +523,7 @@ void vUsage(void)
     printf("   -c ChNum   Channel Number (default all)   \n");
     printf("   -s         Print out data as ASCII string \n");
     printf("   -R         Print Relative Time Counter    \n");
+    printf("   --block-read  Read the data file in 8 MB blocks\n");
     printf("   -T         Print TMATS summary and exit   \n");
     printf("                                             \n");
     printf("The output data fields are:                  \n");
@@ -0,0 +1,251 @@
+/*==========================================================================
+
+  out_buff.c - Block buffered text output, Ctrl-C handling, and fixed size
+    binary record files for the dump utilities
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <signal.h>
+#include <time.h>
+
+#include "i106_stdint.h"
+
+#include "out_buff.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+
+/*
+ * Module data
+ * -----------
+ */
+
+static volatile sig_atomic_t m_bStop = bFALSE;   // Set by Ctrl-C
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static void vSigStop(int iSignal);
+
+
+/* ------------------------------------------------------------------------ */
+
+// Set up the output buffering and stop cleanly on Ctrl-C so buffered output
+// isn't lost. Stdout keeps the usual buffering, line at a time to a terminal
+// and blocks to a pipe.
+
+void vOutBuff_Setup(SuOutBuff * psuOutBuff, FILE * psuFile, int bLineBuffered)
+    {
+    psuOutBuff->psuFile       = psuFile;
+    psuOutBuff->bLineBuffered = bLineBuffered;
+    psuOutBuff->lLastFlush    = time(NULL);
+
+    if (bLineBuffered)
+        setvbuf(psuFile, NULL, _IOLBF, BUFSIZ);
+    else if (psuFile != stdout)
+        setvbuf(psuFile, NULL, _IOFBF, OUT_BUFF_SIZE);
+
+    signal(SIGINT, vSigStop);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Don't let block output sit in the buffer too long. Call this once a
+// packet, not once a line.
+
+void vOutBuff_Poll(SuOutBuff * psuOutBuff)
+    {
+    if (!psuOutBuff->bLineBuffered && (time(NULL) - psuOutBuff->lLastFlush >= OUT_FLUSH_SECS))
+        {
+        fflush(psuOutBuff->psuFile);
+        psuOutBuff->lLastFlush = time(NULL);
+        }
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// True once Ctrl-C has been hit. Stop at the end of the current packet so
+// output files get flushed and closed.
+
+int bOutBuff_Stopped(void)
+    {
+    return m_bStop;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static void vSigStop(int iSignal)
+    {
+    m_bStop = bTRUE;
+    signal(iSignal, SIG_DFL);       // A second Ctrl-C stops right away
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vBinOut_Init(SuBinOut * psuBinOut)
+    {
+    memset(psuBinOut, 0, sizeof(SuBinOut));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Open a binary output file and write a header. The record count gets
+// filled in when the file is closed.
+
+int bBinOut_Open(SuBinOut * psuBinOut, const char * szFileName, const char * szMagic,
+                 uint32_t ulVersion, uint32_t ulRecordSize)
+    {
+    SuBinOutHeader      suBinHdr;
+
+    psuBinOut->pabyRecords = (uint8_t *)malloc(BIN_OUT_BLOCK_RECS * ulRecordSize);
+    if (psuBinOut->pabyRecords == NULL)
+        return bFALSE;
+
+    psuBinOut->psuFile = fopen(szFileName, "wb");
+    if (psuBinOut->psuFile == NULL)
+        {
+        free(psuBinOut->pabyRecords);
+        psuBinOut->pabyRecords = NULL;
+        return bFALSE;
+        }
+
+    // Records are already written in big blocks
+    setvbuf(psuBinOut->psuFile, NULL, _IONBF, 0);
+
+    psuBinOut->ulRecordSize    = ulRecordSize;
+    psuBinOut->uNumRecords     = 0;
+    psuBinOut->ullTotalRecords = 0;
+
+    memset(&suBinHdr, 0, sizeof(suBinHdr));
+    memcpy(suBinHdr.szMagic, szMagic, sizeof(suBinHdr.szMagic));
+    suBinHdr.ulVersion    = ulVersion;
+    suBinHdr.ulHeaderSize = sizeof(SuBinOutHeader);
+    suBinHdr.ulRecordSize = ulRecordSize;
+    fwrite(&suBinHdr, sizeof(suBinHdr), 1, psuBinOut->psuFile);
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get a zeroed record to fill in. Records pile up and get written a block
+// at a time.
+
+void * pvBinOut_NewRecord(SuBinOut * psuBinOut)
+    {
+    void              * pvRec;
+
+    if (psuBinOut->uNumRecords == BIN_OUT_BLOCK_RECS)
+        vBinOut_Flush(psuBinOut);
+
+    pvRec = &psuBinOut->pabyRecords[psuBinOut->uNumRecords * psuBinOut->ulRecordSize];
+    memset(pvRec, 0, psuBinOut->ulRecordSize);
+    psuBinOut->uNumRecords++;
+
+    return pvRec;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Write out the records waiting in the buffer
+
+void vBinOut_Flush(SuBinOut * psuBinOut)
+    {
+    if (psuBinOut->uNumRecords == 0)
+        return;
+
+    fwrite(psuBinOut->pabyRecords, psuBinOut->ulRecordSize, psuBinOut->uNumRecords, psuBinOut->psuFile);
+    psuBinOut->ullTotalRecords += psuBinOut->uNumRecords;
+    psuBinOut->uNumRecords      = 0;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Write out what's left, update the record count in the header, and close
+
+void vBinOut_Close(SuBinOut * psuBinOut)
+    {
+    if (psuBinOut->psuFile == NULL)
+        return;
+
+    vBinOut_Flush(psuBinOut);
+
+    fseek(psuBinOut->psuFile, (long)offsetof(SuBinOutHeader, ullRecords), SEEK_SET);
+    fwrite(&psuBinOut->ullTotalRecords, sizeof(uint64_t), 1, psuBinOut->psuFile);
+    fclose(psuBinOut->psuFile);
+
+    free(psuBinOut->pabyRecords);
+    vBinOut_Init(psuBinOut);
+
+    return;
+    }
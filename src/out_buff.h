@@ -0,0 +1,113 @@
+/*==========================================================================
+
+  out_buff.h - Block buffered text output, Ctrl-C handling, and fixed size
+    binary record files for the dump utilities
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _OUT_BUFF_H
+#define _OUT_BUFF_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "i106_stdint.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define OUT_BUFF_SIZE       0x100000    // Output buffer size for block output
+#define OUT_FLUSH_SECS      2           // Flush block output at least this often
+#define BIN_OUT_BLOCK_RECS  1024        // Binary records written at a time
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// Binary output is a file header followed by fixed size records. Fields are
+// laid out on their natural boundaries so the layout is the same packed or
+// not. Values are in host byte order, little endian on the PCs these run on.
+
+typedef struct
+    {
+    char            szMagic[8];         // Identifies the record type, like "I1553BIN"
+    uint32_t        ulVersion;          // File format version
+    uint32_t        ulHeaderSize;       // Size of this header
+    uint32_t        ulRecordSize;       // Size of each record
+    uint32_t        ulReserved;
+    uint64_t        ullRecords;         // Number of records that follow
+    uint8_t         abyReserved[32];
+    } SuBinOutHeader;                   // 64 bytes
+
+// Text output written in big blocks unless it's being watched live
+typedef struct
+    {
+    FILE              * psuFile;
+    int                 bLineBuffered;
+    time_t              lLastFlush;
+    } SuOutBuff;
+
+// An open binary output file
+typedef struct
+    {
+    FILE              * psuFile;
+    uint8_t           * pabyRecords;    // Records waiting to be written
+    uint32_t            ulRecordSize;
+    unsigned int        uNumRecords;
+    uint64_t            ullTotalRecords;
+    } SuBinOut;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vOutBuff_Setup(SuOutBuff * psuOutBuff, FILE * psuFile, int bLineBuffered);
+void            vOutBuff_Poll(SuOutBuff * psuOutBuff);
+int             bOutBuff_Stopped(void);
+
+void            vBinOut_Init(SuBinOut * psuBinOut);
+int             bBinOut_Open(SuBinOut * psuBinOut, const char * szFileName, const char * szMagic,
+                             uint32_t ulVersion, uint32_t ulRecordSize);
+void          * pvBinOut_NewRecord(SuBinOut * psuBinOut);
+void            vBinOut_Flush(SuBinOut * psuBinOut);
+void            vBinOut_Close(SuBinOut * psuBinOut);
+
+#endif
@@ -0,0 +1,868 @@
+/*==========================================================================
+
+  pcm_decom.c - Pull PCM measurands out of minor frames using a plan made
+    from the TMATS D and C records
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+/*
+The TMATS D record says where each measurand is in the PCM frame: which
+word, which minor frames, and which bits, possibly in several fragments.
+Working that out for every frame is slow, so a channel's requested
+measurands are compiled once into a flat list of taps. Each tap reads one
+word of the minor frame, so pulling a few measurands out of a large frame
+only touches the words they are in. Supercommutated measurands have more
+than one sample per minor frame, subcommutated ones only appear in some
+minor frames, picked by the subframe ID counter from the P record.
+
+Word and frame positions are 1 based in TMATS. The decoder output starts
+with the first word after the minor frame sync so word position 1 is index
+0. Bit masks are read with the rightmost character as the word LSB, and
+are limited to the data bits of the word so the taps can work on words
+that haven't been through the parity check and mask.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "tmats_attr.h"
+#include "pcm_decom.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define MAX_FRAGMENTS       16
+#define COLUMN_TEXT_LEN     24          // ',' and the longest value
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static const char * szLinkName(SuTmatsAttrs * psuAttrs, unsigned int uChanID);
+static int          iFindRecord(SuTmatsAttrs * psuAttrs, char chRecType, const char * szCodeName, const char * szValue);
+static int          iGetInt(const char * szValue, int iDefault);
+static const char * szGetLoc(SuTmatsAttrs * psuAttrs, const char * szCode, int iDIdx, int iList, int iMeas, 
+                             int iLoc, int iFrag, int iNumFrags);
+static EnI106Status enAddMeasurand(SuPcmDecom * psuDecom, SuTmatsAttrs * psuAttrs, int iDIdx, int iList, int iMeas,
+                                   const char * szName, uint32_t uColumn, uint64_t ullWordMask);
+static EnI106Status enAddTap(SuPcmDecom * psuDecom, SuDecomTap * psuTap);
+static void         vGetConversion(SuTmatsAttrs * psuAttrs, SuDecomParam * psuParam);
+static uint64_t     ullParseMask(const char * szMask, uint64_t ullWordMask);
+static uint64_t     ullGather(uint64_t ullWord, uint64_t ullMask);
+static char       * pchFormatValue(SuDecomParam * psuParam, uint64_t ullRaw, char * pchText);
+
+
+/* ======================================================================== */
+
+// Get the minor frames per major frame and the subframe ID counter from the
+// P record for a channel's PCM link. Without a P record it is one minor
+// frame per major frame and no counter.
+
+void vPcmDecom_GetFormat(SuTmatsAttrs * psuAttrs, unsigned int uChanID, uint32_t uWordLen, 
+                         uint32_t uWordsInMinorFrame, SuPcmFrameFormat * psuFormat)
+    {
+    const char        * szLink;
+    const char        * szValue;
+    int                 iPIdx;
+    int                 iWordPos;
+    int                 iStartBit;
+    int                 iBits;
+
+    memset(psuFormat, 0, sizeof(SuPcmFrameFormat));
+    psuFormat->uMinorFrames = 1;
+
+    szLink = szLinkName(psuAttrs, uChanID);
+    if (szLink == NULL)
+        return;
+    iPIdx = iFindRecord(psuAttrs, 'P', "DLN", szLink);
+    if (iPIdx < 0)
+        return;
+
+    psuFormat->uMinorFrames = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\MF\\N", iPIdx), 1);
+    if (psuFormat->uMinorFrames < 1)
+        psuFormat->uMinorFrames = 1;
+
+    if (iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\ISF\\N", iPIdx), 0) < 1)
+        return;
+
+    // Only the first counter is used
+    iWordPos  = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC1-1", iPIdx), 0);
+    iStartBit = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC3-1", iPIdx), 1);
+    iBits     = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC4-1", iPIdx), uWordLen);
+    if ((iWordPos < 1) || ((uint32_t)iWordPos > uWordsInMinorFrame) || (iBits < 1) || (iBits >= 32) ||
+        (iStartBit < 1) || (iStartBit - 1 + iBits > (int)uWordLen))
+        return;
+
+    psuFormat->bHaveSfid      = bTRUE;
+    psuFormat->uSfidWordIdx   = iWordPos - 1;
+    psuFormat->uSfidShift     = uWordLen - (iStartBit - 1) - iBits;
+    psuFormat->ullSfidMask    = (1ULL << iBits) - 1;
+    szValue = szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC10-1", iPIdx);
+    psuFormat->bSfidDown      = (szValue != NULL) && (strcasecmp(szValue, "DEC") == 0);
+    psuFormat->uSfidInitValue = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC6-1", iPIdx), 0);
+    psuFormat->uSfidInitFrame = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC7-1", iPIdx), 1) - 1;
+    psuFormat->uSfidEndValue  = iGetInt(szTmatsAttr_Getf(psuAttrs, "P-%d\\IDC8-1", iPIdx), 
+        (int)((psuFormat->bSfidDown ? psuFormat->uSfidInitValue - (psuFormat->uMinorFrames - 1)
+                                    : psuFormat->uSfidInitValue + (psuFormat->uMinorFrames - 1)) & psuFormat->ullSfidMask));
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The subframe ID counter value in a minor frame
+
+uint32_t uPcmDecom_Sfid(SuPcmFrameFormat * psuFormat, const uint64_t * paullWords)
+    {
+    return (uint32_t)((paullWords[psuFormat->uSfidWordIdx] >> psuFormat->uSfidShift) & psuFormat->ullSfidMask);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The subframe ID counter value expected in the minor frame after one with
+// uSfid, starting over after the end value
+
+uint32_t uPcmDecom_NextSfid(SuPcmFrameFormat * psuFormat, uint32_t uSfid)
+    {
+    if (uSfid == psuFormat->uSfidEndValue)
+        return psuFormat->uSfidInitValue;
+    if (psuFormat->bSfidDown)
+        return (uint32_t)((uSfid - 1) & psuFormat->ullSfidMask);
+    return (uint32_t)((uSfid + 1) & psuFormat->ullSfidMask);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vPcmDecom_Init(SuPcmDecom * psuDecom)
+    {
+    memset(psuDecom, 0, sizeof(SuPcmDecom));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make the extraction plan for one PCM channel. Columns are numbered by the
+// order of aszNames, which can include measurands on other channels. A
+// channel with none of the requested measurands ends up with no params.
+// uWordLen and ullWordMask are the common word length and data mask from
+// the channel's PCM attributes.
+
+EnI106Status enPcmDecom_Compile(SuPcmDecom * psuDecom, SuTmatsAttrs * psuAttrs, unsigned int uChanID,
+                                uint32_t uWordLen, uint64_t ullWordMask, uint32_t uWordsInMinorFrame,
+                                const char * const aszNames[], unsigned int uNumNames)
+    {
+    EnI106Status        enStatus;
+    SuTmatsAttr       * psuAttr;
+    const char        * szLink;
+    int                 iDIdx;
+    int                 iList;
+    int                 iMeas;
+    int                 iLen;
+    uint32_t            uAttrIdx;
+    uint32_t            uNameIdx;
+    uint32_t            uTapIdx;
+    uint32_t            uSlots;
+
+    vPcmDecom_Free(psuDecom);
+    psuDecom->uChanID            = uChanID;
+    psuDecom->uWordsInMinorFrame = uWordsInMinorFrame;
+    psuDecom->uNumColumns        = uNumNames;
+    if ((ullWordMask == 0) && (uWordLen >= 1) && (uWordLen < 64))
+        ullWordMask = (1ULL << uWordLen) - 1;
+
+    psuDecom->paiColumnParam = (int32_t *)malloc((uNumNames + 1) * sizeof(int32_t));
+    if (psuDecom->paiColumnParam == NULL)
+        return I106_BUFFER_TOO_SMALL;
+    for (uNameIdx=0; uNameIdx<uNumNames; uNameIdx++)
+        psuDecom->paiColumnParam[uNameIdx] = -1;
+
+    // The R record names the PCM data link, the D record for that link
+    // has the measurand locations
+    szLink = szLinkName(psuAttrs, uChanID);
+    if (szLink == NULL)
+        return I106_OK;
+
+    iDIdx = iFindRecord(psuAttrs, 'D', "DLN", szLink);
+    if (iDIdx < 0)
+        return I106_OK;
+
+    vPcmDecom_GetFormat(psuAttrs, uChanID, uWordLen, uWordsInMinorFrame, &psuDecom->suFormat);
+
+    // Look through the D record measurand names, "D-x\MN-y-n"
+    for (uAttrIdx=0; uAttrIdx<psuAttrs->uNumAttrs; uAttrIdx++)
+        {
+        psuAttr = &psuAttrs->pasuAttrs[uAttrIdx];
+        if ((psuAttr->chRecType != 'D') || (psuAttr->iRecIdx != iDIdx))
+            continue;
+        iLen = 0;
+        if ((sscanf(psuAttr->szCodeName, "MN-%d-%d%n", &iList, &iMeas, &iLen) != 2) || 
+            (psuAttr->szCodeName[iLen] != '\0'))
+            continue;
+
+        for (uNameIdx=0; uNameIdx<uNumNames; uNameIdx++)
+            {
+            if ((psuDecom->paiColumnParam[uNameIdx] == -1) && (strcmp(aszNames[uNameIdx], psuAttr->szValue) == 0))
+                {
+                enStatus = enAddMeasurand(psuDecom, psuAttrs, iDIdx, iList, iMeas, psuAttr->szValue, 
+                                          uNameIdx, ullWordMask);
+                if (enStatus != I106_OK)
+                    {
+                    vPcmDecom_Free(psuDecom);
+                    return enStatus;
+                    }
+                break;
+                }
+            } // end for all requested names
+        } // end for all attributes
+
+    // Sample values are laid out one row of params per sample in the frame
+    for (uTapIdx=0; uTapIdx<psuDecom->uNumTaps; uTapIdx++)
+        {
+        if (psuDecom->pasuTaps[uTapIdx].uOcc + 1 > psuDecom->uMaxOccs)
+            psuDecom->uMaxOccs = psuDecom->pasuTaps[uTapIdx].uOcc + 1;
+        }
+    for (uTapIdx=0; uTapIdx<psuDecom->uNumTaps; uTapIdx++)
+        psuDecom->pasuTaps[uTapIdx].uSlot = psuDecom->pasuTaps[uTapIdx].uOcc * psuDecom->uNumParams +
+                                            psuDecom->pasuTaps[uTapIdx].uParam;
+
+    uSlots = psuDecom->uMaxOccs * psuDecom->uNumParams;
+    psuDecom->paullValue  = (uint64_t *)calloc(uSlots + 1, sizeof(uint64_t));
+    psuDecom->pabySampled = (uint8_t  *)calloc(uSlots + 1, sizeof(uint8_t));
+    if ((psuDecom->paullValue == NULL) || (psuDecom->pabySampled == NULL))
+        {
+        vPcmDecom_Free(psuDecom);
+        return I106_BUFFER_TOO_SMALL;
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Run the plan over one minor frame of masked data words. Returns the number
+// of output rows, more than one if a supercommutated measurand has more
+// than one sample in this frame, 0 if nothing was sampled.
+
+int iPcmDecom_Frame(SuPcmDecom * psuDecom, const uint64_t * paullWords)
+    {
+    SuDecomTap        * psuTap;
+    SuDecomTap        * psuTapEnd;
+    uint32_t            uFrame;
+    uint32_t            uCount;
+    uint64_t            ullBits;
+    int                 iRows;
+
+    // Which minor frame of the major frame this is. Without a subframe ID
+    // counter just count frames from the start of the data.
+    if (psuDecom->suFormat.bHaveSfid)
+        {
+        uCount = uPcmDecom_Sfid(&psuDecom->suFormat, paullWords);
+        if (psuDecom->suFormat.bSfidDown)
+            uCount = (uint32_t)((psuDecom->suFormat.uSfidInitValue - uCount) & psuDecom->suFormat.ullSfidMask);
+        else
+            uCount = (uint32_t)((uCount - psuDecom->suFormat.uSfidInitValue) & psuDecom->suFormat.ullSfidMask);
+        uFrame = (uCount + psuDecom->suFormat.uSfidInitFrame) % psuDecom->suFormat.uMinorFrames;
+        }
+    else
+        uFrame = psuDecom->uFrameCount % psuDecom->suFormat.uMinorFrames;
+    psuDecom->uFrameCount++;
+
+    memset(psuDecom->pabySampled, 0, psuDecom->uMaxOccs * psuDecom->uNumParams);
+    iRows = 0;
+
+    psuTapEnd = psuDecom->pasuTaps + psuDecom->uNumTaps;
+    for (psuTap = psuDecom->pasuTaps; psuTap < psuTapEnd; psuTap++)
+        {
+        if ((psuTap->uFrameInterval != 0) && ((uFrame % psuTap->uFrameInterval) != psuTap->uFramePhase))
+            continue;
+
+        if (psuTap->ullScatter == 0)
+            ullBits = (paullWords[psuTap->uWordIdx] >> psuTap->uShift) & psuTap->ullMask;
+        else
+            ullBits = ullGather(paullWords[psuTap->uWordIdx], psuTap->ullScatter);
+
+        // Fragments can be in different minor frames so the partial value
+        // is kept from one frame to the next
+        if (psuTap->bFirst)
+            psuDecom->paullValue[psuTap->uSlot] = ullBits;
+        else
+            psuDecom->paullValue[psuTap->uSlot] = (psuDecom->paullValue[psuTap->uSlot] << psuTap->uBits) | ullBits;
+
+        if (psuTap->bLast)
+            {
+            psuDecom->pabySampled[psuTap->uSlot] = 1;
+            if ((int)psuTap->uOcc >= iRows)
+                iRows = psuTap->uOcc + 1;
+            }
+        } // end for all taps
+
+    return iRows;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Longest text pchPcmDecom_Row() can make
+
+uint32_t ulPcmDecom_RowLen(SuPcmDecom * psuDecom)
+    {
+    return psuDecom->uNumColumns * COLUMN_TEXT_LEN + 2;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Format one row of samples from the last frame as ",value,value...\n".
+// Columns for measurands without a sample in this row are empty.
+
+char * pchPcmDecom_Row(SuPcmDecom * psuDecom, int iRow, char * pchText)
+    {
+    uint32_t            uColumn;
+    uint32_t            uSlot;
+    int32_t             iParam;
+
+    for (uColumn=0; uColumn<psuDecom->uNumColumns; uColumn++)
+        {
+        *pchText++ = ',';
+        iParam = psuDecom->paiColumnParam[uColumn];
+        if (iParam < 0)
+            continue;
+        uSlot = iRow * psuDecom->uNumParams + iParam;
+        if (psuDecom->pabySampled[uSlot])
+            pchText = pchFormatValue(&psuDecom->pasuParams[iParam], psuDecom->paullValue[uSlot], pchText);
+        }
+    *pchText++ = '\n';
+
+    return pchText;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vPcmDecom_Free(SuPcmDecom * psuDecom)
+    {
+    uint32_t            uParamIdx;
+
+    for (uParamIdx=0; uParamIdx<psuDecom->uNumParams; uParamIdx++)
+        free(psuDecom->pasuParams[uParamIdx].padCoef);
+    free(psuDecom->pasuParams);
+    free(psuDecom->pasuTaps);
+    free(psuDecom->paiColumnParam);
+    free(psuDecom->paullValue);
+    free(psuDecom->pabySampled);
+    vPcmDecom_Init(psuDecom);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The PCM data link name for a channel, from R-x\PDLN-n or failing that the
+// data source ID. NULL if the channel isn't in TMATS.
+
+static const char * szLinkName(SuTmatsAttrs * psuAttrs, unsigned int uChanID)
+    {
+    SuTmatsAttrChan   * psuChan;
+    const char        * szLink;
+
+    psuChan = psuTmatsAttr_FindChan(psuAttrs, uChanID);
+    if (psuChan == NULL)
+        return NULL;
+    szLink = szTmatsAttr_Getf(psuAttrs, "R-%d\\PDLN-%d", psuChan->iRIndex, psuChan->iDsiIndex);
+    if (szLink == NULL)
+        szLink = psuChan->szDataSourceID;
+
+    return szLink;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Find the index of the first record of a type with an attribute value,
+// e.g. the D record with "D-x\DLN" equal to a link name. -1 if none.
+
+static int iFindRecord(SuTmatsAttrs * psuAttrs, char chRecType, const char * szCodeName, const char * szValue)
+    {
+    uint32_t            uAttrIdx;
+    SuTmatsAttr       * psuAttr;
+
+    for (uAttrIdx=0; uAttrIdx<psuAttrs->uNumAttrs; uAttrIdx++)
+        {
+        psuAttr = &psuAttrs->pasuAttrs[uAttrIdx];
+        if ((psuAttr->chRecType == chRecType) && 
+            (strcasecmp(psuAttr->szCodeName, szCodeName) == 0) &&
+            (strcmp(psuAttr->szValue, szValue) == 0))
+            return psuAttr->iRecIdx;
+        }
+
+    return -1;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int iGetInt(const char * szValue, int iDefault)
+    {
+    if ((szValue == NULL) || (szValue[0] == '\0'))
+        return iDefault;
+    return atoi(szValue);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get a measurement location attribute, e.g. "D-x\WP-y-n-m-e". Files with
+// one fragment often leave off the fragment number.
+
+static const char * szGetLoc(SuTmatsAttrs * psuAttrs, const char * szCode, int iDIdx, int iList, int iMeas, 
+                             int iLoc, int iFrag, int iNumFrags)
+    {
+    const char        * szValue;
+
+    szValue = szTmatsAttr_Getf(psuAttrs, "D-%d\\%s-%d-%d-%d-%d", iDIdx, szCode, iList, iMeas, iLoc, iFrag);
+    if ((szValue == NULL) && (iNumFrags == 1))
+        szValue = szTmatsAttr_Getf(psuAttrs, "D-%d\\%s-%d-%d-%d", iDIdx, szCode, iList, iMeas, iLoc);
+
+    return szValue;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Compile the taps for one measurand. Each measurement location adds its
+// samples after the ones before it, and a location with a word interval
+// (supercommutation) adds one sample for every repeat in the minor frame.
+
+static EnI106Status enAddMeasurand(SuPcmDecom * psuDecom, SuTmatsAttrs * psuAttrs, int iDIdx, int iList, int iMeas,
+                                   const char * szName, uint32_t uColumn, uint64_t ullWordMask)
+    {
+    EnI106Status        enStatus;
+    const char        * szValue;
+    SuDecomParam      * psuParam;
+    SuDecomTap          asuFrag[MAX_FRAGMENTS];
+    SuDecomTap          suTap;
+    int                 aiFragPos[MAX_FRAGMENTS];
+    int                 aiWordPos[MAX_FRAGMENTS];
+    int                 aiWordInt[MAX_FRAGMENTS];
+    int                 iNumLocs;
+    int                 iNumFrags;
+    int                 iLoc;
+    int                 iFrag;
+    int                 iSwap;
+    int                 iFramePos;
+    int                 iFrameInt;
+    int                 iReps;
+    int                 iRep;
+    uint32_t            uOccBase;
+    uint32_t            uNumTaps;
+    uint32_t            uParamBits;
+    uint64_t            ullMask;
+
+    // Only word and frame locations can be pulled straight out of the frame
+    szValue = szTmatsAttr_Getf(psuAttrs, "D-%d\\LT-%d-%d", iDIdx, iList, iMeas);
+    if ((szValue != NULL) && (strcasecmp(szValue, "WDFR") != 0))
+        return I106_OK;
+
+    uNumTaps   = psuDecom->uNumTaps;
+    uOccBase   = 0;
+    uParamBits = 0;
+
+    iNumLocs = iGetInt(szTmatsAttr_Getf(psuAttrs, "D-%d\\MML\\N-%d-%d", iDIdx, iList, iMeas), 1);
+    for (iLoc=1; iLoc<=iNumLocs; iLoc++)
+        {
+        iNumFrags = iGetInt(szTmatsAttr_Getf(psuAttrs, "D-%d\\MNF\\N-%d-%d-%d", iDIdx, iList, iMeas, iLoc), 1);
+        if ((iNumFrags < 1) || (iNumFrags > MAX_FRAGMENTS))
+            continue;
+
+        // Get each fragment's word, frames, and bits
+        iReps = -1;
+        for (iFrag=0; iFrag<iNumFrags; iFrag++)
+            {
+            memset(&asuFrag[iFrag], 0, sizeof(SuDecomTap));
+            aiWordPos[iFrag] = iGetInt(szGetLoc(psuAttrs, "WP", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), 0);
+            aiWordInt[iFrag] = iGetInt(szGetLoc(psuAttrs, "WI", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), 0);
+            aiFragPos[iFrag] = iGetInt(szGetLoc(psuAttrs, "WFP", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), iFrag+1);
+            iFramePos        = iGetInt(szGetLoc(psuAttrs, "FP", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), 0);
+            iFrameInt        = iGetInt(szGetLoc(psuAttrs, "FI", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), 0);
+            if ((aiWordPos[iFrag] < 1) || ((uint32_t)aiWordPos[iFrag] > psuDecom->uWordsInMinorFrame))
+                break;
+
+            // No frame position means every minor frame, a frame position
+            // without an interval means once per major frame
+            if ((iFramePos >= 1) && (psuDecom->suFormat.uMinorFrames > 1))
+                {
+                if (iFrameInt < 1)
+                    iFrameInt = psuDecom->suFormat.uMinorFrames;
+                asuFrag[iFrag].uFrameInterval = iFrameInt;
+                asuFrag[iFrag].uFramePhase    = (iFramePos - 1) % iFrameInt;
+                }
+
+            ullMask = ullParseMask(szGetLoc(psuAttrs, "WFM", iDIdx, iList, iMeas, iLoc, iFrag+1, iNumFrags), ullWordMask)
+                      & ullWordMask;
+            if (ullMask == 0)
+                break;
+            for (asuFrag[iFrag].uShift=0; ((ullMask >> asuFrag[iFrag].uShift) & 1) == 0; asuFrag[iFrag].uShift++)
+                ;
+            asuFrag[iFrag].ullMask = ullMask >> asuFrag[iFrag].uShift;
+            asuFrag[iFrag].uBits   = 0;
+            for ( ; ullMask != 0; ullMask &= ullMask - 1)
+                asuFrag[iFrag].uBits++;
+            if ((asuFrag[iFrag].ullMask & (asuFrag[iFrag].ullMask + 1)) != 0)
+                asuFrag[iFrag].ullScatter = asuFrag[iFrag].ullMask << asuFrag[iFrag].uShift;
+
+            // Supercommutated fragments repeat every word interval. All the
+            // fragments of a location repeat the same number of times.
+            iRep = 1;
+            if (aiWordInt[iFrag] > 0)
+                iRep = (psuDecom->uWordsInMinorFrame - aiWordPos[iFrag]) / aiWordInt[iFrag] + 1;
+            if ((iReps < 0) || (iRep < iReps))
+                iReps = iRep;
+            } // end for all fragments
+        if (iFrag < iNumFrags)
+            continue;
+
+        // Put the fragments in order, most significant first
+        for (iFrag=1; iFrag<iNumFrags; iFrag++)
+            {
+            for (iSwap=iFrag; (iSwap > 0) && (aiFragPos[iSwap-1] > aiFragPos[iSwap]); iSwap--)
+                {
+                suTap = asuFrag[iSwap];  asuFrag[iSwap]   = asuFrag[iSwap-1];   asuFrag[iSwap-1]   = suTap;
+                iRep  = aiFragPos[iSwap]; aiFragPos[iSwap] = aiFragPos[iSwap-1]; aiFragPos[iSwap-1] = iRep;
+                iRep  = aiWordPos[iSwap]; aiWordPos[iSwap] = aiWordPos[iSwap-1]; aiWordPos[iSwap-1] = iRep;
+                iRep  = aiWordInt[iSwap]; aiWordInt[iSwap] = aiWordInt[iSwap-1]; aiWordInt[iSwap-1] = iRep;
+                }
+            }
+
+        if (uParamBits == 0)
+            for (iFrag=0; iFrag<iNumFrags; iFrag++)
+                uParamBits += asuFrag[iFrag].uBits;
+
+        // One set of fragment taps for each sample
+        for (iRep=0; iRep<iReps; iRep++)
+            {
+            for (iFrag=0; iFrag<iNumFrags; iFrag++)
+                {
+                suTap          = asuFrag[iFrag];
+                suTap.uWordIdx = aiWordPos[iFrag] - 1 + iRep * aiWordInt[iFrag];
+                suTap.uParam   = psuDecom->uNumParams;
+                suTap.uOcc     = uOccBase + iRep;
+                suTap.bFirst   = (iFrag == 0);
+                suTap.bLast    = (iFrag == iNumFrags - 1);
+                enStatus = enAddTap(psuDecom, &suTap);
+                if (enStatus != I106_OK)
+                    return enStatus;
+                }
+            }
+        uOccBase += iReps;
+        } // end for all measurement locations
+
+    // Nothing usable so leave it out
+    if (psuDecom->uNumTaps == uNumTaps)
+        return I106_OK;
+
+    psuParam = (SuDecomParam *)realloc(psuDecom->pasuParams, (psuDecom->uNumParams + 1) * sizeof(SuDecomParam));
+    if (psuParam == NULL)
+        return I106_BUFFER_TOO_SMALL;
+    psuDecom->pasuParams = psuParam;
+    psuParam = &psuDecom->pasuParams[psuDecom->uNumParams];
+    memset(psuParam, 0, sizeof(SuDecomParam));
+    strncpy(psuParam->szName, szName, PCM_DECOM_MAX_NAME - 1);
+    psuParam->uColumn = uColumn;
+    psuParam->uBits   = uParamBits > 64 ? 64 : uParamBits;
+    vGetConversion(psuAttrs, psuParam);
+
+    psuDecom->paiColumnParam[uColumn] = psuDecom->uNumParams;
+    psuDecom->uNumParams++;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static EnI106Status enAddTap(SuPcmDecom * psuDecom, SuDecomTap * psuTap)
+    {
+    SuDecomTap        * pasuTaps;
+
+    if ((psuDecom->uNumTaps & 0x3f) == 0)
+        {
+        pasuTaps = (SuDecomTap *)realloc(psuDecom->pasuTaps, (psuDecom->uNumTaps + 0x40) * sizeof(SuDecomTap));
+        if (pasuTaps == NULL)
+            return I106_BUFFER_TOO_SMALL;
+        psuDecom->pasuTaps = pasuTaps;
+        }
+
+    psuDecom->pasuTaps[psuDecom->uNumTaps++] = *psuTap;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get the binary format and engineering unit conversion from the C record
+// with this measurand name. No C record means unsigned raw counts.
+
+static void vGetConversion(SuTmatsAttrs * psuAttrs, SuDecomParam * psuParam)
+    {
+    const char        * szValue;
+    int                 iCIdx;
+    int                 iNum;
+    int                 iIdx;
+    int                 iSwap;
+    double              dTemp;
+
+    iCIdx = iFindRecord(psuAttrs, 'C', "DCN", psuParam->szName);
+    if (iCIdx < 0)
+        return;
+
+    szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\BFM", iCIdx);
+    if (szValue != NULL)
+        {
+        if      ((strcasecmp(szValue, "TWO") == 0) || (strcasecmp(szValue, "INT") == 0))
+            psuParam->uFormat = DECOM_FMT_TWOS;
+        else if (strcasecmp(szValue, "ONE") == 0)
+            psuParam->uFormat = DECOM_FMT_ONES;
+        else if (strcasecmp(szValue, "SIG") == 0)
+            psuParam->uFormat = DECOM_FMT_SIGNMAG;
+        }
+
+    szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\DCT", iCIdx);
+    if (szValue == NULL)
+        return;
+
+    // Polynomial, C-d\CO is the constant and C-d\CO-n the nth order term
+    if (strcasecmp(szValue, "COE") == 0)
+        {
+        iNum = iGetInt(szTmatsAttr_Getf(psuAttrs, "C-%d\\CO\\N", iCIdx), 0) + 1;
+        psuParam->padCoef = (double *)calloc(iNum, sizeof(double));
+        if (psuParam->padCoef == NULL)
+            return;
+        szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\CO", iCIdx);
+        psuParam->padCoef[0] = (szValue != NULL) ? atof(szValue) : 0.0;
+        for (iIdx=1; iIdx<iNum; iIdx++)
+            {
+            szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\CO-%d", iCIdx, iIdx);
+            psuParam->padCoef[iIdx] = (szValue != NULL) ? atof(szValue) : 0.0;
+            }
+        psuParam->uNumCoefs = iNum;
+        psuParam->uConvType = DECOM_CONV_POLY;
+        }
+
+    // Pair set, straight lines between the points sorted by raw value
+    else if (strcasecmp(szValue, "PRS") == 0)
+        {
+        iNum = iGetInt(szTmatsAttr_Getf(psuAttrs, "C-%d\\PS\\N", iCIdx), 0);
+        if (iNum < 2)
+            return;
+        psuParam->padCoef = (double *)calloc(2 * iNum, sizeof(double));
+        if (psuParam->padCoef == NULL)
+            return;
+        for (iIdx=0; iIdx<iNum; iIdx++)
+            {
+            szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\PS1-%d", iCIdx, iIdx+1);
+            psuParam->padCoef[2*iIdx]   = (szValue != NULL) ? atof(szValue) : 0.0;
+            szValue = szTmatsAttr_Getf(psuAttrs, "C-%d\\PS2-%d", iCIdx, iIdx+1);
+            psuParam->padCoef[2*iIdx+1] = (szValue != NULL) ? atof(szValue) : 0.0;
+            for (iSwap=iIdx; (iSwap > 0) && (psuParam->padCoef[2*iSwap-2] > psuParam->padCoef[2*iSwap]); iSwap--)
+                {
+                dTemp = psuParam->padCoef[2*iSwap];   psuParam->padCoef[2*iSwap]   = psuParam->padCoef[2*iSwap-2]; psuParam->padCoef[2*iSwap-2] = dTemp;
+                dTemp = psuParam->padCoef[2*iSwap+1]; psuParam->padCoef[2*iSwap+1] = psuParam->padCoef[2*iSwap-1]; psuParam->padCoef[2*iSwap-1] = dTemp;
+                }
+            }
+        psuParam->uNumCoefs = iNum;
+        psuParam->uConvType = DECOM_CONV_PAIRS;
+        }
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Turn a TMATS word mask like "0000111111110000" into bits. "FW" or no
+// mask is the full data word.
+
+static uint64_t ullParseMask(const char * szMask, uint64_t ullWordMask)
+    {
+    uint64_t            ullMask;
+    const char        * pchBit;
+
+    if ((szMask == NULL) || (szMask[0] == '\0') || (strcasecmp(szMask, "FW") == 0))
+        return ullWordMask;
+
+    ullMask = 0;
+    for (pchBit = szMask; *pchBit != '\0'; pchBit++)
+        {
+        if ((*pchBit != '0') && (*pchBit != '1'))
+            return 0;
+        ullMask = (ullMask << 1) | (uint64_t)(*pchBit - '0');
+        }
+
+    return ullMask;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Pack the masked bits of a word together, for masks with holes in them
+
+static uint64_t ullGather(uint64_t ullWord, uint64_t ullMask)
+    {
+    uint64_t            ullBits = 0;
+    int                 iBit;
+
+    for (iBit=63; iBit>=0; iBit--)
+        {
+        if ((ullMask >> iBit) & 1)
+            ullBits = (ullBits << 1) | ((ullWord >> iBit) & 1);
+        }
+
+    return ullBits;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Format a sample as raw counts, or as engineering units if there is a
+// conversion
+
+static char * pchFormatValue(SuDecomParam * psuParam, uint64_t ullRaw, char * pchText)
+    {
+    char                achDigits[24];
+    int                 iDigits;
+    int                 bNegative;
+    uint64_t            ullSignBit;
+    uint64_t            ullMag;
+    uint32_t            uIdx;
+    double              dRaw;
+    double              dValue;
+    double            * pdPair;
+
+    // Sign and magnitude
+    bNegative  = bFALSE;
+    ullMag     = ullRaw;
+    ullSignBit = (psuParam->uBits >= 1) ? 1ULL << (psuParam->uBits - 1) : 0;
+    if ((psuParam->uFormat != DECOM_FMT_UNSIGNED) && ((ullRaw & ullSignBit) != 0))
+        {
+        bNegative = bTRUE;
+        switch (psuParam->uFormat)
+            {
+            case DECOM_FMT_TWOS :    ullMag = (~ullRaw + 1) & ((ullSignBit << 1) - 1);  break;
+            case DECOM_FMT_ONES :    ullMag =  ~ullRaw      & ((ullSignBit << 1) - 1);  break;
+            case DECOM_FMT_SIGNMAG : ullMag =   ullRaw      &  (ullSignBit - 1);        break;
+            }
+        }
+
+    // Raw counts
+    if (psuParam->uConvType == DECOM_CONV_NONE)
+        {
+        if (bNegative)
+            *pchText++ = '-';
+        iDigits = 0;
+        do  {
+            achDigits[iDigits++] = (char)('0' + (ullMag % 10));
+            ullMag /= 10;
+            } while (ullMag != 0);
+        while (iDigits > 0)
+            *pchText++ = achDigits[--iDigits];
+        return pchText;
+        }
+
+    dRaw = bNegative ? -(double)ullMag : (double)ullMag;
+
+    // Polynomial, Horner's rule
+    if (psuParam->uConvType == DECOM_CONV_POLY)
+        {
+        dValue = 0.0;
+        for (uIdx=psuParam->uNumCoefs; uIdx>0; uIdx--)
+            dValue = dValue * dRaw + psuParam->padCoef[uIdx-1];
+        }
+
+    // Pair set, extend the end segments past the first and last points
+    else
+        {
+        for (uIdx=1; uIdx<psuParam->uNumCoefs-1; uIdx++)
+            if (dRaw < psuParam->padCoef[2*uIdx])
+                break;
+        pdPair = &psuParam->padCoef[2*(uIdx-1)];
+        if (pdPair[2] == pdPair[0])
+            dValue = pdPair[1];
+        else
+            dValue = pdPair[1] + (dRaw - pdPair[0]) * (pdPair[3] - pdPair[1]) / (pdPair[2] - pdPair[0]);
+        }
+
+    iDigits = snprintf(pchText, COLUMN_TEXT_LEN - 1, "%.10g", dValue);
+    if ((iDigits < 0) || (iDigits >= COLUMN_TEXT_LEN - 1))
+        iDigits = (int)strlen(pchText);
+    return pchText + iDigits;
+    }
@@ -0,0 +1,157 @@
+/*==========================================================================
+
+  pcm_decom.h - Pull PCM measurands out of minor frames using a plan made
+    from the TMATS D and C records
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _PCM_DECOM_H
+#define _PCM_DECOM_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "tmats_attr.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define PCM_DECOM_MAX_NAME  64
+
+typedef enum
+    {
+    DECOM_CONV_NONE     = 0,            // Raw counts
+    DECOM_CONV_POLY     = 1,            // C-d\DCT:COE, polynomial
+    DECOM_CONV_PAIRS    = 2,            // C-d\DCT:PRS, pair set
+    } EnDecomConv;
+
+typedef enum
+    {
+    DECOM_FMT_UNSIGNED  = 0,            // C-d\BFM:UNS
+    DECOM_FMT_TWOS      = 1,            // C-d\BFM:TWO or INT
+    DECOM_FMT_ONES      = 2,            // C-d\BFM:ONE
+    DECOM_FMT_SIGNMAG   = 3,            // C-d\BFM:SIG
+    } EnDecomFormat;
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// Minor frame layout of a PCM link from its P record
+typedef struct
+    {
+    uint32_t            uMinorFrames;       // Minor frames per major frame
+    int                 bHaveSfid;          // Subframe ID counter gives the minor frame number
+    uint32_t            uSfidWordIdx;
+    uint32_t            uSfidShift;
+    uint64_t            ullSfidMask;
+    uint32_t            uSfidInitValue;     // Counter value in the first minor frame
+    uint32_t            uSfidEndValue;      // Counter value in the last minor frame
+    uint32_t            uSfidInitFrame;     // Minor frame index of the first value
+    int                 bSfidDown;          // Counter counts down
+    } SuPcmFrameFormat;
+
+// One requested measurand on this channel
+typedef struct
+    {
+    char                szName[PCM_DECOM_MAX_NAME];
+    uint32_t            uColumn;            // Output column
+    uint32_t            uBits;              // Raw length, all fragments
+    uint32_t            uFormat;            // EnDecomFormat
+    uint32_t            uConvType;          // EnDecomConv
+    uint32_t            uNumCoefs;          // Polynomial coefficients or pairs
+    double            * padCoef;            // Coefficients, or raw/EU pairs in raw order
+    } SuDecomParam;
+
+// One fragment of one sample of a measurand. A sample's taps are in
+// fragment order, most significant first.
+typedef struct
+    {
+    uint32_t            uWordIdx;           // Index into the minor frame words
+    uint32_t            uFrameInterval;     // Minor frames between samples, 0 for every frame
+    uint32_t            uFramePhase;        // Minor frame index modulo the interval
+    uint64_t            ullMask;            // Word bits, already shifted down
+    uint32_t            uShift;
+    uint32_t            uBits;
+    uint64_t            ullScatter;         // Word bits for a mask with holes, else 0
+    uint32_t            uParam;
+    uint32_t            uOcc;               // Which sample in the minor frame
+    uint32_t            uSlot;              // Sample value index
+    uint8_t             bFirst;             // First fragment starts a new value
+    uint8_t             bLast;              // Last fragment completes it
+    } SuDecomTap;
+
+// Extraction plan and state for one PCM channel
+typedef struct
+    {
+    uint32_t            uChanID;
+    uint32_t            uWordsInMinorFrame;
+    SuPcmFrameFormat    suFormat;
+    uint32_t            uFrameCount;        // Minor frames seen
+    uint32_t            uNumColumns;        // Every requested measurand
+    int32_t           * paiColumnParam;     // Param for each column, -1 if not on this channel
+    uint32_t            uNumParams;
+    SuDecomParam      * pasuParams;
+    uint32_t            uMaxOccs;           // Most samples of one measurand in a minor frame
+    uint32_t            uNumTaps;
+    SuDecomTap        * pasuTaps;
+    uint64_t          * paullValue;         // uMaxOccs * uNumParams samples
+    uint8_t           * pabySampled;
+    } SuPcmDecom;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vPcmDecom_GetFormat(SuTmatsAttrs * psuAttrs, unsigned int uChanID, uint32_t uWordLen, 
+                                    uint32_t uWordsInMinorFrame, SuPcmFrameFormat * psuFormat);
+uint32_t        uPcmDecom_Sfid(SuPcmFrameFormat * psuFormat, const uint64_t * paullWords);
+uint32_t        uPcmDecom_NextSfid(SuPcmFrameFormat * psuFormat, uint32_t uSfid);
+void            vPcmDecom_Init(SuPcmDecom * psuDecom);
+EnI106Status    enPcmDecom_Compile(SuPcmDecom * psuDecom, SuTmatsAttrs * psuAttrs, unsigned int uChanID,
+                                   uint32_t uWordLen, uint64_t ullWordMask, uint32_t uWordsInMinorFrame,
+                                   const char * const aszNames[], unsigned int uNumNames);
+int             iPcmDecom_Frame(SuPcmDecom * psuDecom, const uint64_t * paullWords);
+uint32_t        ulPcmDecom_RowLen(SuPcmDecom * psuDecom);
+char          * pchPcmDecom_Row(SuPcmDecom * psuDecom, int iRow, char * pchText);
+void            vPcmDecom_Free(SuPcmDecom * psuDecom);
+
+#endif
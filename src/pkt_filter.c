@@ -0,0 +1,453 @@
+/*==========================================================================
+
+  pkt_filter.c - Packet reader that reads only the packets a utility asked
+    for, skipping the rest in big blocks, and can read everything in big
+    blocks instead of a packet at a time
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "pkt_filter.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#if defined(_MSC_VER)
+#define iSeekFile(psuFile, llOffset)    _fseeki64(psuFile, llOffset, SEEK_SET)
+#else
+#define iSeekFile(psuFile, llOffset)    fseeko(psuFile, (off_t)(llOffset), SEEK_SET)
+#endif
+
+#define TYPE_SET_HAS(psuSet, uType)     (((psuSet)->aulType[(uType) >> 5] >> ((uType) & 0x1f)) & 1)
+
+// Little endian header fields from the raw header bytes
+#define HDR_U16(pabyHdr, iOffset)       ((uint16_t)((pabyHdr)[iOffset] | ((pabyHdr)[(iOffset)+1] << 8)))
+#define HDR_U32(pabyHdr, iOffset)       ((uint32_t)HDR_U16(pabyHdr, iOffset) | ((uint32_t)HDR_U16(pabyHdr, (iOffset)+2) << 16))
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static uint8_t    * pabyGetBytes(SuPktFilter * psuFilter, int64_t llOffset, uint32_t ulLen);
+static int          bGoodHeader(const uint8_t * pabyHdr);
+static EnI106Status enLibTakeOver(SuPktFilter * psuFilter, SuI106Ch10Header * psuI106Hdr);
+static void         vStopBlockRead(SuPktFilter * psuFilter);
+
+
+/* ======================================================================== */
+
+void vPktFilter_Init(SuPktFilter * psuFilter)
+    {
+    memset(psuFilter, 0, sizeof(SuPktFilter));
+    psuFilter->iI106Handle = -1;
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Subscribe to a data type on a channel. Either can be PKT_FILTER_ANY.
+// Once anything is subscribed only subscribed packets are returned.
+
+EnI106Status enPktFilter_Add(SuPktFilter * psuFilter, int iChanID, int iDataType)
+    {
+    SuPktTypeSet        suTypes;
+    SuPktTypeSet      * psuTypes;
+    SuPktTypeSet      * pasuNewTypes;
+    int                 iWordIdx;
+
+    if ((iChanID   < PKT_FILTER_ANY) || (iChanID   > 0xffff) ||
+        (iDataType < PKT_FILTER_ANY) || (iDataType > 0xff))
+        return I106_INVALID_PARAMETER;
+
+    memset(&suTypes, 0, sizeof(suTypes));
+    if (iDataType == PKT_FILTER_ANY)
+        memset(&suTypes, 0xff, sizeof(suTypes));
+    else
+        suTypes.aulType[iDataType >> 5] = 1UL << (iDataType & 0x1f);
+
+    // Channel type sets are only made for channels that are asked for
+    if (iChanID == PKT_FILTER_ANY)
+        psuTypes = &psuFilter->suAnyChan;
+    else
+        {
+        if (psuFilter->pauChanSlot == NULL)
+            {
+            psuFilter->pauChanSlot = (uint16_t *)calloc(0x10000, sizeof(uint16_t));
+            if (psuFilter->pauChanSlot == NULL)
+                return I106_BUFFER_TOO_SMALL;
+            }
+
+        if (psuFilter->pauChanSlot[iChanID] == 0)
+            {
+            pasuNewTypes = (SuPktTypeSet *)realloc(psuFilter->pasuChanTypes,
+                               (psuFilter->uNumSlots + 1) * sizeof(SuPktTypeSet));
+            if (pasuNewTypes == NULL)
+                return I106_BUFFER_TOO_SMALL;
+            psuFilter->pasuChanTypes = pasuNewTypes;
+            memset(&psuFilter->pasuChanTypes[psuFilter->uNumSlots], 0, sizeof(SuPktTypeSet));
+            psuFilter->uNumSlots++;
+            psuFilter->pauChanSlot[iChanID] = (uint16_t)psuFilter->uNumSlots;
+            }
+
+        psuTypes = &psuFilter->pasuChanTypes[psuFilter->pauChanSlot[iChanID] - 1];
+        }
+
+    for (iWordIdx = 0; iWordIdx < 8; iWordIdx++)
+        psuTypes->aulType[iWordIdx] |= suTypes.aulType[iWordIdx];
+
+    psuFilter->bActive = bTRUE;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+int bPktFilter_Wanted(SuPktFilter * psuFilter, unsigned int uChanID, unsigned int uDataType)
+    {
+    unsigned int        uSlot;
+
+    if (psuFilter->bActive == bFALSE)
+        return bTRUE;
+
+    uDataType &= 0xff;
+    if (TYPE_SET_HAS(&psuFilter->suAnyChan, uDataType))
+        return bTRUE;
+
+    if (psuFilter->pauChanSlot == NULL)
+        return bFALSE;
+
+    uSlot = psuFilter->pauChanSlot[uChanID & 0xffff];
+    return (uSlot != 0) && TYPE_SET_HAS(&psuFilter->pasuChanTypes[uSlot-1], uDataType);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the whole file in big blocks, even with nothing subscribed, instead
+// of a packet at a time with the library. Set before opening.
+
+void vPktFilter_BlockRead(SuPktFilter * psuFilter, int bBlockRead)
+    {
+    psuFilter->bBlockRead = bBlockRead;
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get ready to read from an open data file. This has to be done before any
+// packet headers are read. The first packet always passes the filter so
+// utilities can check it for TMATS. If anything was subscribed, or block
+// reads were asked for, the data file is opened again to read it in big
+// blocks. If the file can't be opened again everything is read with the
+// library, which skips unwanted packets itself.
+
+EnI106Status enPktFilter_Open(SuPktFilter * psuFilter, int iI106Handle, const char * szDataFile)
+    {
+    psuFilter->iI106Handle  = iI106Handle;
+    psuFilter->bFirst       = bTRUE;
+    psuFilter->llNextOffset = 0;
+    psuFilter->bHaveData    = bFALSE;
+
+    if (((psuFilter->bActive == bFALSE) && (psuFilter->bBlockRead == bFALSE)) || (szDataFile == NULL))
+        return I106_OK;
+
+    psuFilter->ulBuffSize = psuFilter->bBlockRead ? PKT_FILTER_BLOCK_SIZE : PKT_FILTER_BUFF_SIZE;
+    psuFilter->pabyBuff   = (uint8_t *)malloc(psuFilter->ulBuffSize);
+    if (psuFilter->pabyBuff == NULL)
+        return I106_OK;
+
+    psuFilter->psuFile = fopen(szDataFile, "rb");
+    if (psuFilter->psuFile == NULL)
+        {
+        free(psuFilter->pabyBuff);
+        psuFilter->pabyBuff = NULL;
+        return I106_OK;
+        }
+
+    // Reads are always a whole block so stdio buffering would just be a copy
+    setvbuf(psuFilter->psuFile, NULL, _IONBF, 0);
+    psuFilter->llBuffOffset = 0;
+    psuFilter->ulBuffLen    = 0;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the next subscribed packet header. Unwanted packets are stepped over
+// in the buffer and wanted ones come out of it, so every byte is read from
+// the file once. The library is only used again if a bad header means it
+// has to find sync.
+
+EnI106Status enPktFilter_ReadNextHeader(SuPktFilter * psuFilter, SuI106Ch10Header * psuI106Hdr)
+    {
+    EnI106Status        enStatus;
+    uint8_t           * pabyHdr;
+    uint32_t            ulPacketLen;
+    uint32_t            ulHdrLen;
+
+    psuFilter->bHaveData = bFALSE;
+
+    // Not reading blocks so the library reads every header and skips bodies
+    if (psuFilter->psuFile == NULL)
+        {
+        do  {
+            enStatus = enI106Ch10ReadNextHeader(psuFilter->iI106Handle, psuI106Hdr);
+            } while ((enStatus == I106_OK) && (psuFilter->bFirst == bFALSE) &&
+                     !bPktFilter_Wanted(psuFilter, psuI106Hdr->uChID, psuI106Hdr->ubyDataType));
+        psuFilter->bFirst = bFALSE;
+        return enStatus;
+        }
+
+    while (bTRUE)
+        {
+        pabyHdr = pabyGetBytes(psuFilter, psuFilter->llNextOffset, HEADER_SIZE);
+        if (pabyHdr == NULL)
+            return I106_EOF;
+
+        // Anything odd and the library takes over to find sync again
+        if (!bGoodHeader(pabyHdr))
+            return enLibTakeOver(psuFilter, psuI106Hdr);
+
+        ulPacketLen = HDR_U32(pabyHdr, 4);
+        if (psuFilter->bFirst || bPktFilter_Wanted(psuFilter, HDR_U16(pabyHdr, 2), pabyHdr[15]))
+            break;
+
+        psuFilter->llNextOffset += ulPacketLen;
+        } // end while looking at headers
+
+    psuFilter->bFirst = bFALSE;
+
+    // Copy the header, and the secondary header if there is one
+    memcpy(psuI106Hdr, pabyHdr, HEADER_SIZE);
+    ulHdrLen = (uint32_t)iGetHeaderLen(psuI106Hdr);
+    if (ulPacketLen < ulHdrLen)
+        return enLibTakeOver(psuFilter, psuI106Hdr);
+
+    if (ulHdrLen > HEADER_SIZE)
+        {
+        pabyHdr = pabyGetBytes(psuFilter, psuFilter->llNextOffset, ulHdrLen);
+        if (pabyHdr == NULL)
+            return I106_EOF;
+        memcpy(psuI106Hdr, pabyHdr, ulHdrLen);
+        }
+
+    psuFilter->bHaveData     = bTRUE;
+    psuFilter->llDataOffset  = psuFilter->llNextOffset + ulHdrLen;
+    psuFilter->ulDataLen     = ulPacketLen - ulHdrLen;
+    psuFilter->llNextOffset += ulPacketLen;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the data for the last header, like enI106Ch10ReadData(). It is copied
+// out of the buffer, joined up with the next block if it runs past the end.
+// Packets bigger than a block are read straight into the caller's buffer.
+
+EnI106Status enPktFilter_ReadData(SuPktFilter * psuFilter, unsigned long ulBuffSize, void * pvBuff)
+    {
+    uint8_t           * pabyData;
+
+    if (psuFilter->psuFile == NULL)
+        return enI106Ch10ReadData(psuFilter->iI106Handle, ulBuffSize, pvBuff);
+
+    if (psuFilter->bHaveData == bFALSE)
+        return I106_READ_ERROR;
+
+    if (ulBuffSize < psuFilter->ulDataLen)
+        return I106_BUFFER_TOO_SMALL;
+
+    psuFilter->bHaveData = bFALSE;
+
+    if (psuFilter->ulDataLen <= psuFilter->ulBuffSize)
+        {
+        pabyData = pabyGetBytes(psuFilter, psuFilter->llDataOffset, psuFilter->ulDataLen);
+        if (pabyData == NULL)
+            return I106_EOF;
+        memcpy(pvBuff, pabyData, psuFilter->ulDataLen);
+        return I106_OK;
+        }
+
+    if (iSeekFile(psuFilter->psuFile, psuFilter->llDataOffset) != 0)
+        return I106_SEEK_ERROR;
+
+    // The buffer is empty and starts where the file position is left
+    psuFilter->llBuffOffset = psuFilter->llDataOffset + psuFilter->ulDataLen;
+    psuFilter->ulBuffLen    = 0;
+    if (fread(pvBuff, 1, psuFilter->ulDataLen, psuFilter->psuFile) != psuFilter->ulDataLen)
+        return I106_EOF;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vPktFilter_Free(SuPktFilter * psuFilter)
+    {
+    vStopBlockRead(psuFilter);
+    free(psuFilter->pauChanSlot);
+    free(psuFilter->pasuChanTypes);
+    vPktFilter_Init(psuFilter);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Return ulLen bytes at a file offset. If they aren't all in the buffer a
+// new block is read starting there. When the offset is in the buffer the
+// bytes from there to the end are moved to the front and the rest of the
+// block is read after them, so reading straight through never seeks. The
+// file position is always at the end of the buffer. NULL at end of file.
+
+static uint8_t * pabyGetBytes(SuPktFilter * psuFilter, int64_t llOffset, uint32_t ulLen)
+    {
+    int64_t             llBuffIdx;
+    uint32_t            ulKeep;
+
+    llBuffIdx = llOffset - psuFilter->llBuffOffset;
+    if ((llBuffIdx >= 0) && (llBuffIdx + ulLen <= (int64_t)psuFilter->ulBuffLen))
+        return &psuFilter->pabyBuff[llBuffIdx];
+
+    if (ulLen > psuFilter->ulBuffSize)
+        return NULL;
+
+    if ((llBuffIdx >= 0) && (llBuffIdx <= (int64_t)psuFilter->ulBuffLen))
+        {
+        ulKeep = psuFilter->ulBuffLen - (uint32_t)llBuffIdx;
+        memmove(psuFilter->pabyBuff, &psuFilter->pabyBuff[llBuffIdx], ulKeep);
+        }
+    else
+        {
+        psuFilter->ulBuffLen = 0;
+        if (iSeekFile(psuFilter->psuFile, llOffset) != 0)
+            return NULL;
+        ulKeep = 0;
+        }
+
+    psuFilter->llBuffOffset = llOffset;
+    psuFilter->ulBuffLen    = ulKeep + (uint32_t)fread(&psuFilter->pabyBuff[ulKeep], 1,
+                                  psuFilter->ulBuffSize - ulKeep, psuFilter->psuFile);
+    if (psuFilter->ulBuffLen < ulLen)
+        return NULL;
+
+    return psuFilter->pabyBuff;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int bGoodHeader(const uint8_t * pabyHdr)
+    {
+    uint16_t            uSum = 0;
+    int                 iByteIdx;
+
+    if (HDR_U16(pabyHdr, 0) != IRIG106_SYNC)
+        return bFALSE;
+
+    if (HDR_U32(pabyHdr, 4) < HEADER_SIZE)
+        return bFALSE;
+
+    for (iByteIdx = 0; iByteIdx < HEADER_SIZE - 2; iByteIdx += 2)
+        uSum += HDR_U16(pabyHdr, iByteIdx);
+
+    return uSum == HDR_U16(pabyHdr, HEADER_SIZE - 2);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Stop reading blocks and let the library read from the current packet on
+
+static EnI106Status enLibTakeOver(SuPktFilter * psuFilter, SuI106Ch10Header * psuI106Hdr)
+    {
+    EnI106Status        enStatus;
+
+    vStopBlockRead(psuFilter);
+    enStatus = enI106Ch10SetPos(psuFilter->iI106Handle, psuFilter->llNextOffset);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    return enPktFilter_ReadNextHeader(psuFilter, psuI106Hdr);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static void vStopBlockRead(SuPktFilter * psuFilter)
+    {
+    if (psuFilter->psuFile != NULL)
+        fclose(psuFilter->psuFile);
+    free(psuFilter->pabyBuff);
+    psuFilter->psuFile    = NULL;
+    psuFilter->pabyBuff   = NULL;
+    psuFilter->ulBuffLen  = 0;
+    psuFilter->bHaveData  = bFALSE;
+    return;
+    }
@@ -0,0 +1,109 @@
+/*==========================================================================
+
+  pkt_filter.h - Packet reader that reads the data file in big blocks and
+    returns only the packets a utility asked for
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _PKT_FILTER_H
+#define _PKT_FILTER_H
+
+#include <stdio.h>
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define PKT_FILTER_ANY          -1              // Any channel or any data type
+#define PKT_FILTER_BUFF_SIZE    (1024*1024)     // Buffer size for filtered reads
+#define PKT_FILTER_BLOCK_SIZE   (8*1024*1024)   // Block read buffer size
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// Set of 256 data types, one bit each
+typedef struct
+    {
+    uint32_t            aulType[8];
+    } SuPktTypeSet;
+
+// Subscriptions and the state of the block reader. With no subscriptions
+// and no block reads everything passes and packets are read straight from
+// the library.
+typedef struct
+    {
+    int                 bActive;            // Something was subscribed
+    int                 bBlockRead;         // Read in blocks even with nothing subscribed
+    SuPktTypeSet        suAnyChan;          // Data types wanted on every channel
+    uint16_t          * pauChanSlot;        // Channel ID to type set index + 1, 0 if none
+    uint32_t            uNumSlots;
+    SuPktTypeSet      * pasuChanTypes;      // Data types wanted on one channel
+
+    int                 iI106Handle;
+    int                 bFirst;             // First packet not read yet, it always passes
+    FILE              * psuFile;            // Own handle for block reads, NULL if not reading blocks
+    uint8_t           * pabyBuff;
+    uint32_t            ulBuffSize;
+    int64_t             llBuffOffset;       // File offset of pabyBuff[0]
+    uint32_t            ulBuffLen;          // Bytes in pabyBuff
+    int64_t             llNextOffset;       // Next packet header to look at
+    int                 bHaveData;          // Header returned, data not read yet
+    int64_t             llDataOffset;
+    uint32_t            ulDataLen;
+    } SuPktFilter;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vPktFilter_Init(SuPktFilter * psuFilter);
+EnI106Status    enPktFilter_Add(SuPktFilter * psuFilter, int iChanID, int iDataType);
+int             bPktFilter_Wanted(SuPktFilter * psuFilter, unsigned int uChanID, unsigned int uDataType);
+void            vPktFilter_BlockRead(SuPktFilter * psuFilter, int bBlockRead);
+EnI106Status    enPktFilter_Open(SuPktFilter * psuFilter, int iI106Handle, const char * szDataFile);
+EnI106Status    enPktFilter_ReadNextHeader(SuPktFilter * psuFilter, SuI106Ch10Header * psuI106Hdr);
+EnI106Status    enPktFilter_ReadData(SuPktFilter * psuFilter, unsigned long ulBuffSize, void * pvBuff);
+void            vPktFilter_Free(SuPktFilter * psuFilter);
+
+#endif
@@ -0,0 +1,601 @@
+/*==========================================================================
+
+  time_map.c - Relative time counter to clock time table made from all
+    the time packets in a file, optionally saved beside the data file
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+#include "i106_time.h"
+#include "i106_decode_time.h"
+
+#include "time_map.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define MAP_FILE_MAGIC      "I106RTM1"
+#define MAP_MAX_POINTS      0x10000000
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// Time map file header. The data file size is the key that ties the file
+// to the data file it was made from. An array of SuTimeMapPoint follows.
+typedef struct
+    {
+    char                szMagic[8];
+    int64_t             llFileSize;
+    int32_t             iTimeChan;
+    uint32_t            uNumPoints;
+    uint32_t            uDateFmt;
+    uint32_t            uReserved;
+    } SuTimeMapFileHdr;
+
+// The piece being made. Each time packet narrows the range of rates that
+// keep every time packet in the piece within tolerance of the line. When
+// there's no rate left the piece ends and a new one starts at that packet.
+typedef struct
+    {
+    uint32_t            uPiecePoints;       // Time packets in the current piece
+    double              dRateLo;
+    double              dRateHi;
+    } SuTimeMapBuild;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static int     bAddPoint(SuTimeMap * psuMap, SuTimeMapBuild * psuBuild, int64_t llRelTime, int64_t llTime);
+static void    vEndPiece(SuTimeMap * psuMap, SuTimeMapBuild * psuBuild);
+static int     iComparePoints(const void * pvPoint1, const void * pvPoint2);
+static int64_t llRound(double dValue);
+static int64_t llGetFileSize(const char * szFile);
+static void    vMakeMapFileName(const char * szDataFile, char * szMapFile);
+static int     bReadMapFile(SuTimeMap * psuMap, const char * szMapFile, int64_t llFileSize, int iTimeChan);
+static int     bWriteMapFile(SuTimeMap * psuMap, const char * szMapFile);
+
+
+/* ======================================================================== */
+
+void vTimeMap_Init(SuTimeMap * psuMap)
+    {
+    memset(psuMap, 0, sizeof(SuTimeMap));
+    psuMap->iTimeChan = TIME_MAP_ANY_CHAN;
+    psuMap->llFileSize = -1;
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Make the map from every time packet on one time channel in one pass
+// through the file. The file position is put back when done.
+
+EnI106Status enTimeMap_Make(SuTimeMap * psuMap, int iI106Handle, int iTimeChan)
+    {
+    EnI106Status        enStatus;
+    EnI106Status        enRetStatus;
+    SuI106Ch10Header    suI106Hdr;
+    SuIrig106Time       suTime;
+    SuTimeMapBuild      suBuild;
+    int64_t             llSavePos;
+    int64_t             llRelTime;
+    unsigned char     * pvBuff = NULL;
+    unsigned long       ulBuffSize = 0L;
+    uint32_t            uPointIdx;
+
+    vTimeMap_Free(psuMap);
+    psuMap->iTimeChan = iTimeChan;
+    memset(&suBuild, 0, sizeof(suBuild));
+
+    enStatus = enI106Ch10GetPos(iI106Handle, &llSavePos);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    enStatus = enI106Ch10FirstMsg(iI106Handle);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    enRetStatus = I106_OK;
+    while (bTRUE)
+        {
+        enStatus = enI106Ch10ReadNextHeader(iI106Handle, &suI106Hdr);
+        if (enStatus != I106_OK)
+            break;
+
+        // Only time packets from the map's time channel
+        if (suI106Hdr.ubyDataType != I106CH10_DTYPE_IRIG_TIME)
+            continue;
+        if ((psuMap->iTimeChan != TIME_MAP_ANY_CHAN) && (psuMap->iTimeChan != (int)suI106Hdr.uChID))
+            continue;
+
+        // Make sure our buffer is big enough, size *does* matter
+        if (ulBuffSize < suI106Hdr.ulPacketLen)
+            {
+            pvBuff     = (unsigned char *)realloc(pvBuff, suI106Hdr.ulPacketLen);
+            ulBuffSize = suI106Hdr.ulPacketLen;
+            }
+
+        enStatus = enI106Ch10ReadData(iI106Handle, ulBuffSize, pvBuff);
+        if (enStatus != I106_OK)
+            break;
+
+        enStatus = enI106_Decode_TimeF1(&suI106Hdr, pvBuff, &suTime);
+        if (enStatus != I106_OK)
+            continue;
+
+        // The first time packet picks the time channel if it wasn't given
+        if (psuMap->uNumPoints == 0)
+            {
+            psuMap->iTimeChan = suI106Hdr.uChID;
+            psuMap->enDateFmt = suTime.enFmt;
+            }
+
+        vTimeArray2LLInt(suI106Hdr.aubyRefTime, &llRelTime);
+        if (!bAddPoint(psuMap, &suBuild, llRelTime, (int64_t)suTime.ulSecs * 10000000 + suTime.ulFrac))
+            {
+            enRetStatus = I106_BUFFER_TOO_SMALL;
+            break;
+            }
+        } // end while reading packets
+
+    if (psuMap->uNumPoints > 0)
+        vEndPiece(psuMap, &suBuild);
+
+    // Relative time normally only goes up, but a recorder restart can take
+    // it back. Lookups need the map in relative time order.
+    for (uPointIdx=1; uPointIdx<psuMap->uNumPoints; uPointIdx++)
+        if (psuMap->pasuPoints[uPointIdx].llRelTime < psuMap->pasuPoints[uPointIdx-1].llRelTime)
+            {
+            qsort(psuMap->pasuPoints, psuMap->uNumPoints, sizeof(SuTimeMapPoint), iComparePoints);
+            break;
+            }
+
+    free(pvBuff);
+    enI106Ch10SetPos(iI106Handle, llSavePos);
+
+    if ((enRetStatus == I106_OK) && (psuMap->uNumPoints == 0))
+        enRetStatus = I106_TIME_NOT_FOUND;
+
+    return enRetStatus;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get the time map. If a data file name is given then look for a time map
+// file beside it made from a data file the same size. If there isn't one,
+// make the map and write one for next time.
+
+EnI106Status enTimeMap_Get(SuTimeMap * psuMap, int iI106Handle, const char * szDataFile, int iTimeChan)
+    {
+    EnI106Status        enStatus;
+    char                szMapFile[1000];
+    int64_t             llFileSize;
+
+    if (psuMap->uNumPoints != 0)
+        return I106_OK;
+
+    // Try the time map file
+    llFileSize = -1;
+    if (szDataFile != NULL)
+        {
+        llFileSize = llGetFileSize(szDataFile);
+        vMakeMapFileName(szDataFile, szMapFile);
+        if ((llFileSize >= 0) && bReadMapFile(psuMap, szMapFile, llFileSize, iTimeChan))
+            return I106_OK;
+        }
+
+    // Do it the hard way
+    enStatus = enTimeMap_Make(psuMap, iI106Handle, iTimeChan);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    if (llFileSize >= 0)
+        {
+        psuMap->llFileSize = llFileSize;
+        if (!bWriteMapFile(psuMap, szMapFile))
+            fprintf(stderr, "Warning, can't write time map file '%s'\n", szMapFile);
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Relative time to clock time. Without a map this is the same as the
+// library call, using the time reference from the last time packet.
+
+EnI106Status enTimeMap_RelInt2IrigTime(SuTimeMap * psuMap, int iI106Handle, int64_t llRelTime,
+                                       SuIrig106Time * psuTime)
+    {
+    SuTimeMapPoint    * psuPoint;
+    uint32_t            uLow;
+    uint32_t            uHigh;
+    uint32_t            uMid;
+    int64_t             llTime;
+
+    if (psuMap->uNumPoints == 0)
+        return enI106_RelInt2IrigTime(iI106Handle, llRelTime, psuTime);
+
+    // Find the last point at or before the relative time. Before the first
+    // point the first piece is run backwards.
+    uLow  = 0;
+    uHigh = psuMap->uNumPoints;
+    while (uHigh - uLow > 1)
+        {
+        uMid = (uLow + uHigh) / 2;
+        if (psuMap->pasuPoints[uMid].llRelTime <= llRelTime)
+            uLow  = uMid;
+        else
+            uHigh = uMid;
+        }
+    psuPoint = &psuMap->pasuPoints[uLow];
+
+    llTime = psuPoint->llTime + llRound((double)(llRelTime - psuPoint->llRelTime) * psuPoint->dRate);
+
+    psuTime->ulSecs = (uint32_t)(llTime / 10000000);
+    psuTime->ulFrac = (uint32_t)(llTime % 10000000);
+    psuTime->enFmt  = psuMap->enDateFmt;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+EnI106Status enTimeMap_Rel2IrigTime(SuTimeMap * psuMap, int iI106Handle, uint8_t abyRelTime[],
+                                    SuIrig106Time * psuTime)
+    {
+    int64_t             llRelTime;
+
+    if (psuMap->uNumPoints == 0)
+        return enI106_Rel2IrigTime(iI106Handle, abyRelTime, psuTime);
+
+    vTimeArray2LLInt(abyRelTime, &llRelTime);
+
+    return enTimeMap_RelInt2IrigTime(psuMap, iI106Handle, llRelTime, psuTime);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Clock time to relative time. This assumes time goes up through the file.
+// If it jumps back the first matching piece is used.
+
+EnI106Status enTimeMap_Irig2RelInt(SuTimeMap * psuMap, int iI106Handle, SuIrig106Time * psuTime,
+                                   int64_t * pllRelTime)
+    {
+    EnI106Status        enStatus;
+    SuTimeMapPoint    * psuPoint;
+    uint8_t             abyRelTime[6];
+    uint32_t            uLow;
+    uint32_t            uHigh;
+    uint32_t            uMid;
+    int64_t             llTime;
+
+    if (psuMap->uNumPoints == 0)
+        {
+        enStatus = enI106_Irig2RelTime(iI106Handle, psuTime, abyRelTime);
+        *pllRelTime = 0L;
+        memcpy(pllRelTime, abyRelTime, 6);
+        return enStatus;
+        }
+
+    llTime = (int64_t)psuTime->ulSecs * 10000000 + psuTime->ulFrac;
+
+    // Find the last point at or before the clock time, assuming clock time
+    // goes up with relative time. Before the first point the first piece is
+    // run backwards.
+    uLow  = 0;
+    uHigh = psuMap->uNumPoints;
+    while (uHigh - uLow > 1)
+        {
+        uMid = (uLow + uHigh) / 2;
+        if (psuMap->pasuPoints[uMid].llTime <= llTime)
+            uLow  = uMid;
+        else
+            uHigh = uMid;
+        }
+    psuPoint = &psuMap->pasuPoints[uLow];
+
+    *pllRelTime = psuPoint->llRelTime + llRound((double)(llTime - psuPoint->llTime) / psuPoint->dRate);
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vTimeMap_Free(SuTimeMap * psuMap)
+    {
+    free(psuMap->pasuPoints);
+    vTimeMap_Init(psuMap);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Add a time packet to the map, either to the current piece or as the start
+// of a new one
+
+static int bAddPoint(SuTimeMap * psuMap, SuTimeMapBuild * psuBuild, int64_t llRelTime, int64_t llTime)
+    {
+    SuTimeMapPoint    * psuStart;
+    double              dRelDiff;
+    double              dRateLo;
+    double              dRateHi;
+
+    // See if the time packet fits the current piece
+    if (psuMap->uNumPoints > 0)
+        {
+        psuStart = &psuMap->pasuPoints[psuMap->uNumPoints - 1];
+        if (llRelTime > psuStart->llRelTime)
+            {
+            dRelDiff = (double)(llRelTime - psuStart->llRelTime);
+            dRateLo  = (double)(llTime - TIME_MAP_TOLERANCE - psuStart->llTime) / dRelDiff;
+            dRateHi  = (double)(llTime + TIME_MAP_TOLERANCE - psuStart->llTime) / dRelDiff;
+            if (psuBuild->uPiecePoints > 1)
+                {
+                if (dRateLo < psuBuild->dRateLo) dRateLo = psuBuild->dRateLo;
+                if (dRateHi > psuBuild->dRateHi) dRateHi = psuBuild->dRateHi;
+                }
+            if (dRateLo <= dRateHi)
+                {
+                psuBuild->dRateLo = dRateLo;
+                psuBuild->dRateHi = dRateHi;
+                psuBuild->uPiecePoints++;
+                return bTRUE;
+                }
+            }
+
+        vEndPiece(psuMap, psuBuild);
+        } // end if there's a current piece
+
+    // Start a new piece
+    if (psuMap->uNumPoints == psuMap->uMaxPoints)
+        {
+        if (psuMap->uMaxPoints >= MAP_MAX_POINTS)
+            return bFALSE;
+        psuMap->uMaxPoints = psuMap->uMaxPoints == 0 ? 256 : psuMap->uMaxPoints * 2;
+        psuStart = (SuTimeMapPoint *)realloc(psuMap->pasuPoints, psuMap->uMaxPoints * sizeof(SuTimeMapPoint));
+        if (psuStart == NULL)
+            return bFALSE;
+        psuMap->pasuPoints = psuStart;
+        }
+
+    psuStart = &psuMap->pasuPoints[psuMap->uNumPoints++];
+    psuStart->llRelTime = llRelTime;
+    psuStart->llTime    = llTime;
+    psuStart->dRate     = 1.0;
+    psuBuild->uPiecePoints = 1;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Set the rate for the piece just finished. A piece with only one time
+// packet carries on at the rate of the piece before it.
+
+static void vEndPiece(SuTimeMap * psuMap, SuTimeMapBuild * psuBuild)
+    {
+    SuTimeMapPoint    * psuStart;
+
+    psuStart = &psuMap->pasuPoints[psuMap->uNumPoints - 1];
+    if (psuBuild->uPiecePoints > 1)
+        psuStart->dRate = (psuBuild->dRateLo + psuBuild->dRateHi) / 2.0;
+    else if (psuMap->uNumPoints > 1)
+        psuStart->dRate = psuStart[-1].dRate;
+
+    psuBuild->uPiecePoints = 0;
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int iComparePoints(const void * pvPoint1, const void * pvPoint2)
+    {
+    const SuTimeMapPoint  * psuPoint1 = (const SuTimeMapPoint *)pvPoint1;
+    const SuTimeMapPoint  * psuPoint2 = (const SuTimeMapPoint *)pvPoint2;
+
+    if (psuPoint1->llRelTime < psuPoint2->llRelTime) return -1;
+    if (psuPoint1->llRelTime > psuPoint2->llRelTime) return  1;
+    return 0;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int64_t llRound(double dValue)
+    {
+    return (int64_t)(dValue >= 0.0 ? dValue + 0.5 : dValue - 0.5);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int64_t llGetFileSize(const char * szFile)
+    {
+#if defined(_MSC_VER)
+    struct _stati64     suFileInfo;
+    if (_stati64(szFile, &suFileInfo) != 0)
+        return -1;
+#else
+    struct stat         suFileInfo;
+    if (stat(szFile, &suFileInfo) != 0)
+        return -1;
+#endif
+
+    return (int64_t)suFileInfo.st_size;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The time map file is the data file name with a different extension
+
+static void vMakeMapFileName(const char * szDataFile, char * szMapFile)
+    {
+    char              * pchExt;
+
+    strcpy(szMapFile, szDataFile);
+    pchExt = strrchr(szMapFile, '.');
+    if ((pchExt != NULL) && (strchr(pchExt, '/') == NULL) && (strchr(pchExt, '\\') == NULL))
+        *pchExt = '\0';
+    strcat(szMapFile, TIME_MAP_EXT);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the time map file. It's only any good if it was made from a data
+// file the same size, and from the time channel asked for.
+
+static int bReadMapFile(SuTimeMap * psuMap, const char * szMapFile, int64_t llFileSize, int iTimeChan)
+    {
+    FILE                  * psuFile;
+    SuTimeMapFileHdr        suFileHdr;
+    SuTimeMapPoint        * pasuPoints;
+
+    psuFile = fopen(szMapFile, "rb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    if ((fread(&suFileHdr, sizeof(suFileHdr), 1, psuFile) != 1)                 ||
+        (memcmp(suFileHdr.szMagic, MAP_FILE_MAGIC, sizeof(suFileHdr.szMagic)) != 0) ||
+        (suFileHdr.llFileSize != llFileSize)                                    ||
+        ((iTimeChan != TIME_MAP_ANY_CHAN) && (suFileHdr.iTimeChan != iTimeChan)) ||
+        (suFileHdr.uNumPoints == 0)                                             ||
+        (suFileHdr.uNumPoints >  MAP_MAX_POINTS))
+        {
+        fclose(psuFile);
+        return bFALSE;
+        }
+
+    pasuPoints = (SuTimeMapPoint *)malloc(suFileHdr.uNumPoints * sizeof(SuTimeMapPoint));
+    if ((pasuPoints == NULL) ||
+        (fread(pasuPoints, sizeof(SuTimeMapPoint), suFileHdr.uNumPoints, psuFile) != suFileHdr.uNumPoints))
+        {
+        free(pasuPoints);
+        fclose(psuFile);
+        return bFALSE;
+        }
+    fclose(psuFile);
+
+    free(psuMap->pasuPoints);
+    psuMap->pasuPoints = pasuPoints;
+    psuMap->uNumPoints = suFileHdr.uNumPoints;
+    psuMap->uMaxPoints = suFileHdr.uNumPoints;
+    psuMap->iTimeChan  = suFileHdr.iTimeChan;
+    psuMap->enDateFmt  = (EnI106DateFmt)suFileHdr.uDateFmt;
+    psuMap->llFileSize = llFileSize;
+    psuMap->bFromFile  = bTRUE;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int bWriteMapFile(SuTimeMap * psuMap, const char * szMapFile)
+    {
+    FILE                  * psuFile;
+    SuTimeMapFileHdr        suFileHdr;
+    int                     bWriteOK;
+
+    psuFile = fopen(szMapFile, "wb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    memset(&suFileHdr, 0, sizeof(suFileHdr));
+    memcpy(suFileHdr.szMagic, MAP_FILE_MAGIC, sizeof(suFileHdr.szMagic));
+    suFileHdr.llFileSize = psuMap->llFileSize;
+    suFileHdr.iTimeChan  = psuMap->iTimeChan;
+    suFileHdr.uNumPoints = psuMap->uNumPoints;
+    suFileHdr.uDateFmt   = (uint32_t)psuMap->enDateFmt;
+
+    bWriteOK = (fwrite(&suFileHdr, sizeof(suFileHdr), 1, psuFile) == 1) &&
+               (fwrite(psuMap->pasuPoints, sizeof(SuTimeMapPoint), psuMap->uNumPoints, psuFile) == psuMap->uNumPoints);
+    if (fclose(psuFile) != 0)
+        bWriteOK = bFALSE;
+
+    // Don't leave a bad file around to trip up the next run
+    if (!bWriteOK)
+        remove(szMapFile);
+
+    return bWriteOK;
+    }
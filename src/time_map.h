@@ -0,0 +1,102 @@
+/*==========================================================================
+
+  time_map.h - Relative time counter to clock time table made from all
+    the time packets in a file, optionally saved beside the data file
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _TIME_MAP_H
+#define _TIME_MAP_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+#include "i106_time.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define TIME_MAP_EXT        ".rtm"      // Time map file extension
+#define TIME_MAP_TOLERANCE  100         // Largest fit error, 100 nsec units
+#define TIME_MAP_ANY_CHAN   -1          // Use the first time channel found
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// One straight line piece of the map. It holds from this relative time up
+// to the next point's relative time. Time is in 100 nsec units since 1970
+// so it has the same resolution as relative time.
+typedef struct
+    {
+    int64_t             llRelTime;
+    int64_t             llTime;
+    double              dRate;              // Time units per relative time count
+    } SuTimeMapPoint;                       // 24 bytes
+
+// The whole map, sorted by relative time. Lookups don't change it so
+// threads can share it.
+typedef struct
+    {
+    uint32_t            uNumPoints;         // 0 if not made
+    uint32_t            uMaxPoints;
+    SuTimeMapPoint    * pasuPoints;
+    int                 iTimeChan;          // Time channel the map was made from
+    EnI106DateFmt       enDateFmt;
+    int64_t             llFileSize;         // Data file size the map was made from
+    int                 bFromFile;          // Map read from file
+    } SuTimeMap;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vTimeMap_Init(SuTimeMap * psuMap);
+EnI106Status    enTimeMap_Make(SuTimeMap * psuMap, int iI106Handle, int iTimeChan);
+EnI106Status    enTimeMap_Get(SuTimeMap * psuMap, int iI106Handle, const char * szDataFile, int iTimeChan);
+EnI106Status    enTimeMap_RelInt2IrigTime(SuTimeMap * psuMap, int iI106Handle, int64_t llRelTime,
+                                          SuIrig106Time * psuTime);
+EnI106Status    enTimeMap_Rel2IrigTime(SuTimeMap * psuMap, int iI106Handle, uint8_t abyRelTime[],
+                                       SuIrig106Time * psuTime);
+EnI106Status    enTimeMap_Irig2RelInt(SuTimeMap * psuMap, int iI106Handle, SuIrig106Time * psuTime,
+                                      int64_t * pllRelTime);
+void            vTimeMap_Free(SuTimeMap * psuMap);
+
+#endif
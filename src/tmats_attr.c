@@ -0,0 +1,475 @@
+/*==========================================================================
+
+  tmats_attr.c - Hashed store of TMATS attributes made in one pass over the
+    TMATS text
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+/*
+The library TMATS decoder builds linked lists of records, and tools then
+walk those lists over and over to find the attributes for one channel. With
+thousands of attributes that gets slow. This module splits the TMATS text
+into "code:value;" pairs in one pass and hashes them on the full attribute
+code, which includes the record type, record index, and code name. The R
+record TK1 attributes are also indexed by track number so channel metadata
+is a single lookup.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+#include "tmats_attr.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define INITIAL_ATTRS       256
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static EnI106Status enAddAttr(SuTmatsAttrs * psuAttrs, char * szCode, char * szValue);
+static EnI106Status enMakeHash(SuTmatsAttrs * psuAttrs);
+static EnI106Status enMakeChanTable(SuTmatsAttrs * psuAttrs);
+static uint32_t     ulHashCode(const char * szCode);
+static int          bSameCode(const char * szCode1, const char * szCode2);
+static uint32_t     uHashSize(uint32_t uNumEntries);
+static char       * szTrim(char * szText, char * pchEnd);
+
+
+/* ======================================================================== */
+
+void vTmatsAttr_Init(SuTmatsAttrs * psuAttrs)
+    {
+    memset(psuAttrs, 0, sizeof(SuTmatsAttrs));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Split TMATS text into attributes. The text is copied so the caller's
+// buffer can be reused. Each "code:value;" is null terminated in place.
+
+EnI106Status enTmatsAttr_Parse(SuTmatsAttrs * psuAttrs, const void * pvText, uint32_t ulTextLen)
+    {
+    EnI106Status        enStatus;
+    char              * pchCurr;
+    char              * pchEnd;
+    char              * pchColon;
+    char              * pchSemi;
+
+    vTmatsAttr_Free(psuAttrs);
+
+    psuAttrs->pchText = (char *)malloc(ulTextLen + 1);
+    if (psuAttrs->pchText == NULL)
+        return I106_BUFFER_TOO_SMALL;
+    memcpy(psuAttrs->pchText, pvText, ulTextLen);
+    psuAttrs->pchText[ulTextLen] = '\0';
+
+    pchCurr = psuAttrs->pchText;
+    pchEnd  = psuAttrs->pchText + ulTextLen;
+    while (pchCurr < pchEnd)
+        {
+        // Attribute runs to the next semicolon, or to the end of the text
+        pchSemi = (char *)memchr(pchCurr, ';', pchEnd - pchCurr);
+        if (pchSemi == NULL)
+            pchSemi = pchEnd;
+        *pchSemi = '\0';
+
+        // Anything without a colon isn't an attribute so skip it
+        pchColon = (char *)memchr(pchCurr, ':', pchSemi - pchCurr);
+        if (pchColon != NULL)
+            {
+            *pchColon = '\0';
+            enStatus = enAddAttr(psuAttrs, szTrim(pchCurr, pchColon), szTrim(pchColon + 1, pchSemi));
+            if (enStatus != I106_OK)
+                {
+                vTmatsAttr_Free(psuAttrs);
+                return enStatus;
+                }
+            }
+
+        pchCurr = pchSemi + 1;
+        } // end while not end of text
+
+    enStatus = enMakeHash(psuAttrs);
+    if (enStatus == I106_OK)
+        enStatus = enMakeChanTable(psuAttrs);
+    if (enStatus != I106_OK)
+        vTmatsAttr_Free(psuAttrs);
+
+    return enStatus;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Parse the attributes from a TMATS packet, skipping the channel specific
+// data word
+
+EnI106Status enTmatsAttr_ParsePacket(SuTmatsAttrs * psuAttrs, SuI106Ch10Header * psuHdr, void * pvBuff)
+    {
+    if (psuHdr->ulDataLen < 4)
+        return I106_INVALID_DATA;
+
+    return enTmatsAttr_Parse(psuAttrs, &((char *)pvBuff)[4], psuHdr->ulDataLen - 4);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Look up an attribute value by its full code, e.g. "P-1\F1". Returns NULL
+// if there isn't one.
+
+const char * szTmatsAttr_Get(SuTmatsAttrs * psuAttrs, const char * szCode)
+    {
+    uint32_t            uHashMask;
+    uint32_t            uHashIdx;
+    int32_t             iAttrIdx;
+
+    if (psuAttrs->paiHash == NULL)
+        return NULL;
+
+    uHashMask = psuAttrs->uHashSize - 1;
+    uHashIdx  = ulHashCode(szCode) & uHashMask;
+    while ((iAttrIdx = psuAttrs->paiHash[uHashIdx]) != -1)
+        {
+        if (bSameCode(psuAttrs->pasuAttrs[iAttrIdx].szCode, szCode))
+            return psuAttrs->pasuAttrs[iAttrIdx].szValue;
+        uHashIdx = (uHashIdx + 1) & uHashMask;
+        }
+
+    return NULL;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Same as above but the code is made printf style, e.g. "R-%d\\CDT-%d"
+
+const char * szTmatsAttr_Getf(SuTmatsAttrs * psuAttrs, const char * szCodeFmt, ...)
+    {
+    va_list             args;
+    char                szCode[256];
+
+    va_start(args, szCodeFmt);
+    vsnprintf(szCode, sizeof(szCode), szCodeFmt, args);
+    va_end(args);
+    szCode[sizeof(szCode)-1] = '\0';
+
+    return szTmatsAttr_Get(psuAttrs, szCode);
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Find a recorder channel by its track number, NULL if not there
+
+SuTmatsAttrChan * psuTmatsAttr_FindChan(SuTmatsAttrs * psuAttrs, unsigned int uChanID)
+    {
+    uint32_t            uHashMask;
+    uint32_t            uHashIdx;
+    int32_t             iChanIdx;
+
+    if (psuAttrs->paiChanHash == NULL)
+        return NULL;
+
+    uHashMask = psuAttrs->uChanHashSize - 1;
+    uHashIdx  = (uChanID * 2654435761u) & uHashMask;
+    while ((iChanIdx = psuAttrs->paiChanHash[uHashIdx]) != -1)
+        {
+        if (psuAttrs->pasuChans[iChanIdx].uChanID == uChanID)
+            return &psuAttrs->pasuChans[iChanIdx];
+        uHashIdx = (uHashIdx + 1) & uHashMask;
+        }
+
+    return NULL;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vTmatsAttr_Free(SuTmatsAttrs * psuAttrs)
+    {
+    free(psuAttrs->pchText);
+    free(psuAttrs->pasuAttrs);
+    free(psuAttrs->paiHash);
+    free(psuAttrs->pasuChans);
+    free(psuAttrs->paiChanHash);
+    vTmatsAttr_Init(psuAttrs);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Add an attribute to the end of the list and break its code into parts
+
+static EnI106Status enAddAttr(SuTmatsAttrs * psuAttrs, char * szCode, char * szValue)
+    {
+    SuTmatsAttr       * psuAttr;
+    SuTmatsAttr       * pasuNewAttrs;
+    char              * pchNext;
+
+    if (szCode[0] == '\0')
+        return I106_OK;
+
+    if (psuAttrs->uNumAttrs >= psuAttrs->uMaxAttrs)
+        {
+        psuAttrs->uMaxAttrs = (psuAttrs->uMaxAttrs == 0) ? INITIAL_ATTRS : psuAttrs->uMaxAttrs * 2;
+        pasuNewAttrs = (SuTmatsAttr *)realloc(psuAttrs->pasuAttrs, psuAttrs->uMaxAttrs * sizeof(SuTmatsAttr));
+        if (pasuNewAttrs == NULL)
+            return I106_BUFFER_TOO_SMALL;
+        psuAttrs->pasuAttrs = pasuNewAttrs;
+        }
+
+    psuAttr = &psuAttrs->pasuAttrs[psuAttrs->uNumAttrs++];
+    psuAttr->szCode     = szCode;
+    psuAttr->szValue    = szValue;
+    psuAttr->szCodeName = szCode;
+    psuAttr->chRecType  = (char)toupper((unsigned char)szCode[0]);
+    psuAttr->iRecIdx    = -1;
+
+    // Record type is one letter, then "-index" for all but the G record,
+    // then "\" and the code name. Anything else (e.g. COMMENT) is left whole.
+    pchNext = &szCode[1];
+    if (*pchNext == '-')
+        {
+        psuAttr->iRecIdx = (int)strtol(pchNext + 1, &pchNext, 10);
+        }
+    if (*pchNext == '\\')
+        psuAttr->szCodeName = pchNext + 1;
+    else
+        {
+        psuAttr->chRecType = '\0';
+        psuAttr->iRecIdx   = -1;
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Hash all the attributes on their full code. If a code is repeated the
+// last one wins.
+
+static EnI106Status enMakeHash(SuTmatsAttrs * psuAttrs)
+    {
+    uint32_t            uAttrIdx;
+    uint32_t            uHashMask;
+    uint32_t            uHashIdx;
+    int32_t             iOldIdx;
+
+    psuAttrs->uHashSize = uHashSize(psuAttrs->uNumAttrs);
+    psuAttrs->paiHash   = (int32_t *)malloc(psuAttrs->uHashSize * sizeof(int32_t));
+    if (psuAttrs->paiHash == NULL)
+        return I106_BUFFER_TOO_SMALL;
+    memset(psuAttrs->paiHash, 0xff, psuAttrs->uHashSize * sizeof(int32_t));
+
+    uHashMask = psuAttrs->uHashSize - 1;
+    for (uAttrIdx=0; uAttrIdx<psuAttrs->uNumAttrs; uAttrIdx++)
+        {
+        uHashIdx = ulHashCode(psuAttrs->pasuAttrs[uAttrIdx].szCode) & uHashMask;
+        while ((iOldIdx = psuAttrs->paiHash[uHashIdx]) != -1)
+            {
+            if (bSameCode(psuAttrs->pasuAttrs[iOldIdx].szCode, psuAttrs->pasuAttrs[uAttrIdx].szCode))
+                break;
+            uHashIdx = (uHashIdx + 1) & uHashMask;
+            }
+        psuAttrs->paiHash[uHashIdx] = (int32_t)uAttrIdx;
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Every R-x\TK1-n attribute is a recorder channel. Look up the rest of its
+// attributes once here so users don't need to.
+
+static EnI106Status enMakeChanTable(SuTmatsAttrs * psuAttrs)
+    {
+    uint32_t            uAttrIdx;
+    SuTmatsAttr       * psuAttr;
+    SuTmatsAttrChan   * psuChan;
+    uint32_t            uHashMask;
+    uint32_t            uHashIdx;
+    uint32_t            uChanIdx;
+
+    // Count the channels first so the table only gets allocated once
+    psuAttrs->uNumChans = 0;
+    for (uAttrIdx=0; uAttrIdx<psuAttrs->uNumAttrs; uAttrIdx++)
+        {
+        psuAttr = &psuAttrs->pasuAttrs[uAttrIdx];
+        if ((psuAttr->chRecType == 'R') && (strncmp(psuAttr->szCodeName, "TK1-", 4) == 0))
+            psuAttrs->uNumChans++;
+        }
+
+    psuAttrs->pasuChans     = (SuTmatsAttrChan *)calloc(psuAttrs->uNumChans + 1, sizeof(SuTmatsAttrChan));
+    psuAttrs->uChanHashSize = uHashSize(psuAttrs->uNumChans);
+    psuAttrs->paiChanHash   = (int32_t *)malloc(psuAttrs->uChanHashSize * sizeof(int32_t));
+    if ((psuAttrs->pasuChans == NULL) || (psuAttrs->paiChanHash == NULL))
+        return I106_BUFFER_TOO_SMALL;
+    memset(psuAttrs->paiChanHash, 0xff, psuAttrs->uChanHashSize * sizeof(int32_t));
+
+    uChanIdx  = 0;
+    uHashMask = psuAttrs->uChanHashSize - 1;
+    for (uAttrIdx=0; uAttrIdx<psuAttrs->uNumAttrs; uAttrIdx++)
+        {
+        psuAttr = &psuAttrs->pasuAttrs[uAttrIdx];
+        if ((psuAttr->chRecType != 'R') || (strncmp(psuAttr->szCodeName, "TK1-", 4) != 0))
+            continue;
+
+        psuChan = &psuAttrs->pasuChans[uChanIdx];
+        psuChan->uChanID        = (uint32_t)strtoul(psuAttr->szValue, NULL, 10);
+        psuChan->iRIndex        = psuAttr->iRecIdx;
+        psuChan->iDsiIndex      = atoi(&psuAttr->szCodeName[4]);
+        psuChan->szChanType     = szTmatsAttr_Getf(psuAttrs, "R-%d\\CDT-%d", psuChan->iRIndex, psuChan->iDsiIndex);
+        psuChan->szDataSourceID = szTmatsAttr_Getf(psuAttrs, "R-%d\\DSI-%d", psuChan->iRIndex, psuChan->iDsiIndex);
+        psuChan->szEnabled      = szTmatsAttr_Getf(psuAttrs, "R-%d\\CHE-%d", psuChan->iRIndex, psuChan->iDsiIndex);
+
+        // First definition of a track number wins
+        uHashIdx = (psuChan->uChanID * 2654435761u) & uHashMask;
+        while (psuAttrs->paiChanHash[uHashIdx] != -1)
+            {
+            if (psuAttrs->pasuChans[psuAttrs->paiChanHash[uHashIdx]].uChanID == psuChan->uChanID)
+                break;
+            uHashIdx = (uHashIdx + 1) & uHashMask;
+            }
+        if (psuAttrs->paiChanHash[uHashIdx] == -1)
+            psuAttrs->paiChanHash[uHashIdx] = (int32_t)uChanIdx;
+
+        uChanIdx++;
+        } // end for all attributes
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// FNV-1a hash, case insensitive since TMATS codes are
+
+static uint32_t ulHashCode(const char * szCode)
+    {
+    uint32_t            ulHash = 2166136261u;
+
+    while (*szCode != '\0')
+        {
+        ulHash ^= (uint32_t)toupper((unsigned char)*szCode++);
+        ulHash *= 16777619u;
+        }
+
+    return ulHash;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int bSameCode(const char * szCode1, const char * szCode2)
+    {
+    while (toupper((unsigned char)*szCode1) == toupper((unsigned char)*szCode2))
+        {
+        if (*szCode1 == '\0')
+            return bTRUE;
+        szCode1++;
+        szCode2++;
+        }
+
+    return bFALSE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Hash table size, a power of two at least twice the number of entries
+
+static uint32_t uHashSize(uint32_t uNumEntries)
+    {
+    uint32_t            uSize = 16;
+
+    while (uSize < uNumEntries * 2)
+        uSize *= 2;
+
+    return uSize;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Trim leading and trailing white space, including the CR/LF between
+// attributes. pchEnd points to the terminating null.
+
+static char * szTrim(char * szText, char * pchEnd)
+    {
+    while ((szText < pchEnd) && isspace((unsigned char)*szText))
+        szText++;
+    while ((pchEnd > szText) && isspace((unsigned char)pchEnd[-1]))
+        *--pchEnd = '\0';
+
+    return szText;
+    }
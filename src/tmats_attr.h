@@ -0,0 +1,102 @@
+/*==========================================================================
+
+  tmats_attr.h - Hashed store of TMATS attributes made in one pass over the
+    TMATS text
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _TMATS_ATTR_H
+#define _TMATS_ATTR_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// One "code:value;" attribute. The code is split into its parts, so
+// "R-1\TK1-3" is record type 'R', record index 1, code name "TK1-3".
+typedef struct
+    {
+    char              * szCode;             // Full attribute code
+    char              * szValue;
+    char              * szCodeName;         // Code after the record type and index
+    char                chRecType;          // 'G', 'R', 'P', etc.
+    int                 iRecIdx;            // -1 if the record has no index
+    } SuTmatsAttr;
+
+// One recorder channel from the R record TK1 attributes, with the other
+// per channel attributes already looked up
+typedef struct
+    {
+    uint32_t            uChanID;            // Track number
+    int                 iRIndex;            // R record index
+    int                 iDsiIndex;          // Data source index within the R record
+    const char        * szChanType;         // R-x\CDT-n
+    const char        * szDataSourceID;     // R-x\DSI-n
+    const char        * szEnabled;          // R-x\CHE-n
+    } SuTmatsAttrChan;
+
+typedef struct
+    {
+    char              * pchText;            // Private copy of the TMATS text
+    uint32_t            uNumAttrs;
+    uint32_t            uMaxAttrs;
+    SuTmatsAttr       * pasuAttrs;          // In TMATS order
+    uint32_t            uHashSize;          // Always a power of two
+    int32_t           * paiHash;            // Index into pasuAttrs, -1 if empty
+    uint32_t            uNumChans;
+    SuTmatsAttrChan   * pasuChans;          // In TMATS order
+    uint32_t            uChanHashSize;
+    int32_t           * paiChanHash;        // Index into pasuChans, -1 if empty
+    } SuTmatsAttrs;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void                vTmatsAttr_Init(SuTmatsAttrs * psuAttrs);
+EnI106Status        enTmatsAttr_Parse(SuTmatsAttrs * psuAttrs, const void * pvText, uint32_t ulTextLen);
+EnI106Status        enTmatsAttr_ParsePacket(SuTmatsAttrs * psuAttrs, SuI106Ch10Header * psuHdr, void * pvBuff);
+const char        * szTmatsAttr_Get(SuTmatsAttrs * psuAttrs, const char * szCode);
+const char        * szTmatsAttr_Getf(SuTmatsAttrs * psuAttrs, const char * szCodeFmt, ...);
+SuTmatsAttrChan   * psuTmatsAttr_FindChan(SuTmatsAttrs * psuAttrs, unsigned int uChanID);
+void                vTmatsAttr_Free(SuTmatsAttrs * psuAttrs);
+
+#endif
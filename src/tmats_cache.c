@@ -0,0 +1,404 @@
+/*==========================================================================
+
+  tmats_cache.c - Decode a TMATS record once and keep a compact channel
+    table, optionally saved in a file beside the data file
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+#include "i106_decode_tmats.h"
+
+#include "tmats_attr.h"
+#include "tmats_cache.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#if !defined(bTRUE)
+#define bTRUE   (1==1)
+#define bFALSE  (1==0)
+#endif
+
+#define CACHE_FILE_MAGIC    "I106TMC1"
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// Channel table file header. The TMATS signature and length are the key
+// that ties the file to the TMATS record it was made from. An array of
+// SuTmatsChan follows.
+typedef struct
+    {
+    char                szMagic[8];
+    uint32_t            ulTmatsLen;
+    uint32_t            ulSignature;
+    uint16_t            uOpCode;
+    uint16_t            uReserved;
+    uint32_t            uNumChans;
+    char                szProgramName[64];
+    char                szIrig106Rev[16];
+    } SuTmatsCacheFileHdr;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+static void    vMakeChanTable(SuTmatsCache * psuCache);
+static void    vMakeCacheFileName(const char * szDataFile, char * szCacheFile);
+static int     bReadCacheFile(SuTmatsCache * psuCache, const char * szCacheFile);
+static int     bWriteCacheFile(SuTmatsCache * psuCache, const char * szCacheFile);
+static void    vCopyString(char * szDest, const char * szSrc, size_t iDestSize);
+
+
+/* ======================================================================== */
+
+void vTmatsCache_Init(SuTmatsCache * psuCache)
+    {
+    memset(psuCache, 0, sizeof(SuTmatsCache));
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Decode the TMATS record into the library TMATS tree if it hasn't been
+// decoded already
+
+EnI106Status enTmatsCache_Decode(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff)
+    {
+    EnI106Status        enStatus;
+
+    if (psuCache->bDecoded)
+        return I106_OK;
+
+    memset(&psuCache->suTmatsInfo, 0, sizeof(SuTmatsInfo));
+    enStatus = enI106_Decode_Tmats(psuHdr, pvBuff, &psuCache->suTmatsInfo);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuCache->bDecoded   = bTRUE;
+    psuCache->ulTmatsLen = psuHdr->ulDataLen - 4;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Split the TMATS record into the hashed attribute store if it hasn't been
+// done already
+
+EnI106Status enTmatsCache_Attrs(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff)
+    {
+    EnI106Status        enStatus;
+
+    if (psuCache->bParsed)
+        return I106_OK;
+
+    enStatus = enTmatsAttr_ParsePacket(&psuCache->suAttrs, psuHdr, pvBuff);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuCache->bParsed    = bTRUE;
+    psuCache->ulTmatsLen = psuHdr->ulDataLen - 4;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Figure out the TMATS signature. This is quick compared to decoding.
+
+EnI106Status enTmatsCache_Signature(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff)
+    {
+    EnI106Status        enStatus;
+
+    if (psuCache->bHaveSignature)
+        return I106_OK;
+
+    enStatus = enI106_Tmats_Signature(&((char *)pvBuff)[4], psuHdr->ulDataLen-4,
+        TMATS_SIGVER_DEFAULT, TMATS_SIGFLAG_NONE, &psuCache->uOpCode, &psuCache->ulSignature);
+    if (enStatus != I106_OK)
+        return enStatus;
+
+    psuCache->bHaveSignature = bTRUE;
+    psuCache->ulTmatsLen     = psuHdr->ulDataLen - 4;
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Get the channel table. If a data file name is given then look for a
+// channel table file beside it made from the same TMATS record. If there
+// isn't one, make it from the TMATS attributes and write one for next time.
+
+EnI106Status enTmatsCache_ChanTable(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff,
+                                    const char * szDataFile)
+    {
+    EnI106Status        enStatus;
+    char                szCacheFile[1000];
+
+    if (psuCache->pasuChans != NULL)
+        return I106_OK;
+
+    // Try the channel table file
+    if (szDataFile != NULL)
+        {
+        vMakeCacheFileName(szDataFile, szCacheFile);
+        if ((enTmatsCache_Signature(psuCache, psuHdr, pvBuff) == I106_OK) &&
+            bReadCacheFile(psuCache, szCacheFile))
+            return I106_OK;
+        }
+
+    // Do it the hard way
+    enStatus = enTmatsCache_Attrs(psuCache, psuHdr, pvBuff);
+    if (enStatus != I106_OK)
+        return enStatus;
+    vMakeChanTable(psuCache);
+    if (psuCache->pasuChans == NULL)
+        return I106_BUFFER_TOO_SMALL;
+
+    if ((szDataFile != NULL) && psuCache->bHaveSignature)
+        {
+        if (!bWriteCacheFile(psuCache, szCacheFile))
+            fprintf(stderr, "Warning, can't write TMATS channel table file '%s'\n", szCacheFile);
+        }
+
+    return I106_OK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Find a channel in the channel table, NULL if not there
+
+SuTmatsChan * psuTmatsCache_FindChan(SuTmatsCache * psuCache, unsigned int uChanID)
+    {
+    uint32_t            uChanIdx;
+
+    for (uChanIdx=0; uChanIdx<psuCache->uNumChans; uChanIdx++)
+        if (psuCache->pasuChans[uChanIdx].uChanID == uChanID)
+            return &psuCache->pasuChans[uChanIdx];
+
+    return NULL;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+void vTmatsCache_Free(SuTmatsCache * psuCache)
+    {
+    if (psuCache->bDecoded)
+        enI106_Free_TmatsInfo(&psuCache->suTmatsInfo);
+    vTmatsAttr_Free(&psuCache->suAttrs);
+    free(psuCache->pasuChans);
+    vTmatsCache_Init(psuCache);
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Copy the recorder channels out of the TMATS attribute store
+
+static void vMakeChanTable(SuTmatsCache * psuCache)
+    {
+    SuTmatsAttrs      * psuAttrs;
+    SuTmatsAttrChan   * psuAttrChan;
+    SuTmatsChan       * psuChan;
+    uint32_t            uChanIdx;
+
+    psuAttrs = &psuCache->suAttrs;
+    vCopyString(psuCache->szProgramName, szTmatsAttr_Get(psuAttrs, "G\\PN"),  sizeof(psuCache->szProgramName));
+    vCopyString(psuCache->szIrig106Rev,  szTmatsAttr_Get(psuAttrs, "G\\106"), sizeof(psuCache->szIrig106Rev));
+
+    psuCache->uNumChans = 0;
+    psuCache->pasuChans = (SuTmatsChan *)calloc(psuAttrs->uNumChans + 1, sizeof(SuTmatsChan));
+    if (psuCache->pasuChans == NULL)
+        return;
+
+    for (uChanIdx=0; uChanIdx<psuAttrs->uNumChans; uChanIdx++)
+        {
+        psuAttrChan = &psuAttrs->pasuChans[uChanIdx];
+        psuChan     = &psuCache->pasuChans[psuCache->uNumChans++];
+        psuChan->uChanID  = psuAttrChan->uChanID;
+        psuChan->bEnabled = (psuAttrChan->szEnabled != NULL) && (psuAttrChan->szEnabled[0] == 'T');
+        vCopyString(psuChan->szChanType,     psuAttrChan->szChanType,     sizeof(psuChan->szChanType));
+        vCopyString(psuChan->szDataSourceID, psuAttrChan->szDataSourceID, sizeof(psuChan->szDataSourceID));
+        } // end for each recorder channel
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// The channel table file is the data file name with a different extension
+
+static void vMakeCacheFileName(const char * szDataFile, char * szCacheFile)
+    {
+    char              * pchExt;
+
+    strcpy(szCacheFile, szDataFile);
+    pchExt = strrchr(szCacheFile, '.');
+    if ((pchExt != NULL) && (strchr(pchExt, '/') == NULL) && (strchr(pchExt, '\\') == NULL))
+        *pchExt = '\0';
+    strcat(szCacheFile, TMATS_CACHE_EXT);
+
+    return;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Read the channel table file. It's only any good if it was made from a
+// TMATS record with the same signature and length.
+
+static int bReadCacheFile(SuTmatsCache * psuCache, const char * szCacheFile)
+    {
+    FILE                  * psuFile;
+    SuTmatsCacheFileHdr     suFileHdr;
+    SuTmatsChan           * pasuChans;
+
+    psuFile = fopen(szCacheFile, "rb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    if ((fread(&suFileHdr, sizeof(suFileHdr), 1, psuFile) != 1)                 ||
+        (memcmp(suFileHdr.szMagic, CACHE_FILE_MAGIC, sizeof(suFileHdr.szMagic)) != 0) ||
+        (suFileHdr.ulTmatsLen  != psuCache->ulTmatsLen)                         ||
+        (suFileHdr.ulSignature != psuCache->ulSignature)                        ||
+        (suFileHdr.uOpCode     != psuCache->uOpCode)                            ||
+        (suFileHdr.uNumChans   >  0x10000))
+        {
+        fclose(psuFile);
+        return bFALSE;
+        }
+
+    pasuChans = (SuTmatsChan *)calloc(suFileHdr.uNumChans + 1, sizeof(SuTmatsChan));
+    if ((pasuChans == NULL) ||
+        (fread(pasuChans, sizeof(SuTmatsChan), suFileHdr.uNumChans, psuFile) != suFileHdr.uNumChans))
+        {
+        free(pasuChans);
+        fclose(psuFile);
+        return bFALSE;
+        }
+    fclose(psuFile);
+
+    vCopyString(psuCache->szProgramName, suFileHdr.szProgramName, sizeof(psuCache->szProgramName));
+    vCopyString(psuCache->szIrig106Rev,  suFileHdr.szIrig106Rev,  sizeof(psuCache->szIrig106Rev));
+    psuCache->uNumChans = suFileHdr.uNumChans;
+    psuCache->pasuChans = pasuChans;
+    psuCache->bFromFile = bTRUE;
+
+    return bTRUE;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static int bWriteCacheFile(SuTmatsCache * psuCache, const char * szCacheFile)
+    {
+    FILE                  * psuFile;
+    SuTmatsCacheFileHdr     suFileHdr;
+    int                     bWriteOK;
+
+    psuFile = fopen(szCacheFile, "wb");
+    if (psuFile == NULL)
+        return bFALSE;
+
+    memset(&suFileHdr, 0, sizeof(suFileHdr));
+    memcpy(suFileHdr.szMagic, CACHE_FILE_MAGIC, sizeof(suFileHdr.szMagic));
+    suFileHdr.ulTmatsLen  = psuCache->ulTmatsLen;
+    suFileHdr.ulSignature = psuCache->ulSignature;
+    suFileHdr.uOpCode     = psuCache->uOpCode;
+    suFileHdr.uNumChans   = psuCache->uNumChans;
+    vCopyString(suFileHdr.szProgramName, psuCache->szProgramName, sizeof(suFileHdr.szProgramName));
+    vCopyString(suFileHdr.szIrig106Rev,  psuCache->szIrig106Rev,  sizeof(suFileHdr.szIrig106Rev));
+
+    bWriteOK = (fwrite(&suFileHdr, sizeof(suFileHdr), 1, psuFile) == 1) &&
+               (fwrite(psuCache->pasuChans, sizeof(SuTmatsChan), psuCache->uNumChans, psuFile) == psuCache->uNumChans);
+    if (fclose(psuFile) != 0)
+        bWriteOK = bFALSE;
+
+    // Don't leave a bad file around to trip up the next run
+    if (!bWriteOK)
+        remove(szCacheFile);
+
+    return bWriteOK;
+    }
+
+
+
+/* ------------------------------------------------------------------------ */
+
+// Copy a string that may be NULL or too long
+
+static void vCopyString(char * szDest, const char * szSrc, size_t iDestSize)
+    {
+    if (szSrc == NULL)
+        szDest[0] = '\0';
+    else
+        {
+        strncpy(szDest, szSrc, iDestSize - 1);
+        szDest[iDestSize - 1] = '\0';
+        }
+    return;
+    }
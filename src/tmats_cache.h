@@ -0,0 +1,106 @@
+/*==========================================================================
+
+  tmats_cache.h - Decode a TMATS record once and keep a compact channel
+    table, optionally saved in a file beside the data file
+
+ Copyright (c) 2019 Irig106.org
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+   * Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+
+   * Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in the
+     documentation and/or other materials provided with the distribution.
+
+   * Neither the name Irig106.org nor the names of its contributors may
+     be used to endorse or promote products derived from this software
+     without specific prior written permission.
+
+ This software is provided by the copyright holders and contributors
+ "as is" and any express or implied warranties, including, but not
+ limited to, the implied warranties of merchantability and fitness for
+ a particular purpose are disclaimed. In no event shall the copyright
+ owner or contributors be liable for any direct, indirect, incidental,
+ special, exemplary, or consequential damages (including, but not
+ limited to, procurement of substitute goods or services; loss of use,
+ data, or profits; or business interruption) however caused and on any
+ theory of liability, whether in contract, strict liability, or tort
+ (including negligence or otherwise) arising in any way out of the use
+ of this software, even if advised of the possibility of such damage.
+
+ ****************************************************************************/
+
+#ifndef _TMATS_CACHE_H
+#define _TMATS_CACHE_H
+
+#include "i106_stdint.h"
+#include "irig106ch10.h"
+#include "i106_decode_tmats.h"
+
+#include "tmats_attr.h"
+
+
+/*
+ * Macros and definitions
+ * ----------------------
+ */
+
+#define TMATS_CACHE_EXT     ".tmc"      // Channel table file extension
+
+
+/*
+ * Data structures
+ * ---------------
+ */
+
+// One recorder channel from the R records
+typedef struct
+    {
+    uint32_t            uChanID;            // Track number
+    uint32_t            bEnabled;
+    char                szChanType[32];     // Channel data type, "1553IN", "PCMIN", etc.
+    char                szDataSourceID[32];
+    } SuTmatsChan;
+
+// Everything known about one TMATS record. The channel table comes either
+// from the TMATS attribute store or from the channel table file. The full
+// decoded TMATS info is only there if it was decoded.
+typedef struct
+    {
+    int                 bDecoded;           // suTmatsInfo is valid
+    SuTmatsInfo         suTmatsInfo;
+    int                 bParsed;            // suAttrs is valid
+    SuTmatsAttrs        suAttrs;
+    int                 bHaveSignature;
+    uint16_t            uOpCode;
+    uint32_t            ulSignature;
+    uint32_t            ulTmatsLen;         // TMATS text length
+    int                 bFromFile;          // Channel table read from file
+    char                szProgramName[64];
+    char                szIrig106Rev[16];
+    uint32_t            uNumChans;
+    SuTmatsChan       * pasuChans;          // NULL until made
+    } SuTmatsCache;
+
+
+/*
+ * Function prototypes
+ * -------------------
+ */
+
+void            vTmatsCache_Init(SuTmatsCache * psuCache);
+EnI106Status    enTmatsCache_Decode(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff);
+EnI106Status    enTmatsCache_Attrs(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff);
+EnI106Status    enTmatsCache_Signature(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff);
+EnI106Status    enTmatsCache_ChanTable(SuTmatsCache * psuCache, SuI106Ch10Header * psuHdr, void * pvBuff,
+                                       const char * szDataFile);
+SuTmatsChan   * psuTmatsCache_FindChan(SuTmatsCache * psuCache, unsigned int uChanID);
+void            vTmatsCache_Free(SuTmatsCache * psuCache);
+
+#endif